@@ -12,7 +12,7 @@ greaterThan(QT_MAJOR_VERSION, 4) {
     win32:INCLUDEPATH +="$$PWD/winlib/includes/poppler/qt5"
     win32:INCLUDEPATH+= "$$PWD/winlib/includes"
     win32:LIBS += -L"$$PWD/winlib" -lpoppler-qt5
-    unix:LIBS +=    -lcurl \
+    unix:LIBS +=    -lcurl -lz \
                -lpthread -L/usr/lib -lpoppler-qt5 -g -rdynamic
     win32:LIBS += -L"$$PWD/winlib" -lpoppler-qt5 -ltidy
     win32:RC_ICONS += "$$PWD/images/windowIcon.ico"
@@ -23,7 +23,7 @@ equals(QT_MAJOR_VERSION, 4) {
     QT       += core gui webkit sql network xml script
     INCLUDEPATH += /usr/include/poppler/qt4
 #    INCLUDEPATH += /usr/include/tidy
-    LIBS +=    -lcurl \
+    LIBS +=    -lcurl -lz \
                -lpthread -L/usr/lib -lpoppler-qt4 -g -rdynamic
 }
 
@@ -75,9 +75,13 @@ SOURCES += main.cpp\
     sql/usertable.cpp \
     sql/tagtable.cpp \
     sql/searchtable.cpp \
+    sql/trigramtable.cpp \
+    sql/indexhashtable.cpp \
+    sql/searchtexttable.cpp \
     gui/nsearchview.cpp \
     models/notemodel.cpp \
     gui/nmainmenubar.cpp \
+    gui/workstatuslabel.cpp \
     gui/nsearchviewitem.cpp \
     gui/ntagview.cpp \
     gui/ntagviewitem.cpp \
@@ -104,7 +108,14 @@ SOURCES += main.cpp\
     models/notecache.cpp \
     gui/nbrowserwindow.cpp \
     threads/indexrunner.cpp \
+    threads/workmetrics.cpp \
+    threads/metricsquery.cpp \
+    threads/syncchunkfetcher.cpp \
+    threads/noteuploader.cpp \
+    threads/indexjob.cpp \
+    threads/indexaccumulator.cpp \
     html/tagscanner.cpp \
+    html/enmltext.cpp \
     xml/importdata.cpp \
     sql/notemetadata.cpp \
     sql/sharednotebooktable.cpp \
@@ -146,6 +157,7 @@ SOURCES += main.cpp\
     dialog/databasestatus.cpp \
     gui/plugins/popplergraphicsview.cpp \
     threads/counterrunner.cpp \
+    threads/searchrunner.cpp \
     gui/nnotebookviewdelegate.cpp \
     gui/ntrashviewdelegate.cpp \
     gui/ntagviewdelegate.cpp \
@@ -206,6 +218,11 @@ SOURCES += main.cpp\
     gui/browserWidgets/fontsizecombobox.cpp \
     utilities/pixelconverter.cpp \
     utilities/noteindexer.cpp \
+    utilities/textfolding.cpp \
+    utilities/zipreader.cpp \
+    utilities/officetext.cpp \
+    utilities/pdftextcache.cpp \
+    utilities/systemload.cpp \
     xml/batchimport.cpp \
     sql/databaseupgrade.cpp \
     email/emailaddress.cpp \
@@ -240,6 +257,7 @@ SOURCES += main.cpp\
     dialog/noteproperties.cpp \
     dialog/shortcutdialog.cpp \
     cmdtools/signalgui.cpp \
+    cmdtools/searchbenchmark.cpp \
     gui/browserWidgets/table/tablepropertiesdialog.cpp \
     threads/browserrunner.cpp \
     exits/exitpoint.cpp \
@@ -265,9 +283,13 @@ HEADERS  += nixnote.h \
     sql/usertable.h \
     sql/tagtable.h \
     sql/searchtable.h \
+    sql/trigramtable.h \
+    sql/indexhashtable.h \
+    sql/searchtexttable.h \
     gui/nsearchview.h \
     models/notemodel.h \
     gui/nmainmenubar.h \
+    gui/workstatuslabel.h \
     gui/nsearchviewitem.h \
     gui/ntagview.h \
     gui/ntagviewitem.h \
@@ -291,10 +313,18 @@ HEADERS  += nixnote.h \
     filters/filtercriteria.h \
     gui/ntrashtree.h \
     filters/filterengine.h \
+    filters/searchhit.h \
     models/notecache.h \
     gui/nbrowserwindow.h \
     threads/indexrunner.h \
+    threads/workmetrics.h \
+    threads/metricsquery.h \
+    threads/syncchunkfetcher.h \
+    threads/noteuploader.h \
+    threads/indexjob.h \
+    threads/indexaccumulator.h \
     html/tagscanner.h \
+    html/enmltext.h \
     xml/importdata.h \
     sql/notemetadata.h \
     sql/sharednotebooktable.h \
@@ -336,6 +366,7 @@ HEADERS  += nixnote.h \
     dialog/databasestatus.h \
     gui/plugins/popplergraphicsview.h \
     threads/counterrunner.h \
+    threads/searchrunner.h \
     gui/nnotebookviewdelegate.h \
     gui/ntrashviewdelegate.h \
     gui/ntagviewdelegate.h \
@@ -405,6 +436,11 @@ HEADERS  += nixnote.h \
     gui/browserWidgets/fontsizecombobox.h \
     utilities/pixelconverter.h \
     utilities/noteindexer.h \
+    utilities/textfolding.h \
+    utilities/zipreader.h \
+    utilities/officetext.h \
+    utilities/pdftextcache.h \
+    utilities/systemload.h \
     xml/batchimport.h \
     sql/databaseupgrade.h \
     email/emailaddress.h \
@@ -442,6 +478,7 @@ HEADERS  += nixnote.h \
     dialog/noteproperties.h \
     dialog/shortcutdialog.h \
     cmdtools/signalgui.h \
+    cmdtools/searchbenchmark.h \
     gui/browserWidgets/table/tablepropertiesdialog.h \
     dialog/preferences/appearancepreferences.h \
     dialog/preferences/debugpreferences.h \
@@ -489,3 +526,13 @@ help.path = $$PREFIX/share/nixnote2/help
 help.files = help/*
 
 INSTALLS = binary desktop images java translations qss pixmap help
+
+
+# "make benchmark" creates a synthetic account in a scratch directory &
+# times the search suite against it.  Extra options (--notes=50000 ...)
+# can be passed with BENCHMARK_ARGS.
+benchmark.depends = $(TARGET)
+benchmark.commands = rm -rf $$OUT_PWD/benchmark && \
+    QT_QPA_PLATFORM=offscreen $$OUT_PWD/$(TARGET) searchBenchmark --configDir=$$OUT_PWD/benchmark/ \
+    --output=$$OUT_PWD/search-benchmark.json $(BENCHMARK_ARGS)
+QMAKE_EXTRA_TARGETS += benchmark
@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "global.h"
 #include <iostream>
 #include <unistd.h>
+#include <QDir>
 #include "html/enmlformatter.h"
 #include "utilities/crossmemorymapper.h"
 #include "filters/filtercriteria.h"
@@ -121,6 +122,9 @@ int CmdLineTool::run(StartupConfig &config) {
     if (config.signalOtherGui()) {
         return signalGui(config);
     }
+    if (config.searchBenchmark()) {
+        return searchBenchmark(config);
+    }
     return 0;
 }
 
@@ -817,3 +821,29 @@ int CmdLineTool::signalGui(StartupConfig config) {
 
     return 0;
 }
+
+
+
+// Time the searches against a generated account.  This always works on the
+// database directly; it makes no sense to ask a running NixNote to do it.
+int CmdLineTool::searchBenchmark(StartupConfig config) {
+    if (QDir(config.homeDirPath) == QDir(QDir().homePath() + QString("/.nixnote/"))) {
+        std::cout << QString(tr("Use --configDir to give an empty directory for the benchmark account.")).toStdString() << std::endl;
+        return 16;
+    }
+    global.db = new DatabaseConnection("nixnote");  // Startup the database
+
+    // A new account doesn't have the note list table yet
+    NSqlQuery sql(global.db);
+    sql.exec("Select *  from sqlite_master where type='table' and name='NoteTable';");
+    if (!sql.next()) {
+        NoteModel model(this);
+        model.createTable();
+    }
+    sql.finish();
+
+    int retval = config.benchmark->run();
+    if (retval != 0)
+        std::cout << config.benchmark->errorMessage.toStdString() << std::endl;
+    return retval;
+}
@@ -46,6 +46,7 @@ public:
     int closeNotebook(StartupConfig config);
     int sync();
     int signalGui(StartupConfig config);
+    int searchBenchmark(StartupConfig config);
 
 signals:
 
@@ -0,0 +1,611 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "searchbenchmark.h"
+#include "global.h"
+#include "filters/filtercriteria.h"
+#include "filters/filterengine.h"
+#include "sql/notebooktable.h"
+#include "sql/tagtable.h"
+#include "sql/notetable.h"
+#include "sql/resourcetable.h"
+#include "sql/nsqlquery.h"
+#include "sql/configstore.h"
+#include "threads/indexrunner.h"
+
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QFile>
+#include <QTextStream>
+#include <QSet>
+#include <QtAlgorithms>
+#include <qmath.h>
+#include <iostream>
+
+extern Global global;
+
+// Pieces the vocabulary is made from.  Made up words keep the text
+// free of stop words & the same in every locale.
+static const char *syllables[] = {
+    "ka", "lo", "mi", "ren", "to", "sa", "vi", "dor", "ne", "pa",
+    "qui", "ber", "la", "shi", "mon", "te", "ga", "ru", "fen", "zo",
+    "li", "mar", "ko", "sel", "ti", "ban", "du", "ve", "ros", "ha"
+};
+static const int syllableCount = 30;
+
+static const char *authors[] = {
+    "alice", "bruno", "chen", "dmitri", "elena", "farid",
+    "greta", "hiro", "ingrid", "jamal", "kofi", "lucia"
+};
+static const int authorCount = 12;
+
+static const char *places[] = { "home", "office", "berlin", "tokyo", "toronto", "lisbon" };
+static const double placeLatitude[] = { 51.5, 40.7, 52.5, 35.7, 43.7, 38.7 };
+static const double placeLongitude[] = { -0.1, -74.0, 13.4, 139.7, -79.4, -9.1 };
+static const int placeCount = 6;
+
+static const char *sources[] = { "web.clip", "mail.smtp", "mobile.android", "desktop.linux" };
+static const char *sourceApplications[] = { "skitch", "penultimate", "scannable", "food.evernote.com" };
+static const char *contentClasses[] = { "evernote.food.meal", "evernote.hello.encounter" };
+static const char *imageMimes[] = { "image/png", "image/jpeg", "image/gif" };
+static const char *recoTypes[] = { "service", "client" };
+
+#define BENCHMARK_VOCABULARY_SIZE  3000
+#define BENCHMARK_MSECS_PER_DAY    86400000
+
+
+
+SearchBenchmark::SearchBenchmark(QObject *parent) :
+    QObject(parent)
+{
+    notes = 10000;
+    notebooks = 25;
+    tags = 300;
+    resources = 3000;
+    iterations = 20;
+    seed = 1;
+    outputFile = "";
+    errorMessage = "";
+    randomState = 1;
+    generateMsecs = 0;
+    indexMsecs = 0;
+}
+
+
+
+// A small xorshift generator.  qrand() differs between platforms &
+// Qt versions, so it can't be used for a repeatable account.
+quint32 SearchBenchmark::random(quint32 range) {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    if (range == 0)
+        return 0;
+    return randomState % range;
+}
+
+
+
+// Pick a word.  Words near the front of the vocabulary are picked far more
+// often than the ones at the end, roughly like real text.
+QString SearchBenchmark::randomWord() {
+    double u = random(1000000) / 1000000.0;
+    return vocabulary[int(vocabulary.size()*u*u*u)];
+}
+
+
+QString SearchBenchmark::randomText(int words) {
+    QStringList text;
+    for (int i=0; i<words; i++)
+        text.append(randomWord());
+    return text.join(" ");
+}
+
+
+
+void SearchBenchmark::buildVocabulary() {
+    vocabulary.clear();
+    QSet<QString> found;
+    while (vocabulary.size() < BENCHMARK_VOCABULARY_SIZE) {
+        QString word;
+        int parts = 2 + random(3);
+        for (int i=0; i<parts; i++)
+            word.append(syllables[random(syllableCount)]);
+        if (!found.contains(word)) {
+            found.insert(word);
+            vocabulary.append(word);
+        }
+    }
+}
+
+
+
+//*****************************************************************
+//* Create the account.  Everything goes through the same table
+//* classes a sync uses, so the triggers & side tables are filled
+//* the normal way.
+//*****************************************************************
+void SearchBenchmark::generate() {
+    QElapsedTimer timer;
+    timer.start();
+    NSqlQuery sql(global.db);
+    sql.exec("begin");
+
+    NotebookTable notebookTable(global.db);
+    notebookNames.clear();
+    QStringList notebookGuids;
+    for (int i=0; i<notebooks; i++) {
+        Notebook book;
+        QString name = QString("Notebook") + QString::number(i+1).rightJustified(2, '0');
+        QString guid = QString(BENCHMARK_GUID_PREFIX) + QString("notebook-") + QString::number(i+1);
+        book.name = name;
+        book.guid = guid;
+        if (i % 2 == 1)
+            book.stack = QString("Stack") + QString::number(i % 3 + 1);
+        notebookTable.add(0, book, false, false);
+        notebookNames.append(name);
+        notebookGuids.append(guid);
+    }
+
+    // The first tenth of the tags are roots & the rest hang under them,
+    // so tag searches have child tags to include.
+    TagTable tagTable(global.db);
+    tagNames.clear();
+    QStringList tagGuids;
+    qint32 roots = qMax(1, tags/10);
+    for (int i=0; i<tags; i++) {
+        Tag tag;
+        QString name = QString("topic") + QString::number(i+1).rightJustified(3, '0');
+        QString guid = QString(BENCHMARK_GUID_PREFIX) + QString("tag-") + QString::number(i+1);
+        tag.name = name;
+        tag.guid = guid;
+        if (i >= roots)
+            tag.parentGuid = tagGuids[i % roots];
+        tagTable.add(0, tag, false, 0);
+        tagNames.append(name);
+        tagGuids.append(guid);
+    }
+
+    // Spread the resources over the notes
+    QList<qint32> resourceCounts;
+    for (int i=0; i<notes; i++)
+        resourceCounts.append(0);
+    for (int i=0; i<resources && notes > 0; i++)
+        resourceCounts[random(notes)]++;
+
+    NoteTable noteTable(global.db);
+    qint64 base = QDateTime(QDate(2014,1,1), QTime(0,0,0), Qt::UTC).toMSecsSinceEpoch();
+    qint32 resourceNumber = 0;
+    for (int i=0; i<notes; i++) {
+        Note note;
+        QString noteGuid = QString(BENCHMARK_GUID_PREFIX) + QString("note-") + QString::number(i+1);
+        note.guid = noteGuid;
+        QString title = randomText(3 + random(4));
+        title[0] = title[0].toUpper();
+        note.title = title;
+        note.notebookGuid = notebookGuids[random(notebookGuids.size())];
+        qint64 created = base + qint64(random(3*365))*BENCHMARK_MSECS_PER_DAY + random(BENCHMARK_MSECS_PER_DAY);
+        note.created = created;
+        note.updated = created + qint64(random(200))*BENCHMARK_MSECS_PER_DAY;
+        note.active = true;
+        if (random(100) < 3) {
+            note.active = false;
+            note.deleted = created + qint64(random(300))*BENCHMARK_MSECS_PER_DAY;
+        }
+
+        QList<Guid> noteTags;
+        int tagCount = tags > 0 ? random(5) : 0;
+        for (int j=0; j<tagCount; j++) {
+            QString guid = tagGuids[random(tagGuids.size())];
+            if (!noteTags.contains(guid))
+                noteTags.append(guid);
+        }
+        note.tagGuids = noteTags;
+
+        NoteAttributes attributes;
+        attributes.author = QString(authors[random(authorCount)]);
+        if (random(100) < 30) {
+            attributes.source = QString(sources[random(4)]);
+            attributes.sourceURL = QString("http://example.com/") + randomWord();
+        }
+        if (random(100) < 20)
+            attributes.sourceApplication = QString(sourceApplications[random(4)]);
+        if (random(100) < 5)
+            attributes.contentClass = QString(contentClasses[random(2)]);
+        if (random(100) < 25) {
+            int place = random(placeCount);
+            attributes.placeName = QString(places[place]);
+            attributes.latitude = placeLatitude[place] + (random(400) - 200)/1000.0;
+            attributes.longitude = placeLongitude[place] + (random(400) - 200)/1000.0;
+            attributes.altitude = double(random(500));
+        }
+        if (random(100) < 10)
+            attributes.subjectDate = created - qint64(random(365))*BENCHMARK_MSECS_PER_DAY;
+        if (random(100) < 10) {
+            attributes.reminderOrder = created;
+            if (random(100) < 80)
+                attributes.reminderTime = created + qint64(random(400))*BENCHMARK_MSECS_PER_DAY;
+            if (random(100) < 40)
+                attributes.reminderDoneTime = created + qint64(random(400))*BENCHMARK_MSECS_PER_DAY;
+        }
+        note.attributes = attributes;
+
+        // Build the ENML.  Paragraphs, the odd list, some to-do items and
+        // an en-media tag for every resource.
+        QString content = QString("<?xml version=\"1.0\" encoding=\"UTF-8\"?>") +
+                QString("<!DOCTYPE en-note SYSTEM \"http://xml.evernote.com/pub/enml2.dtd\"><en-note>");
+        int paragraphs = 1 + random(8);
+        for (int j=0; j<paragraphs; j++)
+            content.append(QString("<div>") + randomText(10 + random(60)) + QString("</div>"));
+        if (random(100) < 20) {
+            content.append("<ul>");
+            int items = 2 + random(5);
+            for (int j=0; j<items; j++)
+                content.append(QString("<li>") + randomText(2 + random(6)) + QString("</li>"));
+            content.append("</ul>");
+        }
+        if (random(100) < 15) {
+            int todos = 1 + random(3);
+            for (int j=0; j<todos; j++) {
+                QString checked = random(2) == 0 ? "true" : "false";
+                content.append(QString("<div><en-todo checked=\"") + checked + QString("\"/>") + randomText(3 + random(5)) + QString("</div>"));
+            }
+        }
+        if (random(100) < 10)
+            content.append(QString("<div><a href=\"http://example.com/") + randomWord() + QString("\">") + randomText(2) + QString("</a></div>"));
+
+        QList<Resource> noteResources;
+        for (int j=0; j<resourceCounts[i]; j++) {
+            resourceNumber++;
+            Resource r;
+            r.guid = QString(BENCHMARK_GUID_PREFIX) + QString("resource-") + QString::number(resourceNumber);
+            r.noteGuid = noteGuid;
+            r.active = true;
+            QByteArray body = QString("benchmark resource %1 ").arg(resourceNumber).toLatin1().repeated(16);
+            QByteArray hash = QCryptographicHash::hash(body, QCryptographicHash::Md5);
+            Data data;
+            data.body = body;
+            data.bodyHash = hash;
+            data.size = body.size();
+            r.data = data;
+
+            ResourceAttributes resourceAttributes;
+            QString mime;
+            if (random(100) < 85) {
+                mime = QString(imageMimes[random(3)]);
+                r.width = 800;
+                r.height = 600;
+                resourceAttributes.recoType = QString(recoTypes[random(2)]);
+
+                // Recognition data has a few places text was found in
+                // the image, each with up to three guesses at the word.
+                QString reco = QString("<?xml version=\"1.0\" encoding=\"UTF-8\"?>") +
+                        QString("<!DOCTYPE recoIndex PUBLIC \"SYSTEM\" \"http://xml.evernote.com/pub/recoIndex.dtd\">") +
+                        QString("<recoIndex docType=\"unknown\" objType=\"image\" objID=\"") + QString(hash.toHex()) +
+                        QString("\" engineVersion=\"5.5.22.7\" recoType=\"service\" lang=\"en\" objWidth=\"800\" objHeight=\"600\">");
+                int items = 1 + random(10);
+                for (int k=0; k<items; k++) {
+                    reco.append(QString("<item x=\"%1\" y=\"%2\" w=\"%3\" h=\"30\">").arg(random(700)).arg(random(550)).arg(40 + random(100)));
+                    int guesses = 1 + random(3);
+                    int weight = 20 + random(80);
+                    for (int g=0; g<guesses; g++) {
+                        reco.append(QString("<t w=\"%1\">").arg(weight) + randomWord() + QString("</t>"));
+                        weight = weight / 2;
+                    }
+                    reco.append("</item>");
+                }
+                reco.append("</recoIndex>");
+                QByteArray recoBody = reco.toUtf8();
+                Data recognition;
+                recognition.body = recoBody;
+                recognition.size = recoBody.size();
+                recognition.bodyHash = QCryptographicHash::hash(recoBody, QCryptographicHash::Md5);
+                r.recognition = recognition;
+            } else {
+                mime = "application/zip";
+                resourceAttributes.fileName = randomWord() + QString(".zip");
+            }
+            r.mime = mime;
+            r.attributes = resourceAttributes;
+            noteResources.append(r);
+            content.append(QString("<div><en-media hash=\"") + QString(hash.toHex()) + QString("\" type=\"") + mime + QString("\"/></div>"));
+        }
+        if (noteResources.size() > 0)
+            note.resources = noteResources;
+        content.append("</en-note>");
+        note.content = content;
+
+        noteTable.add(0, note, false);
+        if ((i+1) % 500 == 0) {
+            sql.exec("commit");
+            sql.exec("begin");
+        }
+    }
+    sql.exec("commit");
+    sql.finish();
+    generateMsecs = timer.elapsed();
+}
+
+
+
+// Index everything the same way the index thread does.  Each call to
+// index() does a batch, so keep going until nothing is left.  The index
+// isn't held back for system load here, since nothing can be timed
+// until it is done.  If a few batches in a row don't get through any
+// of what is left, something is wrong & we give up.
+bool SearchBenchmark::index() {
+    QElapsedTimer timer;
+    timer.start();
+    global.enableIndexing = true;
+    IndexRunner indexRunner;
+    indexRunner.throttle = false;
+    indexRunner.initialize();
+    NoteTable noteTable(global.db);
+    ResourceTable resourceTable(global.db);
+    QList<qint32> lids;
+    qint32 remaining = noteTable.getIndexNeeded(lids) + resourceTable.getIndexNeeded(lids);
+    int stalls = 0;
+    while (remaining > 0) {
+        indexRunner.index();
+        qint32 left = noteTable.getIndexNeeded(lids) + resourceTable.getIndexNeeded(lids);
+        stalls = (left < remaining ? 0 : stalls+1);
+        remaining = left;
+        if (stalls >= BENCHMARK_INDEX_STALLS) {
+            errorMessage = tr("Indexing stopped with ") + QString::number(remaining) + tr(" notes & resources left.");
+            return false;
+        }
+    }
+    indexMsecs = timer.elapsed();
+    return true;
+}
+
+
+
+//*****************************************************************
+//* The searches that are timed.  Every operator the filter engine
+//* understands is used at least once, both in the default "all"
+//* mode & after "any:".  The words are picked from the vocabulary
+//* by rank so there are common, medium & rare ones.
+//*****************************************************************
+void SearchBenchmark::buildSearches() {
+    searches.clear();
+    QString common = vocabulary[0];
+    QString common2 = vocabulary[3];
+    QString medium = vocabulary[vocabulary.size()/20];
+    QString rare = vocabulary[vocabulary.size()/2];
+    QString typo = vocabulary[1];
+    typo[typo.length()-1] = typo[typo.length()-1] == QChar('a') ? QChar('e') : QChar('a');
+    QString notebook = notebookNames.size() > 0 ? notebookNames[0] : QString("Notebook01");
+    QString notebook2 = notebookNames.size() > 1 ? notebookNames[1] : notebook;
+    QString rootTag = tagNames.size() > 0 ? tagNames[0] : QString("topic001");
+    QString leafTag = tagNames.size() > 0 ? tagNames[tagNames.size()-1] : rootTag;
+
+    searches.append(qMakePair(QString("word-common"), common));
+    searches.append(qMakePair(QString("word-medium"), medium));
+    searches.append(qMakePair(QString("word-rare"), rare));
+    searches.append(qMakePair(QString("words-two"), common2 + " " + medium));
+    searches.append(qMakePair(QString("phrase"), QString("\"") + common + " " + common2 + QString("\"")));
+    searches.append(qMakePair(QString("prefix"), medium.left(3) + QString("*")));
+    searches.append(qMakePair(QString("word-negative"), common + QString(" -") + common2));
+    searches.append(qMakePair(QString("infix"), QString("*") + medium.mid(2)));
+    searches.append(qMakePair(QString("infix-negative"), common + QString(" -*") + medium.mid(2)));
+    searches.append(qMakePair(QString("fuzzy"), QString("fuzzy:") + typo));
+    searches.append(qMakePair(QString("intitle"), QString("intitle:") + common));
+    searches.append(qMakePair(QString("notebook"), QString("notebook:") + notebook));
+    searches.append(qMakePair(QString("notebook-negative"), QString("-notebook:") + notebook));
+    searches.append(qMakePair(QString("stack"), QString("stack:Stack1")));
+    searches.append(qMakePair(QString("tag-leaf"), QString("tag:") + leafTag));
+    searches.append(qMakePair(QString("tag-root"), QString("tag:") + rootTag));
+    searches.append(qMakePair(QString("tag-negative"), QString("-tag:") + rootTag));
+    searches.append(qMakePair(QString("tag-wildcard"), QString("tag:topic00*")));
+    searches.append(qMakePair(QString("todo-true"), QString("todo:true")));
+    searches.append(qMakePair(QString("todo-false"), QString("todo:false")));
+    searches.append(qMakePair(QString("todo-any"), QString("todo:*")));
+    searches.append(qMakePair(QString("reminder-order"), QString("reminderOrder:*")));
+    searches.append(qMakePair(QString("reminder-time"), QString("reminderTime:20150601")));
+    searches.append(qMakePair(QString("reminder-done-time"), QString("reminderDoneTime:20150601")));
+    searches.append(qMakePair(QString("resource-mime"), QString("resource:image/png")));
+    searches.append(qMakePair(QString("resource-wildcard"), QString("resource:image/*")));
+    searches.append(qMakePair(QString("recotype"), QString("recotype:service")));
+    searches.append(qMakePair(QString("latitude"), QString("latitude:40")));
+    searches.append(qMakePair(QString("longitude-negative"), QString("-longitude:0")));
+    searches.append(qMakePair(QString("altitude"), QString("altitude:250")));
+    searches.append(qMakePair(QString("near"), QString("near:52.5,13.4,50")));
+    searches.append(qMakePair(QString("author"), QString("author:") + QString(authors[0])));
+    searches.append(qMakePair(QString("source"), QString("source:web.clip")));
+    searches.append(qMakePair(QString("source-application"), QString("sourceapplication:skitch")));
+    searches.append(qMakePair(QString("content-class"), QString("contentclass:evernote.food.meal")));
+    searches.append(qMakePair(QString("placename"), QString("placename:tokyo")));
+    searches.append(qMakePair(QString("created"), QString("created:20150101")));
+    searches.append(qMakePair(QString("created-negative"), QString("-created:20160101")));
+    searches.append(qMakePair(QString("updated"), QString("updated:20160601")));
+    searches.append(qMakePair(QString("subject-date"), QString("subjectdate:20140601")));
+    searches.append(qMakePair(QString("combined"), QString("notebook:") + notebook + QString(" tag:") + rootTag + QString(" ") + common));
+
+    searches.append(qMakePair(QString("any-words"), QString("any: ") + medium + QString(" ") + rare));
+    searches.append(qMakePair(QString("any-notebooks"), QString("any: notebook:") + notebook + QString(" notebook:") + notebook2));
+    searches.append(qMakePair(QString("any-tags"), QString("any: tag:") + rootTag + QString(" tag:") + leafTag));
+    searches.append(qMakePair(QString("any-intitle"), QString("any: intitle:") + common + QString(" intitle:") + medium));
+    searches.append(qMakePair(QString("any-todo-reminder"), QString("any: todo:true reminderOrder:* reminderTime:20150601 reminderDoneTime:20150601")));
+    searches.append(qMakePair(QString("any-resource"), QString("any: resource:image/gif recotype:client")));
+    searches.append(qMakePair(QString("any-location"), QString("any: latitude:40 longitude:100 altitude:400 near:35.7,139.7,20")));
+    searches.append(qMakePair(QString("any-attributes"), QString("any: author:") + QString(authors[1]) + QString(" source:mail.smtp sourceapplication:scannable contentclass:evernote.hello.encounter")));
+    searches.append(qMakePair(QString("any-dates"), QString("any: created:20160601 updated:20161001 subjectdate:20150101")));
+    searches.append(qMakePair(QString("any-fuzzy"), QString("any: fuzzy:") + typo + QString(" ") + rare));
+}
+
+
+
+QString SearchBenchmark::jsonString(QString value) {
+    QString retval = "\"";
+    for (int i=0; i<value.length(); i++) {
+        QChar c = value[i];
+        if (c == QChar('"') || c == QChar('\\'))
+            retval.append(QChar('\\')).append(c);
+        else if (c.unicode() < 0x20)
+            retval.append(QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0')));
+        else
+            retval.append(c);
+    }
+    return retval + QString("\"");
+}
+
+
+QString SearchBenchmark::jsonNumber(double value) {
+    return QString::number(value, 'f', 3);
+}
+
+
+
+// Nearest rank percentile of a sorted list
+static double percentile(QList<double> &sorted, double p) {
+    if (sorted.size() == 0)
+        return 0;
+    int rank = qCeil(p/100.0 * sorted.size());
+    if (rank < 1)
+        rank = 1;
+    return sorted[qMin(rank, sorted.size())-1];
+}
+
+
+
+// The options that decide what the account looks like.  These are
+// saved with the account so a later run can tell if it matches.
+QString SearchBenchmark::parameters() {
+    return QString("notes=") + QString::number(notes) +
+            QString(" notebooks=") + QString::number(notebooks) +
+            QString(" tags=") + QString::number(tags) +
+            QString(" resources=") + QString::number(resources) +
+            QString(" seed=") + QString::number(seed);
+}
+
+
+
+//*****************************************************************
+//* Fill the account if it is empty, then run each search once to
+//* warm the caches & "iterations" more times to time it.  Returns
+//* 0 if everything worked.
+//*****************************************************************
+int SearchBenchmark::run() {
+    notebooks = qMax(1, notebooks);
+    randomState = seed == 0 ? 1 : seed;
+    buildVocabulary();
+
+    // Don't touch a real account
+    NSqlQuery sql(global.db);
+    sql.exec("select count(*) from NoteTable");
+    qint32 existing = sql.next() ? sql.value(0).toInt() : 0;
+    sql.finish();
+    NoteTable noteTable(global.db);
+    ConfigStore configStore(global.db);
+    bool generated = false;
+    if (existing > 0) {
+        if (noteTable.getLid(QString(BENCHMARK_GUID_PREFIX) + QString("note-1")) <= 0) {
+            errorMessage = tr("The account already has notes.  Use --configDir to point to an empty directory.");
+            return 16;
+        }
+
+        // Reuse the account made by an earlier run, but only if it was made
+        // with the same options.  Otherwise the searches would be built from
+        // words the notes don't have.
+        QByteArray saved;
+        if (!configStore.getSetting(saved, CONFIG_STORE_BENCHMARK) || QString::fromUtf8(saved) != parameters()) {
+            errorMessage = tr("The benchmark account was generated with different options (") +
+                    (saved.isEmpty() ? tr("unknown") : QString::fromUtf8(saved)) +
+                    tr(").  Use the same options or point --configDir to an empty directory.");
+            return 16;
+        }
+        for (int i=0; i<notebooks; i++)
+            notebookNames.append(QString("Notebook") + QString::number(i+1).rightJustified(2, '0'));
+        for (int i=0; i<tags; i++)
+            tagNames.append(QString("topic") + QString::number(i+1).rightJustified(3, '0'));
+    } else {
+        generate();
+        if (!index())
+            return 16;
+        configStore.saveSetting(CONFIG_STORE_BENCHMARK, parameters().toUtf8());
+        generated = true;
+    }
+    buildSearches();
+
+    FilterCriteria *criteria = new FilterCriteria();
+    global.filterCriteria.append(criteria);
+    global.filterPosition = 0;
+
+    QStringList results;
+    for (int i=0; i<searches.size(); i++) {
+        criteria->setSearchString(searches[i].second);
+        QList<qint32> lids;
+        FilterEngine engine;
+        engine.filter(criteria, &lids);
+
+        QList<double> times;
+        QElapsedTimer timer;
+        for (int j=0; j<iterations; j++) {
+            timer.start();
+            engine.filter(criteria, &lids);
+            times.append(timer.nsecsElapsed()/1000000.0);
+        }
+        qSort(times);
+        double total = 0;
+        for (int j=0; j<times.size(); j++)
+            total = total + times[j];
+
+        QString result = QString("    {\"name\": ") + jsonString(searches[i].first) +
+                QString(", \"search\": ") + jsonString(searches[i].second) +
+                QString(", \"results\": ") + QString::number(lids.size()) +
+                QString(", \"minMs\": ") + jsonNumber(times.size() > 0 ? times.first() : 0) +
+                QString(", \"meanMs\": ") + jsonNumber(times.size() > 0 ? total/times.size() : 0) +
+                QString(", \"p50Ms\": ") + jsonNumber(percentile(times, 50)) +
+                QString(", \"p90Ms\": ") + jsonNumber(percentile(times, 90)) +
+                QString(", \"p95Ms\": ") + jsonNumber(percentile(times, 95)) +
+                QString(", \"p99Ms\": ") + jsonNumber(percentile(times, 99)) +
+                QString(", \"maxMs\": ") + jsonNumber(times.size() > 0 ? times.last() : 0) +
+                QString("}");
+        results.append(result);
+    }
+
+    QString json = QString("{\n") +
+            QString("  \"corpus\": {\"notes\": ") + QString::number(notes) +
+            QString(", \"notebooks\": ") + QString::number(notebooks) +
+            QString(", \"tags\": ") + QString::number(tags) +
+            QString(", \"resources\": ") + QString::number(resources) +
+            QString(", \"seed\": ") + QString::number(seed) +
+            QString(", \"generated\": ") + QString(generated ? "true" : "false") +
+            QString(", \"generateMs\": ") + QString::number(generateMsecs) +
+            QString(", \"indexMs\": ") + QString::number(indexMsecs) + QString("},\n") +
+            QString("  \"iterations\": ") + QString::number(iterations) + QString(",\n") +
+            QString("  \"searches\": [\n") + results.join(",\n") + QString("\n  ]\n}\n");
+
+    if (outputFile == "") {
+        std::cout << json.toStdString();
+        return 0;
+    }
+    QFile file(outputFile);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        errorMessage = tr("Unable to open output file ") + outputFile;
+        return 16;
+    }
+    QTextStream out(&file);
+    out.setCodec("UTF-8");
+    out << json;
+    file.close();
+    return 0;
+}
@@ -0,0 +1,86 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+
+#ifndef SEARCHBENCHMARK_H
+#define SEARCHBENCHMARK_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QPair>
+
+// Prefix of every guid the benchmark creates.  Used to recognize
+// an account it has already filled.
+#define BENCHMARK_GUID_PREFIX "benchmark-"
+
+// Index batches in a row that can get through nothing before we give up
+#define BENCHMARK_INDEX_STALLS 3
+
+
+//*****************************************************************
+//* Fill an empty account with a synthetic set of notebooks, tags,
+//* notes & resources and time a fixed set of searches against it.
+//* The same seed always gives the same account, so the numbers
+//* can be compared from one build to the next.  The results are
+//* written as JSON.
+//*****************************************************************
+class SearchBenchmark : public QObject
+{
+    Q_OBJECT
+private:
+    quint32 randomState;
+    QStringList vocabulary;                  // Words used for the note text, most common first
+    QStringList notebookNames;
+    QStringList tagNames;
+    QList< QPair<QString, QString> > searches;   // Name & search string of each timed search
+    qint64 generateMsecs;
+    qint64 indexMsecs;
+
+    quint32 random(quint32 range);
+    QString randomWord();
+    QString randomText(int words);
+    void buildVocabulary();
+    void buildSearches();
+    QString parameters();
+    void generate();
+    bool index();
+    QString jsonString(QString value);
+    QString jsonNumber(double value);
+
+public:
+    explicit SearchBenchmark(QObject *parent = 0);
+    qint32 notes;
+    qint32 notebooks;
+    qint32 tags;
+    qint32 resources;
+    qint32 iterations;
+    quint32 seed;
+    QString outputFile;
+    QString errorMessage;
+    int run();
+
+signals:
+
+public slots:
+
+};
+
+#endif // SEARCHBENCHMARK_H
@@ -37,6 +37,7 @@ void CommunicationError::reset() {
     code = 0;
     message = "";
     type = None;
+    retryAfter = 0;
 }
 
 
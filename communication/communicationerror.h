@@ -57,6 +57,7 @@ public:
     bool retry();                 // Retry after the last error
     int retryCount;               // Current retry count
     int maxRetryCount;            // Maximum number of times to retry
+    int retryAfter;               // Seconds Evernote wants us to wait after hitting the API rate limit
     
 signals:
     
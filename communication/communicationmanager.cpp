@@ -132,6 +132,7 @@ bool CommunicationManager::initNoteStore() {
     if (!getUserInfo(user))
         return false;
     noteStorePath = "/edam/note/" +user.shardId;
+    userShard = user.shardId;
 
     QString noteStoreUrl = QString("https://")+evernoteHost+noteStorePath;
     myNoteStore = new NoteStore(noteStoreUrl, authToken, this);
@@ -584,6 +585,58 @@ qint32 CommunicationManager::uploadNote(Note &note, QString token) {
 
 
 
+// Start uploading a note to Evernote.  The AsyncResult says when it is
+// done; pass what it gives to uploadNoteFinished().  This always goes to
+// the user's own account.
+AsyncResult *CommunicationManager::uploadNoteAsync(const Note &note) {
+    if (note.updateSequenceNum.isSet() && note.updateSequenceNum > 0)
+        return myNoteStore->updateNoteAsync(note, authToken);
+    return myNoteStore->createNoteAsync(note, authToken);
+}
+
+
+
+// Finish an upload started by uploadNoteAsync.  Like uploadNote, this
+// returns the new USN, or 0 with the error filled in.
+qint32 CommunicationManager::uploadNoteFinished(Note &note, QVariant result, QSharedPointer<EverCloudExceptionData> exception) {
+    if (exception.isNull()) {
+        note = result.value<Note>();
+        return note.updateSequenceNum;
+    }
+    try {
+        exception->throwException();
+    } catch (ThriftException e) {
+        QLOG_ERROR() << "ThriftException:";
+        QLOG_ERROR().maybeSpace() << "Exception Type:" << e.type();
+        QLOG_ERROR().maybeSpace() << "Exception Msg:" << e.what() << endl;
+        error.message = errorWhat(e.what());
+        error.type = CommunicationError::ThriftException;
+    } catch (EDAMUserException e) {
+        QLOG_ERROR() << "EDAMUserException:" << e.errorCode;
+        DebugTool d;
+        d.dumpNote(note);
+        error.code = e.errorCode;
+        error.message = errorWhat(e.what());
+        error.type = CommunicationError::EDAMUserException;
+    } catch (EDAMSystemException e) {
+        QLOG_ERROR() << "EDAMSystemException";
+        QLOG_ERROR().maybeSpace() << "Note title: " << note.title << endl;
+        handleEDAMSystemException(e);
+    } catch (EDAMNotFoundException e) {
+        QLOG_ERROR() << "EDAMNotFoundException";
+        QLOG_ERROR().maybeSpace() << "Note title: " << note.title << endl;
+        handleEDAMNotFoundException(e);
+    } catch (EverCloudException e) {
+        // The request never got an answer
+        QLOG_ERROR() << "EverCloudException:" << e.what();
+        error.message = errorWhat(e.what());
+        error.type = CommunicationError::TTransportException;
+    }
+    return 0;
+}
+
+
+
 // delete a note in Evernote
 qint32 CommunicationManager::deleteNote(Guid note, QString token) {
     if (token == "")
@@ -1017,12 +1070,11 @@ void CommunicationManager::downloadInkNoteImage(QString guid, Resource *r, QStri
     Q_UNUSED(shard)
     Q_UNUSED(authToken)
 #else
-    UserTable userTable(db);
+    // This runs on the sync chunk fetcher's thread, so the shard comes
+    // from when we connected rather than from the database.
     QImage *newImage = NULL;
-    User u;
-    userTable.getUser(u);
     if (shard == "")
-        shard = u.shardId;
+        shard = userShard;
     QString urlBase = QString("https://")+evernoteHost
             +QString("/shard/")
             +shard
@@ -1205,6 +1257,9 @@ void CommunicationManager::handleEDAMSystemException(EDAMSystemException e) {
     if (e.errorCode == EDAMErrorCode::RATE_LIMIT_REACHED) {
         int duration = e.rateLimitDuration/60+1;
         error.type = CommunicationError::RateLimitExceeded;
+        error.retryAfter = 0;
+        if (e.rateLimitDuration.isSet())
+            error.retryAfter = e.rateLimitDuration;
         if (duration > 1)
             error.message = tr("API rate limit exceeded.  Please try again in ") +QString::number(duration)+ tr(" minutes.");
         else
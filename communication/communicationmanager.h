@@ -81,6 +81,7 @@ private:
 
     QString userStorePath;                    // Userstore URL path.
     QString noteStorePath;                    // Notestore URL path.
+    QString userShard;                        // Shard of the user's account, for ink notes
     QString clientName;                       // Client name
     QString evernoteHost;                     // Evernote server URL.
 
@@ -138,6 +139,8 @@ public:
     qint32 expungeNotebook(Guid guid);                         // Expunge/delete a notebook
 
     qint32 uploadNote(Note &note, QString token="");           // Upload a note to Evernote
+    AsyncResult *uploadNoteAsync(const Note &note);            // Start uploading a note without waiting for it
+    qint32 uploadNoteFinished(Note &note, QVariant result, QSharedPointer<EverCloudExceptionData> exception);   // Get the result of uploadNoteAsync
     qint32 uploadLinkedNote(Note &note);                       // Upload a note to a linked account
     qint32 deleteNote(Guid guid, QString token="");            // Mark a note as deleted (we don't actually expunge)
     qint32 deleteLinkedNote(Guid guid);                        // Mark a note in a linked notebook as deleted
@@ -22,6 +22,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QGridLayout>
 #include <QCheckBox>
 #include <QLabel>
+#include "sql/notetable.h"
+#include "sql/trigramtable.h"
+#include "sql/resourcetable.h"
+#include "sql/searchtexttable.h"
 
 extern Global global;
 
@@ -65,10 +69,41 @@ SearchPreferences::SearchPreferences(QWidget *parent) :
     mainLayout->addWidget(enableBackgroundIndexing,row++,0);
     enableBackgroundIndexing->setChecked(global.getBackgroundIndexing());
 
+    backgroundSearch = new QCheckBox(tr("Search in the background"));
+    mainLayout->addWidget(backgroundSearch,row++,0);
+    backgroundSearch->setChecked(global.backgroundSearch);
+
+    searchAsYouType = new QCheckBox(tr("Search as you type"));
+    mainLayout->addWidget(searchAsYouType,row++,0);
+    searchAsYouType->setChecked(global.searchAsYouType);
+
+    trigramIndex = new QCheckBox(tr("Allow fuzzy and partial word searches (uses more disk space)"));
+    mainLayout->addWidget(trigramIndex,row++,0);
+    trigramIndex->setChecked(global.trigramIndex);
+
+    includeChildTags = new QCheckBox(tr("Include child tags when filtering by a tag"));
+    mainLayout->addWidget(includeChildTags,row++,0);
+    includeChildTags->setChecked(global.includeChildTags);
+
     forceLowerCase = new QCheckBox(tr("Experimental: Force search to lower case"));
     mainLayout->addWidget(forceLowerCase,row++,0);
     forceLowerCase->setChecked(global.forceSearchLowerCase);
 
+    foldText = new QCheckBox(tr("Ignore accents and character widths when searching"));
+    mainLayout->addWidget(foldText,row++,0);
+    foldText->setChecked(global.foldSearchText);
+
+    stemLanguage = new QComboBox(this);
+    stemLanguage->addItem(tr("None"), "");
+    stemLanguage->addItem(tr("English"), "en");
+    stemLanguage->addItem(tr("French"), "fr");
+    stemLanguage->addItem(tr("German"), "de");
+    stemLanguage->addItem(tr("Spanish"), "es");
+    int index = stemLanguage->findData(global.searchStemLanguage);
+    stemLanguage->setCurrentIndex(index < 0 ? 0 : index);
+    mainLayout->addWidget(new QLabel(tr("Match Other Forms of Words For")), row,0);
+    mainLayout->addWidget(stemLanguage,row++,1);
+
     weight = new QSpinBox(this);
     mainLayout->addWidget(new QLabel(tr("Minimum Image Recognition Weight")), row,0);
     mainLayout->addWidget(weight,row++,1);
@@ -76,6 +111,13 @@ SearchPreferences::SearchPreferences(QWidget *parent) :
     weight->setMaximum(100);
     weight->setValue(global.getMinimumRecognitionWeight());
 
+    indexThreads = new QSpinBox(this);
+    mainLayout->addWidget(new QLabel(tr("Indexing Threads (0 = Automatic)")), row,0);
+    mainLayout->addWidget(indexThreads,row++,1);
+    indexThreads->setMinimum(0);
+    indexThreads->setMaximum(16);
+    indexThreads->setValue(global.indexThreads);
+
     this->setFont(global.getGuiFont(font()));
 
     mainLayout->setAlignment(Qt::AlignTop);
@@ -96,4 +138,36 @@ void SearchPreferences::saveValues() {
     global.setForceSearchLowerCase(forceLowerCase->isChecked());
     global.forceSearchLowerCase=forceLowerCase->isChecked();
     global.setBackgroundIndexing(enableBackgroundIndexing->isChecked());
+    global.setBackgroundSearch(backgroundSearch->isChecked());
+    global.setSearchAsYouType(searchAsYouType->isChecked());
+    global.setIncludeChildTags(includeChildTags->isChecked());
+    global.setIndexThreads(indexThreads->value());
+
+    // Turning the trigram index on means every note needs to be reindexed to fill it.
+    // Turning it off throws it away.
+    if (trigramIndex->isChecked() != global.trigramIndex) {
+        global.setTrigramIndex(trigramIndex->isChecked());
+        if (global.trigramIndex) {
+            NoteTable noteTable(global.db);
+            noteTable.reindexAllNotes();
+        } else {
+            TrigramTable trigramTable(global.db);
+            trigramTable.clear();
+        }
+    }
+
+    // Folded & stemmed words are what is stored in the index, so changing
+    // either one means everything has to be indexed again.  The index
+    // runner picks the notes & resources up in the background.
+    QString language = stemLanguage->itemData(stemLanguage->currentIndex()).toString();
+    if (foldText->isChecked() != global.foldSearchText || language != global.searchStemLanguage) {
+        global.setFoldSearchText(foldText->isChecked());
+        global.setSearchStemLanguage(language);
+        SearchTextTable searchTextTable(global.db);
+        searchTextTable.clear();
+        NoteTable noteTable(global.db);
+        noteTable.reindexAllNotes();
+        ResourceTable resourceTable(global.db);
+        resourceTable.reindexAllResources();
+    }
 }
@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QWidget>
 #include <QSpinBox>
 #include <QCheckBox>
+#include <QComboBox>
 
 class SearchPreferences : public QWidget
 {
@@ -39,6 +40,13 @@ private:
     QCheckBox *tagSelectionOr;          // "OR" tag selections.
     QCheckBox *forceLowerCase;          // Force notes search text to be lower case.  Useful for some non-ASCII languages.
     QCheckBox *enableBackgroundIndexing;  // Do indexing in the background by default.
+    QCheckBox *backgroundSearch;        // Run searches on a separate thread
+    QCheckBox *searchAsYouType;         // Search while the user types
+    QCheckBox *trigramIndex;            // Keep a trigram index for fuzzy searches
+    QCheckBox *includeChildTags;        // Tag filters include the tags below them
+    QCheckBox *foldText;                // Ignore accents, case & character widths
+    QComboBox *stemLanguage;            // Language used to match different forms of a word
+    QSpinBox *indexThreads;             // Number of threads extracting text, 0 for automatic
 
 public:
     explicit SearchPreferences(QWidget *parent = 0);
@@ -50,6 +50,8 @@ FilterCriteria::FilterCriteria(QObject *parent) :
     resetLid = false;
     resetSearchString = false;
     selectedNotesIsSet = false;
+    searchHitsIsSet = false;
+    searchHitsComplete = true;
 }
 
 
@@ -238,6 +240,7 @@ void FilterCriteria::setSearchString(QString string) {
     searchString = string;
     searchStringIsSet = true;
     valueSet = true;
+    searchHitsIsSet = false;
 }
 
 bool FilterCriteria::isSearchStringSet() {
@@ -246,6 +249,62 @@ bool FilterCriteria::isSearchStringSet() {
 
 void FilterCriteria::unsetSearchString() {
     searchStringIsSet = false;
+    searchHitsIsSet = false;
+}
+
+
+
+
+// Search hits are only set when every word in the search string
+// could be answered by the full text index.  If they are complete, a
+// lid without an entry didn't match anything.  If not, only the first
+// hits were collected & the rest are added as they are looked up.
+void FilterCriteria::setSearchHits(SearchHits &hits, bool complete) {
+    searchHits = hits;
+    searchHitsIsSet = true;
+    searchHitsComplete = complete;
+    searchHitsMissing.clear();
+}
+
+bool FilterCriteria::getSearchHit(qint32 lid, SearchHit &hit) {
+    if (!searchHitsIsSet || !searchHits.contains(lid))
+        return false;
+    hit = searchHits[lid];
+    return true;
+}
+
+void FilterCriteria::getSearchHits(SearchHits &hits) {
+    hits = searchHits;
+}
+
+bool FilterCriteria::isSearchHitsSet() {
+    return searchHitsIsSet;
+}
+
+bool FilterCriteria::isSearchHitsComplete() {
+    return searchHitsComplete;
+}
+
+// True if we already know whether this lid was a hit
+bool FilterCriteria::isSearchHitKnown(qint32 lid) {
+    if (!searchHitsIsSet)
+        return false;
+    return searchHitsComplete || searchHits.contains(lid) || searchHitsMissing.contains(lid);
+}
+
+void FilterCriteria::addSearchHit(qint32 lid, SearchHit &hit) {
+    searchHits[lid] = hit;
+}
+
+void FilterCriteria::addSearchMiss(qint32 lid) {
+    searchHitsMissing.insert(lid);
+}
+
+void FilterCriteria::unsetSearchHits() {
+    searchHitsIsSet = false;
+    searchHitsComplete = true;
+    searchHits.clear();
+    searchHitsMissing.clear();
 }
 
 
@@ -304,6 +363,11 @@ void FilterCriteria::duplicate(FilterCriteria &newFilter) {
     if (searchStringIsSet)
         newFilter.setSearchString(searchString);
 
+    if (searchHitsIsSet) {
+        newFilter.setSearchHits(searchHits, searchHitsComplete);
+        newFilter.searchHitsMissing = searchHitsMissing;
+    }
+
     if (attributeIsSet)
         newFilter.setAttribute(*attribute);
 
@@ -25,9 +25,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "gui/nnotebookviewitem.h"
 #include "gui/ntagviewitem.h"
 #include "gui/nsearchviewitem.h"
+#include "filters/searchhit.h"
 
 #include <QTreeWidgetItem>
 #include <QList>
+#include <QSet>
 
 class FilterCriteria : public QObject
 {
@@ -61,6 +63,11 @@ private:
     QList<qint32> selectedNotes;
     bool selectedNotesIsSet;
 
+    SearchHits searchHits;
+    bool searchHitsIsSet;
+    bool searchHitsComplete;
+    QSet<qint32> searchHitsMissing;
+
 public:
     explicit FilterCriteria(QObject *parent = 0);
     bool isSet();
@@ -119,6 +126,16 @@ public:
     void unsetFavorite();
     bool resetFavorite;
 
+    void setSearchHits(SearchHits &hits, bool complete=true);
+    bool getSearchHit(qint32 lid, SearchHit &hit);
+    void getSearchHits(SearchHits &hits);
+    bool isSearchHitsSet();
+    bool isSearchHitsComplete();
+    bool isSearchHitKnown(qint32 lid);
+    void addSearchHit(qint32 lid, SearchHit &hit);
+    void addSearchMiss(qint32 lid);
+    void unsetSearchHits();
+
     void duplicate(FilterCriteria &criteria);
 
 
@@ -29,15 +29,78 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "sql/nsqlquery.h"
 #include "sql/favoritesrecord.h"
 #include "sql/favoritestable.h"
+#include "sql/trigramtable.h"
+#include "sql/searchtable.h"
+#include "utilities/textfolding.h"
 
 #include <QtSql>
+#include <QTextDocument>
+#include <qmath.h>
 
 
 extern Global global;
 
+
+// How far down the tag tree a tag filter reaches.  Depth 0 is just the tag.
+static qint32 tagFilterDepth() {
+    return global.includeChildTags ? TAG_CLOSURE_MAX_DEPTH : 0;
+}
+
 FilterEngine::FilterEngine(QObject *parent) :
     QObject(parent)
 {
+    db = global.db;
+    cancelToken = NULL;
+    generation = 0;
+    searchTerms = NULL;
+    storingResults = false;
+    candidates = NULL;
+    minimumWeight = global.getMinimumRecognitionWeight();
+    tagSelectionOr = global.getTagSelectionOr();
+}
+
+
+// Constructor used by threads that have their own database connection.
+// The settings are read through the shared QSettings, which isn't safe
+// off the GUI thread, so the caller passes them in with setSearchSettings().
+FilterEngine::FilterEngine(DatabaseConnection *db, QObject *parent) :
+    QObject(parent)
+{
+    this->db = db;
+    cancelToken = NULL;
+    generation = 0;
+    searchTerms = NULL;
+    storingResults = false;
+    candidates = NULL;
+    minimumWeight = 20;
+    tagSelectionOr = false;
+}
+
+
+
+// Use search settings read by the GUI thread
+void FilterEngine::setSearchSettings(int minimumWeight, bool tagSelectionOr) {
+    this->minimumWeight = minimumWeight;
+    this->tagSelectionOr = tagSelectionOr;
+}
+
+
+
+//*****************************************************************
+//* Tie this filter to a search generation.  If the requester
+//* moves the token on (because the user typed something else),
+//* the filter gives up at the next predicate or FTS batch.
+//*****************************************************************
+void FilterEngine::setCancelToken(QAtomicInt *token, qint32 generation) {
+    cancelToken = token;
+    this->generation = generation;
+}
+
+
+bool FilterEngine::isCancelled() {
+    if (cancelToken == NULL)
+        return false;
+    return cancelToken->fetchAndAddOrdered(0) != generation;
 }
 
 
@@ -46,11 +109,22 @@ void FilterEngine::filter(FilterCriteria *newCriteria, QList<qint32> *results) {
     QLOG_TRACE_IN();
     bool internalSearch = true;
 
-    NSqlQuery sql(global.db);
+    NSqlQuery sql(db);
     QLOG_DEBUG() << "Purging filters";
     sql.exec("delete from filter");
     QLOG_DEBUG() << "Resetting filter table";
-    sql.prepare("Insert into filter (lid) select lid from NoteTable where notebooklid not in (select lid from datastore where key=:closedNotebooks)");
+    if (candidates != NULL) {
+        sql.exec("create temporary table if not exists candidatelids (lid integer primary key)");
+        sql.exec("delete from candidatelids");
+        sql.prepare("Insert or ignore into candidatelids (lid) values (:lid)");
+        for (int i=0; i<candidates->size(); i++) {
+            sql.bindValue(":lid", candidates->at(i));
+            sql.exec();
+        }
+        sql.prepare("Insert into filter (lid) select lid from NoteTable where lid in (select lid from candidatelids) and notebooklid not in (select lid from datastore where key=:closedNotebooks)");
+    } else {
+        sql.prepare("Insert into filter (lid) select lid from NoteTable where notebooklid not in (select lid from datastore where key=:closedNotebooks)");
+    }
     sql.bindValue(":closedNotebooks", NOTEBOOK_IS_CLOSED);
     sql.exec();
     sql.finish();
@@ -67,24 +141,53 @@ void FilterEngine::filter(FilterCriteria *newCriteria, QList<qint32> *results) {
     QLOG_DEBUG() << "Filtering favorite";
     filterFavorite(criteria);
     QLOG_DEBUG() << "Filtering notebooks";
+    if (isCancelled())
+        return;
     filterNotebook(criteria);
     QLOG_DEBUG() << "Filtering tags";
+    if (isCancelled())
+        return;
     filterTags(criteria);
     QLOG_DEBUG() << "Filtering trash";
+    if (isCancelled())
+        return;
     filterTrash(criteria);
     QLOG_DEBUG() << "Filtering search string";
+    if (isCancelled())
+        return;
     filterSearchString(criteria);
     QLOG_DEBUG() << "Filtering attributes";
+    if (isCancelled())
+        return;
     filterAttributes(criteria);
+    if (isCancelled()) {
+        QLOG_DEBUG() << "Filter superseded by a newer search";
+        return;
+    }
     QLOG_DEBUG() << "Filtering complete";
+    finishFilter(criteria, internalSearch, results);
+}
 
-    // Now, re-insert any pinned notes
-    sql.prepare("Insert into filter (lid) select lid from Datastore where key=:key and lid not in (select lid from filter)");
-    sql.bindValue(":key", NOTE_ISPINNED);
-    sql.exec();
+
+
+// Everything done once the filter table has the matching notes in it.
+// Stored saved search results leave out the pinned notes & hits since
+// those are added when the results are shown.
+void FilterEngine::finishFilter(FilterCriteria *criteria, bool internalSearch, QList<qint32> *results) {
+    if (!storingResults) {
+        // Now, re-insert any pinned notes
+        NSqlQuery sql(db);
+        sql.prepare("Insert into filter (lid) select lid from Datastore where key=:key and lid not in (select lid from filter)");
+        sql.bindValue(":key", NOTE_ISPINNED);
+        sql.exec();
+        sql.finish();
+
+        // Collect the full text hits for the notes that are left
+        findSearchHits(criteria);
+    }
 
     // Remove any selected notes that are not in the filter.
-    NSqlQuery query(global.db);
+    NSqlQuery query(db);
     QList<qint32> goodLids;
     query.exec("select lid from filter;");
     while (query.next()) {
@@ -106,8 +209,10 @@ void FilterEngine::filter(FilterCriteria *newCriteria, QList<qint32> *results) {
         }
     } else {
         results->clear();
+        QSet<qint32> seen;
         for (int i=0; i<goodLids.size(); i++) {
-            if (!results->contains(goodLids[i])) {
+            if (!seen.contains(goodLids[i])) {
+                seen.insert(goodLids[i]);
                 results->append(goodLids[i]);
             }
         }
@@ -116,267 +221,151 @@ void FilterEngine::filter(FilterCriteria *newCriteria, QList<qint32> *results) {
 
 
 
+//*****************************************************************
+//* Run a saved search so its results can be stored.  The terms
+//* were split when the search was first stored, so they aren't
+//* parsed again.  If candidates are given only those notes are
+//* checked, which is how the search thread keeps the stored
+//* results current as notes change.
+//*****************************************************************
+void FilterEngine::filterForSavedSearch(FilterCriteria *criteria, QStringList &terms, QList<qint32> &results, QList<qint32> *candidates) {
+    searchTerms = &terms;
+    this->candidates = candidates;
+    storingResults = true;
+    filter(criteria, &results);
+    searchTerms = NULL;
+    this->candidates = NULL;
+    storingResults = false;
+}
+
+
+
+//*****************************************************************
+//* Show a saved search (or a favorite pointing to one) from the
+//* results the search thread stored for it.  This only works if
+//* nothing else is being filtered on, the stored results are
+//* for the same query, the query has no relative dates & no
+//* notes have changed since they were stored.  Returns false
+//* if the search needs to be run the normal way.
+//*****************************************************************
+bool FilterEngine::filterSavedSearch(FilterCriteria *criteria) {
+    if (!criteria->isSet() || !criteria->isSearchStringSet() || criteria->getSearchString().trimmed() == "")
+        return false;
+    if (criteria->isNotebookSet() || criteria->isTagsSet() || criteria->isAttributeSet() ||
+            (criteria->isDeletedOnlySet() && criteria->getDeletedOnly()))
+        return false;
+    if (criteria->isFavoriteSet()) {
+        FavoritesTable ftable(db);
+        FavoritesRecord rec;
+        if (!ftable.get(rec, criteria->getFavorite()) || rec.type != FavoritesRecord::Search)
+            return false;
+    }
+
+    // Dates like "created:day" move on by themselves, so results stored
+    // yesterday aren't any good today.
+    QStringList terms;
+    splitSearchTerms(terms, criteria->getSearchString());
+    QRegExp relativeDate("^-?(created|updated|subjectdate|remindertime|reminderdonetime):(today|day|week|month|year)",
+                         Qt::CaseInsensitive);
+    for (int i=0; i<terms.size(); i++) {
+        if (relativeDate.indexIn(terms[i].trimmed().remove(QChar('"'))) == 0)
+            return false;
+    }
+
+    SearchTable searchTable(db);
+    qint32 search = searchTable.findResults(criteria->getSearchString());
+    if (search <= 0 || searchTable.hasChanges())
+        return false;
+    QLOG_TRACE_IN();
+
+    // Notes may have been deleted or notebooks closed since the results were stored
+    NSqlQuery sql(db);
+    sql.exec("delete from filter");
+    sql.prepare(QString("Insert into filter (lid) select r.lid from SavedSearchResults r join NoteTable n on n.lid=r.lid ") +
+                QString("where r.search=:search and n.notebooklid not in (select lid from datastore where key=:closedNotebooks) ") +
+                QString("and exists (select 1 from DataStore d indexed by DataStore_Lid where d.lid=r.lid and d.key=:active and d.data=1)"));
+    sql.bindValue(":search", search);
+    sql.bindValue(":closedNotebooks", NOTEBOOK_IS_CLOSED);
+    sql.bindValue(":active", NOTE_ACTIVE);
+    sql.exec();
+    sql.finish();
+
+    finishFilter(criteria, true, NULL);
+    return true;
+}
+
+
 void FilterEngine::filterAttributes(FilterCriteria *criteria) {
     if (!criteria->isSet() || !criteria->isAttributeSet())
         return;
     QLOG_TRACE_IN();
 
     int attribute = criteria->getAttribute()->data(0,Qt::UserRole).toInt();
-    NSqlQuery sql(global.db);
-    QDateTime dt;
-    dt.setDate(QDate().currentDate());
-    int dow = QDate().currentDate().dayOfWeek();
-    int moy = QDate().currentDate().month();
-    int dom = QDate().currentDate().day();
-    dt.setTime(QTime(0,0,0,1));
+    NSqlQuery sql(db);
+
+    // Date attributes are numbered by group (created since, created before,
+    // modified since, modified before) times 100 plus the period they cover.
+    // The boundary is worked out once and compared against the indexed
+    // NoteTable date columns.
+    if (attribute >= CREATED_SINCE_TODAY && attribute <= MODIFIED_BEFORE_LAST_YEAR) {
+        int group = attribute/100;
+        QString column = "dateCreated";
+        if (group >= 2)
+            column = "dateUpdated";
+        QString op = ">";
+        if (group % 2 == 1)
+            op = "<";
+        qint64 bound = dateBound(attributeStartDate(attribute % 100), op);
+        sql.prepare("Delete from filter where lid not in (select lid from NoteTable where " + column + op + ":bound)");
+        sql.bindValue(":bound", bound);
+        sql.exec();
+        sql.finish();
+        return;
+    }
 
+    // Todos, encryption & resource types are bits in NoteFlags, so
+    // these are all the same lookup.
+    int flags = 0;
     switch (attribute)
     {
-    case CREATED_SINCE_TODAY:
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>(datetime(:data/1000)))");
-        sql.bindValue(":key", NOTE_CREATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case CREATED_SINCE_YESTERDAY:
-        dt = dt.addDays(-1);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_CREATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case CREATED_SINCE_THIS_WEEK:
-        dt = dt.addDays(-1*dow);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_CREATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case CREATED_SINCE_LAST_WEEK:
-        dt = dt.addDays(-1*dow-7);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_CREATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case CREATED_SINCE_THIS_MONTH:
-        dt = dt.addDays(-1*dom+1);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_CREATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case CREATED_SINCE_LAST_MONTH:
-        dt = dt.addDays(-1*dom+1);
-        dt = dt.addMonths(-1);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_CREATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case CREATED_SINCE_THIS_YEAR:
-        dt = dt.addDays(-1*dom+1);
-        dt = dt.addMonths(-1*moy+1);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_CREATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case CREATED_SINCE_LAST_YEAR:
-        dt = dt.addDays(-1*dom+1);
-        dt = dt.addMonths(-1*moy+1);
-        dt = dt.addYears(-1);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_CREATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case CREATED_BEFORE_TODAY:
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)<(datetime(:data/1000)))");
-        sql.bindValue(":key", NOTE_CREATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case CREATED_BEFORE_YESTERDAY:
-        dt = dt.addDays(-1);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)<(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_CREATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case CREATED_BEFORE_THIS_WEEK:
-        dt = dt.addDays(-1*dow);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)<(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_CREATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case CREATED_BEFORE_LAST_WEEK:
-        dt = dt.addDays(-1*dow-7);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)<(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_CREATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case CREATED_BEFORE_THIS_MONTH:
-        dt = dt.addDays(-1*dom+1);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)<(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_CREATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case CREATED_BEFORE_LAST_MONTH:
-        dt = dt.addDays(-1*dom+1);
-        dt = dt.addMonths(-1);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)<(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_CREATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case CREATED_BEFORE_THIS_YEAR:
-        dt = dt.addDays(-1*dom+1);
-        dt = dt.addMonths(-1*moy+1);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)<(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_CREATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case CREATED_BEFORE_LAST_YEAR:
-        dt = dt.addDays(-1*dom+1);
-        dt = dt.addMonths(-1*moy+1);
-        dt = dt.addYears(-1);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)<(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_CREATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case MODIFIED_SINCE_TODAY:
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>(datetime(:data/1000)))");
-        sql.bindValue(":key", NOTE_UPDATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case MODIFIED_SINCE_YESTERDAY:
-        dt = dt.addDays(-1);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_UPDATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case MODIFIED_SINCE_THIS_WEEK:
-        dt = dt.addDays(-1*dow);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_UPDATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case MODIFIED_SINCE_LAST_WEEK:
-        dt = dt.addDays(-1*dow-7);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_UPDATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case MODIFIED_SINCE_THIS_MONTH:
-        dt = dt.addDays(-1*dom+1);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_UPDATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case MODIFIED_SINCE_LAST_MONTH:
-        dt = dt.addDays(-1*dom+1);
-        dt = dt.addMonths(-1);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_UPDATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case MODIFIED_SINCE_THIS_YEAR:
-        dt = dt.addDays(-1*dom+1);
-        dt = dt.addMonths(-1*moy+1);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_UPDATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case MODIFIED_SINCE_LAST_YEAR:
-        dt = dt.addDays(-1*dom+1);
-        dt = dt.addMonths(-1*moy+1);
-        dt = dt.addYears(-1);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_UPDATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case MODIFIED_BEFORE_TODAY:
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)<(datetime(:data/1000)))");
-        sql.bindValue(":key", NOTE_UPDATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case MODIFIED_BEFORE_YESTERDAY:
-        dt = dt.addDays(-1);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)<(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_UPDATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case MODIFIED_BEFORE_THIS_WEEK:
-        dt = dt.addDays(-1*dow);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)<(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_UPDATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case MODIFIED_BEFORE_LAST_WEEK:
-        dt = dt.addDays(-1*dow-7);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)<(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_UPDATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case MODIFIED_BEFORE_THIS_MONTH:
-        dt = dt.addDays(-1*dom+1);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)<(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_UPDATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case MODIFIED_BEFORE_LAST_MONTH:
-        dt = dt.addDays(-1*dom+1);
-        dt = dt.addMonths(-1);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)<(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_UPDATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case MODIFIED_BEFORE_THIS_YEAR:
-        dt = dt.addDays(-1*dom+1);
-        dt = dt.addMonths(-1*moy+1);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)<(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_UPDATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
-    case MODIFIED_BEFORE_LAST_YEAR:
-        dt = dt.addDays(-1*dom+1);
-        dt = dt.addMonths(-1*moy+1);
-        dt = dt.addYears(-1);
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)<(datetime(:data/1000)))");;
-        sql.bindValue(":key", NOTE_UPDATED_DATE);
-        sql.bindValue(":data", dt.toMSecsSinceEpoch());
-        break;
     case CONTAINS_IMAGES:
-        sql.prepare("Delete from filter where lid not in (select data from datastore where key=:notelidkey and lid in (select lid from DataStore where key=:mimekey and data like 'image/%'))");
-        sql.bindValue(":notelidkey", RESOURCE_NOTE_LID);
-        sql.bindValue(":mimekey", RESOURCE_MIME);
+        flags = NOTE_FLAG_IMAGE;
         break;
     case CONTAINS_AUDIO:
-        sql.prepare("Delete from filter where lid not in (select data from datastore where key=:notelidkey and lid in (select lid from DataStore where key=:mimekey and data like 'audio/%'))");
-        sql.bindValue(":notelidkey", RESOURCE_NOTE_LID);
-        sql.bindValue(":mimekey", RESOURCE_MIME);
+        flags = NOTE_FLAG_AUDIO;
         break;
     case CONTAINS_INK:
-        sql.prepare("Delete from filter where lid not in (select data from datastore where key=:notelidkey and lid in (select lid from DataStore where key=:mimekey and data = 'application/vnd.evernote.ink'))");
-        sql.bindValue(":notelidkey", RESOURCE_NOTE_LID);
-        sql.bindValue(":mimekey", RESOURCE_MIME);
+        flags = NOTE_FLAG_INK;
         break;
     case CONTAINS_ENCRYPTED_TEXT:
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:encryptedkey)");
-        sql.bindValue(":encryptedkey", NOTE_HAS_ENCRYPT);
+        flags = NOTE_FLAG_ENCRYPTED;
         break;
     case CONTAINS_TODO_ITEMS:
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where (key=:comp or key=:uncomp) and data=1)");
-        sql.bindValue(":comp", NOTE_HAS_TODO_COMPLETED);
-        sql.bindValue(":uncomp", NOTE_HAS_TODO_UNCOMPLETED);
+        flags = NOTE_FLAG_TODO_COMPLETED | NOTE_FLAG_TODO_UNCOMPLETED;
         break;
     case CONTAINS_FINISHED_TODO_ITEMS:
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:comp and data=1)");
-        sql.bindValue(":comp", NOTE_HAS_TODO_COMPLETED);
+        flags = NOTE_FLAG_TODO_COMPLETED;
         break;
     case CONTAINS_UNFINISHED_TODO_ITEMS:
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:uncomp and data=1)");
-        sql.bindValue(":uncomp", NOTE_HAS_TODO_UNCOMPLETED);
+        flags = NOTE_FLAG_TODO_UNCOMPLETED;
         break;
     case CONTAINS_PDF_DOCUMENT:
-        sql.prepare("Delete from filter where lid not in (select data from datastore where key=:notelidkey and lid in (select lid from DataStore where key=:mimekey and data ='application/pdf'))");
-        sql.bindValue(":notelidkey", RESOURCE_NOTE_LID);
-        sql.bindValue(":mimekey", RESOURCE_MIME);
+        flags = NOTE_FLAG_PDF;
         break;
     case CONTAINS_ATTACHMENT:
-        sql.prepare("Delete from filter where lid not in (select lid from datastore where key=:key)");
-        sql.bindValue(":key", NOTE_HAS_ATTACHMENT);
+        flags = NOTE_FLAG_ATTACHMENT;
         break;
+    }
+    if (flags != 0) {
+        sql.prepare("Delete from filter where lid not in (select lid from NoteFlags where flags & :flags)");
+        sql.bindValue(":flags", flags);
+        sql.exec();
+        sql.finish();
+        return;
+    }
+
+    switch (attribute)
+    {
     case CONTAINS_REMINDER:
             sql.prepare("Delete from filter where lid not in (select lid from datastore where key=:key)");
             sql.bindValue(":key", NOTE_ATTRIBUTE_REMINDER_TIME);
@@ -422,12 +411,227 @@ void FilterEngine::filterAttributes(FilterCriteria *criteria) {
 
 
 
+//*****************************************************************
+//* Build the full text query used to find the search hits.  This
+//* returns false if any word can't be answered by the index, in
+//* which case the search falls back to the old text scan.
+//*****************************************************************
+bool FilterEngine::searchHitWords(FilterCriteria *criteria, QStringList &words) {
+    words.clear();
+    if (!criteria->isSearchStringSet() || criteria->getSearchString().trimmed() == "")
+        return false;
+
+    QStringList terms;
+    splitSearchTerms(terms, criteria->getSearchString());
+    QRegExp searchOperator("^-?[a-z]+:", Qt::CaseInsensitive);
+    for (int i=0; i<terms.size(); i++) {
+        QString term = terms[i].trimmed();
+        if (term == "" || term.startsWith("-") || searchOperator.indexIn(term) == 0)
+            continue;
+        term = TextFolding::query(term);
+        QChar firstChar = term.at(0);
+        if (term.startsWith("*") || term.contains("_") || term.contains("-") ||
+                firstChar.toLatin1() == 0 || firstChar.isDigit())
+            return false;   // Not an FTS search
+        if (!term.endsWith("*"))
+            term = term + QString("*");
+        if (term.contains(" "))
+            term = "\""+term+"\"";
+        words.append(term);
+    }
+    return true;
+}
+
+
+
+// Add one row of snippet() output to a hit.  The matched words are
+// the ones marked in the snippet, so the note text itself never needs
+// to be read (e.g. "foxes" is found for "fox*").  When the index holds
+// folded text, the snippet is made from the original text in SearchText
+// instead so the words are marked the way they were written (e.g. "Café"
+// for "cafe*").
+void FilterEngine::addSearchHitRow(SearchHit &hit, QString snippet, QString original, QStringList &words) {
+    if (original != "") {
+        QString marked = TextFolding::snippet(original, words, QChar(1), QChar(2), "...", 15);
+        if (marked != "")
+            snippet = marked;
+    }
+
+    int pos = snippet.indexOf(QChar(1));
+    while (pos >= 0) {
+        int endPos = snippet.indexOf(QChar(2), pos);
+        if (endPos < 0)
+            break;
+        QString word = snippet.mid(pos+1, endPos-pos-1).toLower();
+        if (word != "" && !hit.words.contains(word))
+            hit.words.append(word);
+        pos = snippet.indexOf(QChar(1), endPos);
+    }
+
+    if (hit.snippet == "") {
+#if QT_VERSION < 0x050000
+        snippet = Qt::escape(snippet);
+#else
+        snippet = snippet.toHtmlEscaped();
+#endif
+        snippet.replace(QChar(1), "<b>");
+        snippet.replace(QChar(2), "</b>");
+        hit.snippet = snippet;
+    }
+}
+
+
+
+//*****************************************************************
+//* Ask the full text index where the search words matched in the
+//* notes left in the filter.  snippet() gives a preview for the
+//* note list with the matched words marked.  A broad search can
+//* match most of the database, so only the first SEARCH_HITS_LIMIT
+//* rows are collected here.  The rest are looked up one at a time
+//* by getSearchHit() when the note list or editor needs them.
+//*****************************************************************
+void FilterEngine::findSearchHits(FilterCriteria *criteria) {
+    criteria->unsetSearchHits();
+    QStringList words;
+    if (!searchHitWords(criteria, words))
+        return;
+    QLOG_TRACE_IN();
+
+    SearchHits hits;
+    if (words.size() == 0) {
+        criteria->setSearchHits(hits);
+        return;
+    }
+
+    NSqlQuery sql(db);
+    sql.prepare(QString("select SearchIndex.lid, snippet(SearchIndex, '\x01', '\x02', '...', 3, 15), t.original ") +
+                QString("from SearchIndex left join DataStore d on d.lid=SearchIndex.lid and d.key=:key ") +
+                QString("left join SearchText t on t.docid=SearchIndex.docid ") +
+                QString("where content match :words and weight>=:weight and ") +
+                QString("(SearchIndex.lid in (select lid from filter) or d.data in (select lid from filter)) ") +
+                QString("order by SearchIndex.lid limit :limit"));
+    sql.bindValue(":key", RESOURCE_NOTE_LID);
+    sql.bindValue(":words", words.join(" OR "));
+    sql.bindValue(":weight", minimumWeight);
+    sql.bindValue(":limit", SEARCH_HITS_LIMIT);
+    sql.exec();
+    int rows = 0;
+    qint32 lastLid = -1;
+    while (sql.next()) {
+        rows++;
+        lastLid = sql.value(0).toInt();
+        addSearchHitRow(hits[lastLid], sql.value(1).toString(), sql.value(2).toString(), words);
+    }
+    sql.finish();
+
+    // If we hit the limit the last lid may only have some of its rows,
+    // so leave it to be looked up again.
+    bool complete = rows < SEARCH_HITS_LIMIT;
+    if (!complete)
+        hits.remove(lastLid);
+    criteria->setSearchHits(hits, complete);
+    QLOG_DEBUG() << "Search hits found in " << hits.size() << " notes & resources" << (complete ? "" : " (limited)");
+}
+
+
+
+// Get the search hit for a note or resource.  If the search only
+// collected its first hits, a lid we don't know about yet is looked
+// up in the index & remembered.
+bool FilterEngine::getSearchHit(FilterCriteria *criteria, qint32 lid, SearchHit &hit) {
+    if (criteria->getSearchHit(lid, hit))
+        return true;
+    if (!criteria->isSearchHitsSet() || criteria->isSearchHitKnown(lid))
+        return false;
+
+    QStringList words;
+    if (!searchHitWords(criteria, words) || words.size() == 0) {
+        criteria->addSearchMiss(lid);
+        return false;
+    }
+
+    SearchHit newHit;
+    bool found = false;
+    NSqlQuery sql(db);
+    sql.prepare(QString("select snippet(SearchIndex, '\x01', '\x02', '...', 3, 15), t.original from SearchIndex ") +
+                QString("left join SearchText t on t.docid=SearchIndex.docid ") +
+                QString("where lid=:lid and weight>=:weight and content match :words"));
+    sql.bindValue(":lid", lid);
+    sql.bindValue(":words", words.join(" OR "));
+    sql.bindValue(":weight", minimumWeight);
+    sql.exec();
+    while (sql.next()) {
+        found = true;
+        addSearchHitRow(newHit, sql.value(0).toString(), sql.value(1).toString(), words);
+    }
+    sql.finish();
+
+    if (!found) {
+        criteria->addSearchMiss(lid);
+        return false;
+    }
+    criteria->addSearchHit(lid, newHit);
+    hit = newHit;
+    return true;
+}
+
+
+
+// Get the start of the period a date attribute refers to.  The periods are
+// 1=today, 2=yesterday, 3=this week, 4=last week, 5=this month, 6=last month,
+// 7=this year & 8=last year.
+QDateTime FilterEngine::attributeStartDate(int period) {
+    QDateTime dt;
+    dt.setDate(QDate().currentDate());
+    int dow = QDate().currentDate().dayOfWeek();
+    int moy = QDate().currentDate().month();
+    int dom = QDate().currentDate().day();
+    dt.setTime(QTime(0,0,0,1));
+
+    switch (period) {
+    case 2:
+        return dt.addDays(-1);
+    case 3:
+        return dt.addDays(-1*dow);
+    case 4:
+        return dt.addDays(-1*dow-7);
+    case 5:
+        return dt.addDays(-1*dom+1);
+    case 6:
+        return dt.addDays(-1*dom+1).addMonths(-1);
+    case 7:
+        return dt.addDays(-1*dom+1).addMonths(-1*moy+1);
+    case 8:
+        return dt.addDays(-1*dom+1).addMonths(-1*moy+1).addYears(-1);
+    }
+    return dt;
+}
+
+
+
+// Turn a date into an epoch-ms bound that can be compared directly
+// against a date column so SQLite can use the column index.  Dates
+// are compared to the whole second, so the bound is rounded and the
+// operator rewritten to >= or < to match.  (The old datetime(data/1000)
+// comparisons passed SQLite a Julian day number that is out of range,
+// so they evaluated to NULL and never matched.)
+qint64 FilterEngine::dateBound(QDateTime dt, QString &op) {
+    qint64 seconds = dt.toMSecsSinceEpoch()/1000;
+    if (op == ">" || op == "<=") {
+        op = (op == ">") ? ">=" : "<";
+        return (seconds+1)*1000;
+    }
+    return seconds*1000;
+}
+
+
+
 void FilterEngine::filterFavorite(FilterCriteria *criteria) {
     if (!criteria->isSet() || !criteria->isFavoriteSet())
         return;
     QLOG_TRACE_IN();
 
-    FavoritesTable ftable(global.db);
+    FavoritesTable ftable(db);
     FavoritesRecord rec;
     if (!ftable.get(rec, criteria->getFavorite()))
         return;
@@ -438,7 +642,7 @@ void FilterEngine::filterFavorite(FilterCriteria *criteria) {
         rec.type == FavoritesRecord::SharedNotebook ||
         rec.type == FavoritesRecord::SynchronizedNotebook) {
         qint32 notebookLid = rec.target.toInt();
-        NotebookTable ntable(global.db);
+        NotebookTable ntable(db);
         QString guid="";
         if (ntable.getGuid(guid, notebookLid)) {
             filterIndividualNotebook(guid);
@@ -454,26 +658,17 @@ void FilterEngine::filterFavorite(FilterCriteria *criteria) {
     }
 
     if (rec.type == FavoritesRecord::Tag) {
-        NoteTable noteTable(global.db);
-        TagTable tagTable(global.db);
-        NSqlQuery sql(global.db);
-        sql.exec("create temporary table if not exists goodLids (lid integer)");
-        sql.exec("delete from goodLids");
-        QList<qint32> notes;
-        QString tagGuid="";
-        tagTable.getGuid(tagGuid, rec.target.toInt());
-        noteTable.getNotesWithTag(notes, tagGuid);
-        sql.prepare("insert into goodLids (lid) values (:note)");
-        for (qint32 i=0; i<notes.size(); i++) {
-            sql.bindValue(":note", notes[i]);
-            sql.exec();
-        }
-        sql.exec("delete from filter where lid not in (select lid from goodLids)" );
+        NSqlQuery sql(db);
+        sql.prepare("Delete from filter where lid not in (select lid from datastore where key=:notetagkey and data in (select descendant from TagClosure where ancestor=:tag and depth<=:depth))");
+        sql.bindValue(":notetagkey", NOTE_TAG_LID);
+        sql.bindValue(":tag", rec.target.toInt());
+        sql.bindValue(":depth", tagFilterDepth());
+        sql.exec();
         sql.finish();
     }
 
     if (rec.type == FavoritesRecord::Note) {
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         sql.prepare("delete from filter where lid <> :lid");
         sql.bindValue(":lid", rec.target);
         sql.exec();
@@ -492,9 +687,8 @@ void FilterEngine::filterNotebook(FilterCriteria *criteria) {
         QString stackName = criteria->getNotebook()->text(0);
         filterStack(stackName);
     } else {
-        FilterCriteria *criteria = global.filterCriteria[global.filterPosition];
         qint32 notebookLid = criteria->getNotebook()->data(0,Qt::UserRole).toInt();
-        NotebookTable notebookTable(global.db);
+        NotebookTable notebookTable(db);
         QString notebook;
         notebookTable.getGuid(notebook, notebookLid);
         filterIndividualNotebook(notebook);
@@ -507,10 +701,10 @@ void FilterEngine::filterNotebook(FilterCriteria *criteria) {
 // If they only chose one notebook, then delete everything else
 void FilterEngine::filterIndividualNotebook(QString &notebook) {
     QLOG_TRACE_IN();
-    NotebookTable notebookTable(global.db);
+    NotebookTable notebookTable(db);
     qint32 notebookLid = notebookTable.getLid(notebook);
     // Filter out the records
-    NSqlQuery sql(global.db);
+    NSqlQuery sql(db);
     sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:type and data=:notebookLid)");
     sql.bindValue(":type", NOTE_NOTEBOOK_LID);
     sql.bindValue(":notebookLid", notebookLid);
@@ -530,13 +724,13 @@ void FilterEngine::filterStack(QString &stack) {
     if (stack.startsWith("stack:"))
         stack = stack.mid(stack.indexOf("stack:")+6);
 
-    NotebookTable notebookTable(global.db);
+    NotebookTable notebookTable(db);
     QList<qint32> books;
     QList<qint32> stackBooks;
     notebookTable.getAll(books);
     notebookTable.getStack(stackBooks, stack);
 
-    NSqlQuery sql(global.db);
+    NSqlQuery sql(db);
     if (negative) {
         sql.exec("create temporary table if not exists goodLids (lid integer)");
         sql.exec("delete from goodLids");
@@ -573,36 +767,25 @@ void FilterEngine::filterTags(FilterCriteria *criteria) {
     QLOG_TRACE_IN();
     QList<QTreeWidgetItem*> tags = criteria->getTags();
 
-    if (!global.getTagSelectionOr()) {
-        NSqlQuery query(global.db);
+    if (!tagSelectionOr) {
+        NSqlQuery query(db);
         for (qint32 i=0; i<tags.size(); i++) {
-            query.prepare("Delete from filter where lid not in (select lid from datastore where key=:notetagkey and data=:data)");
+            query.prepare("Delete from filter where lid not in (select lid from datastore where key=:notetagkey and data in (select descendant from TagClosure where ancestor=:data and depth<=:depth))");
             query.bindValue(":notetagkey", NOTE_TAG_LID);
             query.bindValue(":data", tags[i]->data(0,Qt::UserRole).toInt())  ;
+            query.bindValue(":depth", tagFilterDepth());
             query.exec();
         }
         query.finish();
     } else {
-        NoteTable noteTable(global.db);
-        TagTable tagTable(global.db);
-        QList<qint32> goodNotes;
-        for (qint32 i=0; i<tags.size(); i++) {
-            QList<qint32> notes;
-            QString tagGuid;
-            tagTable.getGuid(tagGuid, tags[i]->data(0,Qt::UserRole).toInt());
-            noteTable.getNotesWithTag(notes, tagGuid);
-            for (qint32 j=0; j<notes.size(); j++) {
-                if (!goodNotes.contains(notes[j]))
-                    goodNotes.append(notes[j]);
-            }
-        }
-
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         sql.exec("create temporary table if not exists goodLids (lid integer)");
         sql.exec("delete from goodLids");
-        sql.prepare("insert into goodLids (lid) values (:note)");
-        for (qint32 i=0; i<goodNotes.size(); i++) {
-            sql.bindValue(":note", goodNotes[i]);
+        sql.prepare("insert into goodLids (lid) select lid from datastore where key=:notetagkey and data in (select descendant from TagClosure where ancestor=:data and depth<=:depth)");
+        for (qint32 i=0; i<tags.size(); i++) {
+            sql.bindValue(":notetagkey", NOTE_TAG_LID);
+            sql.bindValue(":data", tags[i]->data(0,Qt::UserRole).toInt());
+            sql.bindValue(":depth", tagFilterDepth());
             sql.exec();
         }
         sql.exec("delete from filter where lid not in (select lid from goodLids)" );
@@ -616,7 +799,7 @@ void FilterEngine::filterTrash(FilterCriteria *criteria) {
     if (!criteria->isSet() || !criteria->isDeletedOnlySet()
             || (criteria->isDeletedOnlySet() && !criteria->getDeletedOnly()))
     {
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:type and data=1)");
         sql.bindValue(":type", NOTE_ACTIVE);
         sql.exec();
@@ -627,7 +810,7 @@ void FilterEngine::filterTrash(FilterCriteria *criteria) {
         return;
 
     // Filter out the records
-    NSqlQuery sql(global.db);
+    NSqlQuery sql(db);
     sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:type and data=0)");
     sql.bindValue(":type", NOTE_ACTIVE);
     sql.exec();
@@ -650,7 +833,10 @@ void FilterEngine::filterSearchString(FilterCriteria *criteria) {
     // Tokenize out the words
     QStringList list;
     QLOG_DEBUG() << "Original String Search: " << criteria->getSearchString();
-    splitSearchTerms(list, criteria->getSearchString());
+    if (searchTerms != NULL)
+        list = *searchTerms;
+    else
+        splitSearchTerms(list, criteria->getSearchString());
 
     if (!anyFlagSet)
         filterSearchStringAll(list);
@@ -721,7 +907,7 @@ void FilterEngine::splitSearchTerms(QStringList &words, QString search) {
 void FilterEngine::filterSearchStringAll(QStringList list) {
     QLOG_TRACE_IN();
     // Filter out the records
-    NSqlQuery sql(global.db), sqlnegative(global.db);
+    NSqlQuery sql(db), sqlnegative(db);
 
     sql.prepare(QString("Delete from filter where lid not in ") +
                 QString("(select lid from SearchIndex where weight>=:weight and content match :word)") +
@@ -732,15 +918,21 @@ void FilterEngine::filterSearchStringAll(QStringList list) {
                 QString(" or lid in (select data from DataStore where key=:key and lid in ") +
                 QString("(select lid from SearchIndex where weight>=:weight2 and content match :word2))"));
 
-    sql.bindValue(":weight", global.getMinimumRecognitionWeight());
-    sql.bindValue(":weight2", global.getMinimumRecognitionWeight());
+    sql.bindValue(":weight", minimumWeight);
+    sql.bindValue(":weight2", minimumWeight);
     sql.bindValue(":key", RESOURCE_NOTE_LID);
 
-    sqlnegative.bindValue(":weight", global.getMinimumRecognitionWeight());
-    sqlnegative.bindValue(":weight2", global.getMinimumRecognitionWeight());
+    sqlnegative.bindValue(":weight", minimumWeight);
+    sqlnegative.bindValue(":weight2", minimumWeight);
     sqlnegative.bindValue(":key", RESOURCE_NOTE_LID);
 
+    // All of the latitude & longitude terms are done at once as a bounding box
+    if (global.geographyIndex)
+        filterSearchStringBoundingBoxAll(list);
+
     for (qint32 i=0; i<list.size(); i++) {
+        if (isCancelled())
+            return;
         QString string = list[i];
         string.remove(QChar('"'));
 
@@ -825,16 +1017,27 @@ void FilterEngine::filterSearchStringAll(QStringList list) {
                 string.startsWith("-subjectdate:", Qt::CaseInsensitive)) {
             filterSearchStringDateAll(string);
         }
+        else if (string.startsWith("fuzzy:", Qt::CaseInsensitive) ||
+                string.startsWith("-fuzzy:", Qt::CaseInsensitive)) {
+            filterSearchStringFuzzyAll(string);
+        }
+        else if (string.startsWith("near:", Qt::CaseInsensitive) ||
+                string.startsWith("-near:", Qt::CaseInsensitive)) {
+            filterSearchStringNearAll(string);
+        }
+        else if (string.startsWith("-*") && filterSearchStringInfix(string.mid(2), true)) {
+            // Negative postfix search done with the trigram index
+        }
         else if (string.startsWith("-*")) {   // Negative postfix search.  FTS doesn't do this.
             string = string.mid(1);
             string = string.replace("*", "%");
             if (!string.endsWith("%"))
                 string = string +QString("%");
-            NSqlQuery prefix(global.db);
+            NSqlQuery prefix(db);
             prefix.prepare("Delete from filter where lid in (select lid from SearchIndex where weight>=:weight and content like :word) or lid in (select data from DataStore where lid in (select lid from SearchIndex where weight>:weight2 and content like :word2))");
 
-            prefix.bindValue(":weight", global.getMinimumRecognitionWeight());
-            prefix.bindValue(":weight2", global.getMinimumRecognitionWeight());
+            prefix.bindValue(":weight", minimumWeight);
+            prefix.bindValue(":weight2", minimumWeight);
             prefix.bindValue(":word", string);
             prefix.bindValue(":word2", string);
             prefix.exec();
@@ -846,11 +1049,11 @@ void FilterEngine::filterSearchStringAll(QStringList list) {
                 string = string +QString("%");
             if (!string.startsWith("%"))
                 string = QString("%") + string;
-            NSqlQuery prefix(global.db);
+            NSqlQuery prefix(db);
             prefix.prepare("Delete from filter where lid not in (select lid from SearchIndex where weight>=:weight and content like :word escape '/') and lid not in (select data from DataStore where key=:key and lid in (select lid from SearchIndex where weight>:weight2 and content like :word2 escape '/'))");
 
-            prefix.bindValue(":weight", global.getMinimumRecognitionWeight());
-            prefix.bindValue(":weight2", global.getMinimumRecognitionWeight());
+            prefix.bindValue(":weight", minimumWeight);
+            prefix.bindValue(":weight2", minimumWeight);
             prefix.bindValue(":word", string);
             prefix.bindValue(":word2", string);
             prefix.bindValue(":key", RESOURCE_NOTE_LID);
@@ -862,17 +1065,19 @@ void FilterEngine::filterSearchStringAll(QStringList list) {
                 string = string +QString("%");
             if (!string.startsWith("%"))
                 string = QString("%") + string;
-            NSqlQuery prefix(global.db);
+            NSqlQuery prefix(db);
             prefix.prepare("Delete from filter where lid not in (select lid from SearchIndex where weight>=:weight and content like :word) and lid not in (select data from DataStore where key=:key and lid in (select lid from SearchIndex where weight>:weight2 and content like :word2))");
 
-            prefix.bindValue(":weight", global.getMinimumRecognitionWeight());
-            prefix.bindValue(":weight2", global.getMinimumRecognitionWeight());
+            prefix.bindValue(":weight", minimumWeight);
+            prefix.bindValue(":weight2", minimumWeight);
             prefix.bindValue(":word", string);
             prefix.bindValue(":word2", string);
             prefix.bindValue(":key", RESOURCE_NOTE_LID);
             prefix.exec();
         }
         else {
+            // Fold & stem the words the same way the index was
+            string = TextFolding::query(string);
 
             // Hack here, by julee. For Chinese, we need use Postfix search
             if(!string.startsWith("*")) {
@@ -883,15 +1088,18 @@ void FilterEngine::filterSearchStringAll(QStringList list) {
                 }
             }
 
-            if (string.startsWith("*")) {    // Postfix search.  FTS doesn't do this.
+            if (string.startsWith("*") && filterSearchStringInfix(string.mid(1), false)) {
+                // Postfix search done with the trigram index
+            }
+            else if (string.startsWith("*")) {    // Postfix search.  FTS doesn't do this.
                 string = string.replace("*", "%");
                 if (!string.endsWith("%"))
                     string = string +QString("%");
-                NSqlQuery prefix(global.db);
+                NSqlQuery prefix(db);
                 prefix.prepare("Delete from filter where lid not in (select lid from SearchIndex where weight>=:weight and content like :word) and lid not in (select data from DataStore where key=:key and lid in (select lid from SearchIndex where weight>:weight2 and content like :word2))");
 
-                prefix.bindValue(":weight", global.getMinimumRecognitionWeight());
-                prefix.bindValue(":weight2", global.getMinimumRecognitionWeight());
+                prefix.bindValue(":weight", minimumWeight);
+                prefix.bindValue(":weight2", minimumWeight);
                 prefix.bindValue(":word", string);
                 prefix.bindValue(":word2", string);
                 prefix.bindValue(":key", RESOURCE_NOTE_LID);
@@ -905,6 +1113,11 @@ void FilterEngine::filterSearchStringAll(QStringList list) {
                         string = string +QString("*");
                     if (string.contains(" "))
                         string = "\""+string+"\"";
+                    if (cancelToken != NULL) {
+                        if (!filterFtsCancellable(string, true))
+                            return;
+                        continue;
+                    }
                     sqlnegative.bindValue(":key", RESOURCE_NOTE_LID);
                     sqlnegative.bindValue(":word", string);
                     sqlnegative.bindValue(":word2", string);
@@ -914,6 +1127,11 @@ void FilterEngine::filterSearchStringAll(QStringList list) {
                         string = string +QString("*");
                     if (string.contains(" "))
                         string = "\""+string+"\"";
+                    if (cancelToken != NULL) {
+                        if (!filterFtsCancellable(string, false))
+                            return;
+                        continue;
+                    }
                     sql.bindValue(":key", RESOURCE_NOTE_LID);
                     sql.bindValue(":word", string);
                     sql.bindValue(":word2", string);
@@ -931,6 +1149,146 @@ void FilterEngine::filterSearchStringAll(QStringList list) {
 
 
 
+// Run a single FTS term a row at a time rather than as one delete statement.  This
+// is only used by background searches so a search that has been superseded can stop
+// in the middle of a long scan.  Returns false if the search was cancelled.
+bool FilterEngine::filterFtsCancellable(QString word, bool negative) {
+    NSqlQuery sql(db), lids(db);
+    sql.exec("create temporary table if not exists ftslids (lid integer)");
+    sql.exec("delete from ftslids");
+
+    sql.prepare("select lid from SearchIndex where weight>=:weight and content match :word");
+    sql.bindValue(":weight", minimumWeight);
+    sql.bindValue(":word", word);
+    sql.exec();
+
+    lids.exec("begin");
+    lids.prepare("insert into ftslids (lid) values (:lid)");
+    qint32 count = 0;
+    while (sql.next()) {
+        if (++count % 250 == 0 && isCancelled()) {
+            sql.finish();
+            lids.exec("rollback");
+            return false;
+        }
+        lids.bindValue(":lid", sql.value(0).toInt());
+        lids.exec();
+    }
+    sql.finish();
+
+    // Resource hits count against the note that owns them
+    lids.prepare("insert into ftslids (lid) select data from DataStore where key=:key and lid in (select lid from ftslids)");
+    lids.bindValue(":key", RESOURCE_NOTE_LID);
+    lids.exec();
+    lids.exec("commit");
+
+    if (negative)
+        lids.exec("Delete from filter where lid in (select lid from ftslids)");
+    else
+        lids.exec("Delete from filter where lid not in (select lid from ftslids)");
+    lids.finish();
+    return !isCancelled();
+}
+
+
+
+
+// Load a list of lids found outside of SQL (the trigram index, near: ...) into
+// a temporary table so they can be used in the filter queries.
+void FilterEngine::loadSearchLids(QList<qint32> &lids) {
+    NSqlQuery sql(db);
+    sql.exec("create temporary table if not exists searchlids (lid integer)");
+    sql.exec("delete from searchlids");
+    sql.exec("begin");
+    sql.prepare("insert into searchlids (lid) values (:lid)");
+    for (int i=0; i<lids.size(); i++) {
+        sql.bindValue(":lid", lids[i]);
+        sql.exec();
+    }
+    sql.exec("commit");
+    sql.finish();
+}
+
+
+
+// Do an infix ("*word") search with the trigram index.  Only the note text is
+// in the trigram index, so resources are still checked with a "like", but only
+// against recognition rows rather than the whole SearchIndex.  Returns false
+// if the trigram index can't be used and the caller needs to do it the old way.
+bool FilterEngine::filterSearchStringInfix(QString fragment, bool negative) {
+    if (!global.trigramIndex)
+        return false;
+    fragment = fragment.replace("*", " ").trimmed();
+    if (fragment.contains(" "))
+        return false;
+
+    // Text without spaces (Chinese, Japanese, ...) is one long "word" to the
+    // trigram index, so leave those to the "like" search.
+    for (int i=0; i<fragment.length(); i++) {
+        if (fragment.at(i).toLatin1() == 0)
+            return false;
+    }
+    QList<qint32> lids;
+    TrigramTable trigramTable(db);
+    if (trigramTable.findInfix(fragment, lids) < 0)
+        return false;
+    loadSearchLids(lids);
+
+    QString like = fragment;
+    like = QString("%") + like.replace("/","//").replace("%","/%").replace("_","/_") + QString("%");
+    NSqlQuery sql(db);
+    if (negative)
+        sql.prepare("Delete from filter where lid in (select lid from searchlids) or lid in (select data from DataStore where key=:key and lid in (select lid from SearchIndex where source match 'recognition' and weight>=:weight and content like :word escape '/'))");
+    else
+        sql.prepare("Delete from filter where lid not in (select lid from searchlids) and lid not in (select data from DataStore where key=:key and lid in (select lid from SearchIndex where source match 'recognition' and weight>=:weight and content like :word escape '/'))");
+    sql.bindValue(":key", RESOURCE_NOTE_LID);
+    sql.bindValue(":weight", minimumWeight);
+    sql.bindValue(":word", like);
+    sql.exec();
+    sql.finish();
+    return true;
+}
+
+
+
+// Find notes with words similar to the one given.  This is for the "all" filter.  If
+// there isn't a trigram index this is an ordinary word search.
+void FilterEngine::filterSearchStringFuzzyAll(QString string) {
+    bool negative = false;
+    if (string.startsWith("-")) {
+        negative = true;
+        string = string.remove(0,1);
+    }
+    string = string.mid(6).trimmed();
+    if (string == "")
+        return;
+
+    NSqlQuery sql(db);
+    if (global.trigramIndex) {
+        QList<qint32> lids;
+        TrigramTable trigramTable(db);
+        trigramTable.findFuzzy(string, TRIGRAM_FUZZY_THRESHOLD, lids);
+        loadSearchLids(lids);
+        if (negative)
+            sql.exec("Delete from filter where lid in (select lid from searchlids)");
+        else
+            sql.exec("Delete from filter where lid not in (select lid from searchlids)");
+    } else {
+        QLOG_DEBUG() << "Trigram index not enabled.  Using an exact search for fuzzy:" << string;
+        if (negative)
+            sql.prepare("Delete from filter where lid in (select lid from SearchIndex where source='text' and weight>=:weight and content match :word)");
+        else
+            sql.prepare("Delete from filter where lid not in (select lid from SearchIndex where source='text' and weight>=:weight and content match :word)");
+        sql.bindValue(":weight", minimumWeight);
+        sql.bindValue(":word", TextFolding::query(string));
+        sql.exec();
+    }
+    sql.finish();
+}
+
+
+
+
 // filter based upon the title string the user specified.  This is for the "all"
 // filter and not the "any".
 void FilterEngine::filterSearchStringIntitleAll(QString string) {
@@ -940,7 +1298,7 @@ void FilterEngine::filterSearchStringIntitleAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery tagSql(global.db);
+        NSqlQuery tagSql(db);
         string = string.replace("*", "%");
         if (!string.endsWith("%"))
             string = string +QString("%");
@@ -957,7 +1315,7 @@ void FilterEngine::filterSearchStringIntitleAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery tagSql(global.db);
+        NSqlQuery tagSql(db);
         string = string.replace("*", "%");
         if (not string.contains("%"))
             string = QString("%") +string +QString("%");
@@ -975,6 +1333,8 @@ void FilterEngine::filterSearchStringIntitleAll(QString string) {
 
 // filter based upon the note coordinates the user specified.  This is for the "all"
 // filter and not the "any".
+// "latitude:x" finds notes at or above x and "-latitude:x" finds notes below it.  Notes
+// without a location never match.
 void FilterEngine::filterSearchStringCoordinatesAll(QString string, int key) {
     QLOG_TRACE_IN();
     bool negative = false;
@@ -982,27 +1342,168 @@ void FilterEngine::filterSearchStringCoordinatesAll(QString string, int key) {
         negative = true;
     int separator = string.indexOf(":")+1;
     string = string.mid(separator);
+    if (string == "")
+        string = "0";
+    NSqlQuery sql(db);
     if (negative) {
-        if (string == "")
-            string = "0";
-        // Filter out the records
-        NSqlQuery sql(global.db);
+        sql.prepare("Delete from filter where lid not in (select lid from datastore where key=:key and data < :data)");
+    } else {
         sql.prepare("Delete from filter where lid not in (select lid from datastore where key=:key and data >= :data)");
-        sql.bindValue(":key", key);
-        sql.bindValue(":data", string.toDouble());
-        sql.exec();
-        sql.finish();
+    }
+    sql.bindValue(":key", key);
+    sql.bindValue(":data", string.toDouble());
+    sql.exec();
+    sql.finish();
+}
+
+
+
+// Do all of the latitude: & longitude: terms with one probe of the note location
+// R*Tree.  Those terms are removed from the list so they aren't done again.  The
+// R*Tree stores its bounds as 32 bit floats rounded outwards, so it only narrows
+// things down & the exact values are checked in the DataStore.  A note needs both
+// a latitude & longitude to be in the index, so if only one of them is searched
+// for the terms are left to be done one at a time.
+void FilterEngine::filterSearchStringBoundingBoxAll(QStringList &list) {
+    double minLatitude = -1000, maxLatitude = 1000;
+    double minLongitude = -1000, maxLongitude = 1000;
+    bool latitudeFound = false, longitudeFound = false;
+    QList<int> terms;
+    for (int i=list.size()-1; i>=0; i--) {
+        QString string = list[i];
+        string.remove(QChar('"'));
+        bool negative = string.startsWith("-");
+        if (negative)
+            string = string.mid(1);
+        bool latitude = string.startsWith("latitude:", Qt::CaseInsensitive);
+        bool longitude = string.startsWith("longitude:", Qt::CaseInsensitive);
+        if (!latitude && !longitude)
+            continue;
+        double value = string.mid(string.indexOf(":")+1).toDouble();
+        double &minValue = latitude ? minLatitude : minLongitude;
+        double &maxValue = latitude ? maxLatitude : maxLongitude;
+        if (negative)
+            maxValue = qMin(maxValue, value);
+        else
+            minValue = qMax(minValue, value);
+        terms.append(i);
+        latitudeFound = latitudeFound || latitude;
+        longitudeFound = longitudeFound || longitude;
+    }
+    if (!latitudeFound || !longitudeFound)
+        return;
+    for (int i=0; i<terms.size(); i++)
+        list.removeAt(terms[i]);
+
+    NSqlQuery sql(db);
+    sql.prepare(QString("Delete from filter where lid not in (select g.lid from NoteGeography g, DataStore a, DataStore b where ") +
+                QString("g.maxLatitude>=:minLatitude and g.minLatitude<:maxLatitude and ") +
+                QString("g.maxLongitude>=:minLongitude and g.minLongitude<:maxLongitude and ") +
+                QString("a.lid=g.lid and a.key=:latitudeKey and a.data>=:minLatitude2 and a.data<:maxLatitude2 and ") +
+                QString("b.lid=g.lid and b.key=:longitudeKey and b.data>=:minLongitude2 and b.data<:maxLongitude2)"));
+    sql.bindValue(":minLatitude", minLatitude);
+    sql.bindValue(":maxLatitude", maxLatitude);
+    sql.bindValue(":minLongitude", minLongitude);
+    sql.bindValue(":maxLongitude", maxLongitude);
+    sql.bindValue(":latitudeKey", NOTE_ATTRIBUTE_LATITUDE);
+    sql.bindValue(":minLatitude2", minLatitude);
+    sql.bindValue(":maxLatitude2", maxLatitude);
+    sql.bindValue(":longitudeKey", NOTE_ATTRIBUTE_LONGITUDE);
+    sql.bindValue(":minLongitude2", minLongitude);
+    sql.bindValue(":maxLongitude2", maxLongitude);
+    sql.exec();
+    sql.finish();
+}
+
+
+
+// Find the notes within a distance of a point.  The search is "near:latitude,longitude"
+// or "near:latitude,longitude,km" and the distance defaults to 10km.  Candidates inside
+// the bounding box of the circle come from the location index (or the DataStore if there
+// isn't one) and are then checked with the haversine formula.  Returns false if the
+// search couldn't be understood.
+bool FilterEngine::findNotesNear(QString string, QList<qint32> &lids) {
+    lids.clear();
+    QStringList parms = string.mid(string.indexOf(":")+1).split(",");
+    if (parms.size() < 2)
+        return false;
+    bool latitudeOk, longitudeOk, radiusOk = true;
+    double latitude = parms[0].toDouble(&latitudeOk);
+    double longitude = parms[1].toDouble(&longitudeOk);
+    double radius = 10.0;
+    if (parms.size() > 2)
+        radius = parms[2].toLower().remove("km").toDouble(&radiusOk);
+    if (!latitudeOk || !longitudeOk || !radiusOk || radius <= 0) {
+        QLOG_DEBUG() << "Invalid near: search " << string;
+        return false;
+    }
+
+    // Bounding box of the circle.  If it goes over a pole or the date line
+    // we just look at every longitude & let the distance check sort it out.
+    const double earthRadius = 6371.0;
+    const double kmPerDegree = earthRadius * M_PI / 180.0;
+    double deltaLatitude = radius / kmPerDegree;
+    double minLongitude = -180, maxLongitude = 180;
+    if (qAbs(latitude) + deltaLatitude < 90) {
+        double deltaLongitude = radius / (kmPerDegree * qCos(latitude * M_PI / 180.0));
+        if (longitude - deltaLongitude >= -180 && longitude + deltaLongitude <= 180) {
+            minLongitude = longitude - deltaLongitude;
+            maxLongitude = longitude + deltaLongitude;
+        }
+    }
+
+    NSqlQuery sql(db);
+    // The index bounds are rounded outwards, so the distance is worked out
+    // from the exact values in the DataStore.
+    if (global.geographyIndex) {
+        sql.prepare(QString("Select g.lid, a.data, b.data from NoteGeography g, DataStore a, DataStore b where ") +
+                    QString("g.maxLatitude>=:minLatitude and g.minLatitude<=:maxLatitude and ") +
+                    QString("g.maxLongitude>=:minLongitude and g.minLongitude<=:maxLongitude and ") +
+                    QString("a.lid=g.lid and a.key=:latitudeKey and b.lid=g.lid and b.key=:longitudeKey"));
     } else {
-        if (string == "")
-            string = "0";
-        // Filter out the records
-        NSqlQuery sql(global.db);
-        sql.prepare("Delete from filter where lid in (select lid from datastore where key=:key and data <= :data)");
-        sql.bindValue(":key", key);
-        sql.bindValue(":data", string.toDouble());
-        sql.exec();
-        sql.finish();
+        sql.prepare(QString("Select a.lid, a.data, b.data from DataStore a, DataStore b where a.lid=b.lid and ") +
+                    QString("a.key=:latitudeKey and b.key=:longitudeKey and ") +
+                    QString("a.data>=:minLatitude and a.data<=:maxLatitude and ") +
+                    QString("b.data>=:minLongitude and b.data<=:maxLongitude"));
+    }
+    sql.bindValue(":latitudeKey", NOTE_ATTRIBUTE_LATITUDE);
+    sql.bindValue(":longitudeKey", NOTE_ATTRIBUTE_LONGITUDE);
+    sql.bindValue(":minLatitude", latitude - deltaLatitude);
+    sql.bindValue(":maxLatitude", latitude + deltaLatitude);
+    sql.bindValue(":minLongitude", minLongitude);
+    sql.bindValue(":maxLongitude", maxLongitude);
+    sql.exec();
+
+    double lat1 = latitude * M_PI / 180.0;
+    double lon1 = longitude * M_PI / 180.0;
+    while (sql.next()) {
+        double lat2 = sql.value(1).toDouble() * M_PI / 180.0;
+        double lon2 = sql.value(2).toDouble() * M_PI / 180.0;
+        double a = qPow(qSin((lat2-lat1)/2), 2) + qCos(lat1) * qCos(lat2) * qPow(qSin((lon2-lon1)/2), 2);
+        double distance = 2 * earthRadius * qAsin(qSqrt(qMin(1.0, a)));
+        if (distance <= radius)
+            lids.append(sql.value(0).toInt());
     }
+    sql.finish();
+    return true;
+}
+
+
+
+// filter based upon how close the note is to a point.  This is for the "all" filter.
+void FilterEngine::filterSearchStringNearAll(QString string) {
+    QLOG_TRACE_IN();
+    bool negative = string.startsWith("-");
+    QList<qint32> lids;
+    if (!findNotesNear(string, lids))
+        return;
+    loadSearchLids(lids);
+    NSqlQuery sql(db);
+    if (negative)
+        sql.exec("Delete from filter where lid in (select lid from searchlids)");
+    else
+        sql.exec("Delete from filter where lid not in (select lid from searchlids)");
+    sql.finish();
 }
 
 
@@ -1019,7 +1520,7 @@ void FilterEngine::filterSearchStringAuthorAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.contains("*")) {
             string = string.replace("*", "%");
             sql.prepare("Delete from filter where lid in (select lid from datastore where key=:key and data like :data)");
@@ -1033,7 +1534,7 @@ void FilterEngine::filterSearchStringAuthorAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.contains("*")) {
             string = string.replace("*", "%");
             sql.prepare("Delete from filter where lid not in (select lid from datastore where key=:key and data like :data)");
@@ -1062,7 +1563,7 @@ void FilterEngine::filterSearchStringSourceAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.contains("*")) {
             string = string.replace("*", "%");
             sql.prepare("Delete from filter where lid in (select lid from datastore where key=:key and data like :data)");
@@ -1076,7 +1577,7 @@ void FilterEngine::filterSearchStringSourceAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.contains("*")) {
             string = string.replace("*", "%");
             sql.prepare("Delete from filter where lid not in (select lid from datastore where key=:key and data like :data)");
@@ -1105,7 +1606,7 @@ void FilterEngine::filterSearchStringContentClassAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.contains("*")) {
             string = string.replace("*", "%");
             sql.prepare("Delete from filter where lid in (select lid from datastore where key=:key and data like :data)");
@@ -1119,7 +1620,7 @@ void FilterEngine::filterSearchStringContentClassAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.contains("*")) {
             string = string.replace("*", "%");
             sql.prepare("Delete from filter where lid not in (select lid from datastore where key=:key and data like :data)");
@@ -1146,7 +1647,7 @@ void FilterEngine::filterSearchStringPlaceNameAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.contains("*")) {
             string = string.replace("*", "%");
             sql.prepare("Delete from filter where lid in (select lid from datastore where key=:key and data like :data)");
@@ -1160,7 +1661,7 @@ void FilterEngine::filterSearchStringPlaceNameAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.contains("*")) {
             string = string.replace("*", "%");
             sql.prepare("Delete from filter where lid not in (select lid from datastore where key=:key and data like :data)");
@@ -1189,7 +1690,7 @@ void FilterEngine::filterSearchStringSourceApplicationAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.contains("*")) {
             string = string.replace("*", "%");
             sql.prepare("Delete from filter where lid in (select lid from datastore where key=:key and data like :data)");
@@ -1203,7 +1704,7 @@ void FilterEngine::filterSearchStringSourceApplicationAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.contains("*")) {
             string = string.replace("*", "%");
             sql.prepare("Delete from filter where lid not in (select lid from datastore where key=:key and data like :data)");
@@ -1229,7 +1730,7 @@ void FilterEngine::filterSearchStringResourceAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         string = string.replace("*", "%");
         if (not string.contains("%"))
             sql.prepare("Delete from filter where lid not in (select data from datastore where key=:notelidkey and lid in (select lid from DataStore where key=:mimekey and data=:data))");
@@ -1245,7 +1746,7 @@ void FilterEngine::filterSearchStringResourceAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         string = string.replace("*", "%");
         if (not string.contains("%"))
             sql.prepare("Delete from filter where lid in (select data from datastore where key=:notelidkey and lid in (select lid from DataStore where key=:mimekey and data like :data))");
@@ -1270,7 +1771,7 @@ void FilterEngine::filterSearchStringResourceRecognitionTypeAll(QString string)
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         string = string.replace("*", "%");
         if (not string.contains("%"))
             sql.prepare("Delete from filter where lid not in (select data from datastore where key=:notelidkey and lid in (select lid from DataStore where key=:mimekey and data=:data))");
@@ -1286,7 +1787,7 @@ void FilterEngine::filterSearchStringResourceRecognitionTypeAll(QString string)
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         string = string.replace("*", "%");
         if (not string.contains("%"))
             sql.prepare("Delete from filter where lid in (select data from datastore where key=:notelidkey and lid in (select lid from DataStore where key=:mimekey and data like :data))");
@@ -1310,16 +1811,17 @@ void FilterEngine::filterSearchStringTagAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery tagSql(global.db);
+        NSqlQuery tagSql(db);
         if (not string.contains("*"))
-            tagSql.prepare("Delete from filter where lid not in (select lid from datastore where key=:notetagkey and data in (select lid from DataStore where data=:tagname and key=:tagnamekey))");
+            tagSql.prepare("Delete from filter where lid not in (select lid from datastore where key=:notetagkey and data in (select c.descendant from TagClosure c join DataStore t on t.lid=c.ancestor where t.key=:tagnamekey and t.data=:tagname and c.depth<=:depth))");
         else {
-            tagSql.prepare("Delete from filter where lid not in (select lid from datastore where key=:notetagkey and data in (select lid from DataStore where data like :tagname and key=:tagnamekey))");
+            tagSql.prepare("Delete from filter where lid not in (select lid from datastore where key=:notetagkey and data in (select c.descendant from TagClosure c join DataStore t on t.lid=c.ancestor where t.key=:tagnamekey and t.data like :tagname and c.depth<=:depth))");
             string = string.replace("*", "%");
         }
         tagSql.bindValue(":tagname", string);
         tagSql.bindValue(":tagnamekey", TAG_NAME);
         tagSql.bindValue(":notetagkey", NOTE_TAG_LID);
+        tagSql.bindValue(":depth", tagFilterDepth());
 
         tagSql.exec();
         tagSql.finish();
@@ -1328,16 +1830,17 @@ void FilterEngine::filterSearchStringTagAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery tagSql(global.db);
+        NSqlQuery tagSql(db);
         if (not string.contains("*"))
-            tagSql.prepare("Delete from filter where lid in (select lid from datastore where key=:notetagkey and data in (select lid from DataStore where data=:tagname and key=:tagnamekey))");
+            tagSql.prepare("Delete from filter where lid in (select lid from datastore where key=:notetagkey and data in (select c.descendant from TagClosure c join DataStore t on t.lid=c.ancestor where t.key=:tagnamekey and t.data=:tagname and c.depth<=:depth))");
         else {
-            tagSql.prepare("Delete from filter where lid in (select lid from datastore where key=:notetagkey and data in (select lid from DataStore where data like :tagname and key=:tagnamekey))");
+            tagSql.prepare("Delete from filter where lid in (select lid from datastore where key=:notetagkey and data in (select c.descendant from TagClosure c join DataStore t on t.lid=c.ancestor where t.key=:tagnamekey and t.data like :tagname and c.depth<=:depth))");
             string = string.replace("*", "%");
         }
         tagSql.bindValue(":tagname", string);
         tagSql.bindValue(":tagnamekey", TAG_NAME);
         tagSql.bindValue(":notetagkey", NOTE_TAG_LID);
+        tagSql.bindValue(":depth", tagFilterDepth());
         tagSql.exec();
         tagSql.finish();
     }
@@ -1354,7 +1857,7 @@ void FilterEngine::filterSearchStringNotebookAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery notebookSql(global.db);
+        NSqlQuery notebookSql(db);
         if (not string.contains("*"))
             notebookSql.prepare("Delete from filter where lid not in (select lid from NoteTable where notebook = :notebook)");
         else {
@@ -1371,7 +1874,7 @@ void FilterEngine::filterSearchStringNotebookAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery notebookSql(global.db);
+        NSqlQuery notebookSql(db);
         if (not string.contains("*"))
             notebookSql.prepare("Delete from filter where lid not in (select lid from NoteTable where notebook <> :notebook)");
         else {
@@ -1399,7 +1902,7 @@ void FilterEngine::filterSearchStringTodoAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.startsWith("*")) {
             sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key1 or key=:key2)");
             sql.bindValue(":key1", NOTE_HAS_TODO_COMPLETED);
@@ -1420,7 +1923,7 @@ void FilterEngine::filterSearchStringTodoAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.startsWith("*")) {
             sql.prepare("Delete from filter where lid in (select lid from DataStore where key=:key1 or key=:key2)");
             sql.bindValue(":key1", NOTE_HAS_TODO_COMPLETED);
@@ -1458,7 +1961,7 @@ void FilterEngine::filterSearchStringReminderOrderAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.startsWith("*")) {
             sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key1)");
             sql.bindValue(":key1", NOTE_ATTRIBUTE_REMINDER_ORDER);
@@ -1475,7 +1978,7 @@ void FilterEngine::filterSearchStringReminderOrderAll(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.startsWith("*")) {
             sql.prepare("Delete from filter where lid in (select lid from DataStore where key=:key1)");
             sql.bindValue(":key1", NOTE_ATTRIBUTE_REMINDER_ORDER);
@@ -1499,42 +2002,43 @@ void FilterEngine::filterSearchStringDateAll(QString string) {
     int separator = string.indexOf(":")+1;
     QString tempString = string.mid(separator);
     QDateTime dt = calculateDateTime(tempString);
-    NSqlQuery sql(global.db);
-    int key=0;
+    QString column = dateColumn(string);
+    if (column == "")
+        return;
 
-    if (string.startsWith("created:", Qt::CaseInsensitive)) {
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>=(datetime(:data/1000)))");;
-        key = NOTE_CREATED_DATE;
-    }
-    else if (string.startsWith("updated:", Qt::CaseInsensitive)) {
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>=(datetime(:data/1000)))");;
-        key = NOTE_UPDATED_DATE;
-    }
-    else if (string.startsWith("subjectdate:", Qt::CaseInsensitive)) {
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>=(datetime(:data/1000)))");;
-        key = NOTE_ATTRIBUTE_SUBJECT_DATE;
-    }
-    else if (string.startsWith("-created:", Qt::CaseInsensitive)) {
-        sql.prepare("Delete from filter where lid in (select lid from DataStore where key=:key and datetime(data/1000)<=(datetime(:data/1000)))");;
-        key = NOTE_CREATED_DATE;
-    }
-    else if (string.startsWith("-updated:", Qt::CaseInsensitive)) {
-        sql.prepare("Delete from filter where lid in (select lid from DataStore where key=:key and datetime(data/1000)<=(datetime(:data/1000)))");;
-        key = NOTE_UPDATED_DATE;
-    }
-    else if (string.startsWith("-subjectdate:", Qt::CaseInsensitive)) {
-        sql.prepare("Delete from filter where lid in (select lid from DataStore where key=:key and datetime(data/1000)<=(datetime(:data/1000)))");;
-        key = NOTE_ATTRIBUTE_SUBJECT_DATE;
+    NSqlQuery sql(db);
+    if (!string.startsWith("-")) {
+        QString op = ">=";
+        qint64 bound = dateBound(dt, op);
+        sql.prepare("Delete from filter where lid not in (select lid from NoteTable where " + column + op + ":bound)");
+        sql.bindValue(":bound", bound);
+    } else {
+        QString op = "<=";
+        qint64 bound = dateBound(dt, op);
+        sql.prepare("Delete from filter where lid in (select lid from NoteTable where " + column + op + ":bound and " + column + ">0)");
+        sql.bindValue(":bound", bound);
     }
-
-    sql.bindValue(":key", key);
-    sql.bindValue(":data", dt.toMSecsSinceEpoch());
     sql.exec();
     sql.finish();
 }
 
 
 
+// Get the NoteTable column a created:, updated: or subjectdate: search refers to.
+QString FilterEngine::dateColumn(QString string) {
+    if (string.startsWith("-"))
+        string = string.mid(1);
+    if (string.startsWith("created:", Qt::CaseInsensitive))
+        return "dateCreated";
+    if (string.startsWith("updated:", Qt::CaseInsensitive))
+        return "dateUpdated";
+    if (string.startsWith("subjectdate:", Qt::CaseInsensitive))
+        return "dateSubject";
+    return "";
+}
+
+
+
 
 
 QDateTime FilterEngine::calculateDateTime(QString string) {
@@ -1628,8 +2132,8 @@ QDateTime FilterEngine::calculateDateTime(QString string) {
 void FilterEngine::filterSearchStringAny(QStringList list) {
     QLOG_TRACE_IN();
     // Filter out the records
-    NSqlQuery sql(global.db), sqlnegative(global.db);
-    NSqlQuery resSql(global.db), resSqlNegative(global.db);
+    NSqlQuery sql(db), sqlnegative(db);
+    NSqlQuery resSql(db), resSqlNegative(db);
 
     sql.exec("create table if not exists anylidsfilter (lid int);");
     sql.exec("delete from anylidsfilter");
@@ -1643,14 +2147,16 @@ void FilterEngine::filterSearchStringAny(QStringList list) {
     sqlnegative.prepare("insert into anylidsfilter (lid) select lid from SearchIndex where lid not in (select lid from searchindex where source='text' and weight>=:weight and content match :word)");
     resSqlNegative.prepare("insert into anylidsfilterRes (lid) select lid from SearchIndex where lid not in (select lid from searchindex where source='recognition' and weight>=:weight and content match :word)");
 
-    sql.bindValue(":weight", global.getMinimumRecognitionWeight());
-    sqlnegative.bindValue(":weight", global.getMinimumRecognitionWeight());
+    sql.bindValue(":weight", minimumWeight);
+    sqlnegative.bindValue(":weight", minimumWeight);
 
-    resSql.bindValue(":weight", global.getMinimumRecognitionWeight());
-    resSqlNegative.bindValue(":weight", global.getMinimumRecognitionWeight());
+    resSql.bindValue(":weight", minimumWeight);
+    resSqlNegative.bindValue(":weight", minimumWeight);
 
     // We start at the second entry because the first is "any:"
     for (qint32 i=1; i<list.size(); i++) {
+        if (isCancelled())
+            return;
         QString string = list[i];
         string.remove(QChar('"'));
 
@@ -1727,7 +2233,16 @@ void FilterEngine::filterSearchStringAny(QStringList list) {
                 string.startsWith("-subjectdate", Qt::CaseInsensitive)) {
             filterSearchStringDateAny(string);
         }
+        else if (string.startsWith("fuzzy:", Qt::CaseInsensitive) ||
+                string.startsWith("-fuzzy:", Qt::CaseInsensitive)) {
+            filterSearchStringFuzzyAny(string);
+        }
+        else if (string.startsWith("near:", Qt::CaseInsensitive) ||
+                string.startsWith("-near:", Qt::CaseInsensitive)) {
+            filterSearchStringNearAny(string);
+        }
         else { // Filter not found
+            string = TextFolding::query(string);
             if (string.startsWith("-")) {
                 string = string.remove(0,1);
                 sqlnegative.bindValue(":word", string.trimmed()+"*");
@@ -1754,6 +2269,42 @@ void FilterEngine::filterSearchStringAny(QStringList list) {
 
 
 
+// Find notes with words similar to the one given.  This is for the "any"
+// filter, so matches are added to anylidsfilter.
+void FilterEngine::filterSearchStringFuzzyAny(QString string) {
+    bool negative = false;
+    if (string.startsWith("-")) {
+        negative = true;
+        string = string.remove(0,1);
+    }
+    string = string.mid(6).trimmed();
+    if (string == "")
+        return;
+
+    NSqlQuery sql(db);
+    if (global.trigramIndex) {
+        QList<qint32> lids;
+        TrigramTable trigramTable(db);
+        trigramTable.findFuzzy(string, TRIGRAM_FUZZY_THRESHOLD, lids);
+        loadSearchLids(lids);
+        if (negative)
+            sql.exec("insert into anylidsfilter (lid) select lid from NoteTable where lid not in (select lid from searchlids)");
+        else
+            sql.exec("insert into anylidsfilter (lid) select lid from searchlids");
+    } else {
+        if (negative)
+            sql.prepare("insert into anylidsfilter (lid) select lid from NoteTable where lid not in (select lid from SearchIndex where source='text' and weight>=:weight and content match :word)");
+        else
+            sql.prepare("insert into anylidsfilter (lid) select lid from SearchIndex where source='text' and weight>=:weight and content match :word");
+        sql.bindValue(":weight", minimumWeight);
+        sql.bindValue(":word", TextFolding::query(string));
+        sql.exec();
+    }
+    sql.finish();
+}
+
+
+
 // filter based upon the notebook string the user specified.  This is for the "any"
 // filter and not the default
 void FilterEngine::filterSearchStringNotebookAny(QString string) {
@@ -1764,7 +2315,7 @@ void FilterEngine::filterSearchStringNotebookAny(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery notebookSql(global.db);
+        NSqlQuery notebookSql(db);
         if (not string.contains("*"))
             notebookSql.prepare("insert into anylidsfilter (lid) select lid from NoteTable where notebook=:notebook");
         else {
@@ -1779,7 +2330,7 @@ void FilterEngine::filterSearchStringNotebookAny(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery notebookSql(global.db);
+        NSqlQuery notebookSql(db);
         if (not string.contains("*"))
             notebookSql.prepare("insert into anylidsfilter (lid) select lid from NoteTable where notebook <> :notebook");
         else {
@@ -1804,7 +2355,7 @@ void FilterEngine::filterSearchStringTodoAny(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.startsWith("*")) {
             sql.prepare("insert into anylidsfilter (lid) select lid from DataStore where key=:key1 or key=:key2");
             sql.bindValue(":key1", NOTE_HAS_TODO_COMPLETED);
@@ -1825,7 +2376,7 @@ void FilterEngine::filterSearchStringTodoAny(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.startsWith("*")) {
             sql.prepare("insert into anylidsfilter (lid) select lid from DataStore where key<>:key1 or key<>:key2");
             sql.bindValue(":key1", NOTE_HAS_TODO_COMPLETED);
@@ -1858,7 +2409,7 @@ void FilterEngine::filterSearchStringReminderOrderAny(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.startsWith("*")) {
             sql.prepare("insert into anylidsfilter (lid) select lid from DataStore where key=:key1");
             sql.bindValue(":key1", NOTE_ATTRIBUTE_REMINDER_ORDER);
@@ -1875,7 +2426,7 @@ void FilterEngine::filterSearchStringReminderOrderAny(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.startsWith("*")) {
             sql.prepare("insert into anylidsfilter (lid) select distinct lid from DataStore where lid not in (select lid from DataStore where key = :key)");
             sql.bindValue(":key", NOTE_ATTRIBUTE_REMINDER_ORDER);
@@ -1902,16 +2453,17 @@ void FilterEngine::filterSearchStringTagAny(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery tagSql(global.db);
+        NSqlQuery tagSql(db);
         if (not string.contains("*"))
-            tagSql.prepare("insert into anylidsfilter (lid) select lid from datastore where key=:notetagkey and data in (select lid from DataStore where data=:tagname and key=:tagnamekey)");
+            tagSql.prepare("insert into anylidsfilter (lid) select lid from datastore where key=:notetagkey and data in (select c.descendant from TagClosure c join DataStore t on t.lid=c.ancestor where t.key=:tagnamekey and t.data=:tagname and c.depth<=:depth)");
         else {
-            tagSql.prepare("insert into anylidsfilter (lid) select lid from datastore where key=:notetagkey and data in (select lid from DataStore where data like :tagname and key=:tagnamekey)");
+            tagSql.prepare("insert into anylidsfilter (lid) select lid from datastore where key=:notetagkey and data in (select c.descendant from TagClosure c join DataStore t on t.lid=c.ancestor where t.key=:tagnamekey and t.data like :tagname and c.depth<=:depth)");
             string = string.replace("*", "%");
         }
         tagSql.bindValue(":tagname", string);
         tagSql.bindValue(":tagnamekey", TAG_NAME);
         tagSql.bindValue(":notetagkey", NOTE_TAG_LID);
+        tagSql.bindValue(":depth", tagFilterDepth());
 
         tagSql.exec();
         tagSql.finish();
@@ -1920,16 +2472,17 @@ void FilterEngine::filterSearchStringTagAny(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery tagSql(global.db);
+        NSqlQuery tagSql(db);
         if (not string.contains("*"))
-            tagSql.prepare("insert into anylidsfilter (lid) select lid from datastore where lid not in (select lid from datastore where key=:notetagkey and data in (select lid from DataStore where data=:tagname and key=:tagnamekey))");
+            tagSql.prepare("insert into anylidsfilter (lid) select lid from datastore where lid not in (select lid from datastore where key=:notetagkey and data in (select c.descendant from TagClosure c join DataStore t on t.lid=c.ancestor where t.key=:tagnamekey and t.data=:tagname and c.depth<=:depth))");
         else {
-            tagSql.prepare("insert into anylidsfilter (lid) select lid from datastore where lid not in (select lid from datastore where key=:notetagkey and data in (select lid from DataStore where data like :tagname and key=:tagnamekey))");
+            tagSql.prepare("insert into anylidsfilter (lid) select lid from datastore where lid not in (select lid from datastore where key=:notetagkey and data in (select c.descendant from TagClosure c join DataStore t on t.lid=c.ancestor where t.key=:tagnamekey and t.data like :tagname and c.depth<=:depth))");
             string = string.replace("*", "%");
         }
         tagSql.bindValue(":tagname", string);
         tagSql.bindValue(":tagnamekey", TAG_NAME);
         tagSql.bindValue(":notetagkey", NOTE_TAG_LID);
+        tagSql.bindValue(":depth", tagFilterDepth());
         tagSql.exec();
         tagSql.finish();
     }
@@ -1947,7 +2500,7 @@ void FilterEngine::filterSearchStringIntitleAny(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery tagSql(global.db);
+        NSqlQuery tagSql(db);
         string = string.replace("*", "%");
         if (not string.contains("%"))
             string = QString("%") +string +QString("%");
@@ -1963,7 +2516,7 @@ void FilterEngine::filterSearchStringIntitleAny(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery tagSql(global.db);
+        NSqlQuery tagSql(db);
         string = string.replace("*", "%");
         if (not string.contains("%"))
             string = QString("%") +string +QString("%");
@@ -1988,7 +2541,7 @@ void FilterEngine::filterSearchStringResourceAny(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         string = string.replace("*", "%");
         if (not string.contains("%"))
             sql.prepare("insert into anylidsfilter (lid) select data from datastore where key=:notelidkey and lid in (select lid from DataStore where key=:mimekey and data=:data)");
@@ -2005,7 +2558,7 @@ void FilterEngine::filterSearchStringResourceAny(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         string = string.replace("*", "%");
         if (not string.contains("%"))
             sql.prepare("insert into anylidsfilter (lid) select lid from datastore where lid not in (select data from datastore where key=:notelid and lid in (select lid from DataStore where data=:data and key = :mimekey))");
@@ -2032,27 +2585,36 @@ void FilterEngine::filterSearchStringCoordinatesAny(QString string, int key) {
         negative = true;
     int separator = string.indexOf(":")+1;
     string = string.mid(separator);
-    if (negative) {
-        if (string == "")
-            string = "0";
-        // Filter out the records
-        NSqlQuery sql(global.db);
-        sql.prepare("insert into anylidsfilter (lid) select lid from datastore where key=:key and data >= :data");
-        sql.bindValue(":key", key);
-        sql.bindValue(":data", string.toDouble());
-        sql.exec();
-        sql.finish();
-    } else {
-        if (string == "")
-            string = "0";
-        // Filter out the records
-        NSqlQuery sql(global.db);
-        sql.prepare("insert into anylidsfilter (lid) select lid from datastore where key=:key and data <= :data");
-        sql.bindValue(":key", key);
-        sql.bindValue(":data", string.toDouble());
-        sql.exec();
-        sql.finish();
-    }
+    if (string == "")
+        string = "0";
+
+    // This is one axis on its own, so the location index (which only holds
+    // notes with both, rounded) isn't any help here.
+    NSqlQuery sql(db);
+    QString op = negative ? "<" : ">=";
+    sql.prepare("insert into anylidsfilter (lid) select lid from datastore where key=:key and data" +op +":data");
+    sql.bindValue(":key", key);
+    sql.bindValue(":data", string.toDouble());
+    sql.exec();
+    sql.finish();
+}
+
+
+
+// filter based upon how close the note is to a point.  This is for the "any" filter.
+void FilterEngine::filterSearchStringNearAny(QString string) {
+    QLOG_TRACE_IN();
+    bool negative = string.startsWith("-");
+    QList<qint32> lids;
+    if (!findNotesNear(string, lids))
+        return;
+    loadSearchLids(lids);
+    NSqlQuery sql(db);
+    if (negative)
+        sql.exec("insert into anylidsfilter (lid) select lid from NoteTable where lid not in (select lid from searchlids)");
+    else
+        sql.exec("insert into anylidsfilter (lid) select lid from searchlids");
+    sql.finish();
 }
 
 
@@ -2071,7 +2633,7 @@ void FilterEngine::filterSearchStringAuthorAny(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.contains("*")) {
             string = string.replace("*", "%");
             sql.prepare("insert into anylidsfilter (lid) select lid from datastore where key=:key and data like :data");
@@ -2085,7 +2647,7 @@ void FilterEngine::filterSearchStringAuthorAny(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.contains("*")) {
             string = string.replace("*", "%");
             sql.prepare("insert into anylidsfilter (lid) select lid from datastore where lid not in (select lid from datastore where key=:key and data like :data)");
@@ -2106,36 +2668,22 @@ void FilterEngine::filterSearchStringDateAny(QString string) {
     int separator = string.indexOf(":")+1;
     QString tempString = string.mid(separator);
     QDateTime dt = calculateDateTime(tempString);
-    NSqlQuery sql(global.db);
-    int key=0;
+    QString column = dateColumn(string);
+    if (column == "")
+        return;
 
-    if (string.startsWith("created:", Qt::CaseInsensitive)) {
-        sql.prepare("insert into anylidsfilter (lid) select lid from DataStore where key=:key and datetime(data/1000)>=(datetime(:data/1000))");
-        key = NOTE_CREATED_DATE;
-    }
-    else if (string.startsWith("updated:", Qt::CaseInsensitive)) {
-        sql.prepare("insert into anylidsfilter (lid) select lid from DataStore where key=:key and datetime(data/1000)>=(datetime(:data/1000))");
-        key = NOTE_UPDATED_DATE;
-    }
-    else if (string.startsWith("subjectdate:", Qt::CaseInsensitive)) {
-        sql.prepare("insert into anylidsfilter (lid) select lid from DataStore where key=:key and datetime(data/1000)>=(datetime(:data/1000))");
-        key = NOTE_ATTRIBUTE_SUBJECT_DATE;
-    }
-    else if (string.startsWith("-created:", Qt::CaseInsensitive)) {
-        sql.prepare("insert into anylidsfilter (lid) select lid from DataStore where key=:key and datetime(data/1000)<=(datetime(:data/1000))");
-        key = NOTE_CREATED_DATE;
-    }
-    else if (string.startsWith("-updated:", Qt::CaseInsensitive)) {
-        sql.prepare("insert into anylidsfilter (lid) select lid from DataStore where key=:key and datetime(data/1000)<=(datetime(:data/1000))");
-        key = NOTE_UPDATED_DATE;
-    }
-    else if (string.startsWith("-subjectdate:", Qt::CaseInsensitive)) {
-        sql.prepare("insert into anylidsfilter (lid) select lid from DataStore where key=:key and datetime(data/1000)<=(datetime(:data/1000))");
-        key = NOTE_ATTRIBUTE_SUBJECT_DATE;
+    NSqlQuery sql(db);
+    if (!string.startsWith("-")) {
+        QString op = ">=";
+        qint64 bound = dateBound(dt, op);
+        sql.prepare("insert into anylidsfilter (lid) select lid from NoteTable where " + column + op + ":bound");
+        sql.bindValue(":bound", bound);
+    } else {
+        QString op = "<=";
+        qint64 bound = dateBound(dt, op);
+        sql.prepare("insert into anylidsfilter (lid) select lid from NoteTable where " + column + op + ":bound and " + column + ">0");
+        sql.bindValue(":bound", bound);
     }
-
-    sql.bindValue(":key", key);
-    sql.bindValue(":data", dt.toMSecsSinceEpoch());
     sql.exec();
     sql.finish();
 }
@@ -2158,7 +2706,7 @@ void FilterEngine::filterSearchStringSourceAny(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.contains("*")) {
             string = string.replace("*", "%");
             sql.prepare("insert into anylidsfilter (lid) select lid from datastore where key=:key and data like :data");
@@ -2171,7 +2719,7 @@ void FilterEngine::filterSearchStringSourceAny(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.contains("*")) {
             string = string.replace("*", "%");
             sql.prepare("insert into anylidsfilter (lid) select lid from datastore where lid not in (select lid from datastore where key=:key and data like :data)");
@@ -2200,7 +2748,7 @@ void FilterEngine::filterSearchStringSourceApplicationAny(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.contains("*")) {
             string = string.replace("*", "%");
             sql.prepare("insert into anylidsfilter (lid) select lid from datastore where key=:key and data like :data");
@@ -2214,7 +2762,7 @@ void FilterEngine::filterSearchStringSourceApplicationAny(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.contains("*")) {
             string = string.replace("*", "%");
             sql.prepare("insert into anylidsfilter (lid) select lid from datastore where lid not in (select lid from datastore where key=:key and data like :data)");
@@ -2244,7 +2792,7 @@ void FilterEngine::filterSearchStringContentClassAny(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.contains("*")) {
             string = string.replace("*", "%");
             sql.prepare("insert into anylidsfilter (lid) select lid from datastore where key=:key and data like :data");
@@ -2258,7 +2806,7 @@ void FilterEngine::filterSearchStringContentClassAny(QString string) {
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.contains("*")) {
             string = string.replace("*", "%");
             sql.prepare("insert into anylidsfilter (lid) select lid from datastore where lid not in (select lid from datastore where key=:key and data like :data)");
@@ -2286,7 +2834,7 @@ void FilterEngine::filterSearchStringResourceRecognitionTypeAny(QString string)
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.contains("*")) {
             string = string.replace("*", "%");
             sql.prepare("insert into anylidsfilter (lid) select lid from datastore where key=:key and data like :data");
@@ -2300,7 +2848,7 @@ void FilterEngine::filterSearchStringResourceRecognitionTypeAny(QString string)
         if (string == "")
             string = "*";
         // Filter out the records
-        NSqlQuery sql(global.db);
+        NSqlQuery sql(db);
         if (string.contains("*")) {
             string = string.replace("*", "%");
             sql.prepare("insert into anylidsfilter (lid) select lid from datastore where lid not in (select lid from datastore where key=:key and data like :data)");
@@ -2325,8 +2873,23 @@ bool FilterEngine::resourceContains(qint32 resourceLid, QString searchString, QS
     bool returnValue = false;
     if (returnHits != NULL)
         returnHits->empty();
-    NSqlQuery query(global.db);
-    NSqlQuery query2(global.db);
+
+    // If the current search already collected its hits, use them
+    // rather than going back to the index.
+    if (global.filterCriteria.size() > 0) {
+        FilterCriteria *criteria = global.filterCriteria[global.filterPosition];
+        if (criteria->isSearchHitsSet() && criteria->getSearchString() == searchString) {
+            SearchHit hit;
+            if (!getSearchHit(criteria, resourceLid, hit))
+                return false;
+            if (returnHits != NULL)
+                returnHits->append(hit.words);
+            return true;
+        }
+    }
+
+    NSqlQuery query(db);
+    NSqlQuery query2(db);
     query.prepare("select lid from SearchIndex where lid=:resourceLid and weight>=:weight and content match :word");
     query2.prepare("select lid from SearchIndex where lid=:resourceLid and weight>=:weight and content like :word");
     QStringList terms;
@@ -2369,14 +2932,18 @@ bool FilterEngine::resourceContains(qint32 resourceLid, QString searchString, QS
                 !searchString.startsWith("updated:", Qt::CaseInsensitive) &&
                 !searchString.startsWith("-updated:", Qt::CaseInsensitive) &&
                 !searchString.startsWith("subjectdate:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("-subjectdate:", Qt::CaseInsensitive)) {
+                !searchString.startsWith("-subjectdate:", Qt::CaseInsensitive) &&
+                !searchString.startsWith("fuzzy:", Qt::CaseInsensitive) &&
+                !searchString.startsWith("-fuzzy:", Qt::CaseInsensitive) &&
+                !searchString.startsWith("near:", Qt::CaseInsensitive) &&
+                !searchString.startsWith("-near:", Qt::CaseInsensitive)) {
             QString term = terms[i];
             if (term.endsWith("*"))
                 term.chop(1);
             if (term.startsWith("*")) {
                 term = term.mid(1);
                 query2.bindValue(":resourceLid", resourceLid);
-                query2.bindValue(":weight", global.getMinimumRecognitionWeight());
+                query2.bindValue(":weight", minimumWeight);
                 query2.bindValue(":word", "%"+term+"%");
                 query2.exec();
                 if (query2.next()) {
@@ -2388,8 +2955,8 @@ bool FilterEngine::resourceContains(qint32 resourceLid, QString searchString, QS
                 }
             } else {
                 query.bindValue(":resourceLid", resourceLid);
-                query.bindValue(":weight", global.getMinimumRecognitionWeight());
-                query.bindValue(":word", term);
+                query.bindValue(":weight", minimumWeight);
+                query.bindValue(":word", TextFolding::query(term));
                 query.exec();
                 if (query.next()) {
                     returnValue = true;
@@ -2413,17 +2980,18 @@ void FilterEngine::filterSearchStringReminderTimeAll(QString string) {
     int separator = string.indexOf(":")+1;
     QString tempString = string.mid(separator);
     QDateTime dt = calculateDateTime(tempString);
-    NSqlQuery sql(global.db);
+    NSqlQuery sql(db);
     int key= NOTE_ATTRIBUTE_REMINDER_TIME;
 
     if (string.startsWith("-", Qt::CaseInsensitive)) {
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)<(datetime(:data/1000)))");;
+        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and data<:data)");;
     } else {
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>=(datetime(:data/1000)))");;
+        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and data>=:data)");;
     }
 
     sql.bindValue(":key", key);
-    sql.bindValue(":data", dt.toMSecsSinceEpoch());
+    QString op = ">=";     // Both < and >= use the bound rounded down to the second
+    sql.bindValue(":data", dateBound(dt, op));
     sql.exec();
     sql.finish();
     QLOG_TRACE_OUT();
@@ -2436,16 +3004,17 @@ void FilterEngine::filterSearchStringReminderTimeAny(QString string) {
     int separator = string.indexOf(":")+1;
     QString tempString = string.mid(separator);
     QDateTime dt = calculateDateTime(tempString);
-    NSqlQuery sql(global.db);
+    NSqlQuery sql(db);
     int key = NOTE_ATTRIBUTE_REMINDER_TIME;
 
     if (string.startsWith("-reminderDoneTime:", Qt::CaseInsensitive)) {
-        sql.prepare("insert into anylidsfilter (lid) select lid from DataStore where key=:key and datetime(data/1000)<(datetime(:data/1000))");
+        sql.prepare("insert into anylidsfilter (lid) select lid from DataStore where key=:key and data<:data");
     } else {
-        sql.prepare("insert into anylidsfilter (lid) select lid from DataStore where key=:key and datetime(data/1000)>=(datetime(:data/1000))");
+        sql.prepare("insert into anylidsfilter (lid) select lid from DataStore where key=:key and data>=:data");
     }
     sql.bindValue(":key", key);
-    sql.bindValue(":data", dt.toMSecsSinceEpoch());
+    QString op = ">=";     // Both < and >= use the bound rounded down to the second
+    sql.bindValue(":data", dateBound(dt, op));
     sql.exec();
     sql.finish();
 }
@@ -2458,17 +3027,18 @@ void FilterEngine::filterSearchStringReminderDoneTimeAll(QString string) {
     int separator = string.indexOf(":")+1;
     QString tempString = string.mid(separator);
     QDateTime dt = calculateDateTime(tempString);
-    NSqlQuery sql(global.db);
+    NSqlQuery sql(db);
     int key = NOTE_ATTRIBUTE_REMINDER_DONE_TIME;
 
     if (string.startsWith("-", Qt::CaseInsensitive)) {
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)<(datetime(:data/1000)))");
+        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and data<:data)");
     } else {
-        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and datetime(data/1000)>=(datetime(:data/1000)))");
+        sql.prepare("Delete from filter where lid not in (select lid from DataStore where key=:key and data>=:data)");
     }
 
     sql.bindValue(":key", key);
-    sql.bindValue(":data", dt.toMSecsSinceEpoch());
+    QString op = ">=";     // Both < and >= use the bound rounded down to the second
+    sql.bindValue(":data", dateBound(dt, op));
     sql.exec();
     sql.finish();
     QLOG_TRACE_OUT();
@@ -2481,16 +3051,17 @@ void FilterEngine::filterSearchStringReminderDoneTimeAny(QString string) {
     int separator = string.indexOf(":")+1;
     QString tempString = string.mid(separator);
     QDateTime dt = calculateDateTime(tempString);
-    NSqlQuery sql(global.db);
+    NSqlQuery sql(db);
     int key = NOTE_ATTRIBUTE_REMINDER_DONE_TIME;
 
     if (string.startsWith("-reminderDoneTime:", Qt::CaseInsensitive)) {
-        sql.prepare("insert into anylidsfilter (lid) select lid from DataStore where key=:key and datetime(data/1000)<(datetime(:data/1000))");
+        sql.prepare("insert into anylidsfilter (lid) select lid from DataStore where key=:key and data<:data");
     } else {
-        sql.prepare("insert into anylidsfilter (lid) select lid from DataStore where key=:key and datetime(data/1000)>=(datetime(:data/1000))");
+        sql.prepare("insert into anylidsfilter (lid) select lid from DataStore where key=:key and data>=:data");
     }
     sql.bindValue(":key", key);
-    sql.bindValue(":data", dt.toMSecsSinceEpoch());
+    QString op = ">=";     // Both < and >= use the bound rounded down to the second
+    sql.bindValue(":data", dateBound(dt, op));
     sql.exec();
     sql.finish();
     QLOG_TRACE_OUT();
@@ -21,7 +21,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define FILTERENGINE_H
 
 #include <QObject>
+#include <QAtomicInt>
 #include "filtercriteria.h"
+#include "sql/databaseconnection.h"
+
+// The most full text index rows a search collects hits for up front
+#define SEARCH_HITS_LIMIT 200
 
 class FilterEngine : public QObject
 {
@@ -36,7 +41,6 @@ private:
     void filterAttributes(FilterCriteria *criteria);
     void filterSearchString(FilterCriteria *criteria);
     void filterSearchStringAll(QStringList list);
-    void splitSearchTerms(QStringList &list, QString search);
     void filterSearchStringNotebookAll(QString string);
 //    void filterSearchTodoAll(QStringList list);
     void filterSearchStringTodoAll(QString string);
@@ -49,6 +53,9 @@ private:
     void filterSearchStringIntitleAll(QString string);
     void filterSearchStringResourceAll(QString string);
     void filterSearchStringCoordinatesAll(QString string, int key);
+    void filterSearchStringBoundingBoxAll(QStringList &list);
+    void filterSearchStringNearAll(QString string);
+    bool findNotesNear(QString string, QList<qint32> &lids);
     void filterSearchStringAuthorAll(QString string);
     void filterSearchStringSourceAll(QString string);
     void filterSearchStringSourceApplicationAll(QString string);
@@ -56,6 +63,9 @@ private:
     void filterSearchStringPlaceNameAll(QString string);
     void filterSearchStringResourceRecognitionTypeAll(QString string);
     QDateTime calculateDateTime(QString string);
+    QDateTime attributeStartDate(int period);
+    qint64 dateBound(QDateTime dt, QString &op);
+    QString dateColumn(QString string);
     void filterSearchStringDateAll(QString string);
 
     void filterSearchStringAny(QStringList list);
@@ -66,18 +76,44 @@ private:
     void filterSearchStringIntitleAny(QString string);
     void filterSearchStringResourceAny(QString string);
     void filterSearchStringCoordinatesAny(QString string, int key);
+    void filterSearchStringNearAny(QString string);
     void filterSearchStringAuthorAny(QString string);
     void filterSearchStringDateAny(QString string);
     void filterSearchStringSourceAny(QString string);
     void filterSearchStringSourceApplicationAny(QString string);
     void filterSearchStringContentClassAny(QString string);
     void filterSearchStringResourceRecognitionTypeAny(QString string);
+    bool filterFtsCancellable(QString word, bool negative);
+    void filterSearchStringFuzzyAll(QString string);
+    void filterSearchStringFuzzyAny(QString string);
+    bool filterSearchStringInfix(QString fragment, bool negative);
+    void loadSearchLids(QList<qint32> &lids);
+    bool searchHitWords(FilterCriteria *criteria, QStringList &words);
+    void addSearchHitRow(SearchHit &hit, QString snippet, QString original, QStringList &words);
+    void findSearchHits(FilterCriteria *criteria);
+    void finishFilter(FilterCriteria *criteria, bool internalSearch, QList<qint32> *results);
     bool anyFlagSet;
+    QStringList *searchTerms;        // Search string already split into terms, if the caller has them
+    bool storingResults;             // Results are being stored for a saved search
+    QList<qint32> *candidates;       // Only these notes are checked, if set
+    DatabaseConnection *db;          // Connection used for every filter query
+    QAtomicInt *cancelToken;         // Search generation counter shared with the requester
+    qint32 generation;               // Generation this search was started for
+    int minimumWeight;               // Minimum OCR recognition weight searched
+    bool tagSelectionOr;             // Selected tags are or'ed instead of and'ed
 
 public:
     explicit FilterEngine(QObject *parent = 0);
+    explicit FilterEngine(DatabaseConnection *db, QObject *parent = 0);
+    void setCancelToken(QAtomicInt *token, qint32 generation);
+    void setSearchSettings(int minimumWeight, bool tagSelectionOr);
+    bool isCancelled();
     void filter(FilterCriteria *newCriteria=NULL, QList<qint32> *results=NULL);
+    void filterForSavedSearch(FilterCriteria *criteria, QStringList &terms, QList<qint32> &results, QList<qint32> *candidates=NULL);
+    bool filterSavedSearch(FilterCriteria *criteria);
+    void splitSearchTerms(QStringList &list, QString search);
     bool resourceContains(qint32 resourceLid, QString searchString, QStringList *returnHits);
+    bool getSearchHit(FilterCriteria *criteria, qint32 lid, SearchHit &hit);
     
 signals:
     
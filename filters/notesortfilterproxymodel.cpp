@@ -19,6 +19,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #include "notesortfilterproxymodel.h"
 #include "global.h"
+#include "models/notemodel.h"
 
 NoteSortFilterProxyModel::NoteSortFilterProxyModel() :
     QSortFilterProxyModel()
@@ -33,9 +34,14 @@ NoteSortFilterProxyModel::~NoteSortFilterProxyModel()
 }
 
 
+// The lid comes straight from the note model so checking a row doesn't
+// read the rest of it from the database.
 bool NoteSortFilterProxyModel::filterAcceptsRow(qint32 source_row, const QModelIndex &source_parent) const {
-    QModelIndex idx = sourceModel()->index(source_row,NOTE_TABLE_LID_POSITION, source_parent);
-    qint32 rowLid = sourceModel()->data(idx).toInt();
+    Q_UNUSED(source_parent);
+    NoteModel *model = qobject_cast<NoteModel*>(sourceModel());
+    if (model == NULL)
+        return false;
+    qint32 rowLid = model->lidAt(source_row);
     if (lidMap->contains(rowLid)) {
         lidMap->remove(rowLid);
         lidMap->insert(rowLid, source_row);
@@ -45,37 +51,12 @@ bool NoteSortFilterProxyModel::filterAcceptsRow(qint32 source_row, const QModelI
 }
 
 
-bool NoteSortFilterProxyModel::lessThan(const QModelIndex &left, const QModelIndex &right) const {
-    QVariant leftData = this->sourceModel()->data(left);
-    QVariant rightData = this->sourceModel()->data(right);
 
-    if (left.column() == NOTE_TABLE_IS_DIRTY_POSITION)
-        return leftData.toBool() < rightData.toBool();
-
-    if (leftData.type() == QVariant::Invalid || rightData.type() == QVariant::Invalid)
-        return true;
-
-    if (leftData.type() == QVariant::Icon || rightData.type() == QVariant::Icon)
-        return true;
-
-    if (leftData.type() == QVariant::Image || rightData.type() == QVariant::Image)
-        return true;
-
-    if (leftData.type() == QVariant::String && rightData.type() == QVariant::String) {
-        QString left = leftData.toString();
-        QString right = rightData.toString();
-        return left.toLower() < right.toLower();
-    }
-
-    if (leftData.type() == QVariant::Int && rightData.type() == QVariant::Int)
-        return leftData.toInt() < rightData.toInt();
-
-    if (leftData.type() == QVariant::LongLong && rightData.type() == QVariant::LongLong)
-        return leftData.toLongLong() < rightData.toLongLong();
-
-    if (leftData.type() == QVariant::Double && rightData.type() == QVariant::Double)
-        return leftData.toDouble() < rightData.toDouble();
-
-    return true;
+// Sorting is done by the note model, in SQL or on a precomputed key, rather
+// than here.  Sorting in the proxy would need every row of every column that
+// is compared to be read.
+void NoteSortFilterProxyModel::sort(int column, Qt::SortOrder order) {
+    NoteModel *model = qobject_cast<NoteModel*>(sourceModel());
+    if (model != NULL)
+        model->sort(column, order);
 }
-
@@ -31,8 +31,7 @@ public:
     explicit NoteSortFilterProxyModel();
     ~NoteSortFilterProxyModel();
     bool filterAcceptsRow(qint32 source_row, const QModelIndex &source_parent) const;
-    //void sort(int column, Qt::SortOrder order);
-    bool lessThan(const QModelIndex &left, const QModelIndex &right) const;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
     QMap<qint32, qint32> *lidMap;
 
 signals:
@@ -102,6 +102,8 @@ Q_SCRIPTABLE QString RemoteQuery::getNotePreview() {
 
 Q_SCRIPTABLE QString RemoteQuery::getNoteDateUpdated() {
     qlonglong dt = 0;
+    if (note == NULL)
+        return "";
     if (note->updated.isSet())
         dt = note->updated;
     if (dt==0)
@@ -119,6 +121,8 @@ Q_SCRIPTABLE QString RemoteQuery::getNoteDateUpdated() {
 
 Q_SCRIPTABLE QString RemoteQuery::getNoteDateCreated() {
     qlonglong dt = 0;
+    if (note == NULL)
+        return "";
     if (note->created.isSet())
         dt = note->created;
     if (dt==0)
@@ -136,7 +140,7 @@ Q_SCRIPTABLE QString RemoteQuery::getNoteDateCreated() {
 
 
 Q_SCRIPTABLE QString RemoteQuery::getNoteTags() {
-    if (!note->tagNames.isSet())
+    if (note == NULL || !note->tagNames.isSet())
         return "";
     QString taglist = "";
     QList <QString> tagNames = note->tagNames;
@@ -0,0 +1,44 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+
+//* A SearchHit holds what the full text index found for one note or
+//* resource in the current search.  They are built while the search
+//* runs so the note list & editor don't need to scan the text again.
+
+#ifndef SEARCHHIT_H
+#define SEARCHHIT_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QMetaType>
+
+class SearchHit
+{
+public:
+    QString snippet;          // Text around the first match, matches marked with <b></b>
+    QStringList words;        // The words that actually matched (i.e. "foxes" for "fox*")
+};
+
+typedef QHash<qint32, SearchHit> SearchHits;    // Hits keyed by note or resource lid
+
+Q_DECLARE_METATYPE(SearchHits)
+
+#endif // SEARCHHIT_H
@@ -85,10 +85,14 @@ Global::Global()
     this->indexPDFLocally = true;
     this->indexRunner = NULL;
     this->isFullscreen = false;
-    this->indexNoteCountPause = -1;
     this->maxIndexInterval = 500;
     this->forceNoStartMimized = false;
     this->forceSearchLowerCase = false;
+    this->trigramIndex = false;
+    this->geographyIndex = false;
+    this->includeChildTags = false;
+    this->foldSearchText = false;
+    this->indexThreads = 0;
     this->forceStartMinimized = false;
     this->globalSettings = NULL;
     this->disableUploads = false;
@@ -99,7 +103,6 @@ Global::Global()
     this->minIndexInterval = 500;
     this->minimumThumbnailInterval = 500;
     this->purgeTemporaryFilesOnShutdown = true;
-    this->indexResourceCountPause = 500;
     this->maximumThumbnailInterval = 500;
     this->disableEditing = false;
     this->nonAsciiSortBug = false;
@@ -233,11 +236,16 @@ void Global::setup(StartupConfig startupConfig, bool guiAvailable) {
 
     minIndexInterval = 5000;
     maxIndexInterval = 120000;
-    indexResourceCountPause=2;
-    indexNoteCountPause=100;
     isFullscreen=false;
     indexPDFLocally=getIndexPDFLocally();
     forceSearchLowerCase=getForceSearchLowerCase();
+    backgroundSearch=getBackgroundSearch();
+    searchAsYouType=getSearchAsYouType();
+    trigramIndex=getTrigramIndex();
+    includeChildTags=getIncludeChildTags();
+    foldSearchText=getFoldSearchText();
+    searchStemLanguage=getSearchStemLanguage();
+    indexThreads=getIndexThreads();
     strictDTD = getStrictDTD();
     bypassTidy = getBypassTidy();
     forceUTF8 = getForceUTF8();
@@ -560,6 +568,138 @@ bool Global::getForceSearchLowerCase() {
 
 
 
+void Global::setBackgroundSearch(bool value) {
+    settings->beginGroup("Search");
+    settings->setValue("backgroundSearch",value);
+    settings->endGroup();
+    backgroundSearch=value;
+}
+
+
+bool Global::getBackgroundSearch() {
+    settings->beginGroup("Search");
+    bool value = settings->value("backgroundSearch",true).toBool();
+    settings->endGroup();
+    backgroundSearch = value;
+    return value;
+}
+
+
+
+
+void Global::setSearchAsYouType(bool value) {
+    settings->beginGroup("Search");
+    settings->setValue("searchAsYouType",value);
+    settings->endGroup();
+    searchAsYouType=value;
+}
+
+
+bool Global::getSearchAsYouType() {
+    settings->beginGroup("Search");
+    bool value = settings->value("searchAsYouType",false).toBool();
+    settings->endGroup();
+    searchAsYouType = value;
+    return value;
+}
+
+
+
+
+void Global::setTrigramIndex(bool value) {
+    settings->beginGroup("Search");
+    settings->setValue("trigramIndex",value);
+    settings->endGroup();
+    trigramIndex=value;
+}
+
+
+bool Global::getTrigramIndex() {
+    settings->beginGroup("Search");
+    bool value = settings->value("trigramIndex",false).toBool();
+    settings->endGroup();
+    trigramIndex = value;
+    return value;
+}
+
+
+
+void Global::setIncludeChildTags(bool value) {
+    settings->beginGroup("Search");
+    settings->setValue("includeChildTags",value);
+    settings->endGroup();
+    includeChildTags=value;
+}
+
+
+bool Global::getIncludeChildTags() {
+    settings->beginGroup("Search");
+    bool value = settings->value("includeChildTags",false).toBool();
+    settings->endGroup();
+    includeChildTags = value;
+    return value;
+}
+
+
+
+
+void Global::setFoldSearchText(bool value) {
+    settings->beginGroup("Search");
+    settings->setValue("foldText",value);
+    settings->endGroup();
+    foldSearchText=value;
+}
+
+
+bool Global::getFoldSearchText() {
+    settings->beginGroup("Search");
+    bool value = settings->value("foldText",false).toBool();
+    settings->endGroup();
+    foldSearchText = value;
+    return value;
+}
+
+
+
+
+void Global::setSearchStemLanguage(QString value) {
+    settings->beginGroup("Search");
+    settings->setValue("stemLanguage",value);
+    settings->endGroup();
+    searchStemLanguage=value;
+}
+
+
+QString Global::getSearchStemLanguage() {
+    settings->beginGroup("Search");
+    QString value = settings->value("stemLanguage","").toString();
+    settings->endGroup();
+    searchStemLanguage = value;
+    return value;
+}
+
+
+
+
+void Global::setIndexThreads(qint32 value) {
+    settings->beginGroup("Search");
+    settings->setValue("indexThreads",value);
+    settings->endGroup();
+    indexThreads=value;
+}
+
+
+qint32 Global::getIndexThreads() {
+    settings->beginGroup("Search");
+    qint32 value = settings->value("indexThreads",0).toInt();
+    settings->endGroup();
+    indexThreads = value;
+    return value;
+}
+
+
+
+
 
 void Global::setStrictDTD(bool value) {
     settings->beginGroup("Debugging");
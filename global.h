@@ -36,6 +36,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "reminders/remindermanager.h"
 #include "sql/databaseconnection.h"
 #include "threads/indexrunner.h"
+#include "threads/workmetrics.h"
 #include "utilities/crossmemorymapper.h"
 #include "exits/exitpoint.h"
 #include "exits/exitmanager.h"
@@ -118,6 +119,7 @@ public:
     int argc;                  // Initial argument count from the program start
     char** argv;               // List of arguments from the program start
     FileManager fileManager;   // Manage file paths
+    WorkMetrics workMetrics;   // What the background threads are doing
     AccountsManager *accountsManager;      // Manage user account
     QCoreApplication *application;              // pointer to this current application
     unsigned int cryptCounter;             // Count of crytpographic entries.  This is incremented each time we encrypt some text.
@@ -183,8 +185,6 @@ public:
 
     qint32 minIndexInterval;                              // Minimum interval to check for any unindexed notes.
     qint32 maxIndexInterval;                              // Maximum interval to check for any unindexed notes.
-    qint32 indexResourceCountPause;                       // After indexing this many resources we pause to avoid overloading the CPU
-    qint32 indexNoteCountPause;                           // After indexing this many notes we pause to avoid overloading the CPU
 
     // Filter criteria.  Used for things like the back & forward buttons
     QList<FilterCriteria*> filterCriteria;
@@ -279,6 +279,28 @@ public:
     void stackDump(int max=0);                                 // Utility to dump the running stack
     bool getForceSearchLowerCase();                            // Get value to force search db in lower case from settings
     void setForceSearchLowerCase(bool value);                  // save forceSearchLowerCase
+    bool backgroundSearch;                                     // Run search text filters on the search thread
+    bool getBackgroundSearch();                                // Get background search setting
+    void setBackgroundSearch(bool value);                      // Save background search setting
+    bool searchAsYouType;                                      // Start searching while the user is still typing
+    bool getSearchAsYouType();                                 // Get search as you type setting
+    void setSearchAsYouType(bool value);                       // Save search as you type setting
+    bool trigramIndex;                                         // Keep a trigram index for fuzzy & infix searches
+    bool getTrigramIndex();                                    // Get trigram index setting
+    void setTrigramIndex(bool value);                          // Save trigram index setting
+    bool geographyIndex;                                       // Is the R*Tree note location index available?
+    bool includeChildTags;                                     // Do tag filters also match the tags below them?
+    bool getIncludeChildTags();                                // Get include child tags setting
+    void setIncludeChildTags(bool value);                      // Save include child tags setting
+    bool foldSearchText;                                       // Fold case, accents & character widths in the search index
+    bool getFoldSearchText();                                  // Get fold search text setting
+    void setFoldSearchText(bool value);                        // Save fold search text setting
+    QString searchStemLanguage;                                // Language used to stem indexed words, "" for none
+    QString getSearchStemLanguage();                           // Get the stemming language
+    void setSearchStemLanguage(QString value);                 // Save the stemming language
+    qint32 indexThreads;                                       // Number of text extraction threads, 0 for automatic
+    qint32 getIndexThreads();                                  // Get the number of index threads
+    void setIndexThreads(qint32 value);                        // Save the number of index threads
     IndexRunner *indexRunner;                                    // Pointer to index thread
 
     int minimumThumbnailInterval;                               // Minimum time to scan for thumbnails
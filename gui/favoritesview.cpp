@@ -706,24 +706,36 @@ void FavoritesView::itemRenamed(qint32 lid, QString oldName, QString newName) {
 }
 
 
-// Update the total counts for the shortcut.  *** UNUSED ***
+// Update the total counts for the shortcut.
 void FavoritesView::updateTotals(qint32 lid, qint32 subTotal, qint32 total) {
-    subTotal = -1;
-    maxCount = -1;
-    return;
-    // This is terribly inefficient, but we shouldn't need to do it too often.
-    // We look for a key in the targetStore.
+    if (setTotals(lid, subTotal, total))
+        repaint();
+}
 
-    if (targetStore.contains(lid)) {
-        FavoritesViewItem *item = targetStore[lid];
-        if (item == NULL)
-            return;
-        item->subTotal = subTotal;
-        item->total = total;
-        if (total > maxCount)
-            maxCount = total;
+// Update the total counts for a batch of notebooks, tags or saved searches
+void FavoritesView::updateTotals(CounterTotals totals) {
+    bool changed = false;
+    CounterTotals::iterator i;
+    for (i=totals.begin(); i!=totals.end(); ++i) {
+        if (setTotals(i.key(), i.value().first, i.value().second))
+            changed = true;
     }
-    repaint();
+    if (changed)
+        repaint();
+}
+
+// Set the counts for the favorite pointing to a lid.  Returns true if
+// there is one.  Notebooks, tags & searches all have their own lids,
+// so the target is enough to find it.
+bool FavoritesView::setTotals(qint32 lid, qint32 subTotal, qint32 total) {
+    FavoritesViewItem *item = targetStore.value(lid, NULL);
+    if (item == NULL || item->record.type == FavoritesRecord::Note)
+        return false;
+    item->subTotal = subTotal;
+    item->total = total;
+    if (total > maxCount)
+        maxCount = total;
+    return true;
 }
 
 void FavoritesView::itemExpunged(qint32 lid, QString name) {
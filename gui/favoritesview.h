@@ -31,6 +31,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QShortcut>
 
 #include "gui/favoritesviewitem.h"
+#include "threads/counterrunner.h"
 
 class FavoritesView : public QTreeWidget
 {
@@ -43,6 +44,7 @@ private:
     int maxCount;
     void addRecord(qint32 lid, FavoritesRecord::FavoritesRecordType type, int row);
     void buildTreeEntry(FavoritesViewItem *parent, const FavoritesRecord *record);
+    bool setTotals(qint32 lid, qint32 subTotal, qint32 total);
 
 private slots:
     int calculateHeightRec(QTreeWidgetItem * item);
@@ -79,6 +81,7 @@ public slots:
     void itemRenamed(qint32 lid, QString oldName, QString newName);
     void buildSelection();
     void updateTotals(qint32 lid, qint32 subTotal, qint32 total);
+    void updateTotals(CounterTotals totals);
     void itemExpunged(qint32 lid);
     void itemExpunged(qint32 lid, QString name);
     void stackExpunged(QString stackname);
@@ -65,9 +65,9 @@ void FavoritesViewDelegate::paint(QPainter *painter, const QStyleOptionViewItem
     } else {
         return;
     }
-    if (item->record.type == FavoritesRecord::NotebookStack
+    if (item == NULL || item->record.type == FavoritesRecord::NotebookStack
             || item->record.type == FavoritesRecord::LinkedStack
-            || item->record.type == FavoritesRecord::Search)
+            || item->record.type == FavoritesRecord::Note)
         return;
 
     qint32 total = item->total;
@@ -90,11 +90,12 @@ void FavoritesViewDelegate::paint(QPainter *painter, const QStyleOptionViewItem
     QRect clip(0, 0, options.rect.width()+iconSize.width(), options.rect.height());
 
     painter->setClipRect(clip);
+    QFontMetrics fm = options.fontMetrics;
     QFont f = options.font;
     f.setBold(false);
     painter->setFont(f);
     painter->setPen(Qt::darkGray);
-    //painter->drawText(6+fm.width(index.data().toString()+QString("   ")),fm.ascent(),countString);
+    painter->drawText(10+fm.width(index.data().toString()+QString(" ")),fm.ascent(),countString);
 
     painter->restore();
 }
@@ -22,11 +22,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "favoritesviewitem.h"
 
 FavoritesViewItem::FavoritesViewItem(QTreeWidget* parent):QTreeWidgetItem(parent){
-    total=0;
-    subTotal=0;
+    total=-1;
+    subTotal=-1;
 }
 
-FavoritesViewItem::FavoritesViewItem():QTreeWidgetItem(){}
+FavoritesViewItem::FavoritesViewItem():QTreeWidgetItem(){
+    total=-1;
+    subTotal=-1;
+}
 
 
 bool FavoritesViewItem::operator<(const QTreeWidgetItem &other)const {
@@ -11,6 +11,7 @@
 #include <QToolButton>
 #include <QStyle>
 #include <QPainter>
+#include <QDateTime>
 #include "global.h"
 
 extern Global global;
@@ -42,7 +43,14 @@ extern Global global;
      inactiveColor = "QLineEdit {color: gray; font:italic;} ";
      activeColor = "QLineEdit {color: black; font:normal;} ";
 
-     connect(this, SIGNAL(returnPressed()), this, SLOT(buildSelection()));
+     keystrokeTime = 0;
+     typedSelection = false;
+     typingTimer.setSingleShot(true);
+     typingTimer.setInterval(300);
+     connect(&typingTimer, SIGNAL(timeout()), this, SLOT(typingTimerExpired()));
+     connect(this, SIGNAL(textEdited(QString)), this, SLOT(textEditedSearch()));
+
+     connect(this, SIGNAL(returnPressed()), this, SLOT(returnPressedSearch()));
      connect(this, SIGNAL(textChanged(QString)), this, SLOT(textChanged(QString)));
      connect(clearButton, SIGNAL(clicked()), this, SLOT(buildSelection()));
      setStyleSheet(inactiveColor);
@@ -72,6 +80,8 @@ extern Global global;
  void LineEdit::buildSelection() {
      QLOG_TRACE() << "Inside LineEdit::buildSelection()";
      savedText = text().trimmed();
+     typedSelection = false;
+     typingTimer.stop();
 
      // First, find out if we're already viewing history.  If we are we
      // chop off the end of the history & start a new one
@@ -151,6 +161,53 @@ void LineEdit::textChanged(QString text) {
     }
 }
 
+
+
+
+// The user pressed enter.  If we already searched for this text while
+// they were typing there is nothing more to do.
+void LineEdit::returnPressedSearch() {
+    keystrokeTime = QDateTime::currentMSecsSinceEpoch();
+    if (typedSelection && text().trimmed() == savedText) {
+        typedSelection = false;
+        typingTimer.stop();
+        return;
+    }
+    buildSelection();
+}
+
+
+void LineEdit::textEditedSearch() {
+    keystrokeTime = QDateTime::currentMSecsSinceEpoch();
+    if (global.searchAsYouType)
+        typingTimer.start();
+}
+
+
+
+//*************************************************************
+// The user stopped typing for a moment.  Start a search, but
+// re-use the history entry from the previous typed search so
+// every keystroke doesn't end up in the history list.
+//*************************************************************
+void LineEdit::typingTimerExpired() {
+    if (!hasFocus() || text().trimmed() == savedText)
+        return;
+    if (typedSelection && filterPosition == global.filterPosition &&
+            global.filterPosition < global.filterCriteria.size()) {
+        savedText = text().trimmed();
+        if (savedText == "")
+            global.filterCriteria[global.filterPosition]->unsetSearchString();
+        else
+            global.filterCriteria[global.filterPosition]->setSearchString(text());
+        emit updateSelectionRequested();
+        return;
+    }
+    buildSelection();
+    typedSelection = true;
+}
+
+
 void LineEdit::focusInEvent(QFocusEvent *e)
 {
   QLineEdit::focusInEvent(e);
@@ -11,6 +11,7 @@
  #define LINEEDIT_H
 
  #include <QLineEdit>
+ #include <QTimer>
 
  class QToolButton;
 
@@ -23,12 +24,15 @@
      QString defaultText;
      QString activeColor;
      QString inactiveColor;
+     QTimer typingTimer;        // Waits for a pause in typing before searching
+     bool typedSelection;       // Was the current history entry created by typing?
 
  public:
      LineEdit(QWidget *parent = 0);
      void updateSelection();
      bool isSet();
      void reloadIcons();
+     qint64 keystrokeTime;      // When the key that started the current search was pressed
 
  protected:
      void resizeEvent(QResizeEvent *);
@@ -39,6 +43,9 @@
      void updateCloseButton(const QString &text);
      void buildSelection();
      void textChanged(QString text);
+     void returnPressedSearch();
+     void textEditedSearch();
+     void typingTimerExpired();
 
  private:
      QToolButton *clearButton;
@@ -50,6 +50,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "utilities/pixelconverter.h"
 #include "gui/browserWidgets/table/tablepropertiesdialog.h"
 #include "exits/exitmanager.h"
+#include "threads/indexrunner.h"
+#include "filters/filterengine.h"
 
 #include <QPlainTextEdit>
 #include <QVBoxLayout>
@@ -432,6 +434,10 @@ void NBrowserWindow::setContent(qint32 lid) {
     if (lid == this->lid)
         return;
 
+    // Index the note ahead of the others if it still needs it
+    if (global.indexRunner != NULL)
+        global.indexRunner->prioritize(lid, INDEX_PRIORITY_USER);
+
     bool hasFocus = false;
     if (this->editor->hasFocus())
         hasFocus = true;
@@ -599,10 +605,24 @@ void NBrowserWindow::setContent(qint32 lid) {
     setSource();
 
     if (criteria->isSearchStringSet()) {
+        // If the search collected its hits we know the words that matched
+        // around the snippet as they are written in the note (e.g. "foxes"
+        // for "fox*", or "Café" for "cafe" when accents are folded), so
+        // highlight those and scroll to the first one.  The search words themselves are always
+        // highlighted for any matches outside the snippet.
         QStringList list = criteria->getSearchString().split(" ");
         for (int i=0; i<list.size(); i++) {
             editor->page()->findText(list[i], QWebPage::HighlightAllOccurrences);
         }
+        SearchHit hit;
+        FilterEngine engine;
+        if (engine.getSearchHit(criteria, lid, hit)) {
+            for (int i=0; i<hit.words.size(); i++) {
+                editor->page()->findText(hit.words[i], QWebPage::HighlightAllOccurrences);
+            }
+            if (hit.words.size() > 0 && editor->page()->findText(hit.words[0]))
+                editor->page()->mainFrame()->evaluateJavaScript("window.getSelection().collapseToStart();");
+        }
     }
 
     QLOG_DEBUG() << "Checking thumbnail";
@@ -845,6 +865,8 @@ void NBrowserWindow::saveNoteContent() {
         } else
             emit requestNoteContentUpdate(lid, formatter.getEnml(), true);
         editor->isDirty = false;
+        if (global.indexRunner != NULL)
+            global.indexRunner->prioritize(lid, INDEX_PRIORITY_USER);
         if (thumbnailer == NULL)
             thumbnailer = new Thumbnailer(global.db);
         QLOG_DEBUG() << "Beginning thumbnail";
@@ -231,56 +231,72 @@ void NNotebookView::mousePressEvent(QMouseEvent *event)
 }
 
 
-// Load up the data from the database
+// Load up the data from the database.  Notebooks that are already in the
+// tree are updated in place, new ones are added and ones that no longer
+// exist are taken out, so a reload only touches what changed.
 void NNotebookView::loadData() {
     NSqlQuery query(global.db);
-    NotebookTable notebookTable(global.db);
-    QList<qint32> closedLids;
-    notebookTable.getClosedNotebooks(closedLids);
-
-
-    QHash<qint32, NNotebookViewItem*>::iterator i1;
-    for (i1=dataStore.begin(); i1!=dataStore.end(); ++i1) {
-        if (i1.value() != NULL)
-            i1.value()->setHidden(true);
-    }
-
-    QHash<QString, NNotebookViewItem*>::iterator i2;
-    for (i2=stackStore.begin(); i2!=stackStore.end(); ++i2) {
-        if (i2.value() != NULL)
-            i2.value()->setHidden(true);
-    }
-
-    dataStore.clear();
-    query.exec("Select lid, name, stack, username from NotebookModel order by username, name");
+    QSet<qint32> found;
+    query.exec("Select lid, name, stack, username, isClosed, isDeleted from NotebookModel order by username, name");
     while (query.next()) {
         qint32 lid = query.value(0).toInt();
-        if (!notebookTable.isDeleted(query.value(0).toInt())) {
-            NNotebookViewItem *newWidget = new NNotebookViewItem(lid);
-            newWidget->setData(NAME_POSITION, Qt::DisplayRole, query.value(1).toString());
-            newWidget->setData(NAME_POSITION, Qt::UserRole, lid);
-            if (closedLids.contains(lid))
-                newWidget->setHidden(true);
-            QString username = query.value(3).toString();
-            if (username.trimmed() != "")
-                newWidget->stack = username;
-            else
-                newWidget->stack = query.value(2).toString();
-            this->dataStore.insert(query.value(0).toInt(), newWidget);
-            root->addChild(newWidget);
+        if (query.value(5).toBool())
+            continue;
+        found.insert(lid);
+
+        NNotebookViewItem *widget = dataStore.value(lid);
+        if (widget == NULL) {
+            widget = new NNotebookViewItem(lid);
+            widget->setData(NAME_POSITION, Qt::UserRole, lid);
+            this->dataStore.insert(lid, widget);
+            root->addChild(widget);
+            this->rebuildNotebookTreeNeeded = true;
+        }
+        QString name = query.value(1).toString();
+        if (widget->data(NAME_POSITION, Qt::DisplayRole).toString() != name)
+            widget->setData(NAME_POSITION, Qt::DisplayRole, name);
+        bool closed = !query.value(4).isNull();
+        if (widget->isHidden() != closed) {
+            widget->setHidden(closed);
+            this->rebuildNotebookTreeNeeded = true;
+        }
+        QString username = query.value(3).toString();
+        QString stack = query.value(2).toString();
+        if (username.trimmed() != "")
+            stack = username;
+        if (widget->stack != stack) {
+            widget->stack = stack;
+            this->rebuildNotebookTreeNeeded = true;
+        }
 
-            if (newWidget->stack != "" && !stackStore.contains(newWidget->stack)) {
-                NNotebookViewItem *stackWidget = new NNotebookViewItem(0);
-                stackWidget->setData(NAME_POSITION, Qt::DisplayRole, newWidget->stack);
-                stackWidget->setData(NAME_POSITION, Qt::UserRole, "STACK");
-                if (username != "")
-                    stackWidget->setType(NNotebookViewItem::LinkedStack);
-                stackStore.insert(newWidget->stack, stackWidget);
-                root->addChild(stackWidget);
-            }
+        if (widget->stack != "" && !stackStore.contains(widget->stack)) {
+            NNotebookViewItem *stackWidget = new NNotebookViewItem(0);
+            stackWidget->setData(NAME_POSITION, Qt::DisplayRole, widget->stack);
+            stackWidget->setData(NAME_POSITION, Qt::UserRole, "STACK");
+            if (username != "")
+                stackWidget->setType(NNotebookViewItem::LinkedStack);
+            stackStore.insert(widget->stack, stackWidget);
+            root->addChild(stackWidget);
         }
     }
     query.finish();
+
+    // Take out any notebooks that are gone
+    QList<qint32> keys = dataStore.keys();
+    for (int i=0; i<keys.size(); i++) {
+        if (found.contains(keys[i]))
+            continue;
+        NNotebookViewItem *ptr = dataStore.take(keys[i]);
+        if (ptr == NULL)
+            continue;
+        if (ptr->parent() != NULL) {
+            if (ptr->parent() != root)
+                ((NNotebookViewItem*)ptr->parent())->childrenLids.removeAll(keys[i]);
+            ptr->parent()->removeChild(ptr);
+        }
+        ptr->setHidden(true);
+        this->rebuildNotebookTreeNeeded = true;
+    }
     this->rebuildTree();
     this->resetSize();
 }
@@ -293,9 +309,8 @@ void NNotebookView::rebuildTree() {
 
     // Go through all the widgets in the view.  If
     // it should be hidden (because the notebook is closed
-    // then hide it, othwise make it visible.  If it has
-    // a stack, then save the stack name later so we can
-    // display stacks properly.
+    // then hide it, othwise make it visible.  If it isn't
+    // under the right stack (or the root) it is moved.
     NotebookTable notebookTable(global.db);
     QList<qint32> closedLids;
     notebookTable.getClosedNotebooks(closedLids);
@@ -303,27 +318,33 @@ void NNotebookView::rebuildTree() {
     while (i.hasNext()) {
         i.next();
         NNotebookViewItem *widget = i.value();
-        if (widget != NULL) {
-            if (i.value()->stack != "") {
-                NNotebookViewItem *stackWidget = NULL;
-                if (stackStore.contains(i.value()->stack)) {
-                    stackWidget = stackStore[i.value()->stack];
-                } else {
-                    NNotebookViewItem *stackWidget = new NNotebookViewItem(0);
-                    stackWidget->setData(NAME_POSITION, Qt::DisplayRole, i.value()->stack);
-                    stackWidget->setData(NAME_POSITION, Qt::UserRole, "STACK");
-                    stackStore.insert(widget->stack, stackWidget);
-                    root->addChild(stackWidget);
-                }
-                i.value()->parent()->removeChild(i.value());
-                stackWidget->childrenLids.append(i.key());
-                stackWidget->addChild(i.value());
+        if (widget == NULL)
+            continue;
+        NNotebookViewItem *parent = root;
+        if (widget->stack != "") {
+            parent = stackStore.value(widget->stack);
+            if (parent == NULL) {
+                parent = new NNotebookViewItem(0);
+                parent->setData(NAME_POSITION, Qt::DisplayRole, widget->stack);
+                parent->setData(NAME_POSITION, Qt::UserRole, "STACK");
+                stackStore.insert(widget->stack, parent);
+                root->addChild(parent);
             }
-            if (closedLids.contains(widget->lid))
-                widget->setHidden(true);
-            else
-                widget->setHidden(false);
         }
+        if (widget->parent() != parent) {
+            if (widget->parent() != NULL) {
+                if (widget->parent() != root)
+                    ((NNotebookViewItem*)widget->parent())->childrenLids.removeAll(i.key());
+                widget->parent()->removeChild(widget);
+            }
+            if (parent != root)
+                parent->childrenLids.append(i.key());
+            parent->addChild(widget);
+        }
+        if (closedLids.contains(widget->lid))
+            widget->setHidden(true);
+        else
+            widget->setHidden(false);
     }
 
     // Remove any empty stacks
@@ -946,6 +967,22 @@ void NNotebookView::updateTotals(qint32 lid, qint32 subTotal, qint32 total) {
 }
 
 
+// Update the counts for every notebook at once, then the stacks, and repaint once.
+void NNotebookView::updateTotals(CounterTotals totals) {
+    CounterTotals::iterator i;
+    for (i=totals.begin(); i!=totals.end(); ++i) {
+        NNotebookViewItem *item = dataStore.value(i.key());
+        if (item == NULL)
+            continue;
+        item->subTotal = i.value().first;
+        item->total = i.value().second;
+        if (item->subTotal > maxCount)
+            maxCount = item->subTotal;
+    }
+    updateTotals(-1, -1, -1);
+}
+
+
 // Handle what happens when something is dropped onto a tag item
 bool NNotebookView::dropMimeData(QTreeWidgetItem *parent, int index, const QMimeData *data, Qt::DropAction action) {
     Q_UNUSED(index); // suppress unused variable
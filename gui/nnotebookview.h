@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QTreeWidget>
 #include <QMenu>
 #include <QShortcut>
+#include "threads/counterrunner.h"
 
 class NNotebookView : public QTreeWidget
 {
@@ -96,6 +97,7 @@ public slots:
     void removeFromStackRequested();
     void notebookExpunged(qint32 lid);
     void updateTotals(qint32 lid, qint32 subTotal, qint32 total);
+    void updateTotals(CounterTotals totals);
     bool dropMimeData(QTreeWidgetItem *parent, int index, const QMimeData *data, Qt::DropAction action);
     void dropEvent(QDropEvent *event);
     void dragEnterEvent(QDragEnterEvent *event);
@@ -471,15 +471,13 @@ void NTableView::refreshData() {
     }
     sql.finish();
     QLOG_DEBUG() << "Valid LIDs retrieved.  Refreshing selection";
-    model()->select();
-    while(model()->canFetchMore())
-        model()->fetchMore();
 
-    // resort the table.  I'm not sure why, but it doesn't always
-    // do this itself.
-    Qt::SortOrder so = this->tableViewHeader->sortIndicatorOrder();
-    int si = this->tableViewHeader->sortIndicatorSection();
-    this->sortByColumn(si, so);
+    // The model keeps its own sort order, so this only reads the sorted
+    // list of lids.  The rest of each row is read as it is displayed.
+    QDateTime start = QDateTime::currentDateTimeUtc();
+    model()->select();
+    QLOG_DEBUG() << "Note list of " << model()->rowCount() << " notes loaded in "
+                 << start.msecsTo(QDateTime::currentDateTimeUtc()) << " milliseconds";
 
     // Re-select any notes
     refreshSelection();
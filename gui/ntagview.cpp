@@ -232,50 +232,69 @@ void NTagView::mousePressEvent(QMouseEvent *event)
 
 
 
-// Load up the data from the database
+// Load up the data from the database.  Tags that are already in the tree
+// are updated in place, new ones are added and ones that no longer exist
+// are taken out, so a reload after a sync only touches what changed.
 void NTagView::loadData() {
-
-    // Empty out the old data store
-    QList<qint32> keys = dataStore.keys();
-    for (int i=0; i<keys.size(); i++) {
-        if (dataStore.contains(keys[i])) {
-            NTagViewItem *ptr = dataStore.take(keys[i]);
-            dataStore.remove(keys[i]);
-            if (ptr->parent() != NULL)
-                ptr->parent()->removeChild(ptr);
-            ptr->setHidden(true);
-           // delete ptr;  << We can leak memory, but otherwise it sometimes gets confused and causes crashes
-        }
-    }
-
     NSqlQuery query(global.db);
-    TagTable tagTable(global.db);
-    query.exec("Select lid, name, parent_gid, account from TagModel order by name");
+    QSet<qint32> found;
+    query.exec("Select lid, name, parent_gid, account, parent_lid from TagModel order by name");
     while (query.next()) {
         qint32 lid = query.value(0).toInt();
         QString name = query.value(1).toString();
         QString parentGid = query.value(2).toString();
         qint32 account = query.value(3).toInt();
-
-        NTagViewItem *newWidget = new NTagViewItem();
-        newWidget->setData(NAME_POSITION, Qt::DisplayRole, name);
-        newWidget->setData(NAME_POSITION, Qt::UserRole, lid);
-        newWidget->account = account;
+        qint32 parentLid = query.value(4).toInt();
+        found.insert(lid);
+
+        NTagViewItem *widget = dataStore.value(lid);
+        if (widget == NULL) {
+            widget = new NTagViewItem();
+            widget->setData(NAME_POSITION, Qt::UserRole, lid);
+            dataStore.insert(lid, widget);
+            root->addChild(widget);
+            this->rebuildTagTreeNeeded = true;
+        }
+        if (widget->data(NAME_POSITION, Qt::DisplayRole).toString() != name)
+            widget->setData(NAME_POSITION, Qt::DisplayRole, name);
+        widget->account = account;
         if (account != accountFilter)
-            newWidget->setHidden(true);
+            widget->setHidden(true);
         else
-            newWidget->setHidden(false);
-        this->dataStore.insert(lid, newWidget);
-        newWidget->parentGuid = parentGid;
-        newWidget->parentLid = tagTable.getLid(parentGid);
-        root->addChild(newWidget);
+            widget->setHidden(false);
+        if (widget->parentGuid != parentGid || widget->parentLid != parentLid) {
+            widget->parentGuid = parentGid;
+            widget->parentLid = parentLid;
+            this->rebuildTagTreeNeeded = true;
+        }
     }
     query.finish();
+
+    // Take out any tags that are gone.  Their children are moved
+    // to the root until rebuildTree finds where they belong.
+    QList<qint32> keys = dataStore.keys();
+    for (int i=0; i<keys.size(); i++) {
+        if (found.contains(keys[i]))
+            continue;
+        NTagViewItem *ptr = dataStore.take(keys[i]);
+        if (ptr == NULL)
+            continue;
+        while (ptr->childCount() > 0) {
+            QTreeWidgetItem *child = ptr->takeChild(0);
+            root->addChild(child);
+        }
+        if (ptr->parent() != NULL)
+            ptr->parent()->removeChild(ptr);
+        ptr->setHidden(true);
+        // delete ptr;  << We can leak memory, but otherwise it sometimes gets confused and causes crashes
+        this->rebuildTagTreeNeeded = true;
+    }
     this->rebuildTree();
 }
 
 
-// Rebuild the GUI tree.
+// Rebuild the GUI tree.  Only tags that are not under the right
+// parent are moved.
 void NTagView::rebuildTree() {
     if (!this->rebuildTagTreeNeeded)
         return;
@@ -286,16 +305,27 @@ void NTagView::rebuildTree() {
     while (i.hasNext()) {
         i.next();
         NTagViewItem *widget = i.value();
-        if (widget != NULL && widget->parentGuid != "") {
+        if (widget == NULL)
+            continue;
+        QTreeWidgetItem *parent = root;
+        if (widget->parentGuid != "") {
             if (widget->parentLid == 0) {
                 widget->parentLid = tagTable.getLid(widget->parentGuid);
             }
-            NTagViewItem *parent = dataStore[widget->parentLid];
+            parent = dataStore.value(widget->parentLid);
+        }
+        if (widget->parent() == parent)
+            continue;
+
+        if (widget->parent() != NULL) {
+            if (widget->parent() != root)
+                ((NTagViewItem*)widget->parent())->childrenLids.removeAll(i.key());
             widget->parent()->removeChild(widget);
-            if (parent != NULL) {
-                parent->childrenLids.append(i.key());
-                parent->addChild(widget);
-            }
+        }
+        if (parent != NULL) {
+            if (parent != root)
+                ((NTagViewItem*)parent)->childrenLids.append(i.key());
+            parent->addChild(widget);
         }
     }
     this->sortByColumn(NAME_POSITION, Qt::AscendingOrder);
@@ -862,6 +892,16 @@ void NTagView::updateTotals(qint32 lid, qint32 subTotal, qint32 total) {
 
 
 
+// Update the counts for every tag at once.
+void NTagView::updateTotals(CounterTotals totals) {
+    CounterTotals::iterator i;
+    for (i=totals.begin(); i!=totals.end(); ++i)
+        updateTotals(i.key(), i.value().first, i.value().second);
+    repaint();
+}
+
+
+
 // If a tag has a zero count and if we should hide the tags, hide it.
 // Make sure the tag's parents are also visible if the child has a non-zero
 // count.
@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QShortcut>
 #include <QMenu>
 #include <QAction>
+#include "threads/counterrunner.h"
 
 class NTagView : public QTreeWidget
 {
@@ -96,6 +97,7 @@ public slots:
     void mergeRequested();
     void tagExpunged(qint32 lid);
     void updateTotals(qint32 lid, qint32 subTotal, qint32 total);
+    void updateTotals(CounterTotals totals);
     void hideUnassignedTags();
     void notebookSelectionChanged(qint32 notebookLid);
 
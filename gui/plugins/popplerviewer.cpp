@@ -30,6 +30,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QImage>
 #include <QPushButton>
 #include "filters/filterengine.h"
+#include "sql/resourcetable.h"
 #include <global.h>
 
 extern Global global;
@@ -40,6 +41,8 @@ PopplerViewer::PopplerViewer(const QString &mimeType, const QString &reslid, QWi
     pageLabel = new QLabel(this);
     this->mimeType = mimeType;
     this->lid = reslid.toInt();
+    ResourceTable resourceTable(global.db);
+    textCache = new PdfTextCache(resourceTable.getDataHash(lid));
     printImageFile = global.fileManager.getTmpDirPath() + QString::number(lid) +QString("-print.png");
     QString file = global.fileManager.getDbaDirPath() + reslid +".pdf";
     doc = Poppler::Document::load(file);
@@ -103,6 +106,11 @@ PopplerViewer::PopplerViewer(const QString &mimeType, const QString &reslid, QWi
 }
 
 
+PopplerViewer::~PopplerViewer() {
+    delete textCache;
+}
+
+
 void PopplerViewer::pageRightPressed() {
     if (currentPage+1 < totalPages) {
         currentPage++;
@@ -146,6 +154,21 @@ void PopplerViewer::pageLeftPressed() {
 }
 
 
+// Check the page's text in the PDF text cache before having Poppler search
+// it, which means reading the whole page.  Pages that aren't cached, and
+// phrases, which Poppler can match across lines, are always searched.
+bool PopplerViewer::pageMightContain(int page) {
+    if (!textCache->hasPage(page))
+        return true;
+    QString text = textCache->page(page);
+    for (int i=0; i<searchHits.size(); i++) {
+        if (searchHits[i].contains(" ") || text.contains(searchHits[i], Qt::CaseInsensitive))
+            return true;
+    }
+    return false;
+}
+
+
 // Search for the next page containing text
 void PopplerViewer::findNextPage(QStringList searchHits, QList<QRectF> *searchLocations) {
 
@@ -154,6 +177,10 @@ void PopplerViewer::findNextPage(QStringList searchHits, QList<QRectF> *searchLo
     searchLocations->clear();
 
     while (page < doc->numPages() && !found) {
+        if (!pageMightContain(page)) {
+            page++;
+            continue;
+        }
         for (int i=0; i<searchHits.size(); i++) {
 //#if QT_VERSION < 0x050000
 //            QList<QRectF> results = doc->page(page)->search(searchHits[i], Poppler::Page::CaseInsensitive);
@@ -182,7 +209,8 @@ QPixmap PopplerViewer::highlightImage() {
     p2.setBrush(yellow);
 
     QList<QRectF> searchLocations;
-    for (int i=0; i<searchHits.size(); i++) {
+    bool searchPage = pageMightContain(currentPage);
+    for (int i=0; searchPage && i<searchHits.size(); i++) {
 //        searchLocations.append(doc->page(currentPage)->search(searchHits[i], Poppler::Page::CaseInsensitive));
 //#if QT_VERSION < 0x050000
 //        searchLocations.append(doc->page(currentPage)->search(searchHits[i], Poppler::Page::CaseInsensitive));
@@ -35,6 +35,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #endif
 
 #include "gui/plugins/popplergraphicsview.h"
+#include "utilities/pdftextcache.h"
 
 class PopplerViewer : public QWidget
 {
@@ -42,6 +43,7 @@ class PopplerViewer : public QWidget
 
 public:
     PopplerViewer(const QString &mimeType, const QString &lid, QWidget *parent = 0);
+    ~PopplerViewer();
 
 private:
     QGraphicsScene *scene;
@@ -58,6 +60,8 @@ private:
     qint32 lid;
     QString printImageFile;
     QStringList searchHits;
+    PdfTextCache *textCache;
+    bool pageMightContain(int page);
     void findNextPage(QStringList searchHits, QList<QRectF> *searchLocations);
     QPixmap highlightImage();
 
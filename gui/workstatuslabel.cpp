@@ -0,0 +1,54 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "workstatuslabel.h"
+#include "global.h"
+#include <QStringList>
+
+extern Global global;
+
+
+WorkStatusLabel::WorkStatusLabel(QWidget *parent) :
+    QLabel(parent)
+{
+    setVisible(false);
+    connect(&timer, SIGNAL(timeout()), this, SLOT(refresh()));
+    timer.start(WORK_STATUS_MSECS);
+}
+
+
+
+void WorkStatusLabel::refresh() {
+    QStringList parts;
+    qint32 index = global.workMetrics.backlog("index");
+    if (index > 0)
+        parts.append(tr("Indexing: %1 left (%2/s)").arg(index)
+                     .arg(global.workMetrics.rate("index"), 0, 'f', 1));
+    qint32 thumbnails = global.workMetrics.backlog("thumbnail");
+    if (thumbnails > 0)
+        parts.append(tr("Thumbnails: %1 left").arg(thumbnails));
+
+    if (parts.size() == 0) {
+        setVisible(false);
+        return;
+    }
+    setText(parts.join("  "));
+    setToolTip(global.workMetrics.report());
+    setVisible(true);
+}
@@ -0,0 +1,49 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef WORKSTATUSLABEL_H
+#define WORKSTATUSLABEL_H
+
+#include <QLabel>
+#include <QTimer>
+
+// How often the status bar figures are refreshed
+#define WORK_STATUS_MSECS       2000
+
+
+//*****************************************************************
+//* A status bar label showing how much background work (indexing
+//* & thumbnails) is waiting and how fast it is going.  It hides
+//* itself when there is nothing to do.  The tool tip has the full
+//* metrics report.
+//*****************************************************************
+class WorkStatusLabel : public QLabel
+{
+    Q_OBJECT
+private:
+    QTimer timer;
+
+public:
+    WorkStatusLabel(QWidget *parent = 0);
+
+private slots:
+    void refresh();
+};
+
+#endif // WORKSTATUSLABEL_H
@@ -0,0 +1,303 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "enmltext.h"
+#include <string.h>
+#include <stdlib.h>
+
+// Longest tag & entity names that are looked at.  Anything longer
+// can't be one we know about.
+#define ENML_TAG_NAME_MAX      16
+#define ENML_ENTITY_NAME_MAX   10
+
+
+// HTML 4 entity names for 160 to 255
+static const char *latin1Entities[] = {
+    "nbsp", "iexcl", "cent", "pound", "curren", "yen", "brvbar", "sect",
+    "uml", "copy", "ordf", "laquo", "not", "shy", "reg", "macr",
+    "deg", "plusmn", "sup2", "sup3", "acute", "micro", "para", "middot",
+    "cedil", "sup1", "ordm", "raquo", "frac14", "frac12", "frac34", "iquest",
+    "Agrave", "Aacute", "Acirc", "Atilde", "Auml", "Aring", "AElig", "Ccedil",
+    "Egrave", "Eacute", "Ecirc", "Euml", "Igrave", "Iacute", "Icirc", "Iuml",
+    "ETH", "Ntilde", "Ograve", "Oacute", "Ocirc", "Otilde", "Ouml", "times",
+    "Oslash", "Ugrave", "Uacute", "Ucirc", "Uuml", "Yacute", "THORN", "szlig",
+    "agrave", "aacute", "acirc", "atilde", "auml", "aring", "aelig", "ccedil",
+    "egrave", "eacute", "ecirc", "euml", "igrave", "iacute", "icirc", "iuml",
+    "eth", "ntilde", "ograve", "oacute", "ocirc", "otilde", "ouml", "divide",
+    "oslash", "ugrave", "uacute", "ucirc", "uuml", "yacute", "thorn", "yuml"
+};
+
+
+// Other entities that show up in notes, mostly from web clips
+struct EnmlEntity {
+    const char *name;
+    uint value;
+};
+static const EnmlEntity entities[] = {
+    {"amp", 38}, {"lt", 60}, {"gt", 62}, {"quot", 34}, {"apos", 39},
+    {"ndash", 8211}, {"mdash", 8212}, {"lsquo", 8216}, {"rsquo", 8217},
+    {"sbquo", 8218}, {"ldquo", 8220}, {"rdquo", 8221}, {"bdquo", 8222},
+    {"hellip", 8230}, {"bull", 8226}, {"euro", 8364}, {"trade", 8482},
+    {"OElig", 338}, {"oelig", 339}, {"Scaron", 352}, {"scaron", 353},
+    {"Yuml", 376}, {"dagger", 8224}, {"Dagger", 8225}, {"permil", 8240},
+    {"lsaquo", 8249}, {"rsaquo", 8250}, {"ensp", 8194}, {"emsp", 8195},
+    {"thinsp", 8201}, {"zwnj", 8204}, {"zwj", 8205}, {"lrm", 8206},
+    {"rlm", 8207}, {"larr", 8592}, {"uarr", 8593}, {"rarr", 8594},
+    {"darr", 8595}, {"harr", 8596}, {"minus", 8722}, {"prime", 8242},
+    {"infin", 8734}, {"ne", 8800}, {"le", 8804}, {"ge", 8805},
+    {"hearts", 9829}
+};
+
+
+// Tags that start a new line when the note is shown.  The text on
+// either side of them are separate words.
+static const char *blockTags[] = {
+    "address", "blockquote", "br", "caption", "center", "dd", "div", "dl",
+    "dt", "en-media", "en-note", "en-todo", "h1", "h2", "h3", "h4", "h5",
+    "h6", "hr", "li", "ol", "p", "pre", "table", "tbody", "td", "tfoot",
+    "th", "thead", "tr", "ul"
+};
+
+
+// Tags whose content isn't note text
+static const char *skippedTags[] = { "en-crypt", "script", "style" };
+
+
+
+static bool inList(const char *name, const char **list, unsigned int count) {
+    for (unsigned int i=0; i<count; i++) {
+        if (strcmp(name, list[i]) == 0)
+            return true;
+    }
+    return false;
+}
+
+
+
+static ushort asciiLower(ushort c) {
+    if (c >= 'A' && c <= 'Z')
+        return c + ('a' - 'A');
+    return c;
+}
+
+
+
+// Does the content at pos start with "what"?  "what" has to be lower case.
+static bool startsWith(const QChar *s, int len, int pos, const char *what) {
+    for (int i=0; what[i] != 0; i++) {
+        if (pos+i >= len || asciiLower(s[pos+i].unicode()) != (uchar)what[i])
+            return false;
+    }
+    return true;
+}
+
+
+
+// Find "what" at or after pos, ignoring case.  Returns len if it isn't there.
+static int find(const QChar *s, int len, int pos, const char *what) {
+    ushort first = (uchar)what[0];
+    for (; pos<len; pos++) {
+        if (asciiLower(s[pos].unicode()) == first && startsWith(s, len, pos, what))
+            return pos;
+    }
+    return len;
+}
+
+
+
+// Get the plain text of a note
+QString EnmlText::toText(const QString &enml) {
+    const QChar *s = enml.constData();
+    int len = enml.length();
+    QString text;
+    text.reserve(len);
+    bool space = true;                   // Leading white space is dropped
+    int pos = 0;
+    while (pos < len) {
+        ushort c = s[pos].unicode();
+        if (c == '<')
+            pos = skipTag(s, len, pos, text, space);
+        else if (c == '&')
+            pos = decodeEntity(s, len, pos, text, space);
+        else {
+            append(text, space, c);
+            pos++;
+        }
+    }
+    if (text.endsWith(QChar(' ')))
+        text.chop(1);
+    return text;
+}
+
+
+
+// Add a character to the text.  White space is only added if the last
+// thing added wasn't white space too.  Invisible formatting characters
+// (soft hyphens, zero width spaces & joiners ...) would split words, so
+// they are left out.
+void EnmlText::append(QString &text, bool &space, uint c) {
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' ||
+            (c > 0x7F && c <= 0xFFFF && QChar(ushort(c)).isSpace())) {
+        if (!space)
+            text.append(QChar(' '));
+        space = true;
+        return;
+    }
+    if (c > 0x7F && c <= 0xFFFF && QChar(ushort(c)).category() == QChar::Other_Format)
+        return;
+    if (c > 0xFFFF) {
+        text.append(QChar(QChar::highSurrogate(c)));
+        text.append(QChar(QChar::lowSurrogate(c)));
+    } else
+        text.append(QChar(ushort(c)));
+    space = false;
+}
+
+
+
+// Skip over the tag starting at pos and return where the text starts
+// again.  Block tags add a space.  Comments, en-crypt, script & style
+// are skipped along with what is in them.  A '<' that doesn't start a tag
+// is kept as text.
+int EnmlText::skipTag(const QChar *s, int len, int pos, QString &text, bool &space) {
+    if (startsWith(s, len, pos, "<!--")) {
+        int end = find(s, len, pos+4, "-->");
+        return end < len ? end+3 : len;
+    }
+    if (startsWith(s, len, pos, "<![cdata[")) {
+        int end = find(s, len, pos+9, "]]>");
+        for (int i=pos+9; i<end; i++)
+            append(text, space, s[i].unicode());
+        return end < len ? end+3 : len;
+    }
+
+    int i = pos+1;
+    bool closing = false;
+    if (i < len && s[i] == QChar('/')) {
+        closing = true;
+        i++;
+    }
+
+    // Get the tag name
+    char name[ENML_TAG_NAME_MAX+1];
+    int n = 0;
+    for (; i<len; i++) {
+        ushort c = asciiLower(s[i].unicode());
+        if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == ':' || c == '_'))
+            break;
+        if (n < ENML_TAG_NAME_MAX)
+            name[n] = c;
+        n++;
+    }
+    if (n > ENML_TAG_NAME_MAX)
+        n = 0;
+    name[n] = 0;
+    if (i == pos+1 && (i >= len || (s[i] != QChar('!') && s[i] != QChar('?')))) {
+        append(text, space, '<');
+        return pos+1;
+    }
+
+    // Find the end of the tag.  A '>' inside an attribute value doesn't count.
+    ushort quote = 0;
+    ushort last = 0;
+    for (; i<len; i++) {
+        ushort c = s[i].unicode();
+        if (quote != 0) {
+            if (c == quote)
+                quote = 0;
+            continue;
+        }
+        if ((c == '"' || c == '\'') && last == '=')
+            quote = c;
+        else if (c == '>')
+            break;
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+            last = c;
+    }
+    if (i >= len)
+        return len;
+    bool empty = s[i-1] == QChar('/');
+    int end = i+1;
+
+    if (!closing && !empty && inList(name, skippedTags, sizeof(skippedTags)/sizeof(skippedTags[0]))) {
+        char closeTag[ENML_TAG_NAME_MAX+3] = "</";
+        strcat(closeTag, name);
+        int close = find(s, len, end, closeTag);
+        if (close >= len)
+            return len;
+        close = find(s, len, close, ">");
+        append(text, space, ' ');
+        return close < len ? close+1 : len;
+    }
+    if (inList(name, blockTags, sizeof(blockTags)/sizeof(blockTags[0])))
+        append(text, space, ' ');
+    return end;
+}
+
+
+
+// Decode the entity starting at pos and return where the text starts
+// again.  Anything that isn't a known entity is kept as text.
+int EnmlText::decodeEntity(const QChar *s, int len, int pos, QString &text, bool &space) {
+    char name[ENML_ENTITY_NAME_MAX+1];
+    int n = 0;
+    int i = pos+1;
+    for (; i<len && n<ENML_ENTITY_NAME_MAX; i++) {
+        ushort c = s[i].unicode();
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || (c == '#' && n == 0)))
+            break;
+        name[n++] = c;
+    }
+    name[n] = 0;
+    if (n == 0 || i >= len || s[i] != QChar(';')) {
+        append(text, space, '&');
+        return pos+1;
+    }
+
+    uint value = 0;
+    if (name[0] == '#') {
+        char *endPtr = NULL;
+        const char *digits = name+1;
+        int base = 10;
+        if (name[1] == 'x' || name[1] == 'X') {
+            digits = name+2;
+            base = 16;
+        }
+        if (*digits != 0) {
+            value = strtoul(digits, &endPtr, base);
+            if (*endPtr != 0 || value > 0x10FFFF || (value >= 0xD800 && value <= 0xDFFF))
+                value = 0;
+        }
+    } else {
+        for (unsigned int j=0; j<sizeof(latin1Entities)/sizeof(latin1Entities[0]) && value == 0; j++) {
+            if (strcmp(name, latin1Entities[j]) == 0)
+                value = 160+j;
+        }
+        for (unsigned int j=0; j<sizeof(entities)/sizeof(entities[0]) && value == 0; j++) {
+            if (strcmp(name, entities[j].name) == 0)
+                value = entities[j].value;
+        }
+    }
+    if (value == 0) {
+        append(text, space, '&');
+        return pos+1;
+    }
+    append(text, space, value);
+    return i+1;
+}
@@ -0,0 +1,48 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef ENMLTEXT_H
+#define ENMLTEXT_H
+
+#include <QString>
+
+
+//*****************************************************************
+//* Turn a note's ENML (or any HTML) into the plain text that goes
+//* into the search index.  This is one pass over the content:
+//* tags are dropped, block tags become a space so words on
+//* different lines don't run together, entities are decoded,
+//* <en-crypt> blocks, comments, scripts & styles are skipped and
+//* runs of white space become a single space.
+//*
+//* It only uses the string it is given, so unlike QTextDocument
+//* it is safe to call from any thread.
+//*****************************************************************
+class EnmlText
+{
+private:
+    static int skipTag(const QChar *s, int len, int pos, QString &text, bool &space);
+    static int decodeEntity(const QChar *s, int len, int pos, QString &text, bool &space);
+    static void append(QString &text, bool &space, uint c);
+
+public:
+    static QString toText(const QString &enml);         // Get the text of a note
+};
+
+#endif // ENMLTEXT_H
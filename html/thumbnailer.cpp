@@ -45,6 +45,7 @@ Thumbnailer::~Thumbnailer() {
 void Thumbnailer::render(qint32 lid) {
     idle = false;
     this->lid = lid;
+    renderTimer.start();
 
     NoteFormatter formatter;
     formatter.thumbnail = true;
@@ -79,7 +80,11 @@ void Thumbnailer::startTimer() {
 void Thumbnailer::pageReady(bool ok) {
     if (ok) {
         capturePage(page);
+        global.workMetrics.done("thumbnail", 1, 0);
+    } else {
+        global.workMetrics.error("thumbnail", "render");
     }
+    global.workMetrics.timing("thumbnail", "render", renderTimer.elapsed());
     NoteTable ntable(db);
     ntable.setThumbnailNeeded(lid, false);
     idle = true;
@@ -114,6 +119,7 @@ void Thumbnailer::generateNextThumbnail() {
 
     timer.stop();
     NoteTable noteTable(db);
+    global.workMetrics.setBacklog("thumbnail", noteTable.getThumbnailsNeededCount());
     int i=0;
     for (; i<global.batchThumbnailCount; i++) {
         QDateTime current;
@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QtWebKit>
 #include <QObject>
 #include <QSqlDatabase>
+#include <QElapsedTimer>
 
 #include "html/noteformatter.h"
 #include "sql/databaseconnection.h"
@@ -42,6 +43,7 @@ class Thumbnailer : public QObject
 private:
     DatabaseConnection *db;
     QTimer timer;
+    QElapsedTimer renderTimer;               // How long the current note has been rendering
     int minTime;
     int maxTime;
 
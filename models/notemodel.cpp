@@ -21,6 +21,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "logger/qslog.h"
 #include "global.h"
 #include "sql/nsqlquery.h"
+#include "sql/searchtable.h"
+#include "filters/filtercriteria.h"
+#include "filters/filterengine.h"
 
 #include <QString>
 #include <QSqlDatabase>
@@ -38,7 +41,7 @@ extern Global global;
 
 // Generic constructor
 NoteModel::NoteModel(QObject *parent)
-    :QSqlTableModel(parent, global.db->conn)
+    :QAbstractTableModel(parent)
 {
     // Check if the table exists.  If not, create it.
     NSqlQuery sql(global.db);
@@ -46,10 +49,12 @@ NoteModel::NoteModel(QObject *parent)
     if (!sql.next())
         this->createTable();
     sql.finish();
-    this->setEditStrategy(QSqlTableModel::OnFieldChange);
 
-    this->setTable("NoteTable");
-    this->setFilter("lid in (select lid from filter)");
+    QSqlRecord record = global.db->conn.record("NoteTable");
+    for (int i=0; i<record.count(); i++)
+        columnNames.append(record.fieldName(i));
+    sortColumn = NOTE_TABLE_DATE_CREATED_POSITION;
+    sortOrder = Qt::AscendingOrder;
 }
 
 // Destructor
@@ -119,23 +124,19 @@ void NoteModel::createTable() {
         QLOG_ERROR() << "Creation of NoteTable table failed: " << sql.lastError();
     }
     sql.finish();
-}
 
+    // Saved searches log note changes through triggers on this table
+    SearchTable searchTable(global.db);
+    searchTable.createChangeTriggers();
+}
 
-//int NoteModel::rowCount(const QModelIndex & /*parent*/) const
-// {
-//    QLOG_TRACE() << "Entering NoteModel::rowCount()";
 
-//    NSqlQuery sql(*db);
-//    sql.exec("Select count(lid) from NoteTable where lid in (select lid from filter)");
-//    if (!sql.next()) {
-//        QLOG_ERROR() << "Error retrieving NoteModel::rowCount: " << sql.lastError();
-//        return 0;
-//    }
-//    int rowCount = QVariant(sql.value(0)).toInt();
-//    return rowCount;
+int NoteModel::rowCount(const QModelIndex &parent) const {
+    if (parent.isValid())
+        return 0;
+    return lids.size();
+}
 
-// }
 
 int NoteModel::columnCount(const QModelIndex &parent) const {
     Q_UNUSED(parent);  // Suppress unused variable
@@ -144,6 +145,171 @@ int NoteModel::columnCount(const QModelIndex &parent) const {
 }
 
 
+
+// Text columns are sorted on a lower case copy of the value, the
+// same way the old proxy model compared them.
+bool NoteModel::isTextColumn(int column) const {
+    return column == NOTE_TABLE_TITLE_POSITION ||
+            column == NOTE_TABLE_NOTEBOOK_POSITION ||
+            column == NOTE_TABLE_TAGS_POSITION ||
+            column == NOTE_TABLE_AUTHOR_POSITION ||
+            column == NOTE_TABLE_SOURCE_POSITION ||
+            column == NOTE_TABLE_SOURCE_URL_POSITION ||
+            column == NOTE_TABLE_SOURCE_APPLICATION_POSITION ||
+            column == NOTE_TABLE_COLOR_POSITION;
+}
+
+
+
+// Used to sort text columns.  The key is computed once per row rather
+// than once per comparison.
+class NoteSortKey {
+public:
+    QString key;
+    qint32 lid;
+    bool operator<(const NoteSortKey &other) const {
+        if (key != other.key)
+            return key < other.key;
+        return lid < other.lid;
+    }
+};
+
+
+
+// Read the lids in the filter in the current sort order.  Number & date
+// columns are sorted by SQLite using the NoteTable indexes.  Text columns
+// are sorted here on a precomputed lower case key, so non-ASCII titles
+// sort the same way they always have (SQLite's nocase only folds ASCII).
+void NoteModel::loadLids() {
+    lids.clear();
+    lidRows.clear();
+    pages.clear();
+    pageOrder.clear();
+
+    QString direction = (sortOrder == Qt::AscendingOrder ? "asc" : "desc");
+    NSqlQuery sql(global.db);
+    if (sortColumn >= 0 && sortColumn < columnNames.size() && isTextColumn(sortColumn)) {
+        QVector<NoteSortKey> keys;
+        sql.exec("Select lid, " +columnNames[sortColumn] +" from NoteTable where lid in (select lid from filter)");
+        while (sql.next()) {
+            NoteSortKey k;
+            k.lid = sql.value(0).toInt();
+            k.key = sql.value(1).toString().toLower();
+            keys.append(k);
+        }
+        qSort(keys.begin(), keys.end());
+        lids.reserve(keys.size());
+        if (sortOrder == Qt::AscendingOrder) {
+            for (int i=0; i<keys.size(); i++)
+                lids.append(keys[i].lid);
+        } else {
+            for (int i=keys.size()-1; i>=0; i--)
+                lids.append(keys[i].lid);
+        }
+    } else {
+        QString order = "lid " +direction;
+        if (sortColumn > 0 && sortColumn < columnNames.size() && sortColumn != NOTE_TABLE_THUMBNAIL_POSITION)
+            order = columnNames[sortColumn] +" " +direction +", " +order;
+        sql.exec("Select lid from NoteTable where lid in (select lid from filter) order by " +order);
+        while (sql.next())
+            lids.append(sql.value(0).toInt());
+    }
+    sql.finish();
+
+    lidRows.reserve(lids.size());
+    for (int i=0; i<lids.size(); i++)
+        lidRows.insert(lids[i], i);
+}
+
+
+
+// Reload the list of notes from the filter table.
+bool NoteModel::select() {
+    beginResetModel();
+    loadLids();
+    endResetModel();
+    return true;
+}
+
+
+
+// Sort the list.  Only the lids are reloaded; selected rows are kept.
+void NoteModel::sort(int column, Qt::SortOrder order) {
+    sortColumn = column;
+    sortOrder = order;
+
+    emit layoutAboutToBeChanged();
+    QModelIndexList oldIndexes = persistentIndexList();
+    QList<qint32> oldLids;
+    for (int i=0; i<oldIndexes.size(); i++)
+        oldLids.append(lidAt(oldIndexes[i].row()));
+
+    loadLids();
+
+    QModelIndexList newIndexes;
+    for (int i=0; i<oldIndexes.size(); i++) {
+        int row = rowOf(oldLids[i]);
+        if (row >= 0)
+            newIndexes.append(index(row, oldIndexes[i].column()));
+        else
+            newIndexes.append(QModelIndex());
+    }
+    changePersistentIndexList(oldIndexes, newIndexes);
+    emit layoutChanged();
+}
+
+
+
+qint32 NoteModel::lidAt(int row) const {
+    if (row < 0 || row >= lids.size())
+        return 0;
+    return lids[row];
+}
+
+
+int NoteModel::rowOf(qint32 lid) const {
+    return lidRows.value(lid, -1);
+}
+
+
+
+// Get the values for a row.  Rows are read a page at a time, and only the most
+// recently used pages are kept, so scrolling through a long list doesn't
+// keep the whole NoteTable in memory.
+const QVector<QVariant> *NoteModel::fetchRow(int row) const {
+    int page = row / NOTE_MODEL_PAGE_SIZE;
+    if (pages.contains(page)) {
+        pageOrder.removeOne(page);
+        pageOrder.append(page);
+        return &pages[page][row % NOTE_MODEL_PAGE_SIZE];
+    }
+
+    int first = page * NOTE_MODEL_PAGE_SIZE;
+    int last = qMin(first + NOTE_MODEL_PAGE_SIZE, lids.size());
+    QStringList pageLids;
+    for (int i=first; i<last; i++)
+        pageLids.append(QString::number(lids[i]));
+
+    QVector< QVector<QVariant> > values(last-first, QVector<QVariant>(columnNames.size()));
+    NSqlQuery sql(global.db);
+    sql.exec("Select * from NoteTable where lid in (" +pageLids.join(",") +")");
+    while (sql.next()) {
+        int r = rowOf(sql.value(NOTE_TABLE_LID_POSITION).toInt()) - first;
+        if (r < 0 || r >= values.size())
+            continue;
+        for (int i=0; i<columnNames.size(); i++)
+            values[r][i] = sql.value(i);
+    }
+    sql.finish();
+
+    pages.insert(page, values);
+    pageOrder.append(page);
+    while (pageOrder.size() > NOTE_MODEL_PAGE_CACHE)
+        pages.remove(pageOrder.takeFirst());
+    return &pages[page][row % NOTE_MODEL_PAGE_SIZE];
+}
+
+
 Qt::ItemFlags NoteModel::flags(const QModelIndex &index) const
 {
     if (!index.isValid())
@@ -156,6 +322,9 @@ Qt::ItemFlags NoteModel::flags(const QModelIndex &index) const
 
 
 QVariant NoteModel::data (const QModelIndex & index, int role) const {
+    if (!index.isValid() || index.row() >= lids.size() || index.column() >= columnNames.size())
+        return QVariant();
+
     if (role == Qt::ForegroundRole) {
         QString color = index.sibling(index.row(), NOTE_TABLE_COLOR_POSITION).data().toString();
         if (color != "") {
@@ -170,5 +339,69 @@ QVariant NoteModel::data (const QModelIndex & index, int role) const {
             return QColor(color);
         }
     }
-    return QSqlTableModel::data(index,role);
+
+    // Show where the search matched when hovering over the title
+    if (role == Qt::ToolTipRole && index.column() == NOTE_TABLE_TITLE_POSITION && global.filterCriteria.size() > 0) {
+        FilterCriteria *criteria = global.filterCriteria[global.filterPosition];
+        SearchHit hit;
+        qint32 lid = lidAt(index.row());
+        FilterEngine engine;
+        if (engine.getSearchHit(criteria, lid, hit) && hit.snippet != "")
+            return hit.snippet;
+    }
+
+    if (role != Qt::DisplayRole && role != Qt::EditRole)
+        return QVariant();
+
+    // The lid is always in memory, so things that only need the lid
+    // (selections, history ...) don't cause the row to be read.
+    if (index.column() == NOTE_TABLE_LID_POSITION)
+        return lids[index.row()];
+    return fetchRow(index.row())->at(index.column());
+}
+
+
+
+// Update a value.  It is written to the NoteTable right away.
+bool NoteModel::setData(const QModelIndex &index, const QVariant &value, int role) {
+    if (!index.isValid() || role != Qt::EditRole || index.row() >= lids.size() ||
+            index.column() >= columnNames.size() || index.column() == NOTE_TABLE_LID_POSITION)
+        return false;
+
+    qint32 lid = lids[index.row()];
+    NSqlQuery sql(global.db);
+    sql.prepare("Update NoteTable set " +columnNames[index.column()] +"=:value where lid=:lid");
+    sql.bindValue(":value", value);
+    sql.bindValue(":lid", lid);
+    bool retval = sql.exec();
+    sql.finish();
+    if (!retval)
+        return false;
+
+    int page = index.row() / NOTE_MODEL_PAGE_SIZE;
+    if (pages.contains(page))
+        pages[page][index.row() % NOTE_MODEL_PAGE_SIZE][index.column()] = value;
+    emit dataChanged(index, index);
+    return true;
+}
+
+
+
+QVariant NoteModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole) {
+        if (headers.contains(section))
+            return headers[section];
+        if (section < columnNames.size())
+            return columnNames[section];
+    }
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+
+bool NoteModel::setHeaderData(int section, Qt::Orientation orientation, const QVariant &value, int role) {
+    if (orientation != Qt::Horizontal || (role != Qt::DisplayRole && role != Qt::EditRole))
+        return false;
+    headers.insert(section, value);
+    emit headerDataChanged(orientation, section, section);
+    return true;
 }
@@ -20,21 +20,56 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #ifndef NOTEMODEL_H
 #define NOTEMODEL_H
 
-#include <QSqlTableModel>
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
 #include "sql/databaseconnection.h"
 
-class NoteModel : public QSqlTableModel
+// Number of rows read from the database at one time & the
+// number of those pages kept in memory.
+#define NOTE_MODEL_PAGE_SIZE     100
+#define NOTE_MODEL_PAGE_CACHE     50
+
+
+//****************************************************
+//* The note list model.  Only the ordered list of
+//* lids in the current filter is kept in memory.  The
+//* rest of a row is read from NoteTable in pages as
+//* the view asks for it, so a large notebook doesn't
+//* need to be loaded all at once.
+//****************************************************
+class NoteModel : public QAbstractTableModel
 {
     Q_OBJECT
 private:
+    QVector<qint32> lids;                                  // Lids in display order
+    QHash<qint32, int> lidRows;                            // lid -> row
+    QStringList columnNames;                               // NoteTable column names
+    QHash<int, QVariant> headers;                          // Column header text
+    int sortColumn;                                        // Current sort column
+    Qt::SortOrder sortOrder;                               // Current sort order
+    mutable QHash<int, QVector< QVector<QVariant> > > pages;   // Cached pages of rows
+    mutable QList<int> pageOrder;                          // Pages, least recently used first
+    void loadLids();                                       // Read the sorted list of lids
+    const QVector<QVariant> *fetchRow(int row) const;      // Get a row, reading its page if needed
+    bool isTextColumn(int column) const;                   // Is this a text column?
+
 public:
     explicit NoteModel(QObject *parent = 0);
     ~NoteModel();
-    //int rowCount(const QModelIndex &parent) const;
-    int columnCount(const QModelIndex &parent) const;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
     void createTable();
+    bool select();                                         // Reload the list from the filter
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+    qint32 lidAt(int row) const;                           // Get the lid at a row without reading the row
+    int rowOf(qint32 lid) const;                           // Get the row of a lid, or -1
     Qt::ItemFlags flags(const QModelIndex &index) const;
     QVariant data ( const QModelIndex & index, int role = Qt::DisplayRole ) const;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole);
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+    bool setHeaderData(int section, Qt::Orientation orientation, const QVariant &value, int role = Qt::EditRole);
 
 signals:
 
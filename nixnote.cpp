@@ -54,6 +54,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "gui/ntabwidget.h"
 #include "sql/notebooktable.h"
 #include "sql/usertable.h"
+#include "sql/indexhashtable.h"
 #include "settings/startupconfig.h"
 #include "dialog/logindialog.h"
 #include "dialog/closenotebookdialog.h"
@@ -134,9 +135,11 @@ NixNote::NixNote(QWidget *parent) : QMainWindow(parent)
     connect(&syncThread, SIGNAL(started()), this, SLOT(syncThreadStarted()));
     connect(&counterThread, SIGNAL(started()), this, SLOT(counterThreadStarted()));
     connect(&indexThread, SIGNAL(started()), this, SLOT(indexThreadStarted()));
+    connect(&searchThread, SIGNAL(started()), this, SLOT(searchThreadStarted()));
     counterThread.start(QThread::LowestPriority);
     syncThread.start(QThread::LowPriority);
     indexThread.start(QThread::LowestPriority);
+    searchThread.start(QThread::NormalPriority);
     this->thread()->setPriority(QThread::HighestPriority);
 
     heartbeatTimer.setInterval(1000);
@@ -160,6 +163,16 @@ NixNote::NixNote(QWidget *parent) : QMainWindow(parent)
     connect(this,SIGNAL(syncRequested()),&syncRunner,SLOT(synchronize()));
     connect(&syncRunner, SIGNAL(setMessage(QString, int)), this, SLOT(setMessage(QString, int)));
 
+    // Setup the search thread
+    QLOG_TRACE() << "Setting up search thread";
+    searchGeneration = 0;
+    searchBatchCount = 0;
+    searchAfterSync = false;
+    searchRequestTime = 0;
+    connect(&searchRunner, SIGNAL(searchResults(qint32,QList<qint32>,bool)), this, SLOT(searchResultsReady(qint32,QList<qint32>,bool)));
+    connect(&searchRunner, SIGNAL(searchHitsFound(qint32,SearchHits,bool)), this, SLOT(searchHitsReady(qint32,SearchHits,bool)));
+    connect(&syncRunner, SIGNAL(syncComplete()), &searchRunner, SLOT(refreshSavedSearches()));
+
     QLOG_TRACE() << "Setting up GUI";
     global.filterPosition = 0;
     this->setupGui();
@@ -227,6 +240,11 @@ NixNote::NixNote(QWidget *parent) : QMainWindow(parent)
     //QDesktopServices::setUrlHandler("evernote", this, "showDesktopUrl");
     remoteQuery = new RemoteQuery();
 
+    // Show what the background threads are doing
+    metricsQuery = new MetricsQuery(this);
+    workStatusLabel = new WorkStatusLabel(this);
+    statusBar()->addPermanentWidget(workStatusLabel);
+
     // Initialize pdfExportWindow to null. We don't fully set this up in case the person requests it.
     pdfExportWindow = NULL;
 
@@ -250,9 +268,11 @@ NixNote::~NixNote()
     syncThread.quit();
     indexThread.quit();
     counterThread.quit();
+    searchThread.quit();
     while (!syncThread.isFinished());
     while (!indexThread.isFinished());
     while(!counterThread.isFinished());
+    while(!searchThread.isFinished());
 
     // Cleanup any temporary files
     if (global.purgeTemporaryFilesOnShutdown) {
@@ -583,6 +603,7 @@ void NixNote::setupGui() {
     connect(tabWindow, SIGNAL(noteUpdated(qint32)), noteTableView, SLOT(refreshData()));
     connect(tabWindow, SIGNAL(noteUpdated(qint32)), &counterRunner, SLOT(countNotebooks()));
     connect(tabWindow, SIGNAL(noteUpdated(qint32)), &counterRunner, SLOT(countTags()));
+    connect(tabWindow, SIGNAL(noteUpdated(qint32)), &searchRunner, SLOT(noteChanged(qint32)));
     connect(tabWindow, SIGNAL(noteTagsUpdated(QString, qint32, QStringList)), noteTableView, SLOT(noteTagsUpdated(QString, qint32, QStringList)));
     connect(tabWindow, SIGNAL(noteNotebookUpdated(QString, qint32, QString)), noteTableView, SLOT(noteNotebookUpdated(QString, qint32, QString)));
     connect(tabWindow, SIGNAL(updateNoteList(qint32, int, QVariant)), noteTableView, SLOT(refreshCell(qint32, int, QVariant)));
@@ -868,6 +889,17 @@ void NixNote::counterThreadStarted() {
 
 
 
+//***************************************************************
+//* Signal received when the searchRunner thread has started
+//***************************************************************
+void NixNote::searchThreadStarted() {
+    searchRunner.moveToThread(&searchThread);
+    QMetaObject::invokeMethod(&searchRunner, "refreshSavedSearches", Qt::QueuedConnection);
+}
+
+
+
+
 //***************************************************************
 //* Signal received when the syncRunner thread has started
 //***************************************************************
@@ -965,7 +997,7 @@ void NixNote::setupTagTree() {
     connect(&syncRunner, SIGNAL(tagUpdated(qint32, QString, QString, qint32)),tagTreeView, SLOT(tagUpdated(qint32, QString, QString, qint32)));
     connect(&syncRunner, SIGNAL(tagExpunged(qint32)), tagTreeView, SLOT(tagExpunged(qint32)));
     connect(&syncRunner, SIGNAL(syncComplete()),tagTreeView, SLOT(rebuildTree()));
-    connect(&counterRunner, SIGNAL(tagTotals(qint32,qint32, qint32)), tagTreeView, SLOT(updateTotals(qint32,qint32, qint32)));
+    connect(&counterRunner, SIGNAL(tagTotals(CounterTotals)), tagTreeView, SLOT(updateTotals(CounterTotals)));
     connect(&counterRunner, SIGNAL(tagCountComplete()), tagTreeView, SLOT(hideUnassignedTags()));
     connect(notebookTreeView, SIGNAL(notebookSelectionChanged(qint32)), tagTreeView, SLOT(notebookSelectionChanged(qint32)));
     connect(tagTreeView, SIGNAL(updateNoteList(qint32,int,QVariant)), noteTableView, SLOT(refreshCell(qint32,int,QVariant)));
@@ -1023,8 +1055,9 @@ void NixNote::setupFavoritesTree() {
     connect(&syncRunner, SIGNAL(notebookExpunged(qint32)), favoritesTreeView, SLOT(itemExpunged(qint32)));
     connect(&syncRunner, SIGNAL(tagExpunged(qint32)), favoritesTreeView, SLOT(itemExpunged(qint32)));
 //    connect(&syncRunner, SIGNAL(noteUpdated(qint32)), notebookTreeView, SLOT(itemExpunged(qint32)));
-    connect(&counterRunner, SIGNAL(notebookTotals(qint32,qint32, qint32)), favoritesTreeView, SLOT(updateTotals(qint32,qint32, qint32)));
-    connect(&counterRunner, SIGNAL(tagTotals(qint32,qint32,qint32)), favoritesTreeView, SLOT(updateTotals(qint32,qint32, qint32)));
+    connect(&counterRunner, SIGNAL(notebookTotals(CounterTotals)), favoritesTreeView, SLOT(updateTotals(CounterTotals)));
+    connect(&counterRunner, SIGNAL(tagTotals(CounterTotals)), favoritesTreeView, SLOT(updateTotals(CounterTotals)));
+    connect(&searchRunner, SIGNAL(savedSearchTotals(CounterTotals)), favoritesTreeView, SLOT(updateTotals(CounterTotals)));
     connect(favoritesTreeView, SIGNAL(updateCounts()), &counterRunner, SLOT(countAll()));
 
     leftSeparator1 = new QLabel();
@@ -1047,7 +1080,7 @@ void NixNote::setupSynchronizedNotebookTree() {
     connect(&syncRunner, SIGNAL(notebookUpdated(qint32, QString,QString, bool, bool)),notebookTreeView, SLOT(notebookUpdated(qint32, QString, QString, bool, bool)));
     connect(&syncRunner, SIGNAL(syncComplete()),notebookTreeView, SLOT(rebuildTree()));
     connect(&syncRunner, SIGNAL(notebookExpunged(qint32)), notebookTreeView, SLOT(notebookExpunged(qint32)));
-    connect(&counterRunner, SIGNAL(notebookTotals(qint32,qint32, qint32)), notebookTreeView, SLOT(updateTotals(qint32,qint32, qint32)));
+    connect(&counterRunner, SIGNAL(notebookTotals(CounterTotals)), notebookTreeView, SLOT(updateTotals(CounterTotals)));
     connect(notebookTreeView, SIGNAL(updateNoteList(qint32,int,QVariant)), noteTableView, SLOT(refreshCell(qint32,int,QVariant)));
     connect(notebookTreeView, SIGNAL(updateCounts()), &counterRunner, SLOT(countAll()));
     QLOG_TRACE() << "Exiting NixNote.setupSynchronizedNotebookTree()";
@@ -1244,8 +1277,10 @@ void NixNote::saveOnExit() {
     noteTableView->saveColumnsVisible();
 
     QLOG_DEBUG() << "Closing threads";
+    searchRunner.cancelSearch();
     indexThread.quit();
     counterThread.quit();
+    searchThread.quit();
 
     QLOG_DEBUG() << "Exitng saveOnExit()";
 }
@@ -1595,9 +1630,121 @@ void NixNote::updateSelectionCriteria(bool afterSync) {
         global.cache.remove(keys[i]);
     }
 
+    // Searching note text can take a while on a large database, so those
+    // searches are done on the search thread.  The rest of the selection
+    // update happens in searchResultsReady() once the results come back.
+    FilterCriteria *criteria = global.filterCriteria[global.filterPosition];
+
+    // The search thread can't read the settings itself, so they are passed
+    // on from here.
+    int minimumWeight = global.getMinimumRecognitionWeight();
+    bool tagSelectionOr = global.getTagSelectionOr();
+    searchRunner.setSearchSettings(minimumWeight, tagSelectionOr);
+
+    // Saved searches have their results stored by the search thread, so
+    // they can usually be shown without searching at all.  Any notes
+    // changed since then are checked so the stored results catch up.
+    QMetaObject::invokeMethod(&searchRunner, "checkChangedNotes", Qt::QueuedConnection);
+    FilterEngine savedSearchEngine;
+    if (savedSearchEngine.filterSavedSearch(criteria)) {
+        searchRunner.cancelSearch();
+        searchGeneration = 0;
+        finishSelectionUpdate(afterSync);
+        return;
+    }
+    if (criteria->isSavedSearchSet())
+        QMetaObject::invokeMethod(&searchRunner, "refreshQuery", Qt::QueuedConnection,
+                                  Q_ARG(QString, criteria->getSearchString()));
+
+    if (global.backgroundSearch && criteria->isSearchStringSet() &&
+            criteria->getSearchString().trimmed() != "") {
+        searchAfterSync = afterSync;
+        searchBatchCount = 0;
+        searchLids.clear();
+        searchRequestTime = QDateTime::currentMSecsSinceEpoch();
+        searchGeneration = searchRunner.requestSearch(criteria, minimumWeight, tagSelectionOr);
+        return;
+    }
+
+    // Anything still running on the search thread is now out of date.
+    searchRunner.cancelSearch();
+    searchGeneration = 0;
+
     FilterEngine filterEngine;
     filterEngine.filter();
 
+    finishSelectionUpdate(afterSync);
+}
+
+
+
+//*****************************************************
+//* Receive a batch of results from the search thread.
+//* The first batch is shown right away; the rest are
+//* added to the filter and shown when the last one
+//* arrives.
+//*****************************************************
+void NixNote::searchResultsReady(qint32 generation, QList<qint32> lids, bool finished) {
+    if (generation != searchGeneration)
+        return;      // The user has moved on since this search was started
+
+    NSqlQuery sql(global.db);
+    sql.exec("begin");
+    if (searchBatchCount == 0)
+        sql.exec("delete from filter");
+    sql.prepare("insert into filter (lid) values (:lid)");
+    for (int i=0; i<lids.size(); i++) {
+        sql.bindValue(":lid", lids[i]);
+        sql.exec();
+    }
+    sql.exec("commit");
+    sql.finish();
+    searchLids.append(lids);
+
+    if (searchBatchCount == 0) {
+        qint64 start = searchRequestTime;
+        if (searchText->keystrokeTime > 0 && searchText->keystrokeTime <= start)
+            start = searchText->keystrokeTime;
+        QLOG_DEBUG() << "Search latency (keystroke to first result): " << QDateTime::currentMSecsSinceEpoch()-start << " ms";
+        if (!finished)
+            noteTableView->refreshData();
+    }
+    searchBatchCount++;
+    if (!finished)
+        return;
+
+    // Remove any selected notes that are not in the results.
+    FilterCriteria *criteria = global.filterCriteria[global.filterPosition];
+    QSet<qint32> goodLids = searchLids.toSet();
+    QList<qint32> selectedLids;
+    criteria->getSelectedNotes(selectedLids);
+    for (int i=selectedLids.size()-1; i>=0; i--) {
+        if (!goodLids.contains(selectedLids[i]))
+            selectedLids.removeAt(i);
+    }
+    criteria->setSelectedNotes(selectedLids);
+    searchLids.clear();
+    searchGeneration = 0;
+
+    finishSelectionUpdate(searchAfterSync);
+}
+
+
+
+// Full text hits for the search we are waiting on.
+void NixNote::searchHitsReady(qint32 generation, SearchHits hits, bool complete) {
+    if (generation != searchGeneration)
+        return;
+    global.filterCriteria[global.filterPosition]->setSearchHits(hits, complete);
+}
+
+
+
+//*****************************************************
+//* The filter table is ready, so update the note list
+//* & the rest of the window to match it.
+//*****************************************************
+void NixNote::finishSelectionUpdate(bool afterSync) {
     QLOG_DEBUG() << "Refreshing data";
 
     noteTableView->refreshData();
@@ -3240,6 +3387,10 @@ void NixNote::reindexDatabase() {
     if (response != QMessageBox::Yes)
         return;
 
+    // Forget what was indexed so nothing is skipped as unchanged
+    IndexHashTable indexHashTable(global.db);
+    indexHashTable.clear();
+
     NoteTable ntable(global.db);
     ResourceTable rtable(global.db);
     rtable.reindexAllResources();
@@ -3256,6 +3407,7 @@ void NixNote::openCloseNotebooks() {
     dialog.exec();
     if (dialog.okPressed) {
         notebookTreeView->rebuildNotebookTreeNeeded = true;
+        QMetaObject::invokeMethod(&searchRunner, "refreshSavedSearches", Qt::QueuedConnection);
         this->updateSelectionCriteria();
         notebookTreeView->rebuildTree();
     }
@@ -34,6 +34,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "watcher/filewatchermanager.h"
 #include "gui/ntabwidget.h"
 #include "gui/lineedit.h"
+#include "gui/workstatuslabel.h"
+#include "threads/metricsquery.h"
 #include "sql/databaseconnection.h"
 #include "gui/ntableview.h"
 #include "gui/ntagview.h"
@@ -49,6 +51,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "gui/ntrashtree.h"
 #include "dialog/accountdialog.h"
 #include "threads/counterrunner.h"
+#include "threads/searchrunner.h"
 //#include "oauth/oauthwindow.h"
 #include "html/thumbnailer.h"
 #include "reminders/remindermanager.h"
@@ -69,6 +72,7 @@ class NixNote;
 class SyncRunner;
 class IndexRunner;
 class CounterRunner;
+class SearchRunner;
 class NTabWidget;
 class Thumbnailer;
 class NTableView;
@@ -116,6 +120,14 @@ private:
     Thumbnailer *hammer;
     QTimer indexTimer;
 
+    // Background search state
+    qint32 searchGeneration;      // Generation of the search we are waiting on
+    qint32 searchBatchCount;      // Number of result batches received so far
+    bool searchAfterSync;         // afterSync value to use when the search finishes
+    qint64 searchRequestTime;     // When the search was requested, if no key was pressed
+    QList<qint32> searchLids;     // Results received so far
+    void finishSelectionUpdate(bool afterSync);
+
     // Tool & menu bar
     NMainMenuBar *menuBar;
     TrayMenu   *trayIconContextMenu;
@@ -168,6 +180,8 @@ private:
     void checkLeftPanelSeparators();
     QSplashScreen *splashScreen;
     RemoteQuery *remoteQuery;
+    MetricsQuery *metricsQuery;
+    WorkStatusLabel *workStatusLabel;
 
     QShortcut *focusSearchShortcut;
     QShortcut *fileSaveShortcut;
@@ -199,8 +213,10 @@ public:
     QThread syncThread;
     QThread indexThread;
     QThread counterThread;
+    QThread searchThread;
     IndexRunner indexRunner;
     CounterRunner counterRunner;
+    SearchRunner searchRunner;
     void closeEvent(QCloseEvent *event);
     //bool notify(QObject* receiver, QEvent* event);
     bool event(QEvent *event);
@@ -284,6 +300,9 @@ public slots:
     void indexThreadStarted();
     void syncThreadStarted();
     void counterThreadStarted();
+    void searchThreadStarted();
+    void searchResultsReady(qint32 generation, QList<qint32> lids, bool finished);
+    void searchHitsReady(qint32 generation, SearchHits hits, bool complete);
     void openCloseNotebooks();
     void newWebcamNote();
     void deleteCurrentNote();
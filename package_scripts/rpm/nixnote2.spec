@@ -9,7 +9,7 @@ URL: http://nevernote.sourceforge.net/
 Packager: Randy Baumgarte <randy@fbn.cx>
 Source: nixnote2___VERSION_____ARCH__.tar.gz
 AutoReqProv: no
-Requires: tidy, bash, qt >= 4.8.5, qt-x11 >= 4.8.5, qtwebkit >= 2.3, glibc >= 2.18, libgcc >= 4.8.2, poppler-qt, libstdc++ >= 4.8.2, openssl >= 1.0.0, OpenEXR >= 1.7, tbb >= 4.1, libcurl >= 3.75.0, libtidy >= 5.0
+Requires: tidy, bash, qt >= 4.8.5, qt-x11 >= 4.8.5, qtwebkit >= 2.3, glibc >= 2.18, libgcc >= 4.8.2, poppler-qt, libstdc++ >= 4.8.2, openssl >= 1.0.0, OpenEXR >= 1.7, tbb >= 4.1, libcurl >= 3.75.0, libtidy >= 5.0, zlib
 
 %description
 NixNote:: Evernote client clone for Linux
@@ -7,20 +7,21 @@
 #include <QEventLoop>
 #include <QtNetwork>
 #include <QSharedPointer>
+#include <QThreadStorage>
 #include <QUrl>
 
 /** @cond HIDDEN_SYMBOLS  */
 
 namespace qevercloud {
 
+// A QNetworkAccessManager can only be used from the thread that created it,
+// so each thread making calls gets its own.  It is deleted when the thread ends.
 QNetworkAccessManager* evernoteNetworkAccessManager() {
-    static QSharedPointer<QNetworkAccessManager> networkAccessManager_;
-    static QMutex networkAccessManagerMutex;
-    QMutexLocker mutexLocker(&networkAccessManagerMutex);
-    if(networkAccessManager_.isNull()) {
-        networkAccessManager_ = QSharedPointer<QNetworkAccessManager>(new QNetworkAccessManager);
+    static QThreadStorage<QNetworkAccessManager*> networkAccessManager_;
+    if(!networkAccessManager_.hasLocalData()) {
+        networkAccessManager_.setLocalData(new QNetworkAccessManager);
     }
-    return networkAccessManager_.data();
+    return networkAccessManager_.localData();
 }
 
 ReplyFetcher::ReplyFetcher(): success_(false), httpStatusCode_(0)
@@ -109,6 +109,10 @@ void FileManager::setup(QString homeDirPath, QString programDirPath, int id) {
     thumbnailDir.setPath(dbDirPath+"tdba");
     createDirOrCheckWriteable(thumbnailDir);
     thumbnailDirPath = slashTerminatePath(thumbnailDir.path());
+
+    pdfTextDir.setPath(dbDirPath+"pdft");
+    createDirOrCheckWriteable(pdfTextDir);
+    pdfTextDirPath = slashTerminatePath(pdfTextDir.path());
 }
 
 
@@ -296,6 +300,12 @@ QString FileManager::getThumbnailDirPath(QString relativePath) {
 QString FileManager::getThumbnailDirPathSpecialChar(QString relativePath) {
     return thumbnailDirPath + toPlatformPathSeparator(relativePath).replace("#", "%23");
 }
+QString FileManager::getPdfTextDirPath() {
+    return pdfTextDirPath;
+}
+QString FileManager::getPdfTextDirPath(QString relativePath) {
+    return pdfTextDirPath + toPlatformPathSeparator(relativePath);
+}
 /*
 QDir FileManager::getXMLDirFile(QString relativePath) {
     return QDir(xmlDir.dirName() + toPlatformPathSeparator(relativePath));
@@ -81,6 +81,9 @@ private:
     QString thumbnailDirPath;
     QDir thumbnailDir;
 
+    QString pdfTextDirPath;
+    QDir pdfTextDir;
+
     //QDir xmlDir;
 
     QString translateDirPath;
@@ -116,6 +119,8 @@ public:
     QString getThumbnailDirPath();
     QString getThumbnailDirPath(QString relativePath);
     QString getThumbnailDirPathSpecialChar(QString relativePath);
+    QString getPdfTextDirPath();
+    QString getPdfTextDirPath(QString relativePath);
     QDir getImageDirFile(QString relativePath);
     QString getImageDirPath(QString relativePath);
     QDir getJavaDirFile(QString relativePath);
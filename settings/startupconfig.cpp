@@ -53,6 +53,7 @@ StartupConfig::StartupConfig()
     importNotes = NULL;
     alter = NULL;
     signalGui = NULL;
+    benchmark = NULL;
 }
 
 
@@ -207,6 +208,19 @@ void StartupConfig::printHelp() {
                    +QString("          --newExternalNote            Create a new note in an external window.\n")
                    +QString("          --accountId=<id>             Account number (defaults to last used account).\n\n")
                    +QString("          --configDir=<dir>            Directory containing config & database.\n")
+                   +QString("  searchBenchmark <options>            Time a fixed set of searches against a generated account.\n")
+                   +QString("                                       The account is created the first time & later runs\n")
+                   +QString("                                       must use the same account options.  This needs a\n")
+                   +QString("                                       display, or QT_QPA_PLATFORM=offscreen.\n")
+                   +QString("     searchBenchmark options:\n")
+                   +QString("          --configDir=<dir>            Empty directory to create the account in (required).\n")
+                   +QString("          --notes=<count>              Number of notes.  Defaults to 10000.\n")
+                   +QString("          --notebooks=<count>          Number of notebooks.  Defaults to 25.\n")
+                   +QString("          --tags=<count>               Number of tags.  Defaults to 300.\n")
+                   +QString("          --resources=<count>          Number of attachments & images.  Defaults to 3000.\n")
+                   +QString("          --seed=<number>              Seed for the generated account.  Defaults to 1.\n")
+                   +QString("          --iterations=<count>         Times each search is run.  Defaults to 20.\n")
+                   +QString("          --output=<filename>          Write the JSON results here instead of stdout.\n")
                    +QString("  Examples:\n\n")
                    +QString("     To Start NixNote, do a sync, and then exit.\n")
                    +QString("     nixnote2 start --syncAndExit\n\n")
@@ -348,6 +362,12 @@ int StartupConfig::init(int argc, char *argv[], bool &guiAvailable) {
             command->setBit(STARTUP_SQLEXEC);
             guiAvailable = false;
         }
+        if (parm.startsWith("searchBenchmark", Qt::CaseSensitive)) {
+            command->setBit(STARTUP_BENCHMARK,true);
+            if (benchmark == NULL)
+                benchmark = new SearchBenchmark();
+            guiAvailable = true;     // Indexing uses QTextDocument
+        }
         if (parm.startsWith("signalGui")) {
             command->setBit(STARTUP_SIGNALGUI,true);
             if (signalGui == NULL)
@@ -604,6 +624,22 @@ int StartupConfig::init(int argc, char *argv[], bool &guiAvailable) {
                 notebookList.append(parm);
             }
         }
+        if (command->at(STARTUP_BENCHMARK)) {
+            if (parm.startsWith("--notes=", Qt::CaseSensitive))
+                benchmark->notes = parm.mid(8).toInt();
+            if (parm.startsWith("--notebooks=", Qt::CaseSensitive))
+                benchmark->notebooks = parm.mid(12).toInt();
+            if (parm.startsWith("--tags=", Qt::CaseSensitive))
+                benchmark->tags = parm.mid(7).toInt();
+            if (parm.startsWith("--resources=", Qt::CaseSensitive))
+                benchmark->resources = parm.mid(12).toInt();
+            if (parm.startsWith("--seed=", Qt::CaseSensitive))
+                benchmark->seed = parm.mid(7).toUInt();
+            if (parm.startsWith("--iterations=", Qt::CaseSensitive))
+                benchmark->iterations = parm.mid(13).toInt();
+            if (parm.startsWith("--output=", Qt::CaseSensitive))
+                benchmark->outputFile = parm.mid(9);
+        }
         if (command->at(STARTUP_SQLEXEC)) {
             this->sqlExec=true;
             if (parm.startsWith("--query", Qt::CaseSensitive)) {
@@ -712,3 +748,7 @@ bool StartupConfig::closeNotebook() {
 bool StartupConfig::signalOtherGui() {
     return command->at(STARTUP_SIGNALGUI);
 }
+
+bool StartupConfig::searchBenchmark() {
+    return command->at(STARTUP_BENCHMARK);
+}
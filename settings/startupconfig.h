@@ -35,6 +35,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "cmdtools/alternote.h"
 #include "cmdtools/importnotes.h"
 #include "cmdtools/signalgui.h"
+#include "cmdtools/searchbenchmark.h"
 
 #define STARTUP_GUI 0
 #define STARTUP_SYNC 1
@@ -54,7 +55,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define STARTUP_APPENDNOTE 15
 #define STARTUP_SQLEXEC 16
 #define STARTUP_SIGNALGUI 17
-#define STARTUP_OPTION_COUNT 18
+#define STARTUP_BENCHMARK 18
+#define STARTUP_OPTION_COUNT 19
 
 class StartupConfig
 {
@@ -88,6 +90,7 @@ public:
     ExtractNotes *exportNotes;
     ImportNotes *importNotes;
     AlterNote *alter;
+    SearchBenchmark *benchmark;
     bool gui();
     bool sync();
     bool addNote();
@@ -105,6 +108,7 @@ public:
     bool closeNotebook();
     bool import();
     bool signalOtherGui();
+    bool searchBenchmark();
     QString sqlString;
     QStringList notebookList;
 
@@ -33,6 +33,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define CONFIG_STORE_LID 0   // This is the highest number object in the database
 #define CONFIG_STORE_WINDOW_GEOMETRY 1 // The window geometry between runs
 #define CONFIG_STORE_WINDOW_STATE 2 // The window state between runs
+#define CONFIG_STORE_BENCHMARK 3 // Options the search benchmark account was generated with
 
 class DatabaseConnection;
 
@@ -23,6 +23,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "sql/nsqlquery.h"
 #include "resourcetable.h"
 #include "sql/databaseupgrade.h"
+#include "sql/trigramtable.h"
+#include "sql/tagtable.h"
+#include "sql/notebooktable.h"
+#include "sql/searchtable.h"
+#include "sql/indexhashtable.h"
+#include "sql/searchtexttable.h"
+#include "utilities/textfolding.h"
 
 
 extern Global global;
@@ -33,6 +40,7 @@ extern Global global;
 DatabaseConnection::DatabaseConnection(QString connection)
 {
     dbLocked = Unlocked;
+    inTransaction = false;
     this->connection = connection;
     QLOG_DEBUG() << "SQL drivers available: " << QSqlDatabase::drivers();
     QLOG_TRACE() << "Adding database SQLITE";
@@ -75,6 +83,38 @@ DatabaseConnection::DatabaseConnection(QString connection)
         }
         global.setDatabaseVersion(2);
 
+        // The trigram tables are new, so they may not exist in older databases.
+        TrigramTable trigramTable(this);
+        trigramTable.createTable();
+
+        NoteTable noteTable(this);
+        noteTable.createGeographyIndex();
+        noteTable.createNoteCounts();
+        noteTable.createNoteFlags();
+
+        TagTable tagTable(this);
+        tagTable.createClosureTable();
+        tagTable.createModelTable();
+
+        NotebookTable notebookTable(this);
+        notebookTable.createModelTable();
+
+        SearchTable searchTable(this);
+        searchTable.createResultsTable();
+
+        IndexHashTable indexHashTable(this);
+        indexHashTable.createTable();
+
+        // Folded text indexed before SearchText existed has nothing to show
+        // in snippets, so index it all again to fill it in.
+        SearchTextTable searchTextTable(this);
+        if (searchTextTable.createTable() && TextFolding::enabled()) {
+            indexHashTable.clear();
+            noteTable.reindexAllNotes();
+            ResourceTable resourceTable(this);
+            resourceTable.reindexAllResources();
+        }
+
         // Get username to use for default notes.  This needs to be done after
         // the database is started because we set it by default to the usertable
         // username.
@@ -84,10 +124,16 @@ DatabaseConnection::DatabaseConnection(QString connection)
 
     QLOG_TRACE() << "Creating filter table";
     tempTable.exec("Create table if not exists filter (lid integer)");
-    tempTable.exec("delete from filter");
-    QLOG_TRACE() << "Adding to filter table";
-    tempTable.exec("insert into filter select distinct lid from NoteTable;");
-    QLOG_TRACE() << "Addition complete";
+
+    // The filter table is shared by every connection, so only the main
+    // connection resets it.  Otherwise a thread starting up later would
+    // wipe out whatever the user has selected.
+    if (connection == "nixnote") {
+        tempTable.exec("delete from filter");
+        QLOG_TRACE() << "Adding to filter table";
+        tempTable.exec("insert into filter select distinct lid from NoteTable;");
+        QLOG_TRACE() << "Addition complete";
+    }
     tempTable.finish();
 
 
@@ -45,6 +45,7 @@ public:
     QSqlDatabase conn;              // The actual database connection
     ConfigStore *configStore;       // Table used to store program settings
     DataStore *dataStore;           // Table that contains the note data
+    bool inTransaction;             // A caller has a transaction open, so don't begin or commit another
     enum LockMethod {
         Unlocked = 0,
         Read = 1,
@@ -78,15 +78,8 @@ void DataStore::createTable() {
         QLOG_ERROR() << "Creation of SearchModel table failed: " << sql.lastError();
     }
 
-    sql.prepare("Create View TagModel as select a.lid, (select d.data from DataStore d where d.key=1000 and a.lid = d.lid) as guid, (select data from datastore b1 where b1.lid = (select b.data from DataStore b where b.key=1002 and a.lid = b.lid)) as parent_gid, (select c.data from DataStore c where c.key=1001 and a.lid = c.lid) as name, (select e.data from DataStore e where e.key=1006 and a.lid = e.lid) as account from DataStore a where a.key=1000;");
-    if (!sql.exec()) {
-        QLOG_ERROR() << "Creation of TagModel table failed: " << sql.lastError();
-    }
-
-    sql.prepare("Create View NotebookModel as select a.lid, (select b.data from DataStore b where b.key=3002 and a.lid = b.lid) as stack, (select c.data from DataStore c where c.key=3001 and a.lid = c.lid) as name, (select d.data from DataStore d where d.key=3201 and a.lid = d.lid) as username, (select e.data from DataStore e where e.key=3999 and a.lid = e.lid) as isClosed from DataStore a where a.key=3000;");
-    if (!sql.exec()) {
-        QLOG_ERROR() << "Creation of NotebookModel table failed: " << sql.lastError();
-    }
+    // TagModel & NotebookModel are created (and kept up to date) by
+    // TagTable & NotebookTable when the database is opened.
 
     if (!sql.exec("Create virtual table SearchIndex using fts4 (lid int, weight int, source text, content text)")) {
         QLOG_ERROR() << "Creation of SearchIndex table failed: " << sql.lastError();
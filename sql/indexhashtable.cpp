@@ -0,0 +1,86 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "indexhashtable.h"
+#include "sql/nsqlquery.h"
+#include "global.h"
+
+extern Global global;
+
+
+// Default constructor
+IndexHashTable::IndexHashTable(DatabaseConnection *db)
+{
+    this->db = db;
+}
+
+
+
+void IndexHashTable::createTable() {
+    NSqlQuery sql(db);
+    db->lockForWrite();
+    if (!sql.exec("Create table if not exists IndexHash (guid text primary key, lid integer, hash blob)")) {
+        QLOG_ERROR() << "Creation of IndexHash table failed: " << sql.lastError();
+    }
+    sql.finish();
+    db->unlock();
+}
+
+
+
+QByteArray IndexHashTable::get(QString guid, qint32 &lid) {
+    lid = 0;
+    NSqlQuery sql(db);
+    db->lockForRead();
+    sql.prepare("Select lid, hash from IndexHash where guid=:guid");
+    sql.bindValue(":guid", guid);
+    sql.exec();
+    QByteArray hash;
+    if (sql.next()) {
+        lid = sql.value(0).toInt();
+        hash = sql.value(1).toByteArray();
+    }
+    sql.finish();
+    db->unlock();
+    return hash;
+}
+
+
+
+void IndexHashTable::set(QString guid, qint32 lid, QByteArray hash) {
+    NSqlQuery sql(db);
+    db->lockForWrite();
+    sql.prepare("Insert or replace into IndexHash (guid, lid, hash) values (:guid, :lid, :hash)");
+    sql.bindValue(":guid", guid);
+    sql.bindValue(":lid", lid);
+    sql.bindValue(":hash", hash);
+    sql.exec();
+    sql.finish();
+    db->unlock();
+}
+
+
+
+void IndexHashTable::clear() {
+    NSqlQuery sql(db);
+    db->lockForWrite();
+    sql.exec("Delete from IndexHash");
+    sql.finish();
+    db->unlock();
+}
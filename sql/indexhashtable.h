@@ -0,0 +1,49 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef INDEXHASHTABLE_H
+#define INDEXHASHTABLE_H
+
+#include <QString>
+#include <QByteArray>
+#include "sql/databaseconnection.h"
+
+
+//*****************************************************************
+//* What each note & resource looked like the last time it was
+//* indexed.  The index runner skips anything whose hash hasn't
+//* changed.  It is kept outside the DataStore because a sync
+//* deletes a note's DataStore rows and gives its resources new
+//* lids, so it is keyed by guid and remembers the lid the text was
+//* stored under.
+//*****************************************************************
+class IndexHashTable
+{
+private:
+    DatabaseConnection *db;
+
+public:
+    IndexHashTable(DatabaseConnection *db);                          // Constructor
+    void createTable();                                              // Create the table if it doesn't exist
+    QByteArray get(QString guid, qint32 &lid);                       // Get the last hash & the lid it was for
+    void set(QString guid, qint32 lid, QByteArray hash);             // Save the hash of what was just indexed
+    void clear();                                                    // Forget everything so it is all indexed again
+};
+
+#endif // INDEXHASHTABLE_H
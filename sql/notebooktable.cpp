@@ -1193,3 +1193,49 @@ void NotebookTable::resetDirtyLocalNotebooks() {
     query.finish();
     db->unlock();
 }
+
+
+
+//*****************************************************************
+//* NotebookModel has one row per notebook with everything the
+//* notebook tree needs.  It used to be a view with a subquery per
+//* column.  It is now a table that triggers refresh one notebook at
+//* a time when one of its values changes.
+//*****************************************************************
+void NotebookTable::createModelTable() {
+    NSqlQuery query(db);
+    db->lockForWrite();
+    query.exec("Select type from sqlite_master where name='NotebookModel'");
+    if (query.next() && query.value(0).toString() == "table") {
+        query.finish();
+        db->unlock();
+        return;
+    }
+
+    QLOG_DEBUG() << "Creating NotebookModel table";
+    query.exec("begin");
+    query.exec("Drop view if exists NotebookModel");
+    query.exec("Create table NotebookModel (lid integer primary key, guid text, stack text, name text collate nocase, username text, isClosed integer, isDeleted integer)");
+
+    // Without statistics SQLite likes the key index better, but the lid
+    // index is the one that finds a handful of rows.
+    QString value = "(select data from DataStore indexed by DataStore_Lid where lid=g.lid and key=%1)";
+    QString select = QString("select g.lid, g.data, ") +value.arg(NOTEBOOK_STACK) +", " +value.arg(NOTEBOOK_NAME) +", " +
+            value.arg(LINKEDNOTEBOOK_USERNAME) +", " +value.arg(NOTEBOOK_IS_CLOSED) +", " +value.arg(NOTEBOOK_IS_DELETED) +
+            " from DataStore g %1 where %2g.key=" +QString::number(NOTEBOOK_GUID);
+    QString columns = "insert or replace into NotebookModel (lid, guid, stack, name, username, isClosed, isDeleted) ";
+    QString refresh = "delete from NotebookModel where lid=%1.lid; " +columns +select.arg("indexed by DataStore_Lid").arg("g.lid=%1.lid and ") +"; ";
+    QString keys = QString("(%1,%2,%3,%4,%5,%6)").arg(NOTEBOOK_GUID).arg(NOTEBOOK_NAME).arg(NOTEBOOK_STACK)
+            .arg(LINKEDNOTEBOOK_USERNAME).arg(NOTEBOOK_IS_CLOSED).arg(NOTEBOOK_IS_DELETED);
+
+    query.exec("Create trigger NotebookModel_Insert after insert on DataStore when new.key in " +keys +" begin " +refresh.arg("new") +"end");
+    query.exec("Create trigger NotebookModel_Delete after delete on DataStore when old.key in " +keys +" begin " +refresh.arg("old") +"end");
+    query.exec("Create trigger NotebookModel_Update after update of data on DataStore when new.key in " +keys +" begin " +refresh.arg("new") +"end");
+
+    query.exec(columns +select.arg("").arg(""));
+    if (!query.exec("commit")) {
+        QLOG_ERROR() << "Creation of NotebookModel failed: " << query.lastError();
+    }
+    query.finish();
+    db->unlock();
+}
@@ -119,6 +119,7 @@ public:
     void removeFromStack(qint32 lid);           // Remove from a stack
     void resetLinkedNotebooksDirty();           // mark all linked notebooks as not-dirty
     void resetDirtyLocalNotebooks();            // mark all local notebooks as synchornized
+    void createModelTable();                    // Create the NotebookModel table & its triggers
 
 };
 
@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "linkednotebooktable.h"
 #include "sql/nsqlquery.h"
 #include "tagtable.h"
+#include "trigramtable.h"
 #include "global.h"
 #include "utilities/noteindexer.h"
 
@@ -63,15 +64,15 @@ void NoteTable::updateGuid(qint32 lid, Guid &guid) {
 
 // Synchronize a new note with what is in the database.  We basically
 // just delete the old one & give it a new entry
-void NoteTable::sync(Note &note, qint32 account) {
-    sync(0, note, account);
+qint32 NoteTable::sync(Note &note, qint32 account) {
+    return sync(0, note, account);
 }
 
 
 
 // Synchronize a new note with what is in the database.  We basically
 // just delete the old one & give it a new entry
-void NoteTable::sync(qint32 lid, const Note &note, qint32 account) {
+qint32 NoteTable::sync(qint32 lid, const Note &note, qint32 account) {
    // QLOG_TRACE() << "Entering NoteTable::sync()";
 
     if (lid > 0) {
@@ -94,6 +95,7 @@ void NoteTable::sync(qint32 lid, const Note &note, qint32 account) {
     setThumbnailNeeded(lid, true);
 
     //QLOG_TRACE() << "Leaving NoteTable::sync()";
+    return lid;
 }
 
 
@@ -143,6 +145,31 @@ qint32 NoteTable::getLid(string guid) {
 
 
 
+// Given a list of guids, find the lids of the ones we have.  This is
+// done a batch at a time rather than a query per note.
+qint32 NoteTable::getLids(const QStringList &guids, QHash<QString, qint32> &lids) {
+    NSqlQuery query(db);
+    db->lockForRead();
+    for (int i=0; i<guids.size(); i+=NOTE_LOOKUP_BATCH) {
+        QStringList batch = guids.mid(i, NOTE_LOOKUP_BATCH);
+        QStringList binds;
+        for (int j=0; j<batch.size(); j++)
+            binds.append(QString(":g")+QString::number(j));
+        query.prepare("Select data, lid from DataStore where key=:key and data in (" +binds.join(",") +")");
+        query.bindValue(":key", NOTE_GUID);
+        for (int j=0; j<batch.size(); j++)
+            query.bindValue(binds[j], batch[j]);
+        query.exec();
+        while (query.next())
+            lids.insert(query.value(0).toString(), query.value(1).toInt());
+    }
+    query.finish();
+    db->unlock();
+    return lids.size();
+}
+
+
+
 // Add a new note to the database
 qint32 NoteTable::add(qint32 l, const Note &t, bool isDirty, qint32 account) {
     db->lockForWrite();
@@ -468,6 +495,7 @@ qint32 NoteTable::add(qint32 l, const Note &t, bool isDirty, qint32 account) {
     db->unlock();
 
     updateNoteList(lid, t, isDirty, account);
+    updateGeographyIndex(lid);
 
     // Experimental index helper
     if (global.enableIndexing) {
@@ -963,6 +991,32 @@ bool NoteTable::isDirty(string guid) {
 }
 
 
+
+// Find which of a list of notes are dirty, a batch at a time
+qint32 NoteTable::getDirty(const QList<qint32> &lids, QSet<qint32> &dirty) {
+    NSqlQuery query(db);
+    db->lockForRead();
+    for (int i=0; i<lids.size(); i+=NOTE_LOOKUP_BATCH) {
+        QList<qint32> batch = lids.mid(i, NOTE_LOOKUP_BATCH);
+        QStringList binds;
+        for (int j=0; j<batch.size(); j++)
+            binds.append(QString(":l")+QString::number(j));
+        query.prepare("Select lid, data from DataStore where key=:key and lid in (" +binds.join(",") +")");
+        query.bindValue(":key", NOTE_ISDIRTY);
+        for (int j=0; j<batch.size(); j++)
+            query.bindValue(binds[j], batch[j]);
+        query.exec();
+        while (query.next()) {
+            if (query.value(1).toBool())
+                dirty.insert(query.value(0).toInt());
+        }
+    }
+    query.finish();
+    db->unlock();
+    return dirty.size();
+}
+
+
 // Does this note exist?
 bool NoteTable::exists(qint32 lid) {
     NSqlQuery query(db);
@@ -1147,6 +1201,26 @@ qint32 NoteTable::getIndexNeeded(QList<qint32> &lids) {
 
 
 
+// Get every note needing indexing along with when it was last updated.
+// Unlike the list above, notes that were just changed are included; the
+// index thread decides when they have settled.
+qint32 NoteTable::getIndexNeeded(QHash<qint32, qlonglong> &updated) {
+    NSqlQuery query(db);
+    updated.clear();
+    db->lockForRead();
+    query.prepare("Select lid, data from DataStore where key=:key and lid in (select lid from datastore where key=:key2 and data=1)");
+    query.bindValue(":key", NOTE_UPDATED_DATE);
+    query.bindValue(":key2", NOTE_INDEX_NEEDED);
+    query.exec();
+    while (query.next())
+        updated.insert(query.value(0).toInt(), query.value(1).toLongLong());
+    query.finish();
+    db->unlock();
+    return updated.size();
+}
+
+
+
 // Update the notebook for a note
 void NoteTable::updateNotebook(qint32 noteLid, qint32 notebookLid, bool setAsDirty) {
     Notebook book;
@@ -1674,6 +1748,16 @@ void NoteTable::expunge(qint32 lid) {
     query.exec();
     query.finish();
     db->unlock();
+
+    if (global.geographyIndex) {
+        query.prepare("delete from NoteGeography where lid=:lid");
+        query.bindValue(":lid", lid);
+        query.exec();
+        query.finish();
+    }
+
+    TrigramTable trigramTable(db);
+    trigramTable.expunge(lid);
 }
 
 
@@ -1870,11 +1954,9 @@ void NoteTable::updateNoteContent(qint32 lid, QString content, bool isDirty) {
 
     if (content.contains("<en-crypt")) {
         query.prepare("insert into datastore (lid, key, data) values (:lid, :key, 1)");
-        if (content.contains("<en-todo checked=\"true\"")) {
-            query.bindValue(":lid", lid);
-            query.bindValue(":key", NOTE_HAS_TODO_COMPLETED);
-            query.exec();
-        }
+        query.bindValue(":lid", lid);
+        query.bindValue(":key", NOTE_HAS_ENCRYPT);
+        query.exec();
         NSqlQuery query2(db);
         query2.prepare("Update NoteTable set hasEncryption=:value where lid=:lid");
         query2.bindValue(":lid", lid);
@@ -2221,6 +2303,7 @@ void NoteTable::resetGeography(qint32 lid, bool isDirty) {
     query.exec();
     query.finish();
     db->unlock();
+    updateGeographyIndex(lid);
 
     if (isDirty)
         this->setDirty(lid, isDirty);
@@ -2254,6 +2337,7 @@ void NoteTable::setGeography(qint32 lid, double longitude, double latitude, doub
     }
     query.finish();
     db->unlock();
+    updateGeographyIndex(lid);
 
     if (isDirty)
         this->setDirty(lid, isDirty);
@@ -2261,6 +2345,288 @@ void NoteTable::setGeography(qint32 lid, double longitude, double latitude, doub
 
 
 
+// Create the R*Tree index of note locations.  Coordinate searches
+// (latitude:, longitude: & near:) use this so a bounding box is a
+// single index probe rather than a scan of the DataStore values for
+// each axis.  The first time it is created it is filled from the
+// DataStore.  If SQLite wasn't built with R*Tree support the
+// searches fall back to the DataStore.
+void NoteTable::createGeographyIndex() {
+    NSqlQuery query(db);
+    db->lockForWrite();
+    global.geographyIndex = false;
+    query.exec("Select count(*) from sqlite_master where name='NoteGeography'");
+    bool exists = query.next() && query.value(0).toInt() > 0;
+    if (!exists) {
+        if (!query.exec("Create virtual table NoteGeography using rtree (lid, minLongitude, maxLongitude, minLatitude, maxLatitude)")) {
+            QLOG_ERROR() << "Creation of NoteGeography table failed.  Coordinate searches will not be indexed: " << query.lastError();
+            query.finish();
+            db->unlock();
+            return;
+        }
+        QLOG_DEBUG() << "Filling note geography index";
+        query.prepare(QString("Insert or replace into NoteGeography (lid, minLongitude, maxLongitude, minLatitude, maxLatitude) ") +
+                      QString("select a.lid, a.data, a.data, b.data, b.data from DataStore a, DataStore b ") +
+                      QString("where a.key=:longitudeKey and b.key=:latitudeKey and a.lid=b.lid"));
+        query.bindValue(":longitudeKey", NOTE_ATTRIBUTE_LONGITUDE);
+        query.bindValue(":latitudeKey", NOTE_ATTRIBUTE_LATITUDE);
+        query.exec();
+    }
+    global.geographyIndex = true;
+    query.finish();
+    db->unlock();
+}
+
+
+
+// Update a note's entry in the location index from the DataStore.  A
+// note needs both a latitude & longitude to be in the index.
+void NoteTable::updateGeographyIndex(qint32 lid) {
+    if (!global.geographyIndex)
+        return;
+    NSqlQuery query(db);
+    db->lockForWrite();
+    query.prepare("Delete from NoteGeography where lid=:lid");
+    query.bindValue(":lid", lid);
+    query.exec();
+
+    query.prepare(QString("Insert or replace into NoteGeography (lid, minLongitude, maxLongitude, minLatitude, maxLatitude) ") +
+                  QString("select a.lid, a.data, a.data, b.data, b.data from DataStore a, DataStore b ") +
+                  QString("where a.lid=:lid and b.lid=:lid2 and a.key=:longitudeKey and b.key=:latitudeKey"));
+    query.bindValue(":lid", lid);
+    query.bindValue(":lid2", lid);
+    query.bindValue(":longitudeKey", NOTE_ATTRIBUTE_LONGITUDE);
+    query.bindValue(":latitudeKey", NOTE_ATTRIBUTE_LATITUDE);
+    query.exec();
+    query.finish();
+    db->unlock();
+}
+
+
+
+// Create the NoteCounts table.  It holds the number of active notes in each
+// notebook (type 5011) & tag (type 5012), and the number of notes in the trash
+// (type 5010).  Triggers on the DataStore keep it up to date, so it doesn't
+// matter which thread or which class changes a note.  Every change also bumps
+// the row with type 0, which the counter uses to tell if anything changed.
+void NoteTable::createNoteCounts() {
+    NSqlQuery query(db);
+    db->lockForWrite();
+    query.exec("Select count(*) from sqlite_master where name='NoteCounts'");
+    if (query.next() && query.value(0).toInt() > 0) {
+        query.finish();
+        db->unlock();
+        return;
+    }
+
+    QLOG_DEBUG() << "Creating note counts";
+    query.exec("begin");
+    query.exec("Create table NoteCounts (type integer, lid integer, total integer, primary key (type, lid))");
+
+    // A note counts towards its notebook & tags unless it is in the trash.
+    QString active = QString("not exists (select 1 from DataStore where lid=%1.lid and key=%2 and data=0)");
+    QString inactive = QString("(select count(*) from DataStore where lid=%1.lid and key=%2 and data=0)");
+    QString tagsAndNotebook = QString("((type=%1 and lid in (select data from DataStore where lid=%3.lid and key=%1)) or "
+                                      "(type=%2 and lid in (select data from DataStore where lid=%3.lid and key=%2)))")
+            .arg(NOTE_NOTEBOOK_LID).arg(NOTE_TAG_LID);
+    QString add = QString("insert or ignore into NoteCounts (type, lid, total) values (%1.key, %1.data, 0); "
+                          "update NoteCounts set total=total+1 where type=%1.key and lid=%1.data; ");
+    QString subtract = QString("update NoteCounts set total=total-1 where type=%1.key and lid=%1.data; ");
+    QString trash = QString("insert or ignore into NoteCounts (type, lid, total) values (%1, 0, 0); "
+                            "update NoteCounts set total=total%2 where type=%1 and lid=0; ").arg(NOTE_ACTIVE);
+    QString version = "update NoteCounts set total=total+1 where type=0 and lid=0; ";
+    QString keys = QString("(%1,%2)").arg(NOTE_NOTEBOOK_LID).arg(NOTE_TAG_LID);
+
+    // Notebook & tag assignments
+    query.exec("Create trigger NoteCounts_Insert after insert on DataStore when new.key in " +keys +
+               " and " +active.arg("new").arg(NOTE_ACTIVE) +" begin " +add.arg("new") +version +"end");
+    query.exec("Create trigger NoteCounts_Delete after delete on DataStore when old.key in " +keys +
+               " and " +active.arg("old").arg(NOTE_ACTIVE) +" begin " +subtract.arg("old") +version +"end");
+    query.exec("Create trigger NoteCounts_Update after update of data on DataStore when old.key in " +keys +
+               " and " +active.arg("old").arg(NOTE_ACTIVE) +" begin " +subtract.arg("old") +add.arg("new") +version +"end");
+
+    // Moving a note in or out of the trash
+    QString toTrash = "update NoteCounts set total=total-1 where " +tagsAndNotebook +"; " +trash.arg("+1");
+    QString fromTrash = "update NoteCounts set total=total+1 where " +tagsAndNotebook +"; " +trash.arg("-1");
+    query.exec(QString("Create trigger NoteCounts_Trash_Insert after insert on DataStore when new.key=%1 and new.data=0 and ").arg(NOTE_ACTIVE) +
+               inactive.arg("new").arg(NOTE_ACTIVE) +"=1 begin " +toTrash.arg("new") +version +"end");
+    query.exec(QString("Create trigger NoteCounts_Trash_Delete after delete on DataStore when old.key=%1 and old.data=0 and ").arg(NOTE_ACTIVE) +
+               active.arg("old").arg(NOTE_ACTIVE) +" begin " +fromTrash.arg("old") +version +"end");
+    query.exec(QString("Create trigger NoteCounts_Trash_Update after update of data on DataStore when new.key=%1 and old.data<>0 and new.data=0 and ").arg(NOTE_ACTIVE) +
+               inactive.arg("new").arg(NOTE_ACTIVE) +"=1 begin " +toTrash.arg("new") +version +"end");
+    query.exec(QString("Create trigger NoteCounts_Restore_Update after update of data on DataStore when new.key=%1 and old.data=0 and new.data<>0 and ").arg(NOTE_ACTIVE) +
+               active.arg("new").arg(NOTE_ACTIVE) +" begin " +fromTrash.arg("new") +version +"end");
+
+    // Fill it with what is there now
+    query.exec("Insert into NoteCounts (type, lid, total) values (0, 0, 0)");
+    query.prepare("Insert into NoteCounts (type, lid, total) select key, data, count(*) from DataStore where key in " +keys +
+                  " and lid not in (select lid from DataStore where key=:activeKey and data=0) group by key, data");
+    query.bindValue(":activeKey", NOTE_ACTIVE);
+    query.exec();
+    query.prepare("Insert into NoteCounts (type, lid, total) select :type, 0, count(*) from DataStore where key=:activeKey and data=0");
+    query.bindValue(":type", NOTE_ACTIVE);
+    query.bindValue(":activeKey", NOTE_ACTIVE);
+    query.exec();
+    if (!query.exec("commit")) {
+        QLOG_ERROR() << "Creation of NoteCounts failed: " << query.lastError();
+    }
+    query.finish();
+    db->unlock();
+}
+
+
+
+// One bit of a note's flags, or 0 if none of the rows match.
+static QString noteFlagBit(QString condition, int bit) {
+    return QString("coalesce(max(") +condition +QString("),0)*") +QString::number(bit);
+}
+
+
+
+// The note keys that go into its flags.
+static QString noteFlagKeys() {
+    return QString("(") +QString::number(NOTE_HAS_TODO_COMPLETED) +QString(",") +
+            QString::number(NOTE_HAS_TODO_UNCOMPLETED) +QString(",") +QString::number(NOTE_HAS_ENCRYPT) +
+            QString(",") +QString::number(NOTE_HAS_ATTACHMENT) +QString(")");
+}
+
+
+
+// SQL to work out the flags for the note whose lid is the expression "lid".
+// The todo & encryption bits come from the note's own DataStore entries.  The
+// resource type bits come from the mime types of the note's resources, which
+// are found through the DataStore_Resource_Note index.
+static QString noteFlagsExpression(QString lid) {
+    QString noteKeys = noteFlagKeys();
+    QString noteBits =
+            noteFlagBit("key=" +QString::number(NOTE_HAS_TODO_COMPLETED) +" and data=1", NOTE_FLAG_TODO_COMPLETED) +" | " +
+            noteFlagBit("key=" +QString::number(NOTE_HAS_TODO_UNCOMPLETED) +" and data=1", NOTE_FLAG_TODO_UNCOMPLETED) +" | " +
+            noteFlagBit("key=" +QString::number(NOTE_HAS_ENCRYPT), NOTE_FLAG_ENCRYPTED) +" | " +
+            noteFlagBit("key=" +QString::number(NOTE_HAS_ATTACHMENT), NOTE_FLAG_ATTACHMENT);
+    QString resourceBits =
+            noteFlagBit("m.data like 'image/%'", NOTE_FLAG_IMAGE) +" | " +
+            noteFlagBit("m.data like 'audio/%'", NOTE_FLAG_AUDIO) +" | " +
+            noteFlagBit("m.data = 'application/vnd.evernote.ink'", NOTE_FLAG_INK) +" | " +
+            noteFlagBit("m.data = 'application/pdf'", NOTE_FLAG_PDF) +" | " +
+            noteFlagBit("m.data not like 'image/%' and m.data not like '%vnd.evernote.ink'", NOTE_FLAG_ATTACHMENT);
+    return QString("((select ") +noteBits +QString(" from DataStore indexed by DataStore_Lid where lid=") +lid +
+            QString(" and key in ") +noteKeys +QString(") | ") +
+            QString("(select ") +resourceBits +QString(" from DataStore r indexed by DataStore_Resource_Note join DataStore m on m.lid=r.lid and m.key=") +
+            QString::number(RESOURCE_MIME) +QString(" where r.key=") +QString::number(RESOURCE_NOTE_LID) +
+            QString(" and r.data=+") +lid +QString("))");
+}
+
+
+
+// Trigger body to recalculate one note's flags.  Notes without any flags
+// aren't kept, so the filters only have to look at the notes that have some.
+static QString noteFlagsRefresh(QString lid) {
+    return QString("delete from NoteFlags where lid=") +lid +QString("; ") +
+            QString("insert into NoteFlags (lid, flags) select lid, flags from (select ") +lid +
+            QString(" as lid, ") +noteFlagsExpression(lid) +QString(" as flags) where lid is not null and flags<>0; ");
+}
+
+
+
+// Create the NoteFlags table.  It has a set of NOTE_FLAG_* bits for each note
+// with todos, encryption or resources, so the "contains" attribute filters are
+// a single lookup rather than a walk through the resources.  Like NoteCounts it
+// is kept up to date by triggers on the DataStore, which recalculate a note's
+// bits whenever one of its todo/encryption keys or one of its resources changes.
+void NoteTable::createNoteFlags() {
+    NSqlQuery query(db);
+    db->lockForWrite();
+    query.exec("Select count(*) from sqlite_master where name='NoteFlags'");
+    if (query.next() && query.value(0).toInt() > 0) {
+        query.finish();
+        db->unlock();
+        return;
+    }
+
+    QLOG_DEBUG() << "Creating note flags";
+    query.exec("begin");
+    query.exec("Create table NoteFlags (lid integer primary key, flags integer not null)");
+
+    // Resources are looked up by their note.  Only RESOURCE_NOTE_LID rows are
+    // in the index, so it is small.
+    query.exec("Create index if not exists DataStore_Resource_Note on DataStore (data) where key=" +
+               QString::number(RESOURCE_NOTE_LID));
+
+    QString noteKeys = noteFlagKeys();
+    QString resourceNote = QString("(select data from DataStore indexed by DataStore_Lid where lid=%1.lid and key=") +
+            QString::number(RESOURCE_NOTE_LID) +QString(")");
+    QString noteLidKey = QString::number(RESOURCE_NOTE_LID);
+    QString mimeKey = QString::number(RESOURCE_MIME);
+
+    // Todo, encryption & attachment keys on the note itself
+    query.exec("Create trigger NoteFlags_Note_Insert after insert on DataStore when new.key in " +noteKeys +
+               " begin " +noteFlagsRefresh("new.lid") +"end");
+    query.exec("Create trigger NoteFlags_Note_Delete after delete on DataStore when old.key in " +noteKeys +
+               " begin " +noteFlagsRefresh("old.lid") +"end");
+    query.exec("Create trigger NoteFlags_Note_Update after update of data on DataStore when new.key in " +noteKeys +
+               " begin " +noteFlagsRefresh("new.lid") +"end");
+
+    // A resource being attached to or removed from a note
+    query.exec("Create trigger NoteFlags_Resource_Insert after insert on DataStore when new.key=" +noteLidKey +
+               " begin " +noteFlagsRefresh("new.data") +"end");
+    query.exec("Create trigger NoteFlags_Resource_Delete after delete on DataStore when old.key=" +noteLidKey +
+               " begin " +noteFlagsRefresh("old.data") +"end");
+    query.exec("Create trigger NoteFlags_Resource_Update after update of data on DataStore when new.key=" +noteLidKey +
+               " begin " +noteFlagsRefresh("old.data") +noteFlagsRefresh("new.data") +"end");
+
+    // A resource's mime type changing
+    query.exec("Create trigger NoteFlags_Mime_Insert after insert on DataStore when new.key=" +mimeKey +
+               " begin " +noteFlagsRefresh(resourceNote.arg("new")) +"end");
+    query.exec("Create trigger NoteFlags_Mime_Delete after delete on DataStore when old.key=" +mimeKey +
+               " begin " +noteFlagsRefresh(resourceNote.arg("old")) +"end");
+    query.exec("Create trigger NoteFlags_Mime_Update after update of data on DataStore when new.key=" +mimeKey +
+               " begin " +noteFlagsRefresh(resourceNote.arg("new")) +"end");
+
+    // Fill it with what is there now
+    query.exec("Insert into NoteFlags (lid, flags) select lid, flags from (select n.lid as lid, " +
+               noteFlagsExpression("n.lid") +" as flags from NoteTable n) where flags<>0");
+    if (!query.exec("commit")) {
+        QLOG_ERROR() << "Creation of NoteFlags failed: " << query.lastError();
+    }
+    query.finish();
+    db->unlock();
+}
+
+
+
+// Get the totals for one type of count (NOTE_NOTEBOOK_LID, NOTE_TAG_LID or
+// NOTE_ACTIVE for the trash).  Returns the number of entries found.
+qint32 NoteTable::getNoteCounts(qint32 type, QHash<qint32, qint32> &totals) {
+    totals.clear();
+    NSqlQuery query(db);
+    db->lockForRead();
+    query.prepare("Select lid, total from NoteCounts where type=:type");
+    query.bindValue(":type", type);
+    query.exec();
+    while (query.next())
+        totals.insert(query.value(0).toInt(), query.value(1).toInt());
+    query.finish();
+    db->unlock();
+    return totals.size();
+}
+
+
+
+// Get the number of times the counts have changed.
+qint32 NoteTable::getNoteCountsVersion() {
+    qint32 retval = 0;
+    NSqlQuery query(db);
+    db->lockForRead();
+    query.exec("Select total from NoteCounts where type=0 and lid=0");
+    if (query.next())
+        retval = query.value(0).toInt();
+    query.finish();
+    db->unlock();
+    return retval;
+}
+
+
+
 void NoteTable::setThumbnailNeeded(qint32 lid, bool value) {
     if (lid >=0)
         return;
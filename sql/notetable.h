@@ -33,6 +33,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QSqlTableModel>
 #include <QtSql>
 #include <QString>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
 #include "sql/databaseconnection.h"
 
 #include "qevercloud/include/QEverCloud.h"
@@ -87,6 +90,21 @@ using namespace qevercloud;
 #define NOTE_EXPUNGED_FROM_TRASH               5998
 #define NOTE_INDEX_NEEDED                      5999
 
+// Bits in NoteFlags.  Triggers work them out from the DataStore so the
+// attribute filters don't have to go through the resources.
+#define NOTE_FLAG_TODO_COMPLETED               0x0001
+#define NOTE_FLAG_TODO_UNCOMPLETED             0x0002
+#define NOTE_FLAG_ENCRYPTED                    0x0004
+#define NOTE_FLAG_ATTACHMENT                   0x0008
+#define NOTE_FLAG_IMAGE                        0x0010
+#define NOTE_FLAG_AUDIO                        0x0020
+#define NOTE_FLAG_INK                          0x0040
+#define NOTE_FLAG_PDF                          0x0080
+
+// Most guids or lids looked up in one query.  Kept under SQLite's
+// limit on bind variables.
+#define NOTE_LOOKUP_BATCH                      500
+
 using namespace std;
 
 class NoteTable
@@ -101,6 +119,7 @@ public:
     NoteTable(DatabaseConnection *db);                             // Constructor
     qint32 getLid(QString guid);                             // given a guid, return the lid
     qint32 getLid(string guid);                              // Given a guid, return the lid
+    qint32 getLids(const QStringList &guids, QHash<QString, qint32> &lids);  // Look up the lids for many guids at once
     QString getGuid(int lid);                                // given a lid, get the guid
     bool get(Note &note, qint32 lid, bool loadResources, bool loadBinary);           // Get a note given a lid
     bool get(Note &note, QString guid, bool loadResources, bool loadBinary);         // get a note given a guid
@@ -108,6 +127,7 @@ public:
     bool isDirty(qint32 lid);                                // Check if a note is dirty
     bool isDirty(QString guid);                              // Check if a note is dirty
     bool isDirty(string guid);                               // Check if a note is dirty
+    qint32 getDirty(const QList<qint32> &lids, QSet<qint32> &dirty);  // Which of these notes are dirty
     bool exists(qint32 lid);                                 // Does this note exist?
     bool exists(QString guid);                               // Does this note exist?
     bool exists(string guid);                                // Does this note exist?
@@ -120,6 +140,7 @@ public:
     qint32 findNotesByTitle(QList<qint32> &lids, QString title);   // Find a note by its title
     qint32 getNotesWithTag(QList<qint32> &retval, QString tag);    // Find all notes for a specific tag;
     qint32 getIndexNeeded(QList<qint32> &lids);              // Get a list of all notes needing indexing
+    qint32 getIndexNeeded(QHash<qint32, qlonglong> &updated);   // Get all notes needing indexing & when they were updated
     qint32 findNotesByNotebook(QList<qint32> &notes, QString guid);    // Find all notes for a given notebook
     qint32 findNotesByNotebook(QList<qint32> &notes, string guid);     // Find all notes for a given notebook
     qint32 findNotesByNotebook(QList<qint32> &notes, qint32 lid);      // Find all notes for a given notebook
@@ -152,6 +173,12 @@ public:
     void reindexAllNotes();                                             // Reindex all notes
     void resetGeography(qint32 lid, bool isDirty);                      // clear geography of note
     void setGeography(qint32 lid, double longitude, double latitude, double altitude, bool isDirty);    // Set the note location
+    void createGeographyIndex();                                        // Create & fill the R*Tree of note locations
+    void updateGeographyIndex(qint32 lid);                              // Refresh a note's entry in the location index
+    void createNoteCounts();                                            // Create the notebook/tag/trash totals & their triggers
+    qint32 getNoteCounts(qint32 type, QHash<qint32, qint32> &totals);   // Get the totals for notebooks, tags or the trash
+    qint32 getNoteCountsVersion();                                      // Get the number of changes to the totals
+    void createNoteFlags();                                             // Create the todo/encryption/resource type bits & their triggers
     void setThumbnailNeeded(qint32 lid, bool value);                    // Set if a thumbnail is needed?
     void setThumbnailNeeded(QString guid, bool value);                  // Set if a thumbail is needed
     void setThumbnailNeeded(string guid, bool value);                   // see if a thumbnail is needed
@@ -182,8 +209,8 @@ public:
     void pinNote(QString guid, bool value);                              // pin the current note
     void pinNote(qint32 lid, bool value);                                // pin the current note
     void updateGuid(qint32 lid, Guid &guid);                             // Update a note's guid
-    void sync(Note &note, qint32 account=0);                             // Sync a note with a new record
-    void sync(qint32 lid, const Note &note, qint32 account=0);           // Sync a note with a new record
+    qint32 sync(Note &note, qint32 account=0);                           // Sync a note with a new record
+    qint32 sync(qint32 lid, const Note &note, qint32 account=0);         // Sync a note with a new record
     qint32 add(qint32 lid, const Note &t, bool isDirty, qint32 account=0); // Add a new note
     void setIndexNeeded(qint32 lid, bool indexNeeded);                   // flag if a note needs reindexing
     void updateNoteListTags(qint32 noteLid, QString tags);               // Update the tag names in the note list
@@ -154,6 +154,34 @@ qint32 ResourceTable::getLid(QString resourceGuid) {
 }
 
 
+// Given a list of resource guids, find the ones we have along with the
+// note each belongs to.  Done a batch at a time rather than a query per
+// resource.
+qint32 ResourceTable::getLids(const QStringList &guids, QHash<QPair<qint32, QString>, qint32> &lids) {
+    NSqlQuery query(db);
+    db->lockForRead();
+    for (int i=0; i<guids.size(); i+=NOTE_LOOKUP_BATCH) {
+        QStringList batch = guids.mid(i, NOTE_LOOKUP_BATCH);
+        QStringList binds;
+        for (int j=0; j<batch.size(); j++)
+            binds.append(QString(":g")+QString::number(j));
+        query.prepare("Select a.data, a.lid, b.data from DataStore a, DataStore b where a.key=:key and a.data in ("
+                      +binds.join(",") +") and b.lid=a.lid and b.key=:key2");
+        query.bindValue(":key", RESOURCE_GUID);
+        query.bindValue(":key2", RESOURCE_NOTE_LID);
+        for (int j=0; j<batch.size(); j++)
+            query.bindValue(binds[j], batch[j]);
+        query.exec();
+        while (query.next())
+            lids.insert(QPair<qint32, QString>(query.value(2).toInt(), query.value(0).toString()), query.value(1).toInt());
+    }
+    query.finish();
+    db->unlock();
+    return lids.size();
+}
+
+
+
 // Get the guid for a given resource lid
 QString ResourceTable::getGuid(int lid) {
     NSqlQuery query(db);
@@ -827,6 +855,32 @@ qint32 ResourceTable::getIndexNeeded(QList<qint32> &lids) {
 
 
 
+// Get every resource needing indexing along with the note it belongs to.
+// A resource without a note is still returned, with a note lid of 0.
+qint32 ResourceTable::getIndexNeeded(QHash<qint32, qint32> &noteLids) {
+    QList<qint32> lids;
+    noteLids.clear();
+    if (getIndexNeeded(lids) == 0)
+        return 0;
+    for (int i=0; i<lids.size(); i++)
+        noteLids.insert(lids[i], 0);
+    NSqlQuery query(db);
+    db->lockForRead();
+    query.prepare("Select lid, data from DataStore where key=:key and lid in (select lid from DataStore where key=:key2 and data=1)");
+    query.bindValue(":key", RESOURCE_NOTE_LID);
+    query.bindValue(":key2", RESOURCE_INDEX_NEEDED);
+    query.exec();
+    while (query.next()) {
+        if (noteLids.contains(query.value(0).toInt()))
+            noteLids.insert(query.value(0).toInt(), query.value(1).toInt());
+    }
+    query.finish();
+    db->unlock();
+    return noteLids.size();
+}
+
+
+
 // Get a list of all resource LIDs for a given note
 bool ResourceTable::getResourceList(QList<qint32> &resourceList, qint32 noteLid) {
 
@@ -1020,6 +1074,21 @@ QByteArray ResourceTable::getDataHash(qint32 lid) {
 }
 
 
+// Get the data hash of every resource, as lower case hex
+void ResourceTable::getDataHashes(QSet<QString> &hashes) {
+    NSqlQuery query(db);
+    db->lockForRead();
+    query.prepare("Select distinct data from DataStore where key=:key");
+    query.bindValue(":key", RESOURCE_DATA_HASH);
+    query.exec();
+    while (query.next())
+        hashes.insert(query.value(0).toString().toLower());
+    query.finish();
+    db->unlock();
+}
+
+
+
 // Mark all note resource as needing reindexed
 void ResourceTable::reindexAllResources() {
     NSqlQuery query(db);
@@ -30,6 +30,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QSqlTableModel>
 #include <QtSql>
 #include <QString>
+#include <QSet>
+#include <QHash>
+#include <QPair>
+#include <QStringList>
 
 #define RESOURCE_GUID                    6000
 #define RESOURCE_NOTE_LID                6001
@@ -80,6 +84,7 @@ public:
     qint32 getLid(string noteGuid, string guid);                 // Given a note & resource guid, return the lid
     qint32 getLid(string resourceGuid);                          // Given a GUID, return the lid
     qint32 getLid(QString resourceGuid);                         // Given a resource GUID, return the lid
+    qint32 getLids(const QStringList &guids, QHash<QPair<qint32, QString>, qint32> &lids);  // Look up many resources at once, keyed by note lid & guid
     QString getGuid(int lid);                                    // Given a lid, get the guid
     bool get(Resource &resource, qint32 lid, bool withBinary);           // Get a resource given a lid
     bool get(Resource &resource, QString noteGuid, QString guid, bool withBinary);      // get a resource given a guid
@@ -94,11 +99,13 @@ public:
     qint32 getLidByHashHex(QString noteGuid, QString hash);      // Get a lid by the resource's hash value
     bool getInkNote(QByteArray &value, qint32 lid);              // Get an inknote
     qint32 getIndexNeeded(QList<qint32> &lids);                  // Get a list of all resources needing indexing
+    qint32 getIndexNeeded(QHash<qint32, qint32> &noteLids);      // Get all resources needing indexing & the note they belong to
     bool getResourceList(QList<qint32> &resourceList, qint32 noteLid);  // Get resources for a note
     qint32 getCount();                                           // count of all resources
     qint32 getUnindexedCount();                                  // count of unindexed resources
     qint32 getNoteLid(qint32 resLid);                            // Get the owning note for this resource
     QByteArray getDataHash(qint32 lid);                          // Get the hash value for the data in a resource
+    void getDataHashes(QSet<QString> &hashes);                   // Get the hex data hashes of every resource
     void getResourceMap(QHash<QString, qint32> &map, QHash<qint32, Resource> &resourceMap, qint32 noteLid);  // Get a resource MAP data
     void getResourceMap(QHash<QString, qint32> &map, QHash<qint32, Resource> &resourceMap, string guid);     // Get a resource's MAP data
     void getResourceMap(QHash<QString, qint32> &map, QHash<qint32, Resource> &resourceMap, QString guid);    // Get a resource's MAP data
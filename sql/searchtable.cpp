@@ -22,7 +22,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "configstore.h"
 
 #include <QSqlTableModel>
+#include <QDataStream>
+#include <QSet>
 #include "sql/nsqlquery.h"
+#include "sql/resourcetable.h"
 
 #include "global.h"
 extern Global global;
@@ -371,6 +374,12 @@ void SearchTable::expunge(qint32 lid) {
     query.prepare("delete from DataStore where lid=:lid");
     query.bindValue(":lid", lid);
     query.exec();
+    query.prepare("delete from SavedSearchResults where search=:lid");
+    query.bindValue(":lid", lid);
+    query.exec();
+    query.prepare("delete from SavedSearchState where search=:lid");
+    query.bindValue(":lid", lid);
+    query.exec();
     query.finish();
     db->unlock();
 }
@@ -482,3 +491,246 @@ QString SearchTable::getGuid(qint32 lid) {
     db->unlock();
     return retval;
 }
+
+
+
+//*****************************************************************
+//* Saved searches keep their parsed search terms & the notes they
+//* matched the last time the search thread ran them.
+//* SavedSearchState has the query text the terms & results are
+//* for, so if the search is edited they are simply out of date
+//* until the next refresh.  Clicking a saved search (or a favorite
+//* pointing to one) can then show the stored results right away.
+//*
+//* Notes are changed from a lot of places (the note list, trash,
+//* imports, merges, sync ...), so rather than have each of them
+//* tell the search thread, triggers on NoteTable log every note
+//* changed in SavedSearchChanges.  The stored results are only
+//* used while that log is empty.
+//*****************************************************************
+void SearchTable::createResultsTable() {
+    NSqlQuery query(db);
+    db->lockForWrite();
+    if (!query.exec("Create table if not exists SavedSearchState (search integer primary key, query text, terms blob)")) {
+        QLOG_ERROR() << "Creation of SavedSearchState table failed: " << query.lastError();
+    }
+    if (!query.exec("Create table if not exists SavedSearchResults (search integer, lid integer, primary key (search, lid)) without rowid")) {
+        QLOG_ERROR() << "Creation of SavedSearchResults table failed: " << query.lastError();
+    }
+    if (!query.exec("Create table if not exists SavedSearchChanges (seq integer primary key autoincrement, lid integer)")) {
+        QLOG_ERROR() << "Creation of SavedSearchChanges table failed: " << query.lastError();
+    }
+    query.finish();
+    db->unlock();
+    createChangeTriggers();
+}
+
+
+
+// Create the NoteTable triggers that log changed notes.  On a new
+// account NoteTable doesn't exist yet when the database is opened, so
+// NoteModel::createTable() calls this again once it has made it.
+void SearchTable::createChangeTriggers() {
+    NSqlQuery query(db);
+    db->lockForWrite();
+    query.exec("Select count(*) from sqlite_master where type='table' and name='NoteTable'");
+    if (!query.next() || query.value(0).toInt() == 0) {
+        QLOG_DEBUG() << "NoteTable doesn't exist yet.  Saved search change triggers not created.";
+        query.finish();
+        db->unlock();
+        return;
+    }
+    if (!query.exec("Create trigger if not exists SavedSearchNoteInsert after insert on NoteTable begin insert into SavedSearchChanges (lid) values (new.lid); end") ||
+            !query.exec("Create trigger if not exists SavedSearchNoteUpdate after update on NoteTable begin insert into SavedSearchChanges (lid) values (new.lid); end") ||
+            !query.exec("Create trigger if not exists SavedSearchNoteDelete after delete on NoteTable begin insert into SavedSearchChanges (lid) values (old.lid); end")) {
+        QLOG_ERROR() << "Creation of saved search change triggers failed: " << query.lastError();
+    }
+    query.finish();
+    db->unlock();
+}
+
+
+
+// Get the parsed terms for a search.  This returns false if the search
+// hasn't been parsed yet or the query has changed since.
+bool SearchTable::getTerms(qint32 lid, QString query, QStringList &terms) {
+    terms.clear();
+    NSqlQuery sql(db);
+    db->lockForRead();
+    sql.prepare("Select terms from SavedSearchState where search=:lid and query=:query");
+    sql.bindValue(":lid", lid);
+    sql.bindValue(":query", query);
+    sql.exec();
+    bool retval = false;
+    if (sql.next()) {
+        QByteArray data = sql.value(0).toByteArray();
+        QDataStream stream(&data, QIODevice::ReadOnly);
+        stream >> terms;
+        retval = true;
+    }
+    sql.finish();
+    db->unlock();
+    return retval;
+}
+
+
+
+// Replace everything stored for a search
+void SearchTable::setResults(qint32 lid, QString query, QStringList &terms, QList<qint32> &results) {
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << terms;
+
+    NSqlQuery sql(db);
+    db->lockForWrite();
+    sql.exec("begin");
+    sql.prepare("Insert or replace into SavedSearchState (search, query, terms) values (:lid, :query, :terms)");
+    sql.bindValue(":lid", lid);
+    sql.bindValue(":query", query);
+    sql.bindValue(":terms", data);
+    sql.exec();
+    sql.prepare("Delete from SavedSearchResults where search=:lid");
+    sql.bindValue(":lid", lid);
+    sql.exec();
+    sql.prepare("Insert or ignore into SavedSearchResults (search, lid) values (:search, :lid)");
+    for (int i=0; i<results.size(); i++) {
+        sql.bindValue(":search", lid);
+        sql.bindValue(":lid", results[i]);
+        sql.exec();
+    }
+    sql.exec("commit");
+    sql.finish();
+    db->unlock();
+}
+
+
+
+// A few notes have been checked against a search again.  The ones in
+// "checked" are removed & the ones in "matched" are put back.
+void SearchTable::updateResults(qint32 lid, QList<qint32> &checked, QList<qint32> &matched) {
+    NSqlQuery sql(db);
+    db->lockForWrite();
+    sql.exec("begin");
+    sql.prepare("Delete from SavedSearchResults where search=:search and lid=:lid");
+    for (int i=0; i<checked.size(); i++) {
+        sql.bindValue(":search", lid);
+        sql.bindValue(":lid", checked[i]);
+        sql.exec();
+    }
+    sql.prepare("Insert or ignore into SavedSearchResults (search, lid) values (:search, :lid)");
+    for (int i=0; i<matched.size(); i++) {
+        sql.bindValue(":search", lid);
+        sql.bindValue(":lid", matched[i]);
+        sql.exec();
+    }
+    sql.exec("commit");
+    sql.finish();
+    db->unlock();
+}
+
+
+
+// Find a search whose stored results are for this query.  Returns 0
+// if there isn't one.
+qint32 SearchTable::findResults(QString query) {
+    NSqlQuery sql(db);
+    db->lockForRead();
+    sql.prepare("Select search from SavedSearchState where query=:query");
+    sql.bindValue(":query", query);
+    sql.exec();
+    qint32 retval = 0;
+    if (sql.next())
+        retval = sql.value(0).toInt();
+    sql.finish();
+    db->unlock();
+    return retval;
+}
+
+
+
+// Get the number of stored results for every search
+void SearchTable::getResultCounts(QHash<qint32, qint32> &counts) {
+    counts.clear();
+    NSqlQuery sql(db);
+    db->lockForRead();
+    sql.exec("Select s.search, (select count(*) from SavedSearchResults r where r.search=s.search) from SavedSearchState s");
+    while (sql.next())
+        counts.insert(sql.value(0).toInt(), sql.value(1).toInt());
+    sql.finish();
+    db->unlock();
+}
+
+
+
+// Check if any notes have changed since the stored results were updated
+bool SearchTable::hasChanges() {
+    NSqlQuery sql(db);
+    db->lockForRead();
+    sql.exec("Select seq from SavedSearchChanges limit 1");
+    bool retval = sql.next();
+    sql.finish();
+    db->unlock();
+    return retval;
+}
+
+
+
+// Log notes whose index text has just been written.  The NoteTable
+// triggers log the edit itself, but the note can be checked before the
+// index thread gets to it, so it needs checking again afterwards.
+// Resources are logged under the note they belong to.
+void SearchTable::logIndexed(QList<qint32> &notes, QList<qint32> &resources) {
+    NSqlQuery sql(db);
+    db->lockForWrite();
+    sql.prepare("Insert into SavedSearchChanges (lid) values (:lid)");
+    for (int i=0; i<notes.size(); i++) {
+        sql.bindValue(":lid", notes[i]);
+        sql.exec();
+    }
+    sql.prepare("Insert into SavedSearchChanges (lid) select data from DataStore where lid=:lid and key=:key");
+    for (int i=0; i<resources.size(); i++) {
+        sql.bindValue(":lid", resources[i]);
+        sql.bindValue(":key", RESOURCE_NOTE_LID);
+        sql.exec();
+    }
+    sql.finish();
+    db->unlock();
+}
+
+
+
+// Get the notes changed since the stored results were updated.  The
+// last change number is returned so only these changes are cleared
+// once the results are updated.
+qint64 SearchTable::getChanges(QList<qint32> &lids) {
+    lids.clear();
+    NSqlQuery sql(db);
+    db->lockForRead();
+    sql.exec("Select seq, lid from SavedSearchChanges order by seq");
+    qint64 retval = 0;
+    QSet<qint32> seen;
+    while (sql.next()) {
+        retval = sql.value(0).toLongLong();
+        qint32 lid = sql.value(1).toInt();
+        if (!seen.contains(lid)) {
+            seen.insert(lid);
+            lids.append(lid);
+        }
+    }
+    sql.finish();
+    db->unlock();
+    return retval;
+}
+
+
+
+// Forget the changes the stored results have caught up with
+void SearchTable::clearChanges(qint64 seq) {
+    NSqlQuery sql(db);
+    db->lockForWrite();
+    sql.prepare("Delete from SavedSearchChanges where seq<=:seq");
+    sql.bindValue(":seq", seq);
+    sql.exec();
+    sql.finish();
+    db->unlock();
+}
@@ -29,6 +29,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QSqlTableModel>
 #include <QtSql>
 #include <QString>
+#include <QStringList>
+#include <QHash>
 #include "sql/databaseconnection.h"
 
 using namespace std;
@@ -82,6 +84,19 @@ public:
     void expunge(string guid);                 // Erase a search
     void setDirty(qint32 lid, bool dirty);     // Set a search as needing to be synchronized
     void setUpdateSequenceNumber(qint32 lid, qint32 usn);     // Set the update sequence number for a search
+
+    // Saved search results
+    void createResultsTable();                 // Create the saved search result tables
+    void createChangeTriggers();               // Log changed notes once NoteTable exists
+    bool getTerms(qint32 lid, QString query, QStringList &terms);            // Get the parsed terms if the query hasn't changed
+    void setResults(qint32 lid, QString query, QStringList &terms, QList<qint32> &results);   // Replace the results of a search
+    void updateResults(qint32 lid, QList<qint32> &checked, QList<qint32> &matched);         // Update the results for some notes
+    qint32 findResults(QString query);         // Find the search with results for a query
+    void getResultCounts(QHash<qint32, qint32> &counts);   // Get the number of results for every search
+    bool hasChanges();                         // Have notes changed since the results were stored?
+    qint64 getChanges(QList<qint32> &lids);    // Get the changed notes & the last change number
+    void clearChanges(qint64 seq);             // Forget the changes up to a change number
+    void logIndexed(QList<qint32> &notes, QList<qint32> &resources);    // Log notes whose index text changed
 };
 
 #endif // SEARCHTABLE_H
@@ -0,0 +1,98 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "searchtexttable.h"
+#include "sql/nsqlquery.h"
+#include "global.h"
+#include "utilities/textfolding.h"
+
+extern Global global;
+
+
+// Default constructor
+SearchTextTable::SearchTextTable(DatabaseConnection *db)
+{
+    this->db = db;
+}
+
+
+
+// Create the table.  Older databases don't have it, so the caller is told
+// when it is new in case existing folded rows need their text.
+bool SearchTextTable::createTable() {
+    NSqlQuery sql(db);
+    db->lockForWrite();
+    sql.exec("Select name from sqlite_master where type='table' and name='SearchText'");
+    bool found = sql.next();
+    if (!found && !sql.exec("Create table SearchText (docid integer primary key, original text)")) {
+        QLOG_ERROR() << "Creation of SearchText table failed: " << sql.lastError();
+    }
+    sql.finish();
+    db->unlock();
+    return !found;
+}
+
+
+
+void SearchTextTable::clear() {
+    NSqlQuery sql(db);
+    db->lockForWrite();
+    sql.exec("Delete from SearchText");
+    sql.finish();
+    db->unlock();
+}
+
+
+
+// Save the original text for the SearchIndex row that was just inserted
+// on this connection.  Without folding the index has the text itself.
+void SearchTextTable::add(QString text) {
+    if (!TextFolding::enabled())
+        return;
+    NSqlQuery sql(db);
+    db->lockForWrite();
+    sql.prepare("Insert or replace into SearchText (docid, original) values (last_insert_rowid(), :original)");
+    sql.bindValue(":original", text);
+    sql.exec();
+    sql.finish();
+    db->unlock();
+}
+
+
+
+// Remove the text for a lid's SearchIndex rows.  This has to be done before
+// the rows themselves are deleted or the docids are lost.
+void SearchTextTable::expunge(qint32 lid, QString source) {
+    if (!TextFolding::enabled())
+        return;
+    NSqlQuery sql(db);
+    db->lockForWrite();
+    if (source == "") {
+        sql.prepare("Delete from SearchText where docid in (select docid from SearchIndex where SearchIndex match :terms and lid=:lid)");
+        sql.bindValue(":terms", QString("lid:") + QString::number(lid));
+    } else {
+        sql.prepare("Delete from SearchText where docid in (select docid from SearchIndex where SearchIndex match :terms and lid=:lid and source=:source)");
+        sql.bindValue(":terms", QString("lid:") + QString::number(lid) + QString(" source:") + source);
+        sql.bindValue(":source", source);
+    }
+    sql.bindValue(":lid", lid);
+    sql.exec();
+    sql.finish();
+    db->unlock();
+}
@@ -0,0 +1,48 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef SEARCHTEXTTABLE_H
+#define SEARCHTEXTTABLE_H
+
+#include <QString>
+#include "sql/databaseconnection.h"
+
+
+//*****************************************************************
+//* When folding or stemming is on, SearchIndex holds the folded
+//* text, which is no good for showing the user.  The text as it
+//* was written is kept here, keyed by the SearchIndex docid, so
+//* snippets & highlighted words can come from it.  Rows are only
+//* added while folding is on; the table is emptied when the
+//* setting changes since everything gets indexed again anyway.
+//*****************************************************************
+class SearchTextTable
+{
+private:
+    DatabaseConnection *db;
+
+public:
+    SearchTextTable(DatabaseConnection *db);                 // Constructor
+    bool createTable();                                      // Create the table.  True if it didn't exist
+    void clear();                                            // Remove everything
+    void add(QString text);                                  // Text for the SearchIndex row just inserted
+    void expunge(qint32 lid, QString source="");             // Remove the text for a lid's SearchIndex rows
+};
+
+#endif // SEARCHTEXTTABLE_H
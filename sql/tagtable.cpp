@@ -656,26 +656,96 @@ bool TagTable::isDeleted(qint32 lid) {
 }
 
 
+// Find all the tags below a tag, however deep they are.
 qint32 TagTable::findChildren(QList<qint32> &list, QString parentGuid) {
-    qint32 parentLid = getLid(parentGuid);
+    return findChildren(list, getLid(parentGuid));
+}
+
+
+
+// Find all the tags below a tag, however deep they are.  The closure
+// table already has them, so this doesn't have to walk the tree.
+qint32 TagTable::findChildren(QList<qint32> &list, qint32 parentLid) {
     NSqlQuery query(db);
     db->lockForRead();
-    query.prepare("Select lid from DataStore where key=:key and data=:parent");
-    query.bindValue(":key", TAG_PARENT_LID);
+    query.prepare("Select descendant from TagClosure where ancestor=:parent and depth>0 order by depth desc");
     query.bindValue(":parent", parentLid);
     query.exec();
+    while (query.next())
+        list.append(query.value(0).toInt());
+    query.finish();
     db->unlock();
+    return list.size();
+}
 
-    // Now find all the children for each found tag
-    while (query.next()) {
-        qint32 nextChild = query.value(0).toInt();
-        QString nextGuid;
-        getGuid(nextGuid, nextChild);
-        findChildren(list, nextGuid);
-        list.append(nextChild);
+
+
+//*****************************************************************
+//* The tag closure table has a row for every tag & each tag above
+//* it, with the number of levels between them.  Every tag is also
+//* its own ancestor at depth 0, so "a tag and everything below it"
+//* is just "where ancestor=x".  It is kept up to date by triggers
+//* on the tag's guid (for the depth 0 row) and on the parent lid,
+//* so a tag being added, moved or expunged is always reflected no
+//* matter which code path changed it.  The parent lid triggers
+//* never touch depth 0 rows, because updating a tag deletes all of
+//* its DataStore rows & adds them back in no particular order.
+//*****************************************************************
+void TagTable::createClosureTable() {
+    NSqlQuery query(db);
+    db->lockForWrite();
+    query.exec("Select count(*) from sqlite_master where name='TagClosure'");
+    if (query.next() && query.value(0).toInt() > 0) {
+        query.finish();
+        db->unlock();
+        return;
+    }
+
+    QLOG_DEBUG() << "Creating tag closure table";
+    query.exec("begin");
+    query.exec("Create table TagClosure (ancestor integer, descendant integer, depth integer, primary key (ancestor, descendant)) without rowid");
+    query.exec("Create index TagClosure_Descendant on TagClosure (descendant, depth)");
+
+    // Everything above the parent (and the parent) gets a row for everything
+    // below the tag (and the tag).
+    QString ancestors = "select %1.data as ancestor, 0 as depth union all select ancestor, depth from TagClosure where descendant=%1.data and depth>0";
+    QString descendants = "select %1.lid as descendant, 0 as depth union all select descendant, depth from TagClosure where ancestor=%1.lid and depth>0";
+    QString link = "insert or ignore into TagClosure (ancestor, descendant, depth) select a.ancestor, d.descendant, a.depth+d.depth+1 from (" +
+            ancestors +") a, (" +descendants +") d where a.ancestor<>d.descendant; ";
+    QString unlink = "delete from TagClosure where depth>0 and ancestor in (select %1.data union select ancestor from TagClosure where descendant=%1.data) "
+            "and descendant in (select %1.lid union select descendant from TagClosure where ancestor=%1.lid); ";
+
+    query.exec(QString("Create trigger TagClosure_Self_Insert after insert on DataStore when new.key=%1 begin ").arg(TAG_GUID) +
+               "insert or ignore into TagClosure (ancestor, descendant, depth) values (new.lid, new.lid, 0); end");
+    query.exec(QString("Create trigger TagClosure_Self_Delete after delete on DataStore when old.key=%1 begin ").arg(TAG_GUID) +
+               "delete from TagClosure where ancestor=old.lid and descendant=old.lid; end");
+    query.exec(QString("Create trigger TagClosure_Insert after insert on DataStore when new.key=%1 and new.data>0 begin ").arg(TAG_PARENT_LID) +
+               link.arg("new") +"end");
+    query.exec(QString("Create trigger TagClosure_Delete after delete on DataStore when old.key=%1 and old.data>0 begin ").arg(TAG_PARENT_LID) +
+               unlink.arg("old") +"end");
+    query.exec(QString("Create trigger TagClosure_Update after update of data on DataStore when new.key=%1 begin ").arg(TAG_PARENT_LID) +
+               unlink.arg("old") +link.arg("new") +"end");
+
+    // Fill it with the tags that are there now.  The parents are copied to a
+    // small table first since recursing through the DataStore is very slow.
+    query.prepare("Insert or ignore into TagClosure (ancestor, descendant, depth) select lid, lid, 0 from DataStore where key=:key");
+    query.bindValue(":key", TAG_GUID);
+    query.exec();
+    query.exec("Create temporary table if not exists tagparents (lid integer primary key, parent integer)");
+    query.prepare("Insert or ignore into tagparents (lid, parent) select lid, data from DataStore where key=:key and data>0");
+    query.bindValue(":key", TAG_PARENT_LID);
+    query.exec();
+    query.prepare("with recursive c(ancestor, descendant, depth) as (select parent, lid, 1 from tagparents "
+                  "union all select p.parent, c.descendant, c.depth+1 from c join tagparents p on p.lid=c.ancestor where c.depth<:maxDepth) "
+                  "insert or ignore into TagClosure (ancestor, descendant, depth) select ancestor, descendant, depth from c");
+    query.bindValue(":maxDepth", TAG_CLOSURE_MAX_DEPTH);
+    query.exec();
+    query.exec("drop table tagparents");
+    if (!query.exec("commit")) {
+        QLOG_ERROR() << "Creation of TagClosure failed: " << query.lastError();
     }
     query.finish();
-    return list.size();
+    db->unlock();
 }
 
 
@@ -843,3 +913,53 @@ void TagTable::cleanupMissingParents() {
     query.finish();
     db->unlock();
 }
+
+
+
+//*****************************************************************
+//* TagModel has one row per tag with everything the tag tree needs.
+//* It used to be a view with a subquery per column, which took
+//* seconds to read with a few thousand tags.  It is now a table
+//* that triggers refresh one tag at a time when one of its values
+//* changes.  If a tag's guid changes, the tags under it get the new
+//* parent guid too.
+//*****************************************************************
+void TagTable::createModelTable() {
+    NSqlQuery query(db);
+    db->lockForWrite();
+    query.exec("Select type from sqlite_master where name='TagModel'");
+    if (query.next() && query.value(0).toString() == "table") {
+        query.finish();
+        db->unlock();
+        return;
+    }
+
+    QLOG_DEBUG() << "Creating TagModel table";
+    query.exec("begin");
+    query.exec("Drop view if exists TagModel");
+    query.exec("Create table TagModel (lid integer primary key, guid text, parent_lid integer, parent_gid text, name text collate nocase, account integer)");
+    query.exec("Create index TagModel_Parent on TagModel (parent_lid)");
+
+    // Without statistics SQLite likes the key index better, but the lid
+    // index is the one that finds a handful of rows.
+    QString value = "(select data from DataStore indexed by DataStore_Lid where lid=%1 and key=%2)";
+    QString select = QString("select lid, guid, parent_lid, ") +value.arg("parent_lid").arg(TAG_GUID) +", name, account from " +
+            "(select g.lid as lid, g.data as guid, " +value.arg("g.lid").arg(TAG_PARENT_LID) +" as parent_lid, " +
+            value.arg("g.lid").arg(TAG_NAME) +" as name, " +value.arg("g.lid").arg(TAG_OWNING_ACCOUNT) +" as account " +
+            "from DataStore g %1 where %2g.key=" +QString::number(TAG_GUID) +")";
+    QString columns = "insert or replace into TagModel (lid, guid, parent_lid, parent_gid, name, account) ";
+    QString refresh = "delete from TagModel where lid=%1.lid; " +columns +select.arg("indexed by DataStore_Lid").arg("g.lid=%1.lid and ") +"; " +
+            "update TagModel set parent_gid=" +value.arg("TagModel.parent_lid").arg(TAG_GUID) +" where parent_lid=%1.lid; ";
+    QString keys = QString("(%1,%2,%3,%4)").arg(TAG_GUID).arg(TAG_NAME).arg(TAG_PARENT_LID).arg(TAG_OWNING_ACCOUNT);
+
+    query.exec("Create trigger TagModel_Insert after insert on DataStore when new.key in " +keys +" begin " +refresh.arg("new") +"end");
+    query.exec("Create trigger TagModel_Delete after delete on DataStore when old.key in " +keys +" begin " +refresh.arg("old") +"end");
+    query.exec("Create trigger TagModel_Update after update of data on DataStore when new.key in " +keys +" begin " +refresh.arg("new") +"end");
+
+    query.exec(columns +select.arg("").arg(""));
+    if (!query.exec("commit")) {
+        QLOG_ERROR() << "Creation of TagModel failed: " << query.lastError();
+    }
+    query.finish();
+    db->unlock();
+}
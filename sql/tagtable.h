@@ -30,6 +30,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QtSql>
 #include <QString>
 #include <QList>
+#include <QHash>
 #include "sql/databaseconnection.h"
 
 
@@ -41,6 +42,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define TAG_ISDELETED               1005
 #define TAG_OWNING_ACCOUNT          1006
 
+// Tags nested deeper than this are assumed to be a loop
+#define TAG_CLOSURE_MAX_DEPTH       100
+
 using namespace std;
 
 class TagTable
@@ -57,6 +61,7 @@ public:
     qint32 findByName(string &name, qint32 account);           // Find a tag given a name
     qint32 findByName(QString &name, qint32 account);          // Find a tag given a name
     qint32 findChildren(QList<qint32> &list, QString parentGuid);
+    qint32 findChildren(QList<qint32> &list, qint32 parentLid); // Find all tags below a tag
     bool get(Tag &tag, qint32 lid);            // Get a tag given a lid
     bool get(Tag &tag, QString guid);          // get a tag given a guid
     bool get(Tag &tag, string guid);           // get a tag given a guid
@@ -97,6 +102,8 @@ public:
     void resetLinkedTagsDirty();                 // mark all linked tags as not-dirty
     void cleanupMissingParents();
     void cleanupLinkedTags();
+    void createClosureTable();                   // Create the tag closure table & its triggers
+    void createModelTable();                     // Create the TagModel table & its triggers
 };
 
 #endif // TAGTABLE_H
@@ -0,0 +1,266 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "trigramtable.h"
+#include "sql/nsqlquery.h"
+#include "global.h"
+#include "utilities/textfolding.h"
+
+extern Global global;
+
+// Words longer than this are usually URLs or encoded junk.  They would add
+// a lot of trigrams that nobody ever searches for, so they are skipped.
+#define TRIGRAM_MAX_WORD_LENGTH     64
+
+
+// Default constructor
+TrigramTable::TrigramTable(DatabaseConnection *db)
+{
+    this->db = db;
+}
+
+
+
+// Create the trigram tables.  They are always created, but only filled when
+// the user has turned the trigram index on.
+void TrigramTable::createTable() {
+    NSqlQuery sql(db);
+    db->lockForWrite();
+    if (!sql.exec("Create table if not exists TrigramWords (wid integer primary key, word text unique, trigrams integer)")) {
+        QLOG_ERROR() << "Creation of TrigramWords table failed: " << sql.lastError();
+    }
+
+    // These are "without rowid" so the primary key is the table.  A separate
+    // index would double the size of the two biggest tables.
+    if (!sql.exec("Create table if not exists TrigramIndex (trigram text, wid integer, primary key (trigram, wid)) without rowid")) {
+        QLOG_ERROR() << "Creation of TrigramIndex table failed: " << sql.lastError();
+    }
+    if (!sql.exec("Create table if not exists TrigramNotes (wid integer, lid integer, primary key (wid, lid)) without rowid")) {
+        QLOG_ERROR() << "Creation of TrigramNotes table failed: " << sql.lastError();
+    }
+    sql.exec("CREATE INDEX if not exists TrigramNotes_Lid on TrigramNotes (lid)");
+    sql.finish();
+    db->unlock();
+}
+
+
+
+// Empty the index.  This is done when the user turns it off so we
+// don't keep the space around.
+void TrigramTable::clear() {
+    NSqlQuery sql(db);
+    db->lockForWrite();
+    sql.exec("delete from TrigramNotes");
+    sql.exec("delete from TrigramIndex");
+    sql.exec("delete from TrigramWords");
+    sql.finish();
+    db->unlock();
+}
+
+
+
+// Split some text into a list of distinct lower case (or folded) words.
+QStringList TrigramTable::words(QString content) {
+    QStringList retval;
+    QSet<QString> found;
+    QString word;
+    content = TextFolding::normalize(content);
+    for (int i=0; i<=content.length(); i++) {
+        if (i<content.length() && content[i].isLetterOrNumber()) {
+            word.append(content[i]);
+            continue;
+        }
+        if (word.length() > 1 && word.length() <= TRIGRAM_MAX_WORD_LENGTH && !found.contains(word)) {
+            found.insert(word);
+            retval.append(word);
+        }
+        word.clear();
+    }
+    return retval;
+}
+
+
+
+// Get the distinct trigrams for a word.  Padded trigrams (two spaces in
+// front, one behind) are what is stored, so short words still have a few
+// trigrams and the start of a word counts more than the end.  Unpadded
+// trigrams are used for infix searches, since the fragment can be anywhere
+// in the word.
+QStringList TrigramTable::trigrams(QString word, bool padded) {
+    QStringList retval;
+    if (padded)
+        word = QString("  ") + word + QString(" ");
+    for (int i=0; i+3<=word.length(); i++) {
+        QString trigram = word.mid(i,3);
+        if (!retval.contains(trigram))
+            retval.append(trigram);
+    }
+    return retval;
+}
+
+
+
+// Find a word in the vocabulary.  If it isn't there, add it along
+// with its trigrams.
+qint32 TrigramTable::getWordId(QString word) {
+    NSqlQuery sql(db);
+    sql.prepare("Select wid from TrigramWords where word=:word");
+    sql.bindValue(":word", word);
+    sql.exec();
+    if (sql.next())
+        return sql.value(0).toInt();
+
+    QStringList grams = trigrams(word, true);
+    sql.prepare("Insert into TrigramWords (word, trigrams) values (:word, :trigrams)");
+    sql.bindValue(":word", word);
+    sql.bindValue(":trigrams", grams.size());
+    if (!sql.exec())
+        return -1;
+    qint32 wid = sql.lastInsertId().toInt();
+
+    sql.prepare("Insert or ignore into TrigramIndex (trigram, wid) values (:trigram, :wid)");
+    for (int i=0; i<grams.size(); i++) {
+        sql.bindValue(":trigram", grams[i]);
+        sql.bindValue(":wid", wid);
+        sql.exec();
+    }
+    return wid;
+}
+
+
+
+// Index a note's text.  Any old entries for the note are replaced.  The caller
+// is expected to have a transaction open; the index runner does this in bulk.
+void TrigramTable::index(qint32 lid, QString content) {
+    QStringList list = words(content);
+    db->lockForWrite();
+    NSqlQuery sql(db);
+    sql.prepare("Delete from TrigramNotes where lid=:lid");
+    sql.bindValue(":lid", lid);
+    sql.exec();
+
+    sql.prepare("Insert or ignore into TrigramNotes (wid, lid) values (:wid, :lid)");
+    for (int i=0; i<list.size(); i++) {
+        qint32 wid = getWordId(list[i]);
+        if (wid <= 0)
+            continue;
+        sql.bindValue(":wid", wid);
+        sql.bindValue(":lid", lid);
+        sql.exec();
+    }
+    sql.finish();
+    db->unlock();
+}
+
+
+
+// Remove a note from the index.  The words are left in the vocabulary since
+// another note is probably using them.
+void TrigramTable::expunge(qint32 lid) {
+    NSqlQuery sql(db);
+    db->lockForWrite();
+    sql.prepare("Delete from TrigramNotes where lid=:lid");
+    sql.bindValue(":lid", lid);
+    sql.exec();
+    sql.finish();
+    db->unlock();
+}
+
+
+
+// Build a list of bind variables for a set of trigrams.  Used
+// for the "trigram in (...)" part of the queries below.
+static QString trigramBindList(int count) {
+    QStringList binds;
+    for (int i=0; i<count; i++)
+        binds.append(QString(":t")+QString::number(i));
+    return binds.join(",");
+}
+
+
+
+// Find all notes containing a word similar to the one given.  Similarity is the
+// number of shared trigrams divided by the number of distinct trigrams in both
+// words, so "serch" matches "search" (0.44).  Words that
+// have too few or too many trigrams to ever reach the threshold are skipped
+// before counting.  Returns the number of notes found.
+qint32 TrigramTable::findFuzzy(QString word, double threshold, QList<qint32> &lids) {
+    lids.clear();
+    QStringList grams = trigrams(TextFolding::normalize(word).trimmed(), true);
+    if (grams.size() == 0 || threshold <= 0)
+        return 0;
+    int count = grams.size();
+
+    NSqlQuery sql(db);
+    db->lockForRead();
+    sql.prepare(QString("Select distinct lid from TrigramNotes where wid in ") +
+                QString("(select t.wid from TrigramIndex t join TrigramWords w on w.wid=t.wid ") +
+                QString("where t.trigram in (") +trigramBindList(count) +QString(") ") +
+                QString("and w.trigrams between :min and :max ") +
+                QString("group by t.wid, w.trigrams ") +
+                QString("having count(*)*1.0/(:count+w.trigrams-count(*)) >= :threshold)"));
+    for (int i=0; i<count; i++)
+        sql.bindValue(QString(":t")+QString::number(i), grams[i]);
+    sql.bindValue(":min", qint32(count*threshold));
+    sql.bindValue(":max", qint32(count/threshold)+1);
+    sql.bindValue(":count", count);
+    sql.bindValue(":threshold", threshold);
+    sql.exec();
+    while (sql.next())
+        lids.append(sql.value(0).toInt());
+    sql.finish();
+    db->unlock();
+    return lids.size();
+}
+
+
+
+// Find all notes with a word containing a fragment of text.  Words must have every
+// trigram of the fragment, and are then checked with a "like" against just the
+// matching words rather than the whole SearchIndex.  Fragments shorter than three
+// characters have no trigrams, so -1 is returned and the caller needs to fall
+// back to the old way.
+qint32 TrigramTable::findInfix(QString fragment, QList<qint32> &lids) {
+    lids.clear();
+    fragment = TextFolding::normalize(fragment).trimmed();
+    QStringList grams = trigrams(fragment, false);
+    if (grams.size() == 0)
+        return -1;
+    int count = grams.size();
+    QString like = fragment;
+    like = QString("%") + like.replace("/","//").replace("%","/%").replace("_","/_") + QString("%");
+
+    NSqlQuery sql(db);
+    db->lockForRead();
+    sql.prepare(QString("Select distinct lid from TrigramNotes where wid in ") +
+                QString("(select t.wid from TrigramIndex t join TrigramWords w on w.wid=t.wid ") +
+                QString("where t.trigram in (") +trigramBindList(count) +QString(") ") +
+                QString("group by t.wid, w.word ") +
+                QString("having count(*)=:count and w.word like :like escape '/')"));
+    for (int i=0; i<count; i++)
+        sql.bindValue(QString(":t")+QString::number(i), grams[i]);
+    sql.bindValue(":count", count);
+    sql.bindValue(":like", like);
+    sql.exec();
+    while (sql.next())
+        lids.append(sql.value(0).toInt());
+    sql.finish();
+    db->unlock();
+    return lids.size();
+}
@@ -0,0 +1,62 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef TRIGRAMTABLE_H
+#define TRIGRAMTABLE_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QSet>
+#include "sql/databaseconnection.h"
+
+// Minimum similarity for a fuzzy: match.  This is the number of shared
+// trigrams divided by the number of distinct trigrams in both words.
+#define TRIGRAM_FUZZY_THRESHOLD     0.3
+
+
+//*****************************************************************
+//* The trigram index is an optional side index over the note text
+//* (the same text that goes into SearchIndex with a source of
+//* 'text', so it includes the title).  Every distinct word is kept
+//* once in TrigramWords, its padded trigrams are in TrigramIndex and
+//* TrigramNotes maps words back to the notes they appear in.  It is
+//* used for typo tolerant (fuzzy:) searches and for infix (*word)
+//* searches, which FTS can't do without a full table scan.
+//*****************************************************************
+class TrigramTable
+{
+private:
+    DatabaseConnection *db;
+    qint32 getWordId(QString word);                          // Find or add a word in the vocabulary
+
+public:
+    TrigramTable(DatabaseConnection *db);                    // Constructor
+    void createTable();                                      // Create the tables if they don't exist
+    void clear();                                            // Remove everything from the index
+    void index(qint32 lid, QString content);                 // (Re)index the text of a note
+    void expunge(qint32 lid);                                // Remove a note from the index
+    qint32 findFuzzy(QString word, double threshold, QList<qint32> &lids);  // Notes with words similar to "word"
+    qint32 findInfix(QString fragment, QList<qint32> &lids); // Notes with words containing "fragment"
+
+    static QStringList words(QString content);               // Split text into distinct lower case words
+    static QStringList trigrams(QString word, bool padded);  // Get the distinct trigrams of a word
+};
+
+#endif // TRIGRAMTABLE_H
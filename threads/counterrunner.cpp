@@ -24,11 +24,18 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "sql/tagtable.h"
 
 #include <QtSql>
+#include <QElapsedTimer>
 
 CounterRunner::CounterRunner(QObject *parent) :
     QObject(parent)
 {
     init = false;
+    timer = NULL;
+    notebooksPending = false;
+    tagsPending = false;
+    trashPending = false;
+    countsVersion = -1;
+    qRegisterMetaType<CounterTotals>("CounterTotals");
 }
 
 
@@ -38,120 +45,220 @@ void CounterRunner::initialize() {
     init = true;
     QLOG_DEBUG() << "Starting CounterRunner";
     db = new DatabaseConnection("counterrunner");
+
+    // Used to pass the notes that entered or left the filter
+    NSqlQuery query(db);
+    query.exec("create temporary table if not exists counterlids (lid integer)");
+    query.finish();
+
+    // This is created here so it belongs to the counter thread
+    timer = new QTimer(this);
+    timer->setSingleShot(true);
+    timer->setInterval(COUNTER_COALESCE_MSECS);
+    connect(timer, SIGNAL(timeout()), this, SLOT(countPending()));
     QLOG_DEBUG() << "CounterRunner initialization complete.";
 }
 
 
+
+//*****************************************************
+//* Count requests come in bunches (a selection change
+//* and a note save can each ask for several counts),
+//* so they only set a flag and start a timer.  When
+//* the timer fires everything asked for is counted
+//* once and sent as one batch.
+//*****************************************************
+void CounterRunner::schedule() {
+    if (!init)
+        initialize();
+    if (!timer->isActive())
+        timer->start();
+    global.workMetrics.setBacklog("counter", int(notebooksPending) + int(tagsPending) + int(trashPending));
+}
+
+
 void CounterRunner::countAll() {
     if (global.countBehavior == Global::CountNone)
         return;
-    QLOG_TRACE_IN();
-    if (!init)
-        initialize();
-    this->countNotebooks();
-    this->countTags();
-    this->countTrash();
-    QLOG_TRACE_OUT();
+    notebooksPending = true;
+    tagsPending = true;
+    trashPending = true;
+    schedule();
 }
 
 
 void CounterRunner::countTrash() {
     if (global.countBehavior == Global::CountNone)
         return;
-    QLOG_TRACE_IN();
-    if (!init)
-        initialize();
-    NoteTable ntable(db);
-    QList<qint32> lids;
-    emit trashTotals(ntable.getAllDeleted(lids));
-    QLOG_TRACE_OUT();
+    trashPending = true;
+    schedule();
 }
 
 
 void CounterRunner::countNotebooks() {
     if (global.countBehavior == Global::CountNone)
         return;
+    notebooksPending = true;
+    schedule();
+}
 
-    QLOG_TRACE_IN();
-    if (!init)
-        initialize();
 
-    // First get every possible notebook
-    NotebookTable nTable(db);
-    QList<qint32> lids;
-    nTable.getAll(lids);
+void CounterRunner::countTags() {
+    if (global.countBehavior == Global::CountNone)
+        return;
+    tagsPending = true;
+    schedule();
+}
 
-    // Next, get the totals of everything possible
-    QHash<qint32, qint32> allNotebooks;
-    for (int i=0; i<lids.size(); i++) {
-        allNotebooks.insert(lids.at(i), 0);
+
+
+// Do the counts that have been asked for since the last time.
+void CounterRunner::countPending() {
+    QLOG_TRACE_IN();
+    bool notebooks = notebooksPending;
+    bool tags = tagsPending;
+    bool trash = trashPending;
+    notebooksPending = false;
+    tagsPending = false;
+    trashPending = false;
+    global.workMetrics.setBacklog("counter", 0);
+    QElapsedTimer timer;
+    timer.start();
+
+    if (notebooks || tags) {
+        countSubTotals();
+        global.workMetrics.timing("counter", "subtotals", timer.restart());
     }
 
-    NSqlQuery query(db);
-    query.exec(" select data, count(data) from datastore where key=5011 and lid not in (select lid from datastore where data=0 and key=5010) group by data;");
-    while (query.next()) {
-        qint32 lid = query.value(0).toInt();
-        qint32 total = query.value(1).toInt();
-        allNotebooks[lid] = total;
+    if (notebooks) {
+        NotebookTable nTable(db);
+        QList<qint32> lids;
+        nTable.getAll(lids);
+        emitTotals(NOTE_NOTEBOOK_LID, lids, notebookSubTotals);
+        global.workMetrics.timing("counter", "notebooks", timer.restart());
     }
 
-    query.exec("select notebooklid, count(notebooklid) from notetable where lid in (select lid from filter) and lid not in (select lid from datastore where data=0 and key=5010) group by notebooklid;");
+    if (tags) {
+        TagTable tTable(db);
+        QList<qint32> lids;
+        tTable.getAll(lids);
+        emitTotals(NOTE_TAG_LID, lids, tagSubTotals);
 
-    while(query.next()) {
-        qint32 lid = query.value(0).toInt();
-        emit notebookTotals(lid, query.value(1).toInt(), allNotebooks[lid]);
-        lids.removeAll(lid);
+        // Finally, emit that we are done so unassigned tags can be hidden
+        emit(tagCountComplete());
+        global.workMetrics.timing("counter", "tags", timer.restart());
     }
 
-    // The ones that are left have a zero count
-    for (int i=0; i<lids.size(); i++)
-        emit(notebookTotals(lids[i], 0, allNotebooks[lids[i]]));
-
-    emit(notebookTotals(-1, -1, -1));
+    if (trash) {
+        NoteTable ntable(db);
+        QHash<qint32, qint32> totals;
+        ntable.getNoteCounts(NOTE_ACTIVE, totals);
+        emit trashTotals(totals.value(0));
+        global.workMetrics.timing("counter", "trash", timer.restart());
+    }
+    global.workMetrics.done("counter", int(notebooks) + int(tags) + int(trash), 0);
     QLOG_TRACE_OUT();
 }
 
 
-void CounterRunner::countTags() {
-    if (global.countBehavior == Global::CountNone)
+
+// Count the notebooks & tags of the notes in a table of lids.  Starting from
+// the lids lets SQLite use the DataStore lid index rather than reading every
+// notebook & tag assignment and the whole trash.
+static QString subTotalQuery = QString("select d.key, d.data, count(*) from %1 c cross join datastore d on d.lid=c.lid ") +
+        QString("where d.key in (:notebookKey, :tagKey) and not exists ") +
+        QString("(select 1 from datastore t where t.lid=c.lid and t.key=:activeKey and t.data=0) group by d.key, d.data");
+
+
+
+//*****************************************************
+//* Get the notebook & tag counts for the notes in the
+//* filter.  If no notes have changed since the last
+//* count, only the notes that have entered or left the
+//* filter are looked at.  Otherwise, or if most of the
+//* filter is different, everything is counted again.
+//*****************************************************
+void CounterRunner::countSubTotals() {
+    NoteTable ntable(db);
+    qint32 version = ntable.getNoteCountsVersion();
+
+    QSet<qint32> current;
+    NSqlQuery query(db);
+    query.exec("select lid from filter");
+    while (query.next())
+        current.insert(query.value(0).toInt());
+    query.finish();
+
+    QList<qint32> added = (current - filterLids).toList();
+    QList<qint32> removed = (filterLids - current).toList();
+    bool delta = (version == countsVersion && added.size()+removed.size() < current.size());
+    filterLids = current;
+    countsVersion = version;
+
+    if (delta) {
+        adjustSubTotals(added, 1);
+        adjustSubTotals(removed, -1);
         return;
-    QLOG_TRACE_IN();
-    if (!init)
-        initialize();
-    // First get every possible tag
-    TagTable tTable(db);
-    QList<qint32> lids;
-    tTable.getAll(lids);
+    }
 
-    // Next, get the totals of everything possible
-    QHash<qint32, qint32> allTags;
-    for (int i=0; i<lids.size(); i++) {
-        allTags.insert(lids.at(i), 0);
+    notebookSubTotals.clear();
+    tagSubTotals.clear();
+    query.prepare(subTotalQuery.arg("filter"));
+    query.bindValue(":notebookKey", NOTE_NOTEBOOK_LID);
+    query.bindValue(":tagKey", NOTE_TAG_LID);
+    query.bindValue(":activeKey", NOTE_ACTIVE);
+    query.exec();
+    while (query.next()) {
+        if (query.value(0).toInt() == NOTE_NOTEBOOK_LID)
+            notebookSubTotals.insert(query.value(1).toInt(), query.value(2).toInt());
+        else
+            tagSubTotals.insert(query.value(1).toInt(), query.value(2).toInt());
     }
+    query.finish();
+}
+
 
+
+// Add (or subtract) the notebooks & tags of some notes to the filter counts.
+void CounterRunner::adjustSubTotals(QList<qint32> &lids, qint32 delta) {
+    if (lids.size() == 0)
+        return;
     NSqlQuery query(db);
-    query.exec(" select data, count(data) from datastore where key=5012 and lid not in (select lid from datastore where data=0 and key=5010) group by data;");
-    while (query.next()) {
-        qint32 lid = query.value(0).toInt();
-        qint32 total = query.value(1).toInt();
-        allTags[lid] = total;
+    query.exec("begin");
+    query.exec("delete from counterlids");
+    query.prepare("insert into counterlids (lid) values (:lid)");
+    for (int i=0; i<lids.size(); i++) {
+        query.bindValue(":lid", lids[i]);
+        query.exec();
     }
+    query.exec("commit");
 
-    // Start counting
-    query.prepare("select data, count(lid) from datastore where key=:key and lid in (select lid from filter) and lid not in (select lid from datastore where data=0 and key=5010) group by data;");
-    query.bindValue(":key", NOTE_TAG_LID);
+    query.prepare(subTotalQuery.arg("counterlids"));
+    query.bindValue(":notebookKey", NOTE_NOTEBOOK_LID);
+    query.bindValue(":tagKey", NOTE_TAG_LID);
+    query.bindValue(":activeKey", NOTE_ACTIVE);
     query.exec();
-    while(query.next()) {
-        qint32 lid = query.value(0).toInt();
-        emit tagTotals(lid, query.value(1).toInt(), allTags[lid]);
-        lids.removeAll(lid);
+    while (query.next()) {
+        QHash<qint32, qint32> &subTotals = (query.value(0).toInt() == NOTE_NOTEBOOK_LID ? notebookSubTotals : tagSubTotals);
+        qint32 lid = query.value(1).toInt();
+        subTotals[lid] = subTotals.value(lid) + delta*query.value(2).toInt();
     }
+    query.finish();
+}
 
-    // The ones that are left have a zero count, so we reset them
-    for (int i=0; i<lids.size(); i++)
-        emit(tagTotals(lids[i], 0, allTags[lids[i]]));
 
-    // Finally, emit that we are done so unassigned tags can be hidden
-    emit(tagCountComplete());
-    QLOG_TRACE_OUT();
+
+// Send the counts for every notebook or tag in one signal.
+void CounterRunner::emitTotals(qint32 key, QList<qint32> &lids, QHash<qint32, qint32> &subTotals) {
+    NoteTable ntable(db);
+    QHash<qint32, qint32> totals;
+    ntable.getNoteCounts(key, totals);
+
+    CounterTotals batch;
+    for (int i=0; i<lids.size(); i++)
+        batch.insert(lids[i], qMakePair(subTotals.value(lids[i]), totals.value(lids[i])));
+    if (key == NOTE_NOTEBOOK_LID)
+        emit notebookTotals(batch);
+    else
+        emit tagTotals(batch);
 }
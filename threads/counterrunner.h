@@ -24,29 +24,54 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "global.h"
 #include <QPair>
 #include <QList>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QMetaType>
 #include "sql/databaseconnection.h"
 
 extern Global global;
 
+// Counts for a batch of notebooks or tags, keyed by lid.  The
+// first number is the count for the current filter, the second
+// is the total.
+typedef QHash<qint32, QPair<qint32, qint32> > CounterTotals;
+Q_DECLARE_METATYPE(CounterTotals)
+
+// How long to wait for more count requests before counting
+#define COUNTER_COALESCE_MSECS  100
+
 class CounterRunner : public QObject
 {
     Q_OBJECT
 private:
-    QList<QPair<qint32, qint32>*> *notebookCounts;
-    QList<QPair<qint32, qint32>*> *tagCounts;
-    qint32 trashCounts;
     DatabaseConnection *db;
     void initialize();
     bool init;
 
+    QTimer *timer;                           // Coalesces count requests
+    bool notebooksPending;
+    bool tagsPending;
+    bool trashPending;
+
+    QSet<qint32> filterLids;                 // The filter we last counted
+    QHash<qint32, qint32> notebookSubTotals; // Notebook counts for filterLids
+    QHash<qint32, qint32> tagSubTotals;      // Tag counts for filterLids
+    qint32 countsVersion;                    // NoteCounts version the subtotals match
+
+    void schedule();
+    void countSubTotals();
+    void adjustSubTotals(QList<qint32> &lids, qint32 delta);
+    void emitTotals(qint32 key, QList<qint32> &lids, QHash<qint32, qint32> &subTotals);
+
 public:
     explicit CounterRunner(QObject *parent = 0);
     bool keepRunning;
     
 signals:
     void trashTotals(qint32);
-    void notebookTotals(qint32, qint32, qint32);
-    void tagTotals(qint32, qint32, qint32);
+    void notebookTotals(CounterTotals);
+    void tagTotals(CounterTotals);
     void tagCountComplete();
     
 public slots:
@@ -54,6 +79,7 @@ public slots:
     void countTrash();
     void countNotebooks();
     void countTags();
+    void countPending();
     
 };
 
@@ -0,0 +1,180 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "indexaccumulator.h"
+#include "global.h"
+#include "sql/databaseconnection.h"
+#include "sql/nsqlquery.h"
+#include "sql/resourcetable.h"
+#include "sql/trigramtable.h"
+#include "utilities/textfolding.h"
+#include <QSet>
+#include <QStringList>
+
+extern Global global;
+
+
+
+IndexAccumulator::IndexAccumulator() {
+}
+
+
+
+// Add what a worker found for a note or resource.  A result with no text
+// still gets an (empty) document so the old text is removed when it is
+// written.
+void IndexAccumulator::add(IndexResult *result) {
+    QSet<IndexKey> replaced;
+    IndexKey own(result->noteLid, result->resource ? "recognition" : "text",
+                 result->resource ? result->lid : 0);
+    documents[own].text.clear();
+    replaced.insert(own);
+
+    for (int i=0; i<result->records.size(); i++) {
+        IndexRecord *rec = result->records[i];
+        if (rec->content.trimmed() == "")
+            continue;
+        IndexKey key(rec->lid, rec->source, rec->resource);
+        IndexDocument &doc = documents[key];
+        if (!replaced.contains(key)) {
+            doc.text.clear();
+            replaced.insert(key);
+        }
+        QString &text = doc.text[rec->weight];
+        if (text != "")
+            text.append(QChar(' '));
+        text.append(rec->content);
+    }
+}
+
+
+
+qint32 IndexAccumulator::size() {
+    qint32 rows = 0;
+    QHash<IndexKey, IndexDocument>::const_iterator i;
+    for (i=documents.constBegin(); i!=documents.constEnd(); ++i)
+        rows = rows + qMax(1, i.value().text.size());
+    return rows;
+}
+
+
+bool IndexAccumulator::isEmpty() {
+    return documents.isEmpty();
+}
+
+
+
+// Write every document.  The old rows for a key are deleted and the new
+// ones inserted with statements that are only prepared once.  FTS columns
+// have no index, so a plain "where lid=:lid" reads the whole table.  The
+// match on the lid & source columns finds the rows through the full text
+// index instead.
+void IndexAccumulator::write(DatabaseConnection *db) {
+    NSqlQuery del(db), ins(db), legacy(db), delText(db), insText(db);
+    TrigramTable trigramTable(db);
+    del.prepare("Delete from SearchIndex where SearchIndex match :terms and lid=:lid and source=:source");
+    ins.prepare("Insert into SearchIndex (lid, weight, source, content) values (:lid, :weight, :source, :content)");
+
+    // With folding on, the text as written is kept in SearchText for snippets
+    bool folding = TextFolding::enabled();
+    delText.prepare("Delete from SearchText where docid in (select docid from SearchIndex where SearchIndex match :terms and lid=:lid and source=:source)");
+    insText.prepare("Insert or replace into SearchText (docid, original) values (last_insert_rowid(), :original)");
+
+    // Resource text used to be stored under the note lid, one word at a time.
+    // Those rows hold every resource of the note, so the ones that aren't
+    // being written now have to be indexed again once they're gone.
+    QSet<qint32> legacyNotes;
+    legacy.prepare("Delete from SearchIndex where SearchIndex match :terms and lid=:lid and source='recognition'");
+
+    QHash<IndexKey, IndexDocument>::const_iterator i;
+    for (i=documents.constBegin(); i!=documents.constEnd(); ++i) {
+        const IndexKey &key = i.key();
+        qint32 lid = key.resource > 0 ? key.resource : key.lid;
+        QString terms = QString("lid:") + QString::number(lid) + QString(" source:") + key.source;
+        if (folding) {
+            delText.bindValue(":terms", terms);
+            delText.bindValue(":lid", lid);
+            delText.bindValue(":source", key.source);
+            delText.exec();
+        }
+        del.bindValue(":terms", terms);
+        del.bindValue(":lid", lid);
+        del.bindValue(":source", key.source);
+        del.exec();
+        if (key.resource > 0 && key.lid > 0) {
+            legacy.bindValue(":terms", QString("lid:") + QString::number(key.lid) + QString(" source:recognition"));
+            legacy.bindValue(":lid", key.lid);
+            legacy.exec();
+            if (legacy.numRowsAffected() > 0)
+                legacyNotes.insert(key.lid);
+        }
+
+        QMap<qint32, QString>::const_iterator j;
+        for (j=i.value().text.constBegin(); j!=i.value().text.constEnd(); ++j) {
+            ins.bindValue(":lid", lid);
+            ins.bindValue(":weight", j.key());
+            ins.bindValue(":source", key.source);
+            ins.bindValue(":content", TextFolding::index(j.value()));
+            ins.exec();
+            if (folding) {
+                insText.bindValue(":original", j.value());
+                insText.exec();
+            }
+        }
+
+        // Keep the trigram index in step with the note text
+        if (global.trigramIndex && key.resource == 0 && key.source == "text")
+            trigramTable.index(key.lid, QStringList(i.value().text.values()).join(" "));
+    }
+    del.finish();
+    ins.finish();
+    legacy.finish();
+    delText.finish();
+    insText.finish();
+
+    // Only the flag is set.  ResourceTable::setIndexNeeded() would index
+    // the resource right here, on the runner's thread, and then clear it.
+    ResourceTable resourceTable(db);
+    NSqlQuery flag(db);
+    QSet<qint32>::const_iterator n;
+    for (n=legacyNotes.constBegin(); n!=legacyNotes.constEnd(); ++n) {
+        QList<qint32> resources;
+        resourceTable.getResourceList(resources, *n);
+        for (int k=0; k<resources.size(); k++) {
+            if (documents.contains(IndexKey(*n, "recognition", resources[k])))
+                continue;
+            QLOG_DEBUG() << "Resource " << resources[k] << " lost its legacy index text.  Indexing it again.";
+            flag.prepare("Delete from DataStore where lid=:lid and key=:key");
+            flag.bindValue(":lid", resources[k]);
+            flag.bindValue(":key", RESOURCE_INDEX_NEEDED);
+            flag.exec();
+            flag.prepare("Insert into DataStore (lid, key, data) values (:lid, :key, 1)");
+            flag.bindValue(":lid", resources[k]);
+            flag.bindValue(":key", RESOURCE_INDEX_NEEDED);
+            flag.exec();
+        }
+    }
+    flag.finish();
+}
+
+
+
+void IndexAccumulator::clear() {
+    documents.clear();
+}
@@ -0,0 +1,92 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef INDEXACCUMULATOR_H
+#define INDEXACCUMULATOR_H
+
+#include <QHash>
+#include <QMap>
+#include <QList>
+#include <QString>
+#include "threads/indexjob.h"
+
+class DatabaseConnection;
+
+
+// What a SearchIndex document belongs to: the note's text, or one of
+// its resources.
+class IndexKey
+{
+public:
+    qint32 lid;           // Note lid
+    QString source;       // "text" or "recognition"
+    qint32 resource;      // Resource lid, 0 for the note's own text
+    IndexKey(qint32 lid, QString source, qint32 resource) {
+        this->lid = lid;
+        this->source = source;
+        this->resource = resource;
+    }
+    bool operator==(const IndexKey &other) const {
+        return lid == other.lid && resource == other.resource && source == other.source;
+    }
+};
+
+inline uint qHash(const IndexKey &key) {
+    return qHash(key.lid) ^ (qHash(key.resource) << 1) ^ qHash(key.source);
+}
+
+
+// All the text for one key.  Recognition alternatives have their own
+// confidence, so the text is kept by weight to let the minimum
+// recognition weight still filter them.
+class IndexDocument
+{
+public:
+    QMap<qint32, QString> text;      // weight -> text with that weight
+};
+
+
+
+//*****************************************************************
+//* Collect what the index workers find until it is written.  A
+//* resource's file name, url, recognition alternatives, PDF and
+//* attachment text all go in one document, written as one row per
+//* weight.  Indexing the same note or resource again before the
+//* cache is written replaces what was there.
+//*
+//* Resource text is stored under the resource lid, the same as
+//* NoteIndexer does.  The filters find the note through the
+//* resource's note lid, so each resource can be replaced without
+//* touching the note's other resources.
+//*****************************************************************
+class IndexAccumulator
+{
+private:
+    QHash<IndexKey, IndexDocument> documents;
+
+public:
+    IndexAccumulator();
+    void add(IndexResult *result);           // Add (or replace) what a worker found
+    qint32 size();                           // Number of rows waiting to be written
+    bool isEmpty();
+    void write(DatabaseConnection *db);      // Write everything.  The caller handles the transaction.
+    void clear();
+};
+
+#endif // INDEXACCUMULATOR_H
@@ -0,0 +1,368 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "indexjob.h"
+#include "global.h"
+#include "html/enmltext.h"
+#include "utilities/officetext.h"
+#include "utilities/pdftextcache.h"
+#include <QThread>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QDir>
+#include <QtXml>
+#if QT_VERSION < 0x050000
+#include <poppler-qt4.h>
+#else
+#include <poppler-qt5.h>
+#endif
+
+extern Global global;
+
+
+IndexResult::IndexResult() {
+    lid = 0;
+    noteLid = 0;
+    resource = false;
+}
+
+
+IndexResult::~IndexResult() {
+    qDeleteAll(records);
+}
+
+
+qint64 IndexResult::size() {
+    qint64 total = sizeof(IndexResult);
+    for (int i=0; i<records.size(); i++)
+        total = total + sizeof(IndexRecord) + records[i]->content.size()*sizeof(QChar);
+    return total;
+}
+
+
+
+
+IndexQueue::IndexQueue(qint64 maxBytes) {
+    this->maxBytes = maxBytes;
+    bytes = 0;
+    cancelled = false;
+}
+
+
+IndexQueue::~IndexQueue() {
+    qDeleteAll(results);
+}
+
+
+
+// Add a result.  If the queue is full, wait for the index thread to take
+// some.  A result bigger than the whole queue is still let in when the
+// queue is empty, otherwise it would wait forever.
+void IndexQueue::put(IndexResult *result) {
+    qint64 size = result->size();
+    QMutexLocker locker(&mutex);
+    while (!cancelled && bytes > 0 && bytes+size > maxBytes)
+        notFull.wait(&mutex);
+    if (cancelled) {
+        delete result;
+        return;
+    }
+    results.append(result);
+    bytes = bytes + size;
+    notEmpty.wakeAll();
+}
+
+
+
+// Take everything that is waiting.  If nothing is, wait up to msecs
+// for something to show up.
+QList<IndexResult*> IndexQueue::take(int msecs) {
+    QMutexLocker locker(&mutex);
+    if (results.size() == 0 && !cancelled && msecs > 0)
+        notEmpty.wait(&mutex, msecs);
+    QList<IndexResult*> retval = results;
+    results.clear();
+    bytes = 0;
+    notFull.wakeAll();
+    return retval;
+}
+
+
+
+// Throw away anything waiting and anything put from now on.  Used when
+// indexing is being shut down so the workers don't block.
+void IndexQueue::cancel() {
+    QMutexLocker locker(&mutex);
+    cancelled = true;
+    qDeleteAll(results);
+    results.clear();
+    bytes = 0;
+    notFull.wakeAll();
+    notEmpty.wakeAll();
+}
+
+
+void IndexQueue::reset() {
+    QMutexLocker locker(&mutex);
+    cancelled = false;
+}
+
+
+bool IndexQueue::isCancelled() {
+    QMutexLocker locker(&mutex);
+    return cancelled;
+}
+
+
+
+
+// Job for a note's text
+IndexJob::IndexJob(IndexQueue *queue, qint32 lid, Note &n) {
+    this->queue = queue;
+    this->note = n;
+    this->noteLid = lid;
+    this->resourceLid = 0;
+    this->officeFound = false;
+    result = NULL;
+}
+
+
+// Job for a resource's recognition data, PDF text or attachment text
+IndexJob::IndexJob(IndexQueue *queue, qint32 noteLid, qint32 resourceLid, Resource &r, bool officeFound) {
+    this->queue = queue;
+    this->resource = r;
+    this->noteLid = noteLid;
+    this->resourceLid = resourceLid;
+    this->officeFound = officeFound;
+    result = NULL;
+}
+
+
+
+void IndexJob::run() {
+    // Extraction is background work.  Let the GUI & sync have the CPU first.
+    QThread::currentThread()->setPriority(QThread::LowestPriority);
+
+    result = new IndexResult();
+    result->noteLid = noteLid;
+    QElapsedTimer timer;
+    timer.start();
+    if (resourceLid > 0) {
+        result->lid = resourceLid;
+        result->resource = true;
+        indexRecognition();
+        global.workMetrics.timing("index", "recognition", timer.restart());
+        QString mime = "";
+        if (resource.mime.isSet())
+            mime = resource.mime;
+        if (mime == "application/pdf") {
+            indexPdf();
+            global.workMetrics.timing("index", "pdf", timer.elapsed());
+        } else if (mime.startsWith("application", Qt::CaseInsensitive) ||
+                 mime == "text/plain" || mime == "text/html") {
+            indexAttachment();
+            global.workMetrics.timing("index", "attachment", timer.elapsed());
+        }
+    } else {
+        result->lid = noteLid;
+        indexNote();
+        global.workMetrics.timing("index", "note", timer.elapsed());
+    }
+    queue->put(result);
+    result = NULL;
+}
+
+
+
+void IndexJob::add(QString content, QString source, qint32 weight) {
+    IndexRecord *rec = new IndexRecord();
+    rec->lid = noteLid;
+    rec->resource = resourceLid;
+    rec->content = content;
+    rec->source = source;
+    rec->weight = weight;
+    result->records.append(rec);
+}
+
+
+
+// This indexes the actual note.
+void IndexJob::indexNote() {
+    if (note.title.isSet()) {
+        QLOG_DEBUG() << "Indexing note: " << note.title;
+    }
+
+    QString content = "";
+    if (note.content.isSet())
+        content = note.content;
+    QString title  = "";
+    if (note.title.isSet())
+        title = note.title;
+    add(EnmlText::toText(content) + " " + title, "text", 100);
+}
+
+
+
+// Index a resource's file name, url & recognition text
+void IndexJob::indexRecognition() {
+    if (queue->isCancelled())
+        return;
+
+    // Add filename or source url to search index
+    if (resource.attributes.isSet()) {
+        ResourceAttributes a = resource.attributes;
+        if (a.fileName.isSet())
+            add(a.fileName, "recognition", 100);
+        if (a.sourceURL.isSet())
+            add(a.sourceURL, "recognition", 100);
+    }
+
+    // Make sure we have something to look through.
+    Data recognition;
+    if (resource.recognition.isSet())
+        recognition = resource.recognition;
+    if (!recognition.body.isSet())
+        return;
+
+    QDomDocument doc;
+    QString emsg;
+    if (!doc.setContent(recognition.body, &emsg)) {
+        global.workMetrics.error("index", "recognition");
+        return;
+    }
+
+    // look for text tags
+    QDomNodeList anchors = doc.documentElement().elementsByTagName("t");
+#if QT_VERSION < 0x050000
+    for (unsigned int i=0; !queue->isCancelled() && i<anchors.length(); i++) {
+#else
+    for (int i=0; !queue->isCancelled() && i<anchors.length(); i++) {
+#endif
+        QDomElement enmedia = anchors.at(i).toElement();
+        QString weight = enmedia.attribute("w");
+        QString text = enmedia.text();
+        if (text != "")
+            add(text, "recognition", weight.toInt());
+    }
+}
+
+
+
+// Index any PDFs that are attached.  Basically it turns the PDF into text and adds it the same
+// way as a note's body.  Pages are read one at a time & saved in the PDF text cache as they
+// are read, so a PDF that has been read before isn't opened again and one that was cut off
+// by a pause or shutdown carries on from the first page that wasn't saved.
+void IndexJob::indexPdf() {
+    if (!global.indexPDFLocally || queue->isCancelled() || noteLid <= 0)
+        return;
+    QString file = global.fileManager.getDbaDirPath() + QString::number(resourceLid) +".pdf";
+
+    QByteArray hash;
+    if (resource.data.isSet() && resource.data.ref().bodyHash.isSet())
+        hash = resource.data.ref().bodyHash.ref();
+    PdfTextCache cache(hash);
+
+    Poppler::Document *doc = NULL;
+    qint32 pages = cache.pageCount();
+    qint32 cached = 0;
+    QString text = "";
+    for (int i=0; !queue->isCancelled() && (pages < 0 || i<pages); i++) {
+        if (cache.hasPage(i)) {
+            text = text + cache.page(i) + QString(" ");
+            cached++;
+            continue;
+        }
+        if (doc == NULL) {
+            doc = Poppler::Document::load(file);
+            if (doc == NULL)
+                global.workMetrics.error("index", "pdf");
+            if (doc == NULL || doc->isEncrypted() || doc->isLocked()) {
+                delete doc;
+                return;
+            }
+            pages = doc->numPages();
+            if (i >= pages)
+                break;
+        }
+        QRectF rect;
+        Poppler::Page *page = doc->page(i);
+        QString pageText = "";
+        if (page != NULL)
+            pageText = page->text(rect);
+        delete page;
+        cache.setPage(i, pageText);
+        text = text + pageText + QString(" ");
+    }
+    delete doc;
+    if (queue->isCancelled())
+        return;
+    if (cache.pageCount() < 0)
+        cache.setPageCount(pages);
+    if (cached > 0)
+        QLOG_DEBUG() << "PDF " << resourceLid << ": " << cached << " of " << pages << " pages cached";
+    add(text, "recognition", 100);
+}
+
+
+
+// Index any files that are attached.  Office & OpenDocument files are read
+// here.  The old binary formats are left for the index runner to convert
+// with soffice, which it does a batch at a time.
+void IndexJob::indexAttachment() {
+    if (queue->isCancelled() || noteLid <= 0)
+        return;
+    QString extension = "";
+    ResourceAttributes attributes;
+    if (resource.attributes.isSet())
+        attributes = resource.attributes;
+    if (attributes.fileName.isSet()) {
+        QString fileName = attributes.fileName;
+        int i = fileName.lastIndexOf(".");
+        if (i != -1)
+            extension = fileName.mid(i).toLower();
+    }
+    bool legacy = officeFound && OfficeText::isLegacy(extension);
+    if (!OfficeText::isDocument(extension) && !legacy)
+        return;
+
+    QString file = global.fileManager.getDbaDirPath() + QString::number(resourceLid) +extension;
+    QFile dataFile(file);
+    if (!dataFile.exists()) {
+        QDir dir(global.fileManager.getDbaDirPath());
+        QStringList filterList;
+        filterList.append(QString::number(resourceLid)+".*");
+        QStringList list= dir.entryList(filterList, QDir::Files);
+        if (list.size() == 0)
+            return;
+        file = global.fileManager.getDbaDirPath()+list[0];
+    }
+
+    if (legacy) {
+        result->convertFile = file;
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QString text = OfficeText::text(file, extension);
+    QLOG_DEBUG() << "Extracted " << text.length() << " characters from " << file
+                 << " in " << timer.elapsed() << " ms";
+    if (text != "")
+        add(text, "recognition", 100);
+}
@@ -0,0 +1,129 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef INDEXJOB_H
+#define INDEXJOB_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QString>
+
+#include "qevercloud/include/QEverCloud.h"
+using namespace qevercloud;
+
+// Workers stop and wait once this much extracted text is queued up
+// waiting for the index thread to write it.
+#define INDEX_QUEUE_MAX_BYTES   (32*1024*1024)
+
+
+// One piece of text for the SearchIndex
+class IndexRecord : public QObject
+{
+    Q_OBJECT
+public:
+    qint32 lid;           // The note the text is from
+    qint32 resource;      // The resource the text is from, 0 for the note's own text
+    qint32 weight;
+    QString source;
+    QString content;
+    IndexRecord() { lid = 0; resource = 0; weight = 0; }
+};
+
+
+
+// Everything a worker found for one note or resource.  The note or
+// resource is marked as indexed when this is written.
+class IndexResult
+{
+public:
+    qint32 lid;                          // The note or resource that was indexed
+    qint32 noteLid;                      // The note it belongs to
+    bool resource;                       // Is lid a resource?
+    QString convertFile;                 // Attachment that has to be converted by soffice
+    QList<IndexRecord*> records;         // Text found, in the order it was found
+    IndexResult();
+    ~IndexResult();
+    qint64 size();                       // Roughly how much memory the text takes
+};
+
+
+
+//*****************************************************************
+//* A bounded queue between the extraction workers and the index
+//* thread, which is the only thing writing to the database.
+//* Workers block in put() while the queue is over its size limit.
+//* Once cancelled, anything put is thrown away so the workers can
+//* finish quickly.
+//*****************************************************************
+class IndexQueue
+{
+private:
+    QMutex mutex;
+    QWaitCondition notFull;
+    QWaitCondition notEmpty;
+    QList<IndexResult*> results;
+    qint64 bytes;
+    qint64 maxBytes;
+    bool cancelled;
+
+public:
+    IndexQueue(qint64 maxBytes);
+    ~IndexQueue();
+    void put(IndexResult *result);                  // Add a result, waiting if the queue is full
+    QList<IndexResult*> take(int msecs);            // Get everything waiting, waiting up to msecs for something
+    void cancel();                                  // Drop everything & stop waiting
+    void reset();                                   // Start accepting results again
+    bool isCancelled();
+};
+
+
+
+//*****************************************************************
+//* Extract the text of one note or resource.  This runs on the
+//* index thread pool, so it never touches the database.  The index
+//* thread reads the note or resource and gives it to the job, and
+//* the job gives back an IndexResult through the queue.
+//*****************************************************************
+class IndexJob : public QRunnable
+{
+private:
+    IndexQueue *queue;
+    IndexResult *result;
+    Note note;
+    Resource resource;
+    qint32 noteLid;
+    qint32 resourceLid;
+    bool officeFound;
+
+    void add(QString content, QString source, qint32 weight);
+    void indexNote();
+    void indexRecognition();
+    void indexPdf();
+    void indexAttachment();
+
+public:
+    IndexJob(IndexQueue *queue, qint32 lid, Note &n);
+    IndexJob(IndexQueue *queue, qint32 noteLid, qint32 resourceLid, Resource &r, bool officeFound);
+    void run();
+};
+
+#endif // INDEXJOB_H
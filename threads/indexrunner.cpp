@@ -22,16 +22,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "sql/notetable.h"
 #include "sql/nsqlquery.h"
 #include "sql/resourcetable.h"
-#include <QTextDocument>
-#include <QtXml>
-#if QT_VERSION < 0x050000
-#include <poppler-qt4.h>
-#else
-#include <poppler-qt5.h>
-#endif
+#include "sql/indexhashtable.h"
+#include "sql/searchtable.h"
+#include "utilities/pdftextcache.h"
+#include <QElapsedTimer>
+#include <QCryptographicHash>
+#include <QProcess>
 
 extern Global global;
-using namespace Poppler;
 
 
 
@@ -42,19 +40,28 @@ IndexRunner::IndexRunner()
     init = false;
     officeFound = false;  // temporarily disabled to test performance impact
     this->pauseIndexing = false;
-    this->textDocument = NULL;
     this->enableIndexing = true;
-    this->indexHash = NULL;
+    this->throttle = true;
     this->keepRunning = true;
     this->db = NULL;
-    //this->indexTimer = NULL;
+    this->pool = NULL;
+    this->queue = NULL;
+    this->jobsRunning = 0;
     this->iAmBusy = false;
+    this->lastUserActivity = 0;
+    this->waiting = 0;
 }
 
 
 // Destructor
 IndexRunner::~IndexRunner() {
-    delete indexHash;
+    qDeleteAll(converting);
+    if (queue != NULL) {
+        queue->cancel();
+        pool->waitForDone();
+        delete pool;
+        delete queue;
+    }
 }
 
 
@@ -62,7 +69,6 @@ IndexRunner::~IndexRunner() {
 // Main thread runner.  This just basically starts up the event queue.  Everything else
 // is done via events signaled from the main thread.
 void IndexRunner::initialize() {
-    //moveToThread(this);
     keepRunning = true;
     pauseIndexing = false;
     enableIndexing = global.enableIndexing;
@@ -70,18 +76,157 @@ void IndexRunner::initialize() {
     iAmBusy = false;
     QLOG_DEBUG() << "Starting IndexRunner";
     db = new DatabaseConnection("indexrunner");
-    //indexTimer = new QTimer();
-    //indexTimer->setInterval(global.minIndexInterval);
-    //connect(indexTimer, SIGNAL(timeout()), this, SLOT(index()));
-    //indexTimer->start();
-    textDocument = new QTextDocument();
-    indexHash = new QHash<qint32, IndexRecord*>();
-    QLOG_DEBUG() << "Indexrunner initialized.";
+    pool = new QThreadPool();
+    load.otherLoad();    // The first reading is only a starting point
+    pool->setMaxThreadCount(threadCount(-1, false));
+    queue = new IndexQueue(INDEX_QUEUE_MAX_BYTES);
+
+    // Drop the cached text of PDFs that have been deleted
+    QSet<QString> hashes;
+    ResourceTable resourceTable(db);
+    resourceTable.getDataHashes(hashes);
+    PdfTextCache::prune(hashes);
+    QLOG_DEBUG() << "Indexrunner initialized with " << pool->maxThreadCount() << " workers.";
+}
+
+
+
+// Is the index thread allowed to keep going?
+bool IndexRunner::running() {
+    return keepRunning && !pauseIndexing;
+}
+
+
+
+// Has the user been editing or opening notes in the last few seconds?
+bool IndexRunner::userActive() {
+    QMutexLocker locker(&priorityMutex);
+    return QDateTime::currentMSecsSinceEpoch() - lastUserActivity < INDEX_FOREGROUND_MSECS;
+}
+
+
+
+// Get the number of extraction workers.  By default, leave one core free
+// for everything else.  On battery only one worker runs, cores that other
+// programs are using are left to them, and while the user is working in
+// NixNote half as many run.
+qint32 IndexRunner::threadCount(qreal otherLoad, bool battery) {
+    qint32 count = global.indexThreads;
+    if (count <= 0)
+        count = QThread::idealThreadCount()-1;
+    if (battery)
+        count = 1;
+    if (otherLoad >= 0)
+        count = qMin(count, qint32(QThread::idealThreadCount() * (1.0-otherLoad)));
+    if (userActive())
+        count = count/2;
+    if (count < 1)
+        count = 1;
+    return count;
+}
+
+
+
+// Put a note ahead of the backlog.  The user opening or editing a note
+// beats a sync bringing it in.  This is called from the GUI & sync
+// threads, so it only touches what priorityMutex guards.
+void IndexRunner::prioritize(qint32 noteLid, qint32 priority) {
+    QMutexLocker locker(&priorityMutex);
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (priority == INDEX_PRIORITY_USER)
+        lastUserActivity = now;
+    if (priorities.contains(noteLid)) {
+        QPair<qint32, qint64> current = priorities[noteLid];
+        if (current.first < priority && now - current.second < INDEX_PRIORITY_MSECS)
+            priority = current.first;
+    }
+    priorities.insert(noteLid, QPair<qint32, qint64>(priority, now));
+}
+
+
+
+// Number of notes & resources waiting to be indexed as of the last pass,
+// including notes waiting for their edits to settle.
+qint32 IndexRunner::queueDepth() {
+    QMutexLocker locker(&priorityMutex);
+    return waiting;
+}
+
+
+
+bool IndexWork::operator<(const IndexWork &other) const {
+    if (priority != other.priority)
+        return priority < other.priority;
+    if (resource != other.resource)
+        return !resource;
+    if (updated != other.updated)
+        return updated > other.updated;
+    return lid > other.lid;
+}
+
+
+
+// Get the notes & resources needing indexing in the order they should be
+// done.  Notes that changed recently are held back until they settle.
+// Returns how many were held back.
+qint32 IndexRunner::getWork(QList<IndexWork> &work) {
+    NoteTable noteTable(db);
+    ResourceTable resourceTable(db);
+    QHash<qint32, qlonglong> updated;
+    QHash<qint32, qint32> noteLids;
+    noteTable.getIndexNeeded(updated);
+    resourceTable.getIndexNeeded(noteLids);
+
+    qint32 held = 0;
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QMutexLocker locker(&priorityMutex);
+    QMutableHashIterator<qint32, QPair<qint32, qint64> > expired(priorities);
+    while (expired.hasNext()) {
+        expired.next();
+        if (now - expired.value().second >= INDEX_PRIORITY_MSECS)
+            expired.remove();
+    }
+
+    QHashIterator<qint32, qlonglong> notes(updated);
+    while (notes.hasNext()) {
+        notes.next();
+        IndexWork w;
+        w.lid = notes.key();
+        w.noteLid = notes.key();
+        w.resource = false;
+        w.priority = priorities.value(w.noteLid, QPair<qint32, qint64>(INDEX_PRIORITY_BACKLOG, 0)).first;
+        w.updated = notes.value();
+        qint64 settle = (w.priority == INDEX_PRIORITY_USER ? INDEX_EDIT_SETTLE_MSECS : INDEX_SETTLE_MSECS);
+        if (throttle && now - w.updated < settle) {
+            held++;
+            continue;
+        }
+        work.append(w);
+    }
+
+    QHashIterator<qint32, qint32> resources(noteLids);
+    while (resources.hasNext()) {
+        resources.next();
+        IndexWork w;
+        w.lid = resources.key();
+        w.noteLid = resources.value();
+        w.resource = true;
+        w.priority = priorities.value(w.noteLid, QPair<qint32, qint64>(INDEX_PRIORITY_BACKLOG, 0)).first;
+        w.updated = updated.value(w.noteLid, 0);
+        work.append(w);
+    }
+    locker.unlock();
+
+    qSort(work);
+    return held;
 }
 
 
 
 // The index timer has expired.  Look for any unindexed notes or resources
+// and hand them to the workers.  Each call only hands out work for
+// INDEX_BATCH_MSECS, then waits for it to finish & returns so the timer
+// can call again.
 void IndexRunner::index() {
     if (!enableIndexing)
         return;
@@ -95,427 +240,402 @@ void IndexRunner::index() {
     if (iAmBusy)
         return;
 
-    //indexTimer->stop();   // Stop the timer because we are already working
-    //indexTimer->setInterval(global.minIndexInterval);
-
     busy(true,false);
-    QList<qint32> lids;
+    qreal otherLoad = load.otherLoad();
+    bool battery = load.onBattery();
+    pool->setMaxThreadCount(threadCount(otherLoad, battery));
+    qint64 budget = (battery ? INDEX_BATCH_MSECS/4 : INDEX_BATCH_MSECS);
+    QElapsedTimer timer;
+    timer.start();
+
+    // Finish anything left over from a pass that was paused
+    waitForJobs();
+    convertAttachments();
+    if (running())
+        flushCache();
 
     NoteTable noteTable(db);
     ResourceTable resourceTable(db);
     bool endMsgNeeded = false;
-
-    int countPause = global.indexNoteCountPause;
-
-    QList<qint32> finishedLids;
-    // Get any unindexed notes
-    if (keepRunning && !pauseIndexing && noteTable.getIndexNeeded(lids) > 0) {
-        QApplication::processEvents();
-        endMsgNeeded = true;
-        QLOG_DEBUG() << "Unindexed Notes found: " << lids.size();
-
-        // Index any undindexed note content.
-        for (int i=0; keepRunning && !pauseIndexing && i<lids.size(); i++) {
-            QApplication::processEvents();
-            Note n;
-            noteTable.get(n, lids[i], false, false);
-            indexNote(lids[i],n);
-            finishedLids.append(lids[i]);
-            if (countPause <=0) {
-                flushCache();
-                for (int j=0; j<finishedLids.size(); j++)
-                    noteTable.setIndexNeeded(finishedLids[j], false);
-                //indexTimer->start();
-                busy(false,false);
-                return;
-            }
-            countPause--;
-        }
-    }
-    if (keepRunning && !pauseIndexing)
-       flushCache();
-    for (int j=0; !pauseIndexing && keepRunning && j<finishedLids.size(); j++)
-        noteTable.setIndexNeeded(finishedLids[j], false);
-
-
-    lids.clear();  // Clear out the list so we can start on resources
-
-    if (!keepRunning || pauseIndexing) {
-        //indexTimer->start();
+    bool finished = true;
+    qint32 passSkips = 0;
+
+    QList<IndexWork> work;
+    qint32 held = 0;
+    if (running())
+        held = getWork(work);
+    priorityMutex.lock();
+    waiting = work.size() + held;
+    priorityMutex.unlock();
+    global.workMetrics.setBacklog("index", work.size() + held);
+
+    // Leave the backlog for later if other programs need the CPU.  Notes
+    // the user is working with are still done.
+    if (throttle && work.size() > 0 && otherLoad > INDEX_BUSY_LOAD && work[0].priority != INDEX_PRIORITY_USER) {
+        QLOG_DEBUG() << "System busy.  Indexing of " << work.size() << " notes & resources put off.";
         busy(false,false);
         return;
     }
 
-    countPause = global.indexResourceCountPause;
-    finishedLids.clear();
-    // Start indexing resources
-    if (keepRunning && !pauseIndexing && resourceTable.getIndexNeeded(lids) > 0) {
+    if (work.size() > 0) {
         endMsgNeeded = true;
+        QLOG_DEBUG() << "Unindexed notes & resources found: " << work.size()
+                     << (battery ? " (on battery)" : "");
+    }
 
-        // Index each resource that is needed.
-        for (int i=0; keepRunning && !pauseIndexing && i<lids.size(); i++) {
-            QApplication::processEvents();
-            Resource r;
-            resourceTable.get(r, lids.at(i), false);
-            qint32 noteLid = noteTable.getLid(r.noteGuid);
-            indexRecognition(noteLid, r);
-            QString mime = "";
-            if (r.mime.isSet())
-                mime = r.mime;
-            if (mime == "application/pdf")
-                indexPdf(noteLid, r);
-            else {
-                if (mime.startsWith("application", Qt::CaseInsensitive))
-                    indexAttachment(noteLid, r);
+    // Hand out the work, most urgent first
+    qint32 submitted = 0;
+    for (int i=0; running() && i<work.size(); i++) {
+        if (timer.elapsed() > budget) {
+            finished = false;
+            break;
+        }
+        submitted++;
+        if (!work[i].resource) {
+            Note n;
+            noteTable.get(n, work[i].lid, false, false);
+            if (unchanged(n.guid.isSet() ? QString(n.guid) : QString(), work[i].lid, noteHash(n), false)) {
+                global.workMetrics.skipped("index", "notes");
+                passSkips++;
+                finishedNotes.append(work[i].lid);
+                continue;
             }
-            finishedLids.append(lids[i]);
-            if (countPause <=0) {
-                flushCache();
-                for (int j=0; keepRunning && !pauseIndexing && j<finishedLids.size(); j++) {
-                    resourceTable.setIndexNeeded(finishedLids[j], false);
-                }
-                busy(false,false);
-                //indexTimer->start();
-                return;
+            submit(new IndexJob(queue, work[i].lid, n));
+        } else {
+            Resource r;
+            resourceTable.get(r, work[i].lid, false);
+            if (unchanged(r.guid.isSet() ? QString(r.guid) : QString(), work[i].lid, resourceHash(r), true)) {
+                global.workMetrics.skipped("index", "resources");
+                passSkips++;
+                finishedResources.append(work[i].lid);
+                continue;
             }
-            countPause--;
+            qint32 noteLid = work[i].noteLid;
+            if (noteLid <= 0)
+                noteLid = noteTable.getLid(r.noteGuid);
+            submit(new IndexJob(queue, noteLid, work[i].lid, r, officeFound));
         }
     }
-    if (!keepRunning || pauseIndexing) {
+    priorityMutex.lock();
+    waiting = work.size() - submitted + held;
+    priorityMutex.unlock();
+    global.workMetrics.setBacklog("index", work.size() - submitted + held);
+
+    waitForJobs();
+    convertAttachments();
+    if (!running()) {
         busy(false,false);
-        //indexTimer->start();
         return;
     }
-    if (keepRunning && !pauseIndexing)
-        flushCache();
-    for (int j=0; keepRunning && !pauseIndexing && j<finishedLids.size(); j++) {
-        resourceTable.setIndexNeeded(finishedLids[j], false);
-    }
+    flushCache();
 
-    if (endMsgNeeded) {
+    if (passSkips > 0) {
+        QLOG_DEBUG() << "Skipped " << passSkips << " unchanged notes & resources";
+    }
+    if (endMsgNeeded && finished) {
         QLOG_DEBUG() << "Indexing completed";
     }
-    busy(false,true);
-    //indexTimer->setInterval(global.maxIndexInterval);
-    //indexTimer->start();
+    busy(false,finished);
 }
 
 
 
-// This indexes the actual note.
-void IndexRunner::indexNote(qint32 lid, Note &n) {
-    if (n.title.isSet()) {
-        QLOG_DEBUG() << "Indexing note: " << n.title;
-    }
+// The settings that change what ends up in the index.  If any of them
+// change, everything has to be indexed again.  INDEX_FORMAT_VERSION is
+// bumped whenever the extraction itself changes.
+QString IndexRunner::indexSettings() {
+    return QString::number(INDEX_FORMAT_VERSION) +
+            QString(global.foldSearchText ? "f" : "") +
+            QString(global.forceSearchLowerCase ? "l" : "") +
+            QString(global.trigramIndex ? "t" : "") +
+            QString(global.indexPDFLocally ? "p" : "") +
+            QString(officeFound ? "o" : "") +
+            QString(":") + global.searchStemLanguage;
+}
 
-    QString content = "";
-    if (n.content.isSet())
-        content = n.content; //.replace(QString("\n"), QString(" "));
 
 
-    // Start looking through the note
-    qint32 startPos = content.indexOf(QChar('<'));
-    qint32 endPos = content.indexOf(QChar('>'),startPos)+1;
-    content.remove(startPos,endPos-startPos);
+// Hash of what a note's index text is made from.  The note's contentHash
+// isn't used because local edits don't update it until the note is synced,
+// but it is the same MD5 of the content.
+QByteArray IndexRunner::noteHash(Note &n) {
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(indexSettings().toUtf8());
+    if (n.title.isSet())
+        hash.addData(QString(n.title).toUtf8());
+    hash.addData("\n");
+    if (n.content.isSet())
+        hash.addData(QString(n.content).toUtf8());
+    return hash.result();
+}
 
-    // Remove encrypted text
-    while (keepRunning && !pauseIndexing && content.contains("<en-crypt")) {
-        startPos = content.indexOf("<en-crypt");
-        endPos = content.indexOf("</en-crypt>") + 11;
-        content = content.mid(0,startPos)+content.mid(endPos);
-    }
 
-    // Remove any XML tags
-    while (keepRunning && !pauseIndexing && content.contains(QChar('<'))) {
-        startPos = content.indexOf(QChar('<'));
-        endPos = content.indexOf(QChar('>'),startPos)+1;
-        content.remove(startPos,endPos-startPos);
-    };
 
-    if (!keepRunning || pauseIndexing) {
-        //indexTimer->start();
-        return;
-    }
-
-    // Get the content as an HTML doc.
-    textDocument->setHtml(content);
-    QString title  = "";
-    if (n.title.isSet())
-        title = n.title;
-    content = textDocument->toPlainText() + " " + title;
-
-    IndexRecord *rec = new IndexRecord();
-    rec->content = content;
-    rec->source = "text";
-    rec->weight = 100;
-    rec->lid = lid;
-    if (indexHash->contains(lid)) {
-        delete indexHash->value(lid);
-        indexHash->remove(lid);
+// Hash of what a resource's index text is made from: the data & recognition
+// hashes plus the attributes that are indexed or decide how it is indexed.
+QByteArray IndexRunner::resourceHash(Resource &r) {
+    // Without a data hash there's no telling if it changed
+    if (!r.data.isSet() || !r.data.ref().bodyHash.isSet())
+        return QByteArray();
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(indexSettings().toUtf8());
+    hash.addData(r.data.ref().bodyHash.ref());
+    hash.addData("\n");
+    if (r.recognition.isSet() && r.recognition.ref().bodyHash.isSet())
+        hash.addData(r.recognition.ref().bodyHash.ref());
+    hash.addData("\n");
+    if (r.mime.isSet())
+        hash.addData(QString(r.mime).toUtf8());
+    if (r.attributes.isSet()) {
+        ResourceAttributes a = r.attributes;
+        hash.addData("\n");
+        if (a.fileName.isSet())
+            hash.addData(QString(a.fileName).toUtf8());
+        hash.addData("\n");
+        if (a.sourceURL.isSet())
+            hash.addData(QString(a.sourceURL).toUtf8());
     }
-    indexHash->insert(lid, rec);
+    return hash.result();
 }
 
 
 
+// Has the note or resource changed since it was last indexed?  A sync gives
+// resources new lids, so a resource whose text is still stored under its old
+// lid has it moved over instead of being indexed again.  The new hash is
+// saved when the cache is written.
+bool IndexRunner::unchanged(QString guid, qint32 lid, QByteArray hash, bool resource) {
+    if (guid == "" || hash.isEmpty())
+        return false;
+    indexedHashes.insert(lid, QPair<QString, QByteArray>(guid, hash));
+    IndexHashTable indexHashTable(db);
+    qint32 indexedLid;
+    if (indexHashTable.get(guid, indexedLid) != hash || indexedLid <= 0)
+        return false;
+    if (indexedLid == lid)
+        return true;
+    if (!resource)
+        return false;
+    ResourceTable resourceTable(db);
+    if (resourceTable.exists(indexedLid))
+        return false;
+    relinks.append(QPair<qint32, qint32>(indexedLid, lid));
+    return true;
+}
 
 
-// Index any resources
-void IndexRunner::indexRecognition(qint32 lid, Resource &r) {
 
-    if (!keepRunning || pauseIndexing) {
-        //indexTimer->start();
+// Hand a job to the pool.  Only a couple of jobs per worker are handed out
+// ahead of time, so notes & resources that have been read but not worked
+// on don't pile up in memory.
+void IndexRunner::submit(IndexJob *job) {
+    while (running() && jobsRunning >= pool->maxThreadCount()*2)
+        collectResults(100);
+    if (!running()) {
+        delete job;
         return;
     }
+    jobsRunning++;
+    pool->start(job);
+}
 
-    // Add filename or source url to search index
-    if (r.attributes.isSet()) {
-        NSqlQuery sql(db);
-        ResourceAttributes a = r.attributes;
-        if (a.fileName.isSet()) {
-            sql.prepare("Insert into SearchIndex (lid, weight, source, content) values (:lid, :weight, :source, :content)");
-            sql.bindValue(":lid", lid);
-            sql.bindValue(":weight", 100);
-            sql.bindValue(":source", "recognition");
-            sql.bindValue(":content", QString(a.fileName));
-            sql.exec();
-        }
-        if (a.sourceURL.isSet()) {
-            sql.prepare("Insert into SearchIndex (lid, weight, source, content) values (:lid, :weight, :source, :content)");
-            sql.bindValue(":lid", lid);
-            sql.bindValue(":weight", 100);
-            sql.bindValue(":source", "recognition");
-            sql.bindValue(":content", QString(a.sourceURL));
-            sql.exec();
-        }
+
+
+// Take the results the workers have finished, waiting up to msecs for one,
+// and add them to the cache.  The cache is written out once it is big enough.
+void IndexRunner::collectResults(int msecs) {
+    QList<IndexResult*> results = queue->take(msecs);
+    for (int i=0; i<results.size(); i++) {
+        IndexResult *result = results[i];
+        jobsRunning--;
+        if (result->convertFile != "")
+            converting.append(result);
+        else
+            finishResult(result);
     }
+    if (running() && accumulator.size() >= INDEX_FLUSH_RECORDS)
+        flushCache();
+}
 
 
-    // Make sure we have something to look through.
-    Data recognition;
-    if (r.recognition.isSet())
-        recognition = r.recognition;
-    if (!recognition.body.isSet())
-        return;
 
-    QDomDocument doc;
-    QString emsg;
-    doc.setContent(recognition.body, &emsg);
-
-    // look for text tags
-    QDomNodeList anchors = doc.documentElement().elementsByTagName("t");
-#if QT_VERSION < 0x050000
-    for (unsigned int i=0; keepRunning && !pauseIndexing && i<anchors.length(); i++) {
-#else
-    for (int i=0; keepRunning && !pauseIndexing && i<anchors.length(); i++) {
-#endif
-        QApplication::processEvents();
-        QDomElement enmedia = anchors.at(i).toElement();
-        QString weight = enmedia.attribute("w");
-        QString text = enmedia.text();
-        if (text != "") {
-            IndexRecord *rec = new IndexRecord();
-            rec->weight = weight.toInt();
-            rec->lid = lid;
-            rec->content = text;
-            rec->source = "recognition";
-            if (indexHash->contains(lid)) {
-                delete indexHash->value(lid);
-                indexHash->remove(lid);
-            }
-            indexHash->insert(lid, rec);
-        }
-    }
+// Add a result to the cache.  It is marked as indexed when the cache is written.
+void IndexRunner::finishResult(IndexResult *result) {
+    qint64 bytes = 0;
+    for (int i=0; i<result->records.size(); i++)
+        bytes = bytes + result->records[i]->content.toUtf8().size();
+    global.workMetrics.done("index", 1, bytes);
+    accumulator.add(result);
+    if (result->resource)
+        finishedResources.append(result->lid);
+    else
+        finishedNotes.append(result->lid);
+    delete result;
 }
 
 
-// Index any PDFs that are attached.  Basically it turns the PDF into text and adds it the same
-// way as a note's body
-void IndexRunner::indexPdf(qint32 lid, Resource &r) {
-    if (!global.indexPDFLocally)
-        return;
-    if (!keepRunning || pauseIndexing) {
-        //indexTimer->start();
-        return;
-    }
-    ResourceTable rtable(db);
-    qint32 reslid = rtable.getLid(r.guid);
-    if (lid <= 0) {
-        //indexTimer->start();
-        return;
-    }
-    QString file = global.fileManager.getDbaDirPath() + QString::number(reslid) +".pdf";
 
-    QString text = "";
-    Poppler::Document *doc = Poppler::Document::load(file);
-    if (doc == NULL || doc->isEncrypted() || doc->isLocked()) {
-        //indexTimer->start();
-        return;
+// Run soffice to convert some files to text.  Returns false if it didn't
+// finish in time, in which case only some of the files were converted.
+bool IndexRunner::runOffice(QStringList &files, QString outDir, int msecs) {
+    QStringList args;
+    args << "--headless" << "--convert-to" << "txt:Text" << "--outdir" << outDir;
+    args.append(files);
+
+    QElapsedTimer timer;
+    timer.start();
+    QProcess sofficeProcess;
+    sofficeProcess.start("soffice", args, QIODevice::ReadOnly);
+    QLOG_DEBUG() << "Starting soffice for " << files.size() << " attachments";
+    sofficeProcess.waitForStarted();
+    bool finished = sofficeProcess.waitForFinished(msecs);
+    if (!finished) {
+        QLOG_ERROR() << "soffice timed out.";
+        global.workMetrics.error("index", "convert");
+        sofficeProcess.kill();
+        sofficeProcess.waitForFinished();
     }
-    for (int i=0; keepRunning && !pauseIndexing && i<doc->numPages(); i++) {
-        QRectF rect;
-        text = text + doc->page(i)->text(rect) + QString(" ");
+    int rc = sofficeProcess.exitCode();
+    QLOG_DEBUG() << "soffice Errors:" << sofficeProcess.readAllStandardError();
+    QLOG_DEBUG() << "soffice Output:" << sofficeProcess.readAllStandardOutput();
+    QLOG_DEBUG() << "return code:" << rc;
+    if (sofficeProcess.error() == QProcess::FailedToStart || (finished && rc == 255)) {
+        QLOG_ERROR() << "soffice not found.  Disabling attachment indexing.";
+        officeFound = false;
+        return true;
     }
-    IndexRecord *rec = new IndexRecord();
-    rec->content = text;
-    rec->source = "recognition";
-    rec->weight = 100;
-    rec->lid = lid;
-    if (indexHash->contains(lid)) {
-        delete indexHash->value(lid);
-        indexHash->remove(lid);
+    if (finished) {
+        QLOG_DEBUG() << "soffice converted " << files.size() << " attachments in "
+                     << timer.elapsed() << " ms, " << timer.elapsed()/files.size() << " ms each";
+        for (int i=0; i<files.size(); i++)
+            global.workMetrics.timing("index", "convert", timer.elapsed()/files.size());
     }
-    indexHash->insert(lid, rec);
+    return finished;
 }
 
 
 
+// Convert the attachments that need soffice.  One soffice process does a
+// whole batch, so LibreOffice starts once for every INDEX_CONVERT_BATCH
+// files rather than once for each of them.  If the batch takes too long
+// (usually one bad file), the files it didn't get to are converted one
+// at a time so a single file can't hold up the rest.
+void IndexRunner::convertAttachments() {
+    QString outDir = global.fileManager.getTmpDirPath();
+    while (running() && converting.size() > 0) {
+        QList<IndexResult*> batch;
+        QStringList files;
+        while (batch.size() < INDEX_CONVERT_BATCH && converting.size() > 0) {
+            IndexResult *result = converting.takeFirst();
+            batch.append(result);
+            files.append(result->convertFile);
+        }
 
-// Index any files that are attached.
-void IndexRunner::indexAttachment(qint32 lid, Resource &r) {
-    if (!officeFound)
-        return;
-    QLOG_DEBUG() << "indexing attachment to note " << lid;
-    if (!keepRunning || pauseIndexing) {
-        //indexTimer->start();
-        return;
-    }
-    ResourceTable rtable(db);
-    qint32 reslid = rtable.getLid(r.guid);
-    if (lid <= 0) {
-        //indexTimer->start();
-        return;
-    }
-    QLOG_DEBUG() << "Resource " << reslid;
-    QString extension = "";
-    ResourceAttributes attributes;
-    if (r.attributes.isSet())
-        attributes = r.attributes;
-    if (attributes.fileName.isSet()) {
-        extension = attributes.fileName;
-        int i = extension.indexOf(".");
-	if (i != -1)
-	  extension = extension.mid(i);
-    }
-    if (extension != ".doc"  && extension != ".xls"  && extension != ".ppt" &&
-        extension != ".docx" && extension != ".xlsx" && extension != ".pptx" &&
-        extension != ".pps"  && extension != ".pdf"  && extension != ".odt"  &&
-        extension != ".odf"  && extension != ".ott"  && extension != ".odm"  &&
-        extension != ".html" && extension != ".txt"  && extension != ".oth"  &&
-        extension != ".ods"  && extension != ".ots"  && extension != ".odg"  &&
-        extension != ".otg"  && extension != ".odp"  && extension != ".otp"  &&
-        extension != ".odb"  && extension != ".oxt"  && extension != ".htm"  &&
-        extension != ".docm")
-                return;
-
-    QString file = global.fileManager.getDbaDirPath() + QString::number(reslid) +extension;
-    QFile dataFile(file);
-    if (!dataFile.exists()) {
-        QDir dir(global.fileManager.getDbaDirPath());
-        QStringList filterList;
-        filterList.append(QString::number(lid)+".*");
-        QStringList list= dir.entryList(filterList, QDir::Files);
-        if (list.size() > 0) {
-            file = global.fileManager.getDbaDirPath()+list[0];
+        if (officeFound && !runOffice(files, outDir, INDEX_CONVERT_BATCH_MSECS) && batch.size() > 1) {
+            for (int i=0; i<batch.size() && officeFound && running(); i++) {
+                QString txtName = outDir + QFileInfo(batch[i]->convertFile).completeBaseName() + ".txt";
+                if (QFile::exists(txtName))
+                    continue;
+                QStringList single;
+                single.append(batch[i]->convertFile);
+                runOffice(single, outDir, INDEX_CONVERT_MSECS);
+            }
         }
-    }
 
-    QString outDir = global.fileManager.getTmpDirPath();
+        // Whatever was converted is added to the rest of the resource's text
+        for (int i=0; i<batch.size(); i++) {
+            IndexResult *result = batch[i];
+            QString txtName = outDir + QFileInfo(result->convertFile).completeBaseName() + ".txt";
+            QFile txtFile(txtName);
+            if (txtFile.open(QIODevice::ReadOnly)) {
+                IndexRecord *rec = new IndexRecord();
+                rec->lid = result->noteLid;
+                rec->resource = result->lid;
+                rec->weight = 100;
+                rec->source = "recognition";
+                rec->content = QString::fromUtf8(txtFile.readAll());
+                result->records.append(rec);
+                txtFile.close();
+                txtFile.remove();
+            } else if (officeFound) {
+                global.workMetrics.error("index", "convert");
+            }
+            finishResult(result);
+        }
+    }
+}
 
-    QProcess sofficeProcess;
-    QString cmd = "soffice --headless --convert-to txt:\"Text\" --outdir "
-                    +outDir + " "
-                    +file;
 
-    sofficeProcess.start(cmd,
-                         QIODevice::ReadWrite|QIODevice::Unbuffered);
 
-    QLOG_DEBUG() << "Starting soffice ";
-    sofficeProcess.waitForStarted();
-    QLOG_DEBUG() << "Waiting for completion";
-    sofficeProcess.waitForFinished();
-    int rc = sofficeProcess.exitCode();
-    QLOG_DEBUG() << "soffice Errors:" << sofficeProcess.readAllStandardError();
-    QLOG_DEBUG() << "soffice Output:" << sofficeProcess.readAllStandardOutput();
-    QLOG_DEBUG() << "return code:" << rc;
-    if (rc == 255) {
-        QLOG_ERROR() << "soffice not found.  Disabling attachment indexing.";
-        this->officeFound = false;
-        return;
+// Wait for the jobs that have been handed out.  If indexing is paused part
+// way, whatever is still running is picked up on the next pass.  If it is
+// being shut down, the jobs are cancelled & their results thrown away.
+void IndexRunner::waitForJobs() {
+    while (running() && jobsRunning > 0)
+        collectResults(100);
+    if (!keepRunning && jobsRunning > 0) {
+        queue->cancel();
+        pool->waitForDone();
+        jobsRunning = 0;
     }
-    QFile txtFile(outDir+QString::number(reslid) +".txt");
-    if (txtFile.open(QIODevice::ReadOnly)) {
-        QString text;
-        text = txtFile.readAll();
-        NSqlQuery sql(db);
-        db->lockForWrite();
-        sql.prepare("Insert into SearchIndex (lid, weight, source, content) values (:lid, :weight, 'recognition', :content)");
-        sql.bindValue(":lid", lid);
-        sql.bindValue(":weight", 100);
-        if (!global.forceSearchLowerCase)
-            sql.bindValue(":content", text);
-        else
-            sql.bindValue(":content", text.toLower());
-        QLOG_DEBUG() << "Adding note resource to index DB";
-        sql.exec();
-        db->unlock();
-        txtFile.close();
-    }
-    QDir dir;
-    dir.remove(outDir+QString::number(reslid) +".txt");
 }
 
 
+
+// Write everything the workers have found to the index in one transaction
+// and mark the notes & resources it came from as indexed.
 void IndexRunner::flushCache() {
-    if (indexHash->size() <= 0)
+    if (accumulator.isEmpty() && finishedNotes.size() <= 0 && finishedResources.size() <= 0)
         return;
     QDateTime start = QDateTime::currentDateTimeUtc();
     NSqlQuery sql(db);
     db->lockForWrite();
     sql.exec("begin");
-    QHash<qint32, IndexRecord*>::iterator i;
-
-    // Start adding words to the index.  Every 200 sql insertions we do a commit
-    int commitCount = 200;
-
-    for (i=indexHash->begin(); keepRunning && !pauseIndexing && i!=indexHash->end(); ++i) {
-        qint32 lid = i.key();
-        IndexRecord *rec = i.value();
-        qint32 weight = rec->weight;
-        QString source = rec->source;
-        QString content = rec->content;
-        delete rec;
-
-        // Delete any old content
-        sql.prepare("Delete from SearchIndex where lid=:lid and source=:source");
-        sql.bindValue(":lid", lid);
-        sql.bindValue(":source", source);
-        sql.exec();
 
-        // Add the new content.  it is basically a text version of the note with a weight of 100.
-        sql.prepare("Insert into SearchIndex (lid, weight, source, content) values (:lid, :weight, :source, :content)");
-        sql.bindValue(":lid", lid);
-        sql.bindValue(":weight", weight);
-        sql.bindValue(":source", source);
-        if (!global.forceSearchLowerCase)
-            sql.bindValue(":content", content);
-        else
-            sql.bindValue(":content", content.toLower());
+    qint32 records = accumulator.size();
+    accumulator.write(db);
+    accumulator.clear();
+
+    // Unchanged resources that were given a new lid by a sync
+    sql.prepare("Update SearchIndex set lid=:lid where SearchIndex match :terms and lid=:oldLid");
+    for (int j=0; j<relinks.size(); j++) {
+        sql.bindValue(":lid", relinks[j].second);
+        sql.bindValue(":terms", QString("lid:") + QString::number(relinks[j].first));
+        sql.bindValue(":oldLid", relinks[j].first);
         sql.exec();
-        commitCount--;
-        if (commitCount <= 0) {
-            sql.exec("commit");
-            commitCount = 200;
+    }
+    relinks.clear();
+
+    // Only now that the text is there are they marked as done
+    IndexHashTable indexHashTable(db);
+    NoteTable noteTable(db);
+    for (int j=0; j<finishedNotes.size(); j++) {
+        noteTable.setIndexNeeded(finishedNotes[j], false);
+        if (indexedHashes.contains(finishedNotes[j])) {
+            QPair<QString, QByteArray> indexed = indexedHashes.take(finishedNotes[j]);
+            indexHashTable.set(indexed.first, finishedNotes[j], indexed.second);
+        }
+    }
+    ResourceTable resourceTable(db);
+    for (int j=0; j<finishedResources.size(); j++) {
+        resourceTable.setIndexNeeded(finishedResources[j], false);
+        if (indexedHashes.contains(finishedResources[j])) {
+            QPair<QString, QByteArray> indexed = indexedHashes.take(finishedResources[j]);
+            indexHashTable.set(indexed.first, finishedResources[j], indexed.second);
         }
     }
-    indexHash->clear();
+    SearchTable searchTable(db);
+    searchTable.logIndexed(finishedNotes, finishedResources);
+    finishedNotes.clear();
+    finishedResources.clear();
     sql.exec("commit");
 
     sql.finish();
     db->unlock();
     QDateTime finish = QDateTime::currentDateTimeUtc();
+    global.workMetrics.timing("index", "write", finish.toMSecsSinceEpoch() - start.toMSecsSinceEpoch());
 
-    QLOG_DEBUG() << "Index Cache Flush Complete: " <<
+    QLOG_DEBUG() << "Index Cache Flush Complete: " << records << " records in " <<
                     finish.toMSecsSinceEpoch() - start.toMSecsSinceEpoch()
                     << " milliseconds.";
 }
@@ -33,7 +33,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <stdio.h>
 #include <QFileInfo>
 #include <QTimer>
-#include <QTextDocument>
+#include <QThreadPool>
+#include <QMutex>
+#include <QPair>
+#include "threads/indexjob.h"
+#include "threads/indexaccumulator.h"
+#include "utilities/systemload.h"
 
 #include "qevercloud/include/QEverCloud.h"
 using namespace qevercloud;
@@ -43,32 +48,102 @@ using namespace std;
 // Forward declare classes used later
 class DatabaseConnection;
 
-class IndexRecord : public QObject
+// How long one call to index() keeps handing out work before it finishes
+// up and lets the thread's event loop (pauses, shutdown) have a turn.
+#define INDEX_BATCH_MSECS       10000
+
+// Write the cache out once it holds this many rows
+#define INDEX_FLUSH_RECORDS     1000
+
+// Notes are left alone for a while after they change so they aren't
+// indexed over & over while being edited.  A note the user is working
+// on is indexed sooner than the rest.
+#define INDEX_SETTLE_MSECS      300000
+#define INDEX_EDIT_SETTLE_MSECS 30000
+
+// How long a note the user opened or a sync brought in stays ahead of
+// the backlog, and how long after an edit the user counts as busy.
+#define INDEX_PRIORITY_MSECS    600000
+#define INDEX_FOREGROUND_MSECS  10000
+
+// Put indexing off while other programs use this share of the CPU
+#define INDEX_BUSY_LOAD         0.9
+
+// Indexing priorities, most urgent first
+#define INDEX_PRIORITY_USER     0      // Notes the user just opened or edited
+#define INDEX_PRIORITY_SYNC     1      // Notes a sync just brought in
+#define INDEX_PRIORITY_BACKLOG  2      // Everything else
+
+// Bump this when the text that is extracted changes, so everything
+// is indexed again instead of being skipped as unchanged.
+#define INDEX_FORMAT_VERSION    1
+
+// Attachments converted by one soffice process, how long a whole batch
+// is allowed to take, and how long each one gets if the batch is too
+// slow & they are converted one at a time.
+#define INDEX_CONVERT_BATCH     25
+#define INDEX_CONVERT_BATCH_MSECS 120000
+#define INDEX_CONVERT_MSECS     30000
+
+
+
+// A note or resource waiting to be indexed.  These sort in the order
+// they are indexed: by priority, notes before their resources, then the
+// most recently updated first.
+class IndexWork
 {
-    Q_OBJECT
 public:
     qint32 lid;
-    qint32 weight;
-    QString source;
-    QString content;
+    qint32 noteLid;                          // The note, or the note a resource belongs to
+    bool resource;
+    qint32 priority;
+    qlonglong updated;                       // When the note was last updated
+    bool operator<(const IndexWork &other) const;
 };
 
 
 
-
+//*****************************************************************
+//* Index notes & resources.  The text extraction (HTML to text,
+//* recognition XML, PDFs & attachments) is done by IndexJobs on a
+//* thread pool.  Their results come back through a bounded queue
+//* and this thread is the only one writing them to the database,
+//* in large transactions.
+//*****************************************************************
 class IndexRunner : public QObject
 {
     Q_OBJECT
 private:
-//    QTimer *indexTimer;
-    QHash<qint32, IndexRecord*> *indexHash;
+    IndexAccumulator accumulator;            // Text waiting to be written
+    QList<IndexResult*> converting;          // Results waiting for soffice to convert an attachment
+    QHash<qint32, QPair<QString, QByteArray> > indexedHashes;   // lid -> guid & hash to save once it is written
+    QList<QPair<qint32, qint32> > relinks;   // Old & new lids of unchanged resources with a new lid
+    QList<qint32> finishedNotes;             // Notes to mark as indexed when the cache is flushed
+    QList<qint32> finishedResources;         // Resources to mark as indexed when the cache is flushed
+    QMutex priorityMutex;                    // Priorities are set from the GUI & sync threads
+    QHash<qint32, QPair<qint32, qint64> > priorities;   // note lid -> priority & when it was set
+    qint64 lastUserActivity;                 // When the user last opened or edited a note
+    qint32 waiting;                          // Notes & resources not yet handed to a worker
+    SystemLoad load;
+    QThreadPool *pool;
+    IndexQueue *queue;
+    qint32 jobsRunning;                      // Jobs handed to the pool that haven't given back a result
     bool init;
-    void indexRecognition(qint32 lid, Resource &r);
-    void indexNote(qint32 lid, Note &n);
-    void indexPdf(qint32 lid, Resource &r);
-    void indexAttachment(qint32 lid, Resource &r);
-    QTextDocument *textDocument;
     DatabaseConnection *db;
+    bool running();
+    bool userActive();
+    qint32 threadCount(qreal otherLoad, bool battery);
+    qint32 getWork(QList<IndexWork> &work);
+    void submit(IndexJob *job);
+    void collectResults(int msecs);
+    void finishResult(IndexResult *result);
+    void convertAttachments();
+    bool runOffice(QStringList &files, QString outDir, int msecs);
+    QString indexSettings();
+    QByteArray noteHash(Note &n);
+    QByteArray resourceHash(Resource &r);
+    bool unchanged(QString guid, qint32 lid, QByteArray hash, bool resource);
+    void waitForJobs();
     void flushCache();
     void busy(bool value, bool finished);
     bool iAmBusy;
@@ -77,10 +152,13 @@ public:
     bool enableIndexing;
     bool keepRunning;
     bool pauseIndexing;
+    bool throttle;                           // Hold work back for system load & notes still being edited
     void initialize();
     bool officeFound;
     IndexRunner();
     ~IndexRunner();
+    void prioritize(qint32 noteLid, qint32 priority);   // Move a note ahead of the backlog.  Any thread can call this.
+    qint32 queueDepth();                     // Notes & resources waiting to be indexed
 
 signals:
     void thumbnailNeeded(qint32);
@@ -0,0 +1,60 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "metricsquery.h"
+#include "global.h"
+
+
+extern Global global;
+
+MetricsQuery::MetricsQuery(QObject *parent) :
+    QObject(parent)
+{
+    this->initDbus();
+}
+
+
+
+void MetricsQuery::initDbus() {
+    if (!QDBusConnection::sessionBus().isConnected()) {
+        return;
+    }
+    // Another copy of NixNote may already have the name.  It isn't worth stopping for.
+    if (!QDBusConnection::sessionBus().registerService(METRICS_DBUS_SERVICE_NAME)) {
+        QLOG_WARN() << "Unable to register metrics DBus service: " << QDBusConnection::sessionBus().lastError().message();
+        return;
+    }
+    QDBusConnection::sessionBus().registerObject("/org/nixnote/NixNote2/Metrics", this, QDBusConnection::ExportScriptableSlots);
+}
+
+
+
+// What the background threads (indexing, thumbnails & counts) are doing:
+// backlog, items done & items per second, bytes indexed, errors, items
+// skipped and latency histograms for each step, keyed by thread.
+Q_SCRIPTABLE QVariantMap MetricsQuery::getMetrics() {
+    return global.workMetrics.snapshot();
+}
+
+
+
+// The same as getMetrics(), as text with one number per line
+Q_SCRIPTABLE QString MetricsQuery::getMetricsReport() {
+    return global.workMetrics.report();
+}
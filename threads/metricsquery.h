@@ -0,0 +1,57 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef METRICSQUERY_H
+#define METRICSQUERY_H
+
+#include <QObject>
+#if QT_VERSION < 0x050000
+#include <QtDBus/QtDBus>
+#else
+#include <QtDBus>
+#endif
+#include <QString>
+#include <QVariantMap>
+
+
+#define METRICS_DBUS_SERVICE_NAME "org.nixnote.NixNote2"
+
+
+//*****************************************************************
+//* Puts the background work metrics (WorkMetrics) on the session
+//* bus.  It only reads the counters, never the database, so it is
+//* its own object rather than part of RemoteQuery, which is not
+//* exported.
+//*****************************************************************
+class MetricsQuery : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.nixnote.NixNote2.Metrics")
+
+public:
+    explicit MetricsQuery(QObject *parent = 0);
+    void initDbus();
+
+public slots:
+    Q_SCRIPTABLE QVariantMap getMetrics();
+    Q_SCRIPTABLE QString getMetricsReport();
+};
+
+
+#endif // METRICSQUERY_H
@@ -0,0 +1,210 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "noteuploader.h"
+#include "global.h"
+#include "sql/notetable.h"
+
+extern Global global;
+
+
+NoteUploader::NoteUploader(CommunicationManager *comm, DatabaseConnection *db, bool *keepRunning) {
+    this->comm = comm;
+    this->db = db;
+    this->keepRunning = keepRunning;
+    concurrency = UPLOAD_CONCURRENCY;
+    backoff = UPLOAD_BACKOFF_SECS;
+    paused = false;
+    stopped = false;
+    resumeTimer.setSingleShot(true);
+    connect(&resumeTimer, SIGNAL(timeout()), this, SLOT(resume()));
+}
+
+
+NoteUploader::~NoteUploader() {
+    qDeleteAll(ready);
+    qDeleteAll(results);
+}
+
+
+
+// Upload the notes, reading each from the database while earlier ones
+// are on their way.  Returns once nothing is in flight & there is
+// nothing more to send (or the sync was stopped).  Notes never sent are
+// left dirty for the next sync.
+void NoteUploader::upload(const QList<qint32> &lids) {
+    pending = lids;
+    while (true) {
+        startUploads();
+        if (*keepRunning && !stopped && ready.size() < UPLOAD_PREPARE_AHEAD && pending.size() > 0) {
+            prepare(pending.takeFirst());
+            loop.processEvents();
+            continue;
+        }
+
+        bool more = *keepRunning && !stopped && ready.size() > 0;
+        if (inFlight.size() == 0 && !more)
+            break;
+
+        // Wait for an upload to finish or a rate limit to run out.
+        // While waiting out a rate limit, look up every second in case
+        // the sync was stopped.
+        if (paused)
+            QTimer::singleShot(1000, &loop, SLOT(quit()));
+        loop.exec();
+    }
+    qDeleteAll(ready);
+    ready.clear();
+    pending.clear();
+}
+
+
+
+// A copy of a note with the things that change when it is edited.  The
+// resource data is left out (its hash is kept) so it can be read again
+// cheaply & the guid & USN are left out because the upload sets them.
+static Note editableCopy(const Note &note) {
+    Note copy = note;
+    copy.guid.clear();
+    copy.updateSequenceNum.clear();
+    QList<Resource> resources;
+    if (note.resources.isSet()) {
+        QList<Resource> noteResources = note.resources;
+        for (int i=0; i<noteResources.size(); i++) {
+            Resource r;
+            r.guid = noteResources[i].guid;
+            r.mime = noteResources[i].mime;
+            r.active = noteResources[i].active;
+            r.attributes = noteResources[i].attributes;
+            if (noteResources[i].data.isSet() && noteResources[i].data.value().bodyHash.isSet()) {
+                Data d;
+                d.bodyHash = noteResources[i].data.value().bodyHash;
+                r.data = d;
+            }
+            resources.append(r);
+        }
+        copy.resources = resources;
+    }
+    return copy;
+}
+
+
+
+// Read a note (with its resources) ready to go
+void NoteUploader::prepare(qint32 lid) {
+    NoteTable noteTable(db);
+    NoteUpload *upload = new NoteUpload();
+    upload->lid = lid;
+    noteTable.get(upload->note, lid, true, true);
+    upload->sent = editableCopy(upload->note);
+    if (upload->note.title.isSet())
+        upload->title = upload->note.title;
+    if (upload->note.updateSequenceNum.isSet())
+        upload->oldUsn = upload->note.updateSequenceNum;
+    ready.append(upload);
+}
+
+
+
+// Send as many waiting notes as are allowed at once
+void NoteUploader::startUploads() {
+    while (!paused && !stopped && *keepRunning && inFlight.size() < concurrency && ready.size() > 0) {
+        NoteUpload *upload = ready.takeFirst();
+        AsyncResult *request = comm->uploadNoteAsync(upload->note);
+        connect(request, SIGNAL(finished(QVariant, QSharedPointer<EverCloudExceptionData>)),
+                this, SLOT(uploadFinished(QVariant, QSharedPointer<EverCloudExceptionData>)));
+        inFlight.insert(request, upload);
+    }
+}
+
+
+
+// Evernote has answered one of the uploads
+void NoteUploader::uploadFinished(QVariant result, QSharedPointer<EverCloudExceptionData> exception) {
+    NoteUpload *upload = inFlight.take(sender());
+    if (upload == NULL)
+        return;
+    upload->usn = comm->uploadNoteFinished(upload->note, result, exception);
+
+    if (upload->usn == 0 && comm->error.type == CommunicationError::RateLimitExceeded) {
+        qint32 wait = qMax(comm->error.retryAfter, backoff);
+        if (wait <= UPLOAD_MAX_WAIT_SECS && *keepRunning) {
+            // Try it again once the wait is over, & go slower after that
+            QLOG_WARN() << "API rate limit reached.  Waiting " << wait << " seconds to upload more notes.";
+            ready.prepend(upload);
+            if (!paused)
+                backoff = wait*2;
+            paused = true;
+            concurrency = 1;
+            QDateTime until = QDateTime::currentDateTimeUtc().addSecs(wait);
+            if (!resumeTimer.isActive() || until > resumeAt) {
+                resumeAt = until;
+                resumeTimer.start(wait*1000);
+            }
+            loop.quit();
+            return;
+        }
+        stopped = true;
+    }
+    finish(upload);
+    loop.quit();
+}
+
+
+
+// Record how an upload went.  A note Evernote took is marked clean
+// straight away, unless it was edited after it was read.  The edit
+// could have been saved any time while it waited to go, so the note is
+// read again & compared with what was sent.
+void NoteUploader::finish(NoteUpload *upload) {
+    if (upload->usn > 0) {
+        NoteTable noteTable(db);
+        if (upload->oldUsn == 0)
+            noteTable.updateGuid(upload->lid, upload->note.guid);
+        noteTable.setUpdateSequenceNumber(upload->lid, upload->usn);
+        Note current;
+        noteTable.get(current, upload->lid, true, false);
+        if (editableCopy(current) == upload->sent)
+            noteTable.setDirty(upload->lid, false);
+        else {
+            QLOG_DEBUG() << "Note " << upload->lid << " changed while uploading.  Leaving it dirty.";
+            upload->changed = true;
+        }
+
+        // Work back up to full speed after a rate limit
+        if (concurrency < UPLOAD_CONCURRENCY)
+            concurrency++;
+        backoff = UPLOAD_BACKOFF_SECS;
+    } else {
+        upload->errorType = comm->error.type;
+        upload->errorMessage = comm->error.message;
+        upload->errorCode = comm->error.code;
+    }
+    upload->note = Note();
+    upload->sent = Note();
+    results.append(upload);
+}
+
+
+
+// A rate limit wait is over
+void NoteUploader::resume() {
+    paused = false;
+    loop.quit();
+}
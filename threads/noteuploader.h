@@ -0,0 +1,119 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef NOTEUPLOADER_H
+#define NOTEUPLOADER_H
+
+#include <QObject>
+#include <QList>
+#include <QHash>
+#include <QEventLoop>
+#include <QTimer>
+#include <QDateTime>
+#include <QVariant>
+#include <QSharedPointer>
+#include "communication/communicationmanager.h"
+#include "communication/communicationerror.h"
+#include "sql/databaseconnection.h"
+
+#include "qevercloud/include/QEverCloud.h"
+using namespace qevercloud;
+
+// Most uploads to have going at once
+#define UPLOAD_CONCURRENCY      3
+
+// Notes read from the database & waiting for a free upload.  With the
+// ones in flight this bounds how many notes (with their resources) are
+// held in memory.
+#define UPLOAD_PREPARE_AHEAD    2
+
+// Longest rate limit wait to sit out.  Anything longer stops the upload
+// & goes through the usual rate limit error.
+#define UPLOAD_MAX_WAIT_SECS    120
+
+// First wait when Evernote gives no time; doubled each time it happens again
+#define UPLOAD_BACKOFF_SECS     5
+
+
+// One note being uploaded & how it went
+class NoteUpload
+{
+public:
+    qint32 lid;
+    Note note;                                   // Emptied once it has been sent
+    Note sent;                                   // What was sent, without the resource data
+    QString title;
+    qint32 oldUsn;
+    qint32 usn;                                  // New USN, or 0 if it failed
+    bool changed;                                // Edited while it was uploading, so still dirty
+    CommunicationError::CommunicationErrorType errorType;
+    QString errorMessage;
+    int errorCode;
+    NoteUpload() { lid = 0; oldUsn = 0; usn = 0; changed = false; errorType = CommunicationError::None; errorCode = 0; }
+};
+
+
+
+//*****************************************************************
+//* Upload a list of notes with a few requests in flight at once.
+//* Everything runs on the calling (sync) thread: the uploads are
+//* qevercloud async requests, and the next notes are read from the
+//* database while they are under way.  Each note is marked clean as
+//* soon as Evernote accepts it, so a sync that is stopped doesn't
+//* send it again.  A note edited after it was read stays dirty so
+//* the edit goes up on the next sync.
+//*
+//* If Evernote says the API rate limit has been hit, no more uploads
+//* are started until the time it gives has passed, then they carry
+//* on one at a time & work back up to UPLOAD_CONCURRENCY.  A longer
+//* wait than UPLOAD_MAX_WAIT_SECS stops the upload.
+//*****************************************************************
+class NoteUploader : public QObject
+{
+    Q_OBJECT
+private:
+    CommunicationManager *comm;
+    DatabaseConnection *db;
+    bool *keepRunning;
+    QList<qint32> pending;                       // Not read from the database yet
+    QList<NoteUpload*> ready;                    // Read & waiting to go
+    QHash<QObject*, NoteUpload*> inFlight;       // Request -> note
+    QEventLoop loop;
+    QTimer resumeTimer;
+    QDateTime resumeAt;                          // When resumeTimer goes off
+    qint32 concurrency;                          // Uploads allowed at once right now
+    qint32 backoff;                              // Seconds to wait at the next rate limit, at least
+    bool paused;                                 // Waiting out a rate limit
+    bool stopped;                                // Rate limited for too long
+    void prepare(qint32 lid);
+    void startUploads();
+    void finish(NoteUpload *upload);
+
+public:
+    QList<NoteUpload*> results;                  // Everything tried, in the order it finished
+    NoteUploader(CommunicationManager *comm, DatabaseConnection *db, bool *keepRunning);
+    ~NoteUploader();
+    void upload(const QList<qint32> &lids);      // Upload the notes & wait until done
+
+private slots:
+    void uploadFinished(QVariant result, QSharedPointer<EverCloudExceptionData> exception);
+    void resume();
+};
+
+#endif // NOTEUPLOADER_H
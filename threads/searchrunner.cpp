@@ -0,0 +1,382 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "searchrunner.h"
+#include "filters/filterengine.h"
+#include "sql/nsqlquery.h"
+#include "sql/searchtable.h"
+
+#include <QElapsedTimer>
+#include <QMetaType>
+#include <QMutexLocker>
+
+SearchRunner::SearchRunner(QObject *parent) :
+    QObject(parent)
+{
+    init = false;
+    db = NULL;
+    pendingCriteria = NULL;
+    pendingGeneration = 0;
+    minimumWeight = global.getMinimumRecognitionWeight();
+    tagSelectionOr = global.getTagSelectionOr();
+    refreshTimer = NULL;
+    fullRefreshPending = false;
+    batchSize = 250;
+    qRegisterMetaType< QList<qint32> >("QList<qint32>");
+    qRegisterMetaType<SearchHits>("SearchHits");
+}
+
+
+SearchRunner::~SearchRunner() {
+    delete pendingCriteria;
+    qDeleteAll(pendingItems);
+}
+
+
+
+void SearchRunner::initialize() {
+    init = true;
+    QLOG_DEBUG() << "Starting SearchRunner";
+    db = new DatabaseConnection("searchrunner");
+
+    // The filter engine works by deleting from the filter tables.  Temporary
+    // tables are private to this connection and are found before the shared
+    // ones with the same name, so searching here doesn't touch what the
+    // main window is currently showing.
+    NSqlQuery sql(db);
+    sql.exec("create temporary table if not exists filter (lid integer)");
+    sql.exec("create temporary table if not exists anylidsfilter (lid int)");
+    sql.exec("create temporary table if not exists anylidsfilterRes (lid int)");
+    sql.finish();
+
+    // This is created here so it belongs to the search thread
+    refreshTimer = new QTimer(this);
+    refreshTimer->setSingleShot(true);
+    refreshTimer->setInterval(SAVED_SEARCH_REFRESH_MSECS);
+    connect(refreshTimer, SIGNAL(timeout()), this, SLOT(refreshPending()));
+    QLOG_DEBUG() << "SearchRunner initialization complete.";
+}
+
+
+
+//*****************************************************
+//* Take a copy of the criteria that the search thread
+//* can own.  The originals point at items in the GUI
+//* trees which may change or be deleted while we are
+//* still searching.
+//*****************************************************
+FilterCriteria* SearchRunner::copyCriteria(FilterCriteria *criteria, QList<QTreeWidgetItem*> &items) {
+    FilterCriteria *copy = new FilterCriteria();
+    if (criteria->isFavoriteSet())
+        copy->setFavorite(criteria->getFavorite());
+    if (criteria->isNotebookSet() && criteria->getNotebook() != NULL) {
+        QTreeWidgetItem *item = new QTreeWidgetItem(*criteria->getNotebook());
+        items.append(item);
+        copy->setNotebook(*item);
+    }
+    if (criteria->isTagsSet()) {
+        QList<QTreeWidgetItem*> tags = criteria->getTags();
+        QList<QTreeWidgetItem*> tagCopies;
+        for (int i=0; i<tags.size(); i++) {
+            QTreeWidgetItem *item = new QTreeWidgetItem(*tags[i]);
+            items.append(item);
+            tagCopies.append(item);
+        }
+        copy->setTags(tagCopies);
+    }
+    if (criteria->isAttributeSet() && criteria->getAttribute() != NULL) {
+        QTreeWidgetItem *item = new QTreeWidgetItem(*criteria->getAttribute());
+        items.append(item);
+        copy->setAttribute(*item);
+    }
+    if (criteria->isDeletedOnlySet())
+        copy->setDeletedOnly(criteria->getDeletedOnly());
+    if (criteria->isSearchStringSet())
+        copy->setSearchString(criteria->getSearchString());
+    return copy;
+}
+
+
+
+//*****************************************************
+//* Queue a search.  This is called from the GUI thread
+//* and returns the generation the results will be
+//* tagged with.  Any search already running is told
+//* to stop.  The search settings come with the request
+//* since only the GUI thread can read them.  If they
+//* have changed the saved searches are run again too.
+//*****************************************************
+qint32 SearchRunner::requestSearch(FilterCriteria *criteria, int minimumWeight, bool tagSelectionOr) {
+    QMutexLocker locker(&requestMutex);
+    delete pendingCriteria;
+    qDeleteAll(pendingItems);
+    pendingItems.clear();
+
+    updateSearchSettings(minimumWeight, tagSelectionOr);
+    pendingCriteria = copyCriteria(criteria, pendingItems);
+    pendingGeneration = generation.fetchAndAddOrdered(1) + 1;
+    QMetaObject::invokeMethod(this, "search", Qt::QueuedConnection);
+    return pendingGeneration;
+}
+
+
+
+// Pass on the search settings without starting a search, so saved
+// searches are refreshed with the current ones.  Called from the GUI thread.
+void SearchRunner::setSearchSettings(int minimumWeight, bool tagSelectionOr) {
+    QMutexLocker locker(&requestMutex);
+    updateSearchSettings(minimumWeight, tagSelectionOr);
+}
+
+
+// Keep the new settings.  The caller holds requestMutex.
+void SearchRunner::updateSearchSettings(int minimumWeight, bool tagSelectionOr) {
+    if (minimumWeight == this->minimumWeight && tagSelectionOr == this->tagSelectionOr)
+        return;
+    this->minimumWeight = minimumWeight;
+    this->tagSelectionOr = tagSelectionOr;
+    QMetaObject::invokeMethod(this, "refreshSavedSearches", Qt::QueuedConnection);
+}
+
+
+
+// Stop any search in progress without starting a new one.
+void SearchRunner::cancelSearch() {
+    QMutexLocker locker(&requestMutex);
+    delete pendingCriteria;
+    pendingCriteria = NULL;
+    qDeleteAll(pendingItems);
+    pendingItems.clear();
+    generation.fetchAndAddOrdered(1);
+}
+
+
+
+//*****************************************************
+//* Run the most recent search request.  Several queued
+//* calls can arrive for one request if the user types
+//* quickly; only the first finds anything to do.
+//*****************************************************
+void SearchRunner::search() {
+    requestMutex.lock();
+    FilterCriteria *criteria = pendingCriteria;
+    QList<QTreeWidgetItem*> items = pendingItems;
+    qint32 searchGeneration = pendingGeneration;
+    int weight = minimumWeight;
+    bool tagOr = tagSelectionOr;
+    pendingCriteria = NULL;
+    pendingItems.clear();
+    requestMutex.unlock();
+
+    if (criteria == NULL)
+        return;
+
+    QLOG_TRACE_IN();
+    if (!init)
+        initialize();
+
+    QElapsedTimer timer;
+    timer.start();
+    FilterEngine engine(db);
+    engine.setCancelToken(&generation, searchGeneration);
+    engine.setSearchSettings(weight, tagOr);
+    QList<qint32> lids;
+    engine.filter(criteria, &lids);
+
+    if (engine.isCancelled()) {
+        QLOG_DEBUG() << "Search " << searchGeneration << " cancelled after " << timer.elapsed() << " ms";
+    } else {
+        QLOG_DEBUG() << "Search " << searchGeneration << " found " << lids.size() << " notes in " << timer.elapsed() << " ms";
+
+        // The hits go first so they are in place before the note list is refreshed
+        if (criteria->isSearchHitsSet()) {
+            SearchHits hits;
+            criteria->getSearchHits(hits);
+            emit searchHitsFound(searchGeneration, hits, criteria->isSearchHitsComplete());
+        }
+
+        // Send the results back in batches so the note list can show
+        // the first ones while it loads the rest.  The filter works by
+        // removing notes, so nothing is known to match until it has
+        // finished; the batches only split up the painting.
+        if (lids.size() == 0)
+            emit searchResults(searchGeneration, lids, true);
+        for (int i=0; i<lids.size() && !engine.isCancelled(); i=i+batchSize) {
+            emit searchResults(searchGeneration, lids.mid(i, batchSize), i+batchSize >= lids.size());
+        }
+    }
+
+    delete criteria;
+    qDeleteAll(items);
+    QLOG_TRACE_OUT();
+}
+
+
+
+//*****************************************************
+//* Saved search refreshes.  Every saved search is run
+//* again at startup, after a sync or if its query has
+//* changed.  When notes change (the NoteTable triggers
+//* log them in SavedSearchChanges) only those notes
+//* are checked against each search.  Requests are
+//* gathered up by a timer so a burst of edits is one
+//* refresh.
+//*****************************************************
+void SearchRunner::scheduleRefresh() {
+    if (!init)
+        initialize();
+    if (!refreshTimer->isActive())
+        refreshTimer->start();
+}
+
+
+void SearchRunner::refreshSavedSearches() {
+    fullRefreshPending = true;
+    scheduleRefresh();
+}
+
+
+void SearchRunner::noteChanged(qint32 lid) {
+    changedLids.insert(lid);
+    scheduleRefresh();
+}
+
+
+// Some notes have been changed somewhere.  Check them against the saved
+// searches if the change log has anything in it.
+void SearchRunner::checkChangedNotes() {
+    if (!init)
+        initialize();
+    SearchTable searchTable(db);
+    if (searchTable.hasChanges())
+        scheduleRefresh();
+}
+
+
+void SearchRunner::refreshPending() {
+    SearchTable searchTable(db);
+    QList<qint32> loggedLids;
+    qint64 lastChange = searchTable.getChanges(loggedLids);
+    if (!fullRefreshPending && changedLids.isEmpty() && loggedLids.isEmpty())
+        return;
+    QLOG_TRACE_IN();
+    bool full = fullRefreshPending;
+    for (int i=0; i<loggedLids.size(); i++)
+        changedLids.insert(loggedLids[i]);
+    QList<qint32> candidates = changedLids.toList();
+    fullRefreshPending = false;
+    changedLids.clear();
+
+    QElapsedTimer timer;
+    timer.start();
+    QList<qint32> searches;
+    searchTable.getAll(searches);
+    for (int i=0; i<searches.size(); i++) {
+        // Don't hold up a search the user is waiting for
+        search();
+
+        SavedSearch savedSearch;
+        if (searchTable.isDeleted(searches[i]) || !searchTable.get(savedSearch, searches[i]))
+            continue;
+        refreshSearch(searches[i], savedSearch.query, full, candidates);
+    }
+    QLOG_DEBUG() << "Refreshed " << searches.size() << " saved searches in " << timer.elapsed() << " ms";
+
+    // Anything changed while we were running is left for the next refresh
+    if (lastChange > 0)
+        searchTable.clearChanges(lastChange);
+    if (searchTable.hasChanges())
+        scheduleRefresh();
+
+    sendTotals();
+    QLOG_TRACE_OUT();
+}
+
+
+
+//*****************************************************
+//* Run the saved searches with this query again.  This
+//* is for a saved search the user clicked on that had
+//* no stored results, so the rest aren't held up.
+//*****************************************************
+void SearchRunner::refreshQuery(QString query) {
+    if (!init)
+        initialize();
+    if (query.trimmed() == "")
+        return;
+    QLOG_TRACE_IN();
+    SearchTable searchTable(db);
+    QList<qint32> searches;
+    QList<qint32> candidates;
+    searchTable.getAll(searches);
+    for (int i=0; i<searches.size(); i++) {
+        SavedSearch savedSearch;
+        if (searchTable.isDeleted(searches[i]) || !searchTable.get(savedSearch, searches[i]))
+            continue;
+        if (savedSearch.query == query)
+            refreshSearch(searches[i], query, true, candidates);
+    }
+    sendTotals();
+    QLOG_TRACE_OUT();
+}
+
+
+
+// Bring the stored results for one saved search up to date.  If "full"
+// is false & the terms are current only the candidate notes are checked.
+void SearchRunner::refreshSearch(qint32 lid, QString query, bool full, QList<qint32> &candidates) {
+    if (query.trimmed() == "")
+        return;
+    requestMutex.lock();
+    int weight = minimumWeight;
+    bool tagOr = tagSelectionOr;
+    requestMutex.unlock();
+
+    SearchTable searchTable(db);
+    FilterEngine engine(db);
+    engine.setSearchSettings(weight, tagOr);
+    FilterCriteria criteria;
+    criteria.setSearchString(query);
+    QStringList terms;
+    QList<qint32> results;
+    bool current = searchTable.getTerms(lid, query, terms);
+    if (full || !current) {
+        if (!current)
+            engine.splitSearchTerms(terms, query);
+        engine.filterForSavedSearch(&criteria, terms, results);
+        searchTable.setResults(lid, query, terms, results);
+    } else {
+        engine.filterForSavedSearch(&criteria, terms, results, &candidates);
+        searchTable.updateResults(lid, candidates, results);
+    }
+}
+
+
+
+// Send the number of stored results for each saved search to the favorites
+void SearchRunner::sendTotals() {
+    SearchTable searchTable(db);
+    QHash<qint32, qint32> counts;
+    searchTable.getResultCounts(counts);
+    CounterTotals totals;
+    QHash<qint32, qint32>::iterator i;
+    for (i=counts.begin(); i!=counts.end(); ++i)
+        totals.insert(i.key(), QPair<qint32, qint32>(i.value(), i.value()));
+    emit savedSearchTotals(totals);
+}
@@ -0,0 +1,99 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef SEARCHRUNNER_H
+#define SEARCHRUNNER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QList>
+#include <QSet>
+#include <QTimer>
+#include <QTreeWidgetItem>
+#include "global.h"
+#include "filters/filtercriteria.h"
+#include "sql/databaseconnection.h"
+#include "threads/counterrunner.h"
+
+extern Global global;
+
+// How long to wait for more note changes before saved searches are refreshed
+#define SAVED_SEARCH_REFRESH_MSECS  2000
+
+
+//*****************************************************
+//* Run note searches on their own thread & database
+//* connection so typing in the search box doesn't
+//* block the GUI.  Each request gets a generation
+//* number; a newer request cancels anything older.
+//*
+//* The results of saved searches are also stored &
+//* kept current here so they can be shown without
+//* searching when one is clicked.
+//*****************************************************
+class SearchRunner : public QObject
+{
+    Q_OBJECT
+private:
+    DatabaseConnection *db;
+    bool init;
+    void initialize();
+
+    QMutex requestMutex;                   // Protects the pending request
+    FilterCriteria *pendingCriteria;       // Latest request not yet picked up by the thread
+    QList<QTreeWidgetItem*> pendingItems;  // Copies of tree items the pending request refers to
+    qint32 pendingGeneration;
+    int minimumWeight;                     // Search settings read by the GUI thread.  Protected
+    bool tagSelectionOr;                   // by requestMutex.
+    QAtomicInt generation;                 // Newest generation requested.  Used as the cancel token.
+    FilterCriteria *copyCriteria(FilterCriteria *criteria, QList<QTreeWidgetItem*> &items);
+    void updateSearchSettings(int minimumWeight, bool tagSelectionOr);
+
+    QTimer *refreshTimer;                  // Coalesces saved search refreshes
+    QSet<qint32> changedLids;              // Notes changed since the last refresh
+    bool fullRefreshPending;               // Every saved search needs to be run again
+    void scheduleRefresh();
+    void refreshSearch(qint32 lid, QString query, bool full, QList<qint32> &candidates);
+    void sendTotals();
+
+public:
+    explicit SearchRunner(QObject *parent = 0);
+    ~SearchRunner();
+    int batchSize;                         // Number of lids sent in each searchResults() signal
+    qint32 requestSearch(FilterCriteria *criteria, int minimumWeight, bool tagSelectionOr);
+    void setSearchSettings(int minimumWeight, bool tagSelectionOr);
+    void cancelSearch();
+
+signals:
+    void searchResults(qint32 generation, QList<qint32> lids, bool finished);
+    void searchHitsFound(qint32 generation, SearchHits hits, bool complete);
+    void savedSearchTotals(CounterTotals totals);
+
+public slots:
+    void search();
+    void refreshSavedSearches();
+    void noteChanged(qint32 lid);
+    void checkChangedNotes();
+    void refreshPending();
+    void refreshQuery(QString query);
+
+};
+
+#endif // SEARCHRUNNER_H
@@ -0,0 +1,265 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "syncchunkfetcher.h"
+#include "global.h"
+
+#include <QElapsedTimer>
+
+extern Global global;
+
+
+FetchedChunk::FetchedChunk() {
+    ok = true;
+}
+
+
+FetchedChunk::~FetchedChunk() {
+    for (int i=0; i<inkNotes.size(); i++) {
+        delete inkNotes[i]->second;
+        delete inkNotes[i];
+    }
+}
+
+
+
+
+SyncChunkFetcher::SyncChunkFetcher(CommunicationManager *comm, qint32 usn, qint32 chunkSize, qint32 types, bool fullSync) {
+    this->comm = comm;
+    this->usn = usn;
+    this->chunkSize = chunkSize;
+    this->types = types;
+    this->fullSync = fullSync;
+    fetchMsecs = 0;
+    applyMsecs = 0;
+    entryBytes = 0;
+    cancelled = false;
+    finished = false;
+}
+
+
+SyncChunkFetcher::~SyncChunkFetcher() {
+    cancel();
+    wait();
+    qDeleteAll(chunks);
+}
+
+
+
+// Download chunks until the last one, a failure or a cancel.  A failed
+// chunk is handed over like any other so the sync thread sees the error.
+void SyncChunkFetcher::run() {
+    bool more = true;
+    while (more) {
+        mutex.lock();
+        more = !cancelled;
+        mutex.unlock();
+        if (!more)
+            break;
+
+        FetchedChunk *fetched = new FetchedChunk();
+        QElapsedTimer timer;
+        timer.start();
+        fetched->ok = comm->getSyncChunk(fetched->chunk, usn, chunkSize, types, fullSync);
+        if (fetched->ok)
+            resize(fetched->chunk, timer.elapsed());
+
+        // The ink notes downloaded for this chunk go with it
+        while (comm->inkNoteList->size() > 0)
+            fetched->inkNotes.append(comm->inkNoteList->takeFirst());
+
+        more = fetched->ok && fetched->chunk.chunkHighUSN.isSet() &&
+                fetched->chunk.chunkHighUSN < fetched->chunk.updateCount;
+        if (fetched->chunk.chunkHighUSN.isSet())
+            usn = fetched->chunk.chunkHighUSN;
+        QLOG_DEBUG() << "Fetched chunk up to USN " << usn;
+        if (!put(fetched))
+            break;
+    }
+
+    mutex.lock();
+    finished = true;
+    notEmpty.wakeAll();
+    mutex.unlock();
+}
+
+
+
+// Hand a chunk to the sync thread, waiting while too many are waiting.
+// Returns false if the fetch was cancelled.
+bool SyncChunkFetcher::put(FetchedChunk *fetched) {
+    QMutexLocker locker(&mutex);
+    while (!cancelled && chunks.size() >= SYNC_PREFETCH_CHUNKS)
+        notFull.wait(&mutex);
+    if (cancelled) {
+        delete fetched;
+        return false;
+    }
+    chunks.append(fetched);
+    notEmpty.wakeAll();
+    return true;
+}
+
+
+
+FetchedChunk *SyncChunkFetcher::take() {
+    QMutexLocker locker(&mutex);
+    while (chunks.size() == 0 && !finished && !cancelled)
+        notEmpty.wait(&mutex);
+    if (chunks.size() == 0)
+        return NULL;
+    FetchedChunk *fetched = chunks.takeFirst();
+    notFull.wakeAll();
+    return fetched;
+}
+
+
+
+// Stop downloading.  The chunk being downloaded is finished first, so
+// call wait() before using the CommunicationManager again.
+void SyncChunkFetcher::cancel() {
+    QMutexLocker locker(&mutex);
+    cancelled = true;
+    qDeleteAll(chunks);
+    chunks.clear();
+    notFull.wakeAll();
+    notEmpty.wakeAll();
+}
+
+
+
+// The sync thread has written a chunk
+void SyncChunkFetcher::applied(const SyncChunk &chunk, qint64 msecs) {
+    qint32 entries = entryCount(chunk);
+    if (entries == 0)
+        return;
+    QMutexLocker locker(&mutex);
+    applyMsecs = average(applyMsecs, double(msecs)/entries);
+}
+
+
+
+// Pick the size of the next chunk from how the last ones went.  It is
+// whatever would take SYNC_CHUNK_TARGET_MSECS to download or
+// SYNC_CHUNK_WRITE_MSECS to write, whichever is fewer, cut down to keep
+// under SYNC_CHUNK_MAX_BYTES.  It only doubles at a time but shrinks as
+// far as it needs to at once.
+void SyncChunkFetcher::resize(const SyncChunk &chunk, qint64 msecs) {
+    qint32 entries = entryCount(chunk);
+    if (entries == 0)
+        return;
+    fetchMsecs = average(fetchMsecs, double(msecs)/entries);
+    entryBytes = average(entryBytes, double(byteCount(chunk))/entries);
+    mutex.lock();
+    double writeMsecs = applyMsecs;
+    mutex.unlock();
+
+    double size = SYNC_CHUNK_MAX_ENTRIES;
+    if (fetchMsecs > 0)
+        size = qMin(size, SYNC_CHUNK_TARGET_MSECS/fetchMsecs);
+    if (writeMsecs > 0)
+        size = qMin(size, SYNC_CHUNK_WRITE_MSECS/writeMsecs);
+    if (entryBytes > 0)
+        size = qMin(size, SYNC_CHUNK_MAX_BYTES/entryBytes);
+    size = qMin(size, chunkSize*2.0);
+    size = qMax(size, double(SYNC_CHUNK_MIN_ENTRIES));
+
+    if (qint32(size) != chunkSize)
+        QLOG_DEBUG() << "Sync chunk size " << chunkSize << " -> " << qint32(size)
+                     << " (" << fetchMsecs << "ms download, " << writeMsecs << "ms write, "
+                     << qint64(entryBytes) << " bytes per entry)";
+    chunkSize = qint32(size);
+}
+
+
+
+// Running average that moves up to a bigger value at once so a run of
+// large or slow entries is allowed for straight away.
+double SyncChunkFetcher::average(double old, double latest) {
+    if (latest >= old)
+        return latest;
+    return (old+latest)/2;
+}
+
+
+
+qint32 SyncChunkFetcher::entryCount(const SyncChunk &chunk) {
+    qint32 count = 0;
+    if (chunk.notes.isSet())
+        count += chunk.notes.ref().size();
+    if (chunk.resources.isSet())
+        count += chunk.resources.ref().size();
+    if (chunk.notebooks.isSet())
+        count += chunk.notebooks.ref().size();
+    if (chunk.tags.isSet())
+        count += chunk.tags.ref().size();
+    if (chunk.searches.isSet())
+        count += chunk.searches.ref().size();
+    if (chunk.linkedNotebooks.isSet())
+        count += chunk.linkedNotebooks.ref().size();
+    if (chunk.expungedNotes.isSet())
+        count += chunk.expungedNotes.ref().size();
+    if (chunk.expungedNotebooks.isSet())
+        count += chunk.expungedNotebooks.ref().size();
+    if (chunk.expungedTags.isSet())
+        count += chunk.expungedTags.ref().size();
+    if (chunk.expungedSearches.isSet())
+        count += chunk.expungedSearches.ref().size();
+    if (chunk.expungedLinkedNotebooks.isSet())
+        count += chunk.expungedLinkedNotebooks.ref().size();
+    return count;
+}
+
+
+
+// Roughly how much memory the note content & resource data in a chunk take
+qint64 SyncChunkFetcher::byteCount(const SyncChunk &chunk) {
+    qint64 bytes = 0;
+    if (chunk.notes.isSet()) {
+        const QList<Note> &notes = chunk.notes.ref();
+        for (int i=0; i<notes.size(); i++) {
+            if (notes[i].content.isSet())
+                bytes += notes[i].content.ref().size();
+            if (notes[i].resources.isSet()) {
+                const QList<Resource> &resources = notes[i].resources.ref();
+                for (int j=0; j<resources.size(); j++)
+                    bytes += byteCount(resources[j]);
+            }
+        }
+    }
+    if (chunk.resources.isSet()) {
+        const QList<Resource> &resources = chunk.resources.ref();
+        for (int i=0; i<resources.size(); i++)
+            bytes += byteCount(resources[i]);
+    }
+    return bytes;
+}
+
+
+
+qint64 SyncChunkFetcher::byteCount(const Resource &r) {
+    qint64 bytes = 0;
+    if (r.data.isSet() && r.data.ref().body.isSet())
+        bytes += r.data.ref().body.ref().size();
+    if (r.recognition.isSet() && r.recognition.ref().body.isSet())
+        bytes += r.recognition.ref().body.ref().size();
+    if (r.alternateData.isSet() && r.alternateData.ref().body.isSet())
+        bytes += r.alternateData.ref().body.ref().size();
+    return bytes;
+}
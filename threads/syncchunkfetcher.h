@@ -0,0 +1,117 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef SYNCCHUNKFETCHER_H
+#define SYNCCHUNKFETCHER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QImage>
+#include "communication/communicationmanager.h"
+
+#include "qevercloud/include/QEverCloud.h"
+using namespace qevercloud;
+
+// Chunks downloaded ahead of the one being written to the database
+#define SYNC_PREFETCH_CHUNKS    2
+
+// Limits on the number of entries asked for in one chunk.  Within them
+// the size follows how long entries take to download & write and how
+// big they are.
+#define SYNC_CHUNK_MIN_ENTRIES  1
+#define SYNC_CHUNK_MAX_ENTRIES  5000
+#define SYNC_CHUNK_TARGET_MSECS 10000           // Aim for a chunk to download in about this long
+#define SYNC_CHUNK_WRITE_MSECS  2000            // ... & to be written in about this long.  It is one transaction, so other writers wait for it.
+#define SYNC_CHUNK_MAX_BYTES    (16*1024*1024)  // Most note & resource data to hold for one chunk
+
+
+// A sync chunk with everything downloaded for it: the full notes &
+// resources and any ink note images.
+class FetchedChunk
+{
+public:
+    SyncChunk chunk;
+    QList< QPair<QString, QImage*>* > inkNotes;
+    bool ok;                                 // False if the download failed.  The error is in the CommunicationManager.
+    FetchedChunk();
+    ~FetchedChunk();
+};
+
+
+
+//*****************************************************************
+//* Download sync chunks on their own thread so the next chunk is
+//* on its way while the sync thread writes the last one to the
+//* database.  Only SYNC_PREFETCH_CHUNKS are kept waiting, so memory
+//* stays bounded if the database is the slow side.  Chunks are
+//* handed over in USN order & the sync thread still records the
+//* USN after writing each one, so an interrupted sync carries on
+//* from the last chunk written.
+//*
+//* The number of entries asked for starts at the caller's chunk
+//* size & then adapts: chunks of small notes grow until a chunk takes
+//* about SYNC_CHUNK_TARGET_MSECS to download or SYNC_CHUNK_WRITE_MSECS
+//* to write, and chunks
+//* of big resources shrink to stay under SYNC_CHUNK_MAX_BYTES.
+//*
+//* The CommunicationManager belongs to this thread until it has
+//* finished (take() returned NULL or a failed chunk, or after
+//* cancel() & wait()).
+//*****************************************************************
+class SyncChunkFetcher : public QThread
+{
+    Q_OBJECT
+private:
+    CommunicationManager *comm;
+    qint32 usn;                              // Where the next chunk starts
+    qint32 chunkSize;
+    qint32 types;
+    bool fullSync;
+    double fetchMsecs;                       // Download time per entry, averaged
+    double applyMsecs;                       // Time per entry to write to the database, averaged
+    double entryBytes;                       // Data per entry, averaged
+    QMutex mutex;
+    QWaitCondition notFull;
+    QWaitCondition notEmpty;
+    QList<FetchedChunk*> chunks;             // Downloaded, waiting to be taken
+    bool cancelled;
+    bool finished;                           // No more chunks are coming
+    bool put(FetchedChunk *fetched);
+    void resize(const SyncChunk &chunk, qint64 msecs);
+    static double average(double old, double latest);
+    static qint32 entryCount(const SyncChunk &chunk);
+    static qint64 byteCount(const SyncChunk &chunk);
+    static qint64 byteCount(const Resource &r);
+
+protected:
+    void run();
+
+public:
+    SyncChunkFetcher(CommunicationManager *comm, qint32 usn, qint32 chunkSize, qint32 types, bool fullSync);
+    ~SyncChunkFetcher();
+    FetchedChunk *take();                    // Wait for the next chunk.  NULL once there are no more.
+    void cancel();                           // Stop downloading & drop anything not taken
+    void applied(const SyncChunk &chunk, qint64 msecs);  // A chunk took this long to write
+};
+
+#endif // SYNCCHUNKFETCHER_H
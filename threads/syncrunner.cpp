@@ -18,6 +18,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 ***********************************************************************************/
 
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QStringList>
 
 #include "syncrunner.h"
 #include "global.h"
@@ -34,6 +37,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "communication/communicationmanager.h"
 #include "communication/communicationerror.h"
 #include "sql/nsqlquery.h"
+#include "threads/indexrunner.h"
+#include "threads/syncchunkfetcher.h"
+#include "threads/noteuploader.h"
 
 extern Global global;
 
@@ -42,6 +48,7 @@ SyncRunner::SyncRunner()
     init = false;
     finalSync = false;
     apiRateLimitExceeded=false;
+    inChunk = false;
 }
 
 SyncRunner::~SyncRunner() {
@@ -215,79 +222,219 @@ bool SyncRunner::syncRemoteToLocal(qint32 updateCount) {
     // Part #4: Do linked notebook stuff.  Basically the same as
     //          this except we do it across multiple accounts.
 
-    int chunkSize = 5000;
-    bool more = true;
-
-    bool rc;
     int startingSequenceNumber = updateSequenceNumber;
-
-    while(more && keepRunning)  {
-        SyncChunk chunk;
-        rc = comm->getSyncChunk(chunk, updateSequenceNumber, chunkSize,
-                                SYNC_CHUNK_LINKED_NOTEBOOKS | SYNC_CHUNK_NOTEBOOKS |
-                                SYNC_CHUNK_TAGS | SYNC_CHUNK_SEARCHES | SYNC_CHUNK_EXPUNGED,
-                                fullSync);
-        if (!rc) {
-            QLOG_ERROR() << "Error retrieving chunk";
-            error = true;
-            this->communicationErrorHandler();
-            QLOG_TRACE_OUT();
-            return false;
-        }
-        QLOG_DEBUG() << "-(Pass 1)->>>>  Old USN:" << updateSequenceNumber << " New USN:" << chunk.chunkHighUSN;
-        int pct = (updateSequenceNumber-startingSequenceNumber)*100/(updateCount-startingSequenceNumber);
-        emit setMessage(tr("Download ") +QString::number(pct) + tr("% complete for notebooks, tags, & searches."), defaultMsgTimeout);
-
-        processSyncChunk(chunk);
-
-        updateSequenceNumber = chunk.chunkHighUSN;
-        if (!chunk.chunkHighUSN.isSet() || chunk.chunkHighUSN >= chunk.updateCount)
-            more = false;
+    if (!syncChunks(5000, SYNC_CHUNK_LINKED_NOTEBOOKS | SYNC_CHUNK_NOTEBOOKS |
+                    SYNC_CHUNK_TAGS | SYNC_CHUNK_SEARCHES | SYNC_CHUNK_EXPUNGED,
+                    false, startingSequenceNumber, updateCount)) {
+        QLOG_TRACE_OUT();
+        return false;
     }
 
     emit setMessage(tr("Download complete for notebooks, tags, & searches.  Downloading notes."), defaultMsgTimeout);
 
     comm->loadTagGuidMap();
-    more = true;
-    chunkSize = 50;
     updateSequenceNumber = startingSequenceNumber;
-    UserTable userTable(db);
+    if (!syncChunks(20, SYNC_CHUNK_NOTES | SYNC_CHUNK_RESOURCES, true, startingSequenceNumber, updateCount)) {
+        QLOG_TRACE_OUT();
+        return false;
+    }
+
+    emit setMessage(tr("Download complete."), defaultMsgTimeout);
+    QLOG_TRACE_OUT();
+    return true;
+}
 
 
-    while(more && keepRunning)  {
-        SyncChunk chunk;
-        rc = comm->getSyncChunk(chunk, updateSequenceNumber, chunkSize, SYNC_CHUNK_NOTES | SYNC_CHUNK_RESOURCES, fullSync);
-        if (!rc) {
+
+// Download chunks starting at updateSequenceNumber & write them to the
+// database.  A SyncChunkFetcher downloads the next chunks while this
+// thread writes the current one.  On the notes pass the USN is saved
+// after each chunk is written, so a sync that stops part way picks up
+// from there next time.  Each chunk is written in one transaction
+// along with its USN, so the database never has part of a chunk.
+// chunkSize is only where the fetcher starts; it adjusts the size as
+// it goes.
+bool SyncRunner::syncChunks(qint32 chunkSize, qint32 types, bool notes, qint32 startingSequenceNumber, qint32 updateCount) {
+    UserTable userTable(db);
+    SyncChunkFetcher fetcher(comm, updateSequenceNumber, chunkSize, types, fullSync);
+    fetcher.start();
+    bool written = true;
+
+    while (keepRunning) {
+        FetchedChunk *fetched = fetcher.take();
+        if (fetched == NULL)
+            break;
+        if (!fetched->ok) {
+            delete fetched;
+            fetcher.wait();
             QLOG_ERROR() << "Error retrieving chunk";
             error = true;
             this->communicationErrorHandler();
-            QLOG_TRACE_OUT();
             return false;
         }
-        QLOG_DEBUG() << "-(Pass 2) ->>>>  Old USN:" << updateSequenceNumber << " New USN:" << chunk.chunkHighUSN;
+        SyncChunk &chunk = fetched->chunk;
+        QLOG_DEBUG() << (notes ? "-(Pass 2) ->>>>  Old USN:" : "-(Pass 1)->>>>  Old USN:")
+                     << updateSequenceNumber << " New USN:" << chunk.chunkHighUSN;
         int pct = (updateSequenceNumber-startingSequenceNumber)*100/(updateCount-startingSequenceNumber);
-        emit setMessage(tr("Download ") +QString::number(pct) + tr("% complete."), defaultMsgTimeout);
-        processSyncChunk(chunk);
-
-        userTable.updateLastSyncNumber(chunk.chunkHighUSN);
-        userTable.updateLastSyncDate(chunk.currentTime);
-
-        updateSequenceNumber = chunk.chunkHighUSN;
-        if (!chunk.chunkHighUSN.isSet() || chunk.chunkHighUSN >= chunk.updateCount) {
-            more = false;
+        if (notes)
+            emit setMessage(tr("Download ") +QString::number(pct) + tr("% complete."), defaultMsgTimeout);
+        else
+            emit setMessage(tr("Download ") +QString::number(pct) + tr("% complete for notebooks, tags, & searches."), defaultMsgTimeout);
+
+        QElapsedTimer timer;
+        timer.start();
+        if (!beginChunk()) {
+            delete fetched;
+            written = false;
+            break;
+        }
+        processSyncChunk(chunk, 0, &fetched->inkNotes);
+        if (!keepRunning) {
+            // Stopped part way through.  Leave the whole chunk for next time.
+            rollbackChunk();
+            delete fetched;
+            break;
+        }
+        if (notes) {
+            userTable.updateLastSyncNumber(chunk.chunkHighUSN);
+            userTable.updateLastSyncDate(chunk.currentTime);
+        }
+        if (notes && (!chunk.chunkHighUSN.isSet() || chunk.chunkHighUSN >= chunk.updateCount))
             userTable.updateLastSyncNumber(updateCount);
+        if (!commitChunk()) {
+            delete fetched;
+            written = false;
+            break;
         }
+        updateSequenceNumber = chunk.chunkHighUSN;
+        fetcher.applied(chunk, timer.elapsed());
+        delete fetched;
     }
 
-    emit setMessage(tr("Download complete."), defaultMsgTimeout);
-    QLOG_TRACE_OUT();
+    // Stopped early.  Let the download in progress finish before anything
+    // else uses the connection.
+    fetcher.cancel();
+    fetcher.wait();
+    if (!written) {
+        // The database didn't take the chunk.  Stop here & pick up from
+        // the last chunk that was written next time.
+        error = true;
+        emit setMessage(tr("Error saving sync data.  Sync stopped."), defaultMsgTimeout);
+        return false;
+    }
+    return true;
+}
+
+
+
+// Start writing a chunk.  Everything up to commitChunk() is one
+// transaction & the GUI isn't told about any of it until then.  The
+// write lock is taken right away ("immediate") so the reads at the start
+// of the chunk can't leave us with a snapshot the index thread has
+// written past.  db->inTransaction stops the table classes starting or
+// committing their own transactions part way through.
+bool SyncRunner::beginChunk() {
+    NSqlQuery sql(db);
+    if (!sql.exec("begin immediate")) {
+        QLOG_ERROR() << "Unable to start sync chunk transaction: " << sql.lastError();
+        return false;
+    }
+    inChunk = true;
+    db->inTransaction = true;
     return true;
 }
 
 
 
-// Deal with the sync chunk returned
-void SyncRunner::processSyncChunk(SyncChunk &chunk, qint32 linkedNotebook) {
+// Finish writing a chunk & tell everyone what changed.  If the commit
+// fails nothing was written, so nothing is sent to the GUI.
+bool SyncRunner::commitChunk() {
+    NSqlQuery sql(db);
+    bool ok = sql.exec("commit");
+    if (!ok) {
+        QLOG_ERROR() << "Unable to commit sync chunk: " << sql.lastError();
+        rollbackChunk();
+        return false;
+    }
+    inChunk = false;
+    db->inTransaction = false;
+    for (int i=0; i<notices.size(); i++)
+        sendNotice(notices[i]);
+    notices.clear();
+    return true;
+}
+
+
+
+// Throw away a chunk that wasn't finished.  Nothing was sent to the GUI.
+void SyncRunner::rollbackChunk() {
+    NSqlQuery sql(db);
+    sql.exec("rollback");
+    inChunk = false;
+    db->inTransaction = false;
+    notices.clear();
+}
+
+
+
+// Let the GUI know about a change, or hold on to it until the chunk
+// it is part of has been committed.
+void SyncRunner::notify(SyncNotice::Type type, qint32 lid, QString name, QString extra, qint32 account, bool linked, bool shared) {
+    SyncNotice notice;
+    notice.type = type;
+    notice.lid = lid;
+    notice.name = name;
+    notice.extra = extra;
+    notice.account = account;
+    notice.linked = linked;
+    notice.shared = shared;
+    if (inChunk)
+        notices.append(notice);
+    else
+        sendNotice(notice);
+}
+
+
+
+void SyncRunner::sendNotice(const SyncNotice &notice) {
+    switch (notice.type) {
+    case SyncNotice::NoteUpdated:
+        // Remove it from the cache (if it exists)
+        if (global.cache.contains(notice.lid)) {
+            delete global.cache[notice.lid];
+            global.cache.remove(notice.lid);
+        }
+        if (global.indexRunner != NULL)
+            global.indexRunner->prioritize(notice.lid, INDEX_PRIORITY_SYNC);
+        if (!finalSync)
+            emit noteUpdated(notice.lid);
+        break;
+    case SyncNotice::TagUpdated:
+        emit tagUpdated(notice.lid, notice.name, notice.extra, notice.account);
+        break;
+    case SyncNotice::NotebookUpdated:
+        emit notebookUpdated(notice.lid, notice.name, notice.extra, notice.linked, notice.shared);
+        break;
+    case SyncNotice::SearchUpdated:
+        emit searchUpdated(notice.lid, notice.name);
+        break;
+    case SyncNotice::TagExpunged:
+        emit tagExpunged(notice.lid);
+        break;
+    case SyncNotice::NotebookExpunged:
+        emit notebookExpunged(notice.lid);
+        break;
+    case SyncNotice::SearchExpunged:
+        emit searchExpunged(notice.lid);
+        break;
+    }
+}
+
+
+
+// Deal with the sync chunk returned.  The ink notes come with the chunk
+// when it was downloaded ahead, otherwise they're still in comm.
+void SyncRunner::processSyncChunk(SyncChunk &chunk, qint32 linkedNotebook, QList< QPair<QString, QImage*>* > *inkNotes) {
 
     // Now start processing the chunk
     if (chunk.expungedNotes.isSet())
@@ -352,8 +499,10 @@ void SyncRunner::processSyncChunk(SyncChunk &chunk, qint32 linkedNotebook) {
     }
 
     // Save any ink notes
-    while (comm->inkNoteList->size() > 0) {
-        QPair<QString, QImage *> *pair = comm->inkNoteList->takeFirst();
+    if (inkNotes == NULL)
+        inkNotes = comm->inkNoteList;
+    while (inkNotes->size() > 0) {
+        QPair<QString, QImage *> *pair = inkNotes->takeFirst();
         ResourceTable resTable(db);
         qint32 resLid = resTable.getLid(pair->first);
         if (resLid > 0) {
@@ -386,7 +535,7 @@ void SyncRunner::syncRemoteExpungedNotebooks(QList<Guid> guids) {
         int lid = notebookTable.getLid(guids[i]);
         notebookTable.expunge(guids[i]);
         if (!finalSync)
-            emit notebookExpunged(lid);
+            notify(SyncNotice::NotebookExpunged, lid);
     }
     QLOG_TRACE() << "Leaving SyncRunner::syncRemoteExpungedNotebooks";
 }
@@ -400,7 +549,7 @@ void SyncRunner::syncRemoteExpungedTags(QList<Guid> guids) {
         int lid = tagTable.getLid(guids[i]);
         tagTable.expunge(guids[i]);
         if (!finalSync)
-            emit tagExpunged(lid);
+            notify(SyncNotice::TagExpunged, lid);
     }
     QLOG_TRACE() << "Leaving SyncRunner::syncRemoteExpungedTags";
 }
@@ -414,7 +563,7 @@ void SyncRunner::syncRemoteExpungedSavedSearches(QList<Guid> guids) {
         int lid = searchTable.getLid(guids[i]);
         searchTable.expunge(guids[i]);
         if (!finalSync)
-            emit searchExpunged(lid);
+            notify(SyncNotice::SearchExpunged, lid);
     }
     QLOG_TRACE() << "Leaving SyncRunner::syncRemoteExpungedSavedSearches";
 }
@@ -461,9 +610,9 @@ void SyncRunner::syncRemoteTags(QList<Tag> tags, qint32 account) {
             parentGuid = t.parentGuid;
         if (!finalSync) {
             if (t.name.isSet())
-                emit tagUpdated(lid, t.name, parentGuid, account);
+                notify(SyncNotice::TagUpdated, lid, t.name, parentGuid, account);
             else
-                emit(tagUpdated(lid, "", parentGuid, account));
+                notify(SyncNotice::TagUpdated, lid, "", parentGuid, account);
             }
     }
 
@@ -488,9 +637,9 @@ void SyncRunner::syncRemoteSearches(QList<SavedSearch> searches) {
         }
         if (!finalSync) {
             if (t.name.isSet())
-                emit searchUpdated(lid, t.name);
+                notify(SyncNotice::SearchUpdated, lid, t.name);
             else
-                emit searchUpdated(lid, "");
+                notify(SyncNotice::SearchUpdated, lid);
         }
     }
 
@@ -552,9 +701,9 @@ void SyncRunner::syncRemoteNotebooks(QList<Notebook> books, qint32 account) {
         }
         if (!finalSync) {
             if (t.name.isSet())
-                emit notebookUpdated(lid, t.name, stack, false, shared);
+                notify(SyncNotice::NotebookUpdated, lid, t.name, stack, 0, false, shared);
             else
-                emit notebookUpdated(lid, "", stack, false, shared);
+                notify(SyncNotice::NotebookUpdated, lid, "", stack, 0, false, shared);
         }
     }
     QLOG_TRACE() << "Leaving SyncRunner::syncRemoteNotebooks";
@@ -567,30 +716,34 @@ void SyncRunner::syncRemoteNotes(QList<Note> notes, qint32 account) {
     NoteTable noteTable(db);
     NotebookTable bookTable(db);
 
+    // Find the notes we already have & which of them have local
+    // changes, all at once rather than a note at a time
+    QStringList guids;
+    for (int i=0; i<notes.size(); i++)
+        guids.append(notes[i].guid);
+    QHash<QString, qint32> lids;
+    noteTable.getLids(guids, lids);
+    QSet<qint32> dirty;
+    noteTable.getDirty(lids.values(), dirty);
+
     for (int i=0; i<notes.size() && keepRunning; i++) {
         Note t = notes[i];
-        qint32 lid = noteTable.getLid(t.guid);
+        qint32 lid = lids.value(t.guid, 0);
         if (lid > 0) {
             // Find out if it is a conflicting change
-            if (noteTable.isDirty(lid)) {
+            if (dirty.contains(lid)) {
                 qint32 newLid = noteTable.duplicateNote(lid);
                 qint32 conflictNotebook = bookTable.getConflictNotebook();
                 noteTable.updateNotebook(newLid, conflictNotebook, true);
                 if (!finalSync)
-                    emit noteUpdated(newLid);
+                    notify(SyncNotice::NoteUpdated, newLid);
              }
             noteTable.sync(lid, notes.at(i), account);
         } else {
-            noteTable.sync(t, account);
-            lid = noteTable.getLid(t.guid);
-        }
-        // Remove it from the cache (if it exists)
-        if (global.cache.contains(lid)) {
-            delete global.cache[lid];
-            global.cache.remove(lid);
+            lid = noteTable.sync(t, account);
+            lids.insert(t.guid, lid);
         }
-        if (!finalSync)
-            emit noteUpdated(lid);
+        notify(SyncNotice::NoteUpdated, lid);
     }
 
     QLOG_TRACE() << "Leaving SyncRunner::syncRemoteNotes";
@@ -602,10 +755,26 @@ void SyncRunner::syncRemoteNotes(QList<Note> notes, qint32 account) {
 void SyncRunner::syncRemoteResources(QList<Resource> resources) {
     QLOG_TRACE() << "Entering SyncRunner::syncRemoteResources";
     ResourceTable resTable(db);
+    NoteTable noteTable(db);
+
+    // Look up the resources & the notes they belong to all at once.
+    // This is done after the chunk's notes are written since writing
+    // a note replaces its resources.
+    QStringList guids;
+    QStringList noteGuids;
+    for (int i=0; i<resources.size(); i++) {
+        guids.append(resources[i].guid);
+        noteGuids.append(resources[i].noteGuid);
+    }
+    QHash<QPair<qint32, QString>, qint32> lids;
+    resTable.getLids(guids, lids);
+    QHash<QString, qint32> noteLids;
+    noteTable.getLids(noteGuids, noteLids);
 
     for (int i=0; i<resources.size(); i++) {
         Resource r = resources[i];
-        qint32 lid = resTable.getLid(r.noteGuid, r.guid);
+        qint32 noteLid = noteLids.value(r.noteGuid, 0);
+        qint32 lid = lids.value(QPair<qint32, QString>(noteLid, r.guid), 0);
         if (lid > 0)
             resTable.sync(lid, r);
         else
@@ -630,7 +799,7 @@ void SyncRunner::syncRemoteLinkedNotebooksChunk(QList<LinkedNotebook> books) {
         if (lbk.username.isSet())
             username = lbk.username;
         if (!finalSync)
-            emit notebookUpdated(lid, sharename, username, true, false);
+            notify(SyncNotice::NotebookUpdated, lid, sharename, username, 0, true, false);
     }
     QLOG_TRACE_OUT();
 }
@@ -700,7 +869,17 @@ bool SyncRunner::syncRemoteLinkedNotebooksActual() {
                     return false;
                 }
             } else {
+                if (!beginChunk()) {
+                    error = true;
+                    QLOG_TRACE_OUT();
+                    return false;
+                }
                 processSyncChunk(chunk, lids[i]);
+                if (!commitChunk()) {
+                    error = true;
+                    QLOG_TRACE_OUT();
+                    return false;
+                }
                 usn = chunk.chunkHighUSN;
                 if (chunk.updateCount > 0 && chunk.updateCount > startingSequenceNumber) {
                     int pct = (usn-startingSequenceNumber)*100/(chunk.updateCount-startingSequenceNumber);
@@ -740,7 +919,19 @@ bool SyncRunner::syncRemoteLinkedNotebooksActual() {
                     return false;
                 }
             } else {
+                if (!beginChunk()) {
+                    error = true;
+                    return false;
+                }
                 processSyncChunk(chunk, lids[i]);
+                if (!chunk.chunkHighUSN.isSet() || chunk.chunkHighUSN >= chunk.updateCount) {
+                    more = false;
+                    ltable.setLastUpdateSequenceNumber(lids[i], syncState.updateCount);
+                }
+                if (!commitChunk()) {
+                    error = true;
+                    return false;
+                }
                 usn = chunk.chunkHighUSN;
                 if (chunk.updateCount > 0 && chunk.updateCount > startingSequenceNumber) {
                     int pct = (usn-startingSequenceNumber)*100/(chunk.updateCount-startingSequenceNumber);
@@ -749,10 +940,6 @@ bool SyncRunner::syncRemoteLinkedNotebooksActual() {
                         sharename = book.shareName;
                     emit setMessage(tr("Downloading ") +QString::number(pct) + tr("% complete for shared notebook ") +sharename + tr("."), defaultMsgTimeout);
                 }
-                if (!chunk.chunkHighUSN.isSet() || chunk.chunkHighUSN >= chunk.updateCount) {
-                    more = false;
-                    ltable.setLastUpdateSequenceNumber(lids[i], syncState.updateCount);
-                }
             }
         }
 
@@ -861,7 +1048,7 @@ void SyncRunner::syncRemoteExpungedLinkedNotebooks(QList<Guid> guids) {
         LinkedNotebookTable ntable(db);
         qint32 lid = ntable.getLid(guids[i]);
         btable.expunge(guids[i]);
-        emit notebookExpunged(lid);
+        notify(SyncNotice::NotebookExpunged, lid);
     }
 }
 
@@ -1173,35 +1360,28 @@ qint32 SyncRunner::uploadPersonalNotes() {
     }
 
 
-    // Start uploading notes
-    for (int i=0; i<validLids.size(); i++) {
-        Note note;
-        noteTable.get(note, validLids[i],true, true);
-
-        qint32 oldUsn=0;
-        if (note.updateSequenceNum.isSet())
-            oldUsn = note.updateSequenceNum;
-        usn = comm->uploadNote(note);
-        if (usn == 0) {
+    // Start uploading notes.  A few go at once; each is marked clean
+    // by the uploader as soon as Evernote has it.
+    NoteUploader uploader(comm, db, &keepRunning);
+    uploader.upload(validLids);
+    for (int i=0; i<uploader.results.size(); i++) {
+        NoteUpload *upload = uploader.results[i];
+        if (upload->usn == 0) {
+            comm->error.type = upload->errorType;
+            comm->error.message = upload->errorMessage;
+            comm->error.code = upload->errorCode;
             this->communicationErrorHandler();
-            if (note.title.isSet())
-                QLOG_ERROR() << tr("Error uploading note:") +note.title;
+            if (upload->title != "")
+                QLOG_ERROR() << tr("Error uploading note:") +upload->title;
             else
                 QLOG_ERROR() << tr("Error uploading note with a missing title!");
             error = true;
-            //return maxUsn;
-        }
-        if (usn > maxUsn) {
-            maxUsn = usn;
-            if (oldUsn == 0)
-                noteTable.updateGuid(validLids[i], note.guid);
-            noteTable.setUpdateSequenceNumber(validLids[i], usn);
-            noteTable.setDirty(validLids[i], false);
-            if (!finalSync)
-                emit(noteSynchronized(validLids[i], false));
-        } else {
-            error = true;
+            continue;
         }
+        if (upload->usn > maxUsn)
+            maxUsn = upload->usn;
+        if (!finalSync)
+            emit(noteSynchronized(upload->lid, upload->changed));
     }
     QLOG_TRACE_OUT();
     return maxUsn;
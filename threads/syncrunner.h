@@ -38,6 +38,25 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "qevercloud/include/QEverCloud.h"
 using namespace qevercloud;
 
+
+// A change made by a sync chunk that the rest of NixNote has to be
+// told about.  While a chunk's transaction is open these are held back
+// so the GUI doesn't go to the database before the change is there.
+class SyncNotice
+{
+public:
+    enum Type { NoteUpdated, TagUpdated, NotebookUpdated, SearchUpdated,
+                TagExpunged, NotebookExpunged, SearchExpunged };
+    Type type;
+    qint32 lid;
+    QString name;
+    QString extra;                           // Parent guid for tags, stack for notebooks
+    qint32 account;
+    bool linked;
+    bool shared;
+};
+
+
 class SyncRunner : public QObject
 {
     Q_OBJECT
@@ -70,12 +89,20 @@ private:
     bool fullSync;
     QHash<QString, QString> changedNotebooks;
     QHash<QString, QString> changedTags;
+    bool inChunk;                            // A chunk transaction is open
+    QList<SyncNotice> notices;               // Held back until the chunk is committed
 
     void evernoteSync();
     bool syncRemoteToLocal(qint32 highSequence);
+    bool syncChunks(qint32 chunkSize, qint32 types, bool notes, qint32 startingSequenceNumber, qint32 updateCount);
+    bool beginChunk();
+    bool commitChunk();
+    void rollbackChunk();
+    void notify(SyncNotice::Type type, qint32 lid, QString name="", QString extra="", qint32 account=0, bool linked=false, bool shared=false);
+    void sendNotice(const SyncNotice &notice);
     void syncRemoteExpungedNotes(QList<Guid> guids);
     void syncRemoteExpungedNotebooks(QList<Guid> guids);
-    void processSyncChunk(SyncChunk &chunk, qint32 linkedNotebook=0);
+    void processSyncChunk(SyncChunk &chunk, qint32 linkedNotebook=0, QList< QPair<QString, QImage*>* > *inkNotes=NULL);
     void syncRemoteExpungedTags(QList<Guid> guids);
     void syncRemoteExpungedSavedSearches(QList<Guid> guid);
 
@@ -0,0 +1,206 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "workmetrics.h"
+#include <QDateTime>
+#include <QMutexLocker>
+
+
+void WorkMetrics::setBacklog(QString worker, qint32 count) {
+    QMutexLocker locker(&mutex);
+    stats[worker].backlog = count;
+}
+
+
+
+void WorkMetrics::done(QString worker, qint32 items, qint64 bytes) {
+    QMutexLocker locker(&mutex);
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    WorkStats &s = stats[worker];
+    s.items = s.items + items;
+    s.bytes = s.bytes + bytes;
+    s.recent[now/1000] += items;
+    trim(s, now);
+}
+
+
+
+void WorkMetrics::timing(QString worker, QString step, qint64 msecs) {
+    QMutexLocker locker(&mutex);
+    QVector<qint64> &histogram = stats[worker].latency[step];
+    if (histogram.size() == 0)
+        histogram.fill(0, METRICS_BUCKET_COUNT);
+    int bucket = 0;
+    while (bucket < METRICS_BUCKET_COUNT-1 && msecs > metricsBucketBounds[bucket])
+        bucket++;
+    histogram[bucket]++;
+}
+
+
+
+void WorkMetrics::error(QString worker, QString step) {
+    QMutexLocker locker(&mutex);
+    WorkStats &s = stats[worker];
+    s.errors++;
+    s.stepErrors[step]++;
+}
+
+
+
+void WorkMetrics::skipped(QString worker, QString kind, qint32 items) {
+    QMutexLocker locker(&mutex);
+    WorkStats &s = stats[worker];
+    s.skipped = s.skipped + items;
+    s.kindSkipped[kind] += items;
+}
+
+
+
+// Forget the per second counts that are too old for the rate
+void WorkMetrics::trim(WorkStats &s, qint64 now) {
+    qint64 oldest = (now-METRICS_RATE_MSECS)/1000;
+    while (s.recent.size() > 0 && s.recent.begin().key() < oldest)
+        s.recent.erase(s.recent.begin());
+}
+
+
+
+qint32 WorkMetrics::backlog(QString worker) {
+    QMutexLocker locker(&mutex);
+    if (!stats.contains(worker))
+        return 0;
+    return stats[worker].backlog;
+}
+
+
+
+double WorkMetrics::rate(QString worker) {
+    QMutexLocker locker(&mutex);
+    if (!stats.contains(worker))
+        return 0;
+    WorkStats &s = stats[worker];
+    trim(s, QDateTime::currentMSecsSinceEpoch());
+    qint64 count = 0;
+    QMapIterator<qint64, qint32> i(s.recent);
+    while (i.hasNext())
+        count = count + i.next().value();
+    return double(count) * 1000.0 / METRICS_RATE_MSECS;
+}
+
+
+
+QString WorkMetrics::bucketName(int bucket) {
+    if (bucket < METRICS_BUCKET_COUNT-1)
+        return QString("<=") + QString::number(metricsBucketBounds[bucket]) + "ms";
+    return QString(">") + QString::number(metricsBucketBounds[METRICS_BUCKET_COUNT-2]) + "ms";
+}
+
+
+
+// Everything as nested maps, which DBus sends as a{sv}
+QVariantMap WorkMetrics::snapshot() {
+    QStringList workers;
+    mutex.lock();
+    workers = stats.keys();
+    mutex.unlock();
+
+    QVariantMap retval;
+    for (int i=0; i<workers.size(); i++) {
+        double itemsPerSecond = rate(workers[i]);
+        QMutexLocker locker(&mutex);
+        WorkStats &s = stats[workers[i]];
+        QVariantMap worker;
+        worker.insert("backlog", s.backlog);
+        worker.insert("items", s.items);
+        worker.insert("itemsPerSecond", itemsPerSecond);
+        worker.insert("bytes", s.bytes);
+        worker.insert("errors", s.errors);
+
+        QVariantMap latency;
+        QHashIterator<QString, QVector<qint64> > steps(s.latency);
+        while (steps.hasNext()) {
+            steps.next();
+            QVariantMap histogram;
+            for (int j=0; j<steps.value().size(); j++)
+                histogram.insert(bucketName(j), steps.value()[j]);
+            latency.insert(steps.key(), histogram);
+        }
+        worker.insert("latency", latency);
+
+        QVariantMap errors;
+        QHashIterator<QString, qint64> stepErrors(s.stepErrors);
+        while (stepErrors.hasNext()) {
+            stepErrors.next();
+            errors.insert(stepErrors.key(), stepErrors.value());
+        }
+        worker.insert("stepErrors", errors);
+
+        worker.insert("skipped", s.skipped);
+        QVariantMap skipped;
+        QHashIterator<QString, qint64> kindSkipped(s.kindSkipped);
+        while (kindSkipped.hasNext()) {
+            kindSkipped.next();
+            skipped.insert(kindSkipped.key(), kindSkipped.value());
+        }
+        worker.insert("kindSkipped", skipped);
+        retval.insert(workers[i], worker);
+    }
+    return retval;
+}
+
+
+
+// Everything as text, one line per number, for people reading it with
+// a DBus command line tool.
+QString WorkMetrics::report() {
+    QVariantMap all = snapshot();
+    QStringList lines;
+    QMapIterator<QString, QVariant> workers(all);
+    while (workers.hasNext()) {
+        workers.next();
+        QVariantMap worker = workers.value().toMap();
+        QString name = workers.key();
+        lines.append(name + ".backlog " + worker.value("backlog").toString());
+        lines.append(name + ".items " + worker.value("items").toString());
+        lines.append(name + ".itemsPerSecond " + QString::number(worker.value("itemsPerSecond").toDouble(), 'f', 2));
+        lines.append(name + ".bytes " + worker.value("bytes").toString());
+        lines.append(name + ".errors " + worker.value("errors").toString());
+        QMapIterator<QString, QVariant> errors(worker.value("stepErrors").toMap());
+        while (errors.hasNext()) {
+            errors.next();
+            lines.append(name + ".errors." + errors.key() + " " + errors.value().toString());
+        }
+        lines.append(name + ".skipped " + worker.value("skipped").toString());
+        QMapIterator<QString, QVariant> skipped(worker.value("kindSkipped").toMap());
+        while (skipped.hasNext()) {
+            skipped.next();
+            lines.append(name + ".skipped." + skipped.key() + " " + skipped.value().toString());
+        }
+        QMapIterator<QString, QVariant> steps(worker.value("latency").toMap());
+        while (steps.hasNext()) {
+            steps.next();
+            QVariantMap histogram = steps.value().toMap();
+            QStringList buckets;
+            for (int j=0; j<METRICS_BUCKET_COUNT; j++)
+                buckets.append(bucketName(j) + ":" + histogram.value(bucketName(j)).toString());
+            lines.append(name + ".latency." + steps.key() + " " + buckets.join(" "));
+        }
+    }
+    return lines.join("\n");
+}
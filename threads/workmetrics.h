@@ -0,0 +1,85 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef WORKMETRICS_H
+#define WORKMETRICS_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QMap>
+#include <QVector>
+#include <QMutex>
+#include <QVariantMap>
+
+// Items per second is worked out over this long
+#define METRICS_RATE_MSECS      60000
+
+// Upper bounds of the latency histogram buckets, in milliseconds.  There
+// is one more bucket for anything slower than the last one.
+#define METRICS_BUCKET_COUNT    8
+static const qint64 metricsBucketBounds[METRICS_BUCKET_COUNT-1] = { 10, 50, 100, 500, 1000, 5000, 30000 };
+
+
+// What one kind of background work (indexing, thumbnails, counts) has done
+class WorkStats
+{
+public:
+    qint32 backlog;                              // Items waiting
+    qint64 items;                                // Items done since startup
+    qint64 bytes;                                // Bytes of text produced
+    qint64 errors;
+    qint64 skipped;                              // Items that didn't need doing
+    QMap<qint64, qint32> recent;                 // Items done per second over the last METRICS_RATE_MSECS
+    QHash<QString, QVector<qint64> > latency;    // Step -> histogram of how long it took
+    QHash<QString, qint64> stepErrors;           // Step -> errors
+    QHash<QString, qint64> kindSkipped;          // Kind of item -> skipped
+    WorkStats() { backlog = 0; items = 0; bytes = 0; errors = 0; skipped = 0; }
+};
+
+
+
+//*****************************************************************
+//* Counters for the background threads, so what the indexer,
+//* thumbnailer & counter are doing can be seen without reading the
+//* debug log.  The threads report as they go; the numbers are read
+//* over DBus (MetricsQuery) and by the status bar.  Everything is
+//* guarded by one mutex so any thread can report.
+//*****************************************************************
+class WorkMetrics
+{
+private:
+    QMutex mutex;
+    QMap<QString, WorkStats> stats;              // Worker -> what it has done
+    void trim(WorkStats &s, qint64 now);
+    static QString bucketName(int bucket);
+
+public:
+    void setBacklog(QString worker, qint32 count);                // Items a worker has waiting
+    void done(QString worker, qint32 items, qint64 bytes);        // Items a worker has finished
+    void timing(QString worker, QString step, qint64 msecs);      // How long one step of an item took
+    void error(QString worker, QString step);                     // A step failed
+    void skipped(QString worker, QString kind, qint32 items=1);   // Items that didn't need doing (e.g. unchanged)
+    qint32 backlog(QString worker);
+    double rate(QString worker);                                  // Items per second, lately
+    QVariantMap snapshot();                                       // Everything, keyed by worker
+    QString report();                                             // Everything, as text
+};
+
+#endif // WORKMETRICS_H
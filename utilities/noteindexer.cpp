@@ -24,7 +24,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "sql/notetable.h"
 #include "sql/nsqlquery.h"
 #include "sql/resourcetable.h"
-#include <QTextDocument>
+#include "sql/trigramtable.h"
+#include "sql/searchtexttable.h"
+#include "utilities/textfolding.h"
+#include "html/enmltext.h"
 #include <QtXml>
 #if QT_VERSION < 0x050000
 #include <poppler-qt4.h>
@@ -56,38 +59,18 @@ void NoteIndexer::indexNote(qint32 lid) {
         content = n.content;
 
 
-    // Start looking through the note
-    qint32 startPos =content.indexOf(QChar('<'));
-    qint32 endPos = content.indexOf(QChar('>'),startPos)+1;
-    content.remove(startPos,endPos-startPos);
-
-    // Remove encrypted text
-    while (content.contains("<en-crypt")) {
-        startPos = content.indexOf("<en-crypt");
-        endPos = content.indexOf("</en-crypt>") + 11;
-        content = content.mid(0,startPos)+content.mid(endPos);
-    }
-
-    // Remove any XML tags
-    while (content.contains(QChar('<'))) {
-        startPos = content.indexOf(QChar('<'));
-        endPos = content.indexOf(QChar('>'),startPos)+1;
-        content.remove(startPos,endPos-startPos);
-    };
-
-    // Get the content as an HTML doc.
-    QTextDocument textDocument;
-    textDocument.setHtml(content);
     QString title  = "";
     if (n.title.isSet())
         title = n.title;
-    content = textDocument.toPlainText() + " " + title;
+    content = EnmlText::toText(content) + " " + title;
     this->addTextIndex(lid, content);
 }
 
 
 void NoteIndexer::addTextIndex(int lid, QString content) {
     // Delete any old content
+    SearchTextTable searchTextTable(db);
+    searchTextTable.expunge(lid, "text");
     NSqlQuery sql(db);
     sql.prepare("Delete from SearchIndex where lid=:lid and source=:source");
     sql.bindValue(":lid", lid);
@@ -99,11 +82,19 @@ void NoteIndexer::addTextIndex(int lid, QString content) {
     sql.bindValue(":lid", lid);
     sql.bindValue(":weight", 100);
     sql.bindValue(":source", "text");
-    if (!global.forceSearchLowerCase)
-        sql.bindValue(":content", content);
-    else
-        sql.bindValue(":content", content.toLower());
+    sql.bindValue(":content", TextFolding::index(content));
     sql.exec();
+    searchTextTable.add(content);
+
+    // Update the trigram index too, if the user wants one.
+    if (global.trigramIndex) {
+        TrigramTable trigramTable(db);
+        if (!db->inTransaction)
+            sql.exec("begin");
+        trigramTable.index(lid, content);
+        if (!db->inTransaction)
+            sql.exec("commit");
+    }
 
     sql.prepare("Delete from DataStore where lid=:lid and key=:key");
     sql.bindValue(":lid", lid);
@@ -126,6 +117,8 @@ void NoteIndexer::indexResource(qint32 lid) {
 
     // Delete the old index
     QLOG_DEBUG() << "Deleting old resource from index";
+    SearchTextTable searchTextTable(db);
+    searchTextTable.expunge(lid);
     sql.prepare("Delete from SearchIndex where lid=:lid");
     sql.bindValue(":lid", lid);
     sql.exec();
@@ -138,16 +131,18 @@ void NoteIndexer::indexResource(qint32 lid) {
             sql.bindValue(":lid", lid);
             sql.bindValue(":weight", 100);
             sql.bindValue(":source", "recognition");
-            sql.bindValue(":content", QString(a.fileName));
+            sql.bindValue(":content", TextFolding::index(a.fileName));
             sql.exec();
+            searchTextTable.add(a.fileName);
         }
         if (a.sourceURL.isSet()) {
             sql.prepare("Insert into SearchIndex (lid, weight, source, content) values (:lid, :weight, :source, :content)");
             sql.bindValue(":lid", lid);
             sql.bindValue(":weight", 100);
             sql.bindValue(":source", "recognition");
-            sql.bindValue(":content", QString(a.sourceURL));
+            sql.bindValue(":content", TextFolding::index(a.sourceURL));
             sql.exec();
+            searchTextTable.add(a.sourceURL);
         }
     }
 
@@ -182,6 +177,7 @@ void NoteIndexer::indexRecognition(qint32 reslid, Resource &r) {
         return;
 
     NSqlQuery sql(db);
+    SearchTextTable searchTextTable(db);
 
     // Make sure we have something to look through.
     Data recognition;
@@ -199,7 +195,10 @@ void NoteIndexer::indexRecognition(qint32 reslid, Resource &r) {
 
     QLOG_TRACE() << "Beginning insertion of recognition:";
     QLOG_TRACE() << "Anchors found: " << anchors.length();
-    sql.exec("begin;");
+    // The sync writes a whole chunk in one transaction, so only start one
+    // if nobody else has.
+    if (!db->inTransaction)
+        sql.exec("begin;");
 #if QT_VERSION < 0x050000
     for (unsigned int i=0;  i<anchors.length(); i++) {
 #else
@@ -217,15 +216,14 @@ void NoteIndexer::indexRecognition(qint32 reslid, Resource &r) {
             sql.bindValue(":weight", weight);
             sql.bindValue(":source", "recognition");
             //sql.bindValue(":content", text);
-            if (!global.forceSearchLowerCase)
-                sql.bindValue(":content", text);
-            else
-                sql.bindValue(":content", text.toLower());
+            sql.bindValue(":content", TextFolding::index(text));
             sql.exec();
+            searchTextTable.add(text);
         }
     }
     QLOG_TRACE() << "Committing";
-    sql.exec("commit");
+    if (!db->inTransaction)
+        sql.exec("commit");
     QLOG_TRACE_OUT();
 }
 
@@ -261,10 +259,9 @@ void NoteIndexer::indexPdf(qint32 reslid) {
     sql.bindValue(":lid", reslid);
     sql.bindValue(":weight", 100);
     sql.bindValue(":source", "recognition");
-    if (!global.forceSearchLowerCase)
-        sql.bindValue(":content", text);
-    else
-        sql.bindValue(":content", text.toLower());
+    sql.bindValue(":content", TextFolding::index(text));
     sql.exec();
+    SearchTextTable searchTextTable(db);
+    searchTextTable.add(text);
     QLOG_TRACE_OUT();
 }
@@ -29,7 +29,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <string>
 #include <stdio.h>
 #include <QFileInfo>
-#include <QTextDocument>
 
 #include "qevercloud/include/QEverCloud.h"
 using namespace qevercloud;
@@ -0,0 +1,179 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "officetext.h"
+#include "utilities/zipreader.h"
+#include "html/enmltext.h"
+#include <QFile>
+#include <QMap>
+#include <QXmlStreamReader>
+
+// Extensions that can be read in process.  Extensions are lower case
+// and include the dot.
+static const char *ooxmlExtensions[] = { ".docx", ".docm", ".xlsx", ".pptx" };
+static const char *odfExtensions[] = {
+    ".odt", ".ott", ".ods", ".ots", ".odp", ".otp", ".odg", ".otg",
+    ".odm", ".oth", ".odf"
+};
+static const char *plainExtensions[] = { ".txt", ".html", ".htm" };
+
+// Extensions that are sent to soffice
+static const char *legacyExtensions[] = { ".doc", ".xls", ".ppt", ".pps", ".pdf", ".odb", ".oxt" };
+
+// Elements that end a word: paragraphs, headings, tabs, line breaks,
+// table & spreadsheet cells and the ODF space element.
+static const char *separatorElements[] = {
+    "p", "h", "tab", "br", "cr", "s", "line-break", "table-cell", "tc",
+    "c", "si", "list-item"
+};
+
+
+static bool inList(QString value, const char **list, unsigned int count) {
+    for (unsigned int i=0; i<count; i++) {
+        if (value == QLatin1String(list[i]))
+            return true;
+    }
+    return false;
+}
+
+#define IN_LIST(value, list) inList(value, list, sizeof(list)/sizeof(list[0]))
+
+
+
+bool OfficeText::isDocument(QString extension) {
+    return IN_LIST(extension, ooxmlExtensions) || IN_LIST(extension, odfExtensions) ||
+            IN_LIST(extension, plainExtensions);
+}
+
+
+bool OfficeText::isLegacy(QString extension) {
+    return IN_LIST(extension, legacyExtensions);
+}
+
+
+
+// Get the text of a file.  Returns an empty string if the file can't
+// be read.
+QString OfficeText::text(QString file, QString extension) {
+    if (IN_LIST(extension, plainExtensions)) {
+        QFile f(file);
+        if (!f.open(QIODevice::ReadOnly))
+            return "";
+        QString content = QString::fromUtf8(f.readAll());
+        f.close();
+        if (extension == ".txt")
+            return content;
+        return EnmlText::toText(content);
+    }
+    return zipText(file, extension);
+}
+
+
+
+// Read the parts of the archive that have the document's text, in the
+// order they are shown.
+QString OfficeText::zipText(QString file, QString extension) {
+    ZipReader zip(file);
+    if (!zip.isValid())
+        return "";
+
+    QStringList parts;
+    bool ooxml = IN_LIST(extension, ooxmlExtensions);
+    QStringList names = zip.fileNames();
+    if (!ooxml) {
+        parts.append("content.xml");
+    } else if (extension == ".xlsx") {
+        parts.append("xl/sharedStrings.xml");
+        parts.append(numbered(names, "xl/worksheets/sheet"));
+    } else if (extension == ".pptx") {
+        parts.append(numbered(names, "ppt/slides/slide"));
+        parts.append(numbered(names, "ppt/notesSlides/notesSlide"));
+    } else {
+        parts.append("word/document.xml");
+        parts.append(numbered(names, "word/header"));
+        parts.append(numbered(names, "word/footer"));
+        parts.append("word/footnotes.xml");
+        parts.append("word/endnotes.xml");
+    }
+
+    QString text;
+    for (int i=0; i<parts.size(); i++) {
+        if (!zip.contains(parts[i]))
+            continue;
+        text.append(xmlText(zip.fileData(parts[i]), ooxml));
+        text.append(QChar(' '));
+    }
+    return text.simplified();
+}
+
+
+
+// Get the parts named prefix1.xml, prefix2.xml ... in number order.
+QStringList OfficeText::numbered(const QStringList &names, QString prefix) {
+    QMap<int, QString> found;
+    for (int i=0; i<names.size(); i++) {
+        if (!names[i].startsWith(prefix) || !names[i].endsWith(".xml"))
+            continue;
+        bool ok;
+        int number = names[i].mid(prefix.length(), names[i].length()-prefix.length()-4).toInt(&ok);
+        if (ok)
+            found.insert(number, names[i]);
+    }
+    return found.values();
+}
+
+
+
+// Get the text out of one XML part.  In Office Open XML the text is in
+// <t> elements (and spreadsheet values in <v>); everything else is markup.
+// In OpenDocument all the character data in the body is text.
+QString OfficeText::xmlText(const QByteArray &xml, bool ooxml) {
+    QXmlStreamReader reader(xml);
+    QString text;
+    text.reserve(xml.size()/4);
+    int inText = 0;
+    bool inBody = false;
+    bool sharedCell = false;        // A spreadsheet cell whose value is a shared string index
+    while (!reader.atEnd()) {
+        QXmlStreamReader::TokenType token = reader.readNext();
+        if (token == QXmlStreamReader::StartElement) {
+            QString name = reader.name().toString();
+            if (ooxml) {
+                if (name == "c")
+                    sharedCell = reader.attributes().value("t") == QLatin1String("s");
+                if (name == "t" || (name == "v" && !sharedCell))
+                    inText++;
+            } else if (name == "body") {
+                inBody = true;
+            }
+            if (IN_LIST(name, separatorElements))
+                text.append(QChar(' '));
+        } else if (token == QXmlStreamReader::EndElement) {
+            QString name = reader.name().toString();
+            if (ooxml && inText > 0 && (name == "t" || (name == "v" && !sharedCell)))
+                inText--;
+            if (IN_LIST(name, separatorElements))
+                text.append(QChar(' '));
+        } else if (token == QXmlStreamReader::Characters) {
+            if ((ooxml && inText > 0) || (!ooxml && inBody))
+                text.append(reader.text().toString());
+        }
+    }
+    return text;
+}
@@ -0,0 +1,52 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef OFFICETEXT_H
+#define OFFICETEXT_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+
+
+//*****************************************************************
+//* Get the text of an attachment without starting LibreOffice.
+//* Office Open XML (docx, xlsx, pptx) and OpenDocument (odt, ods,
+//* odp ...) files are zip archives of XML, which are read with
+//* QXmlStreamReader.  Plain text & HTML are read directly.  The
+//* older binary formats still need soffice; the index runner
+//* converts those in batches.
+//*
+//* Nothing here uses the database or the GUI, so it can be called
+//* from any thread.
+//*****************************************************************
+class OfficeText
+{
+private:
+    static QString xmlText(const QByteArray &xml, bool ooxml);
+    static QStringList numbered(const QStringList &names, QString prefix);
+    static QString zipText(QString file, QString extension);
+
+public:
+    static bool isDocument(QString extension);     // Can the text be read in process?
+    static bool isLegacy(QString extension);       // Does it need soffice?
+    static QString text(QString file, QString extension);
+};
+
+#endif // OFFICETEXT_H
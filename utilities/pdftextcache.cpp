@@ -0,0 +1,134 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "pdftextcache.h"
+#include "global.h"
+#include <QDir>
+#include <QFile>
+#include <QTemporaryFile>
+#include <QStringList>
+
+extern Global global;
+
+
+PdfTextCache::PdfTextCache(QByteArray hash) {
+    dir = "";
+    if (hash.size() > 0)
+        dir = global.fileManager.getPdfTextDirPath(QString(hash.toHex()).toLower() + "/");
+}
+
+
+bool PdfTextCache::isValid() {
+    return dir != "";
+}
+
+
+QString PdfTextCache::pagePath(qint32 page) {
+    return dir + QString::number(page) + ".txt";
+}
+
+
+
+// Write a file to a temporary name & rename it, so a file cut off by a
+// shutdown is never mistaken for a cached one.  The temporary name is
+// unique because two resources with the same PDF can be indexed at once.
+void PdfTextCache::writeFile(QString path, const QByteArray &data) {
+    QDir().mkpath(dir);
+    QTemporaryFile f(path + ".XXXXXX");
+    f.setAutoRemove(false);
+    if (!f.open())
+        return;
+    QString tmp = f.fileName();
+    bool ok = f.write(data) == data.size();
+    f.close();
+    if (ok) {
+        QFile::remove(path);
+        ok = QFile::rename(tmp, path);
+    }
+    if (!ok)
+        QFile::remove(tmp);    // Someone else got there first, or the write failed
+}
+
+
+
+qint32 PdfTextCache::pageCount() {
+    if (!isValid())
+        return -1;
+    QFile f(dir + "pages");
+    if (!f.open(QIODevice::ReadOnly))
+        return -1;
+    bool ok;
+    qint32 count = QString(f.readAll()).trimmed().toInt(&ok);
+    f.close();
+    if (!ok)
+        return -1;
+    return count;
+}
+
+
+
+void PdfTextCache::setPageCount(qint32 count) {
+    if (!isValid())
+        return;
+    writeFile(dir + "pages", QByteArray::number(count));
+}
+
+
+
+bool PdfTextCache::hasPage(qint32 page) {
+    return isValid() && QFile::exists(pagePath(page));
+}
+
+
+
+QString PdfTextCache::page(qint32 page) {
+    if (!isValid())
+        return "";
+    QFile f(pagePath(page));
+    if (!f.open(QIODevice::ReadOnly))
+        return "";
+    QString text = QString::fromUtf8(f.readAll());
+    f.close();
+    return text;
+}
+
+
+
+void PdfTextCache::setPage(qint32 page, const QString &text) {
+    if (!isValid())
+        return;
+    writeFile(pagePath(page), text.toUtf8());
+}
+
+
+
+// Remove the text of PDFs that are no longer in the database
+void PdfTextCache::prune(const QSet<QString> &hashes) {
+    QDir cacheDir(global.fileManager.getPdfTextDirPath());
+    QStringList dirs = cacheDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (int i=0; i<dirs.size(); i++) {
+        if (hashes.contains(dirs[i].toLower()))
+            continue;
+        QDir doc(cacheDir.filePath(dirs[i]));
+        QStringList files = doc.entryList(QDir::Files);
+        for (int j=0; j<files.size(); j++)
+            doc.remove(files[j]);
+        cacheDir.rmdir(dirs[i]);
+    }
+}
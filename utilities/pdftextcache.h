@@ -0,0 +1,58 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef PDFTEXTCACHE_H
+#define PDFTEXTCACHE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QSet>
+
+
+//*****************************************************************
+//* The text of each page of a PDF, kept on disk so a big PDF is
+//* only read once.  It is keyed by the resource's data hash, so the
+//* same PDF in several notes, or one that sync gave a new lid, is
+//* shared.  Pages are saved as they are extracted, so indexing that
+//* is paused or shut down part way through picks up where it
+//* stopped.  The PDF viewer uses it to find pages to search.
+//*
+//* Each document is a directory of <page>.txt files.  A "pages"
+//* file with the page count is written once every page is there.
+//* Nothing here uses the database, so any thread can use it.
+//*****************************************************************
+class PdfTextCache
+{
+private:
+    QString dir;
+    QString pagePath(qint32 page);
+    void writeFile(QString path, const QByteArray &data);
+
+public:
+    PdfTextCache(QByteArray hash);
+    bool isValid();                            // Is there a hash to key the cache by?
+    qint32 pageCount();                        // Number of pages, or -1 if not every page is cached
+    void setPageCount(qint32 count);           // Every page is cached
+    bool hasPage(qint32 page);                 // Is this page cached?
+    QString page(qint32 page);                 // Get a cached page's text
+    void setPage(qint32 page, const QString &text);  // Save a page's text
+    static void prune(const QSet<QString> &hashes);  // Remove documents not in the list of hex hashes
+};
+
+#endif // PDFTEXTCACHE_H
@@ -0,0 +1,100 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "systemload.h"
+#include <QFile>
+#include <QDir>
+#include <QString>
+#include <QStringList>
+
+
+SystemLoad::SystemLoad() {
+    lastTotal = -1;
+    lastIdle = 0;
+    lastOwn = 0;
+}
+
+
+static QString readFile(QString path) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly))
+        return "";
+    QString value = QString(f.readAll()).trimmed();
+    f.close();
+    return value;
+}
+
+
+
+// Work out how much of the CPU other programs used since the last call.
+// The time spent by everything, from /proc/stat, has our own time, from
+// /proc/self/stat, taken out so the indexer doesn't throttle itself.
+// Both are in clock ticks.  The first call only takes a reading.
+qreal SystemLoad::otherLoad() {
+#ifdef Q_OS_LINUX
+    QStringList cpu = readFile("/proc/stat").section('\n', 0, 0).split(' ', QString::SkipEmptyParts);
+    QString self = readFile("/proc/self/stat");
+    // The command name can have spaces, so count the fields after it
+    QStringList own = self.mid(self.lastIndexOf(')')+2).split(' ', QString::SkipEmptyParts);
+    if (cpu.size() < 5 || cpu[0] != "cpu" || own.size() < 13)
+        return -1;
+    qint64 total = 0;
+    for (int i=1; i<cpu.size() && i<=8; i++)
+        total = total + cpu[i].toLongLong();
+    qint64 idle = cpu[4].toLongLong();
+    if (cpu.size() > 5)
+        idle = idle + cpu[5].toLongLong();   // Waiting on I/O
+    qint64 ownTime = own[11].toLongLong() + own[12].toLongLong();   // utime + stime
+
+    qreal load = -1;
+    if (lastTotal >= 0 && total > lastTotal) {
+        qint64 busy = (total-lastTotal) - (idle-lastIdle) - (ownTime-lastOwn);
+        load = qBound(0.0, qreal(busy) / qreal(total-lastTotal), 1.0);
+    }
+    lastTotal = total;
+    lastIdle = idle;
+    lastOwn = ownTime;
+    return load;
+#else
+    return -1;
+#endif
+}
+
+
+
+// Check the power supplies.  Anything plugged in means we aren't on
+// battery.  Otherwise it's a battery if one of them is discharging.
+bool SystemLoad::onBattery() {
+#ifdef Q_OS_LINUX
+    QDir supplies("/sys/class/power_supply");
+    QStringList names = supplies.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    bool discharging = false;
+    for (int i=0; i<names.size(); i++) {
+        QString path = supplies.filePath(names[i]) + "/";
+        QString type = readFile(path + "type");
+        if ((type == "Mains" || type == "USB") && readFile(path + "online") == "1")
+            return false;
+        if (type == "Battery" && readFile(path + "status") == "Discharging")
+            discharging = true;
+    }
+    return discharging;
+#else
+    return false;
+#endif
+}
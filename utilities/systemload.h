@@ -0,0 +1,45 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef SYSTEMLOAD_H
+#define SYSTEMLOAD_H
+
+#include <QtGlobal>
+
+
+//*****************************************************************
+//* How busy the machine is, used to decide how much background
+//* work to do.  This is read from /proc & /sys, so on other
+//* platforms the load is unknown and the machine is assumed to be
+//* plugged in.
+//*****************************************************************
+class SystemLoad
+{
+private:
+    qint64 lastTotal;          // All CPU time at the last check
+    qint64 lastIdle;           // Idle CPU time at the last check
+    qint64 lastOwn;            // Our own CPU time at the last check
+
+public:
+    SystemLoad();
+    qreal otherLoad();         // Share of the CPU used by other programs since the last call, -1 if unknown
+    bool onBattery();          // Is the machine running on battery?
+};
+
+#endif // SYSTEMLOAD_H
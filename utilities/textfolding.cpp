@@ -0,0 +1,351 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "textfolding.h"
+#include "global.h"
+
+extern Global global;
+
+// Words shorter than this are left alone by the stemmers.  They are
+// almost always a root already and stripping them causes false matches.
+#define STEM_MINIMUM_LENGTH     4
+
+
+// Is folding or stemming turned on?  If neither is, the text is stored
+// the way it always has been.
+bool TextFolding::enabled() {
+    return global.foldSearchText || global.searchStemLanguage != "";
+}
+
+
+
+// Letters that don't decompose into a base letter and an accent, but
+// which people still type without the accent.
+static QString foldSpecial(ushort c) {
+    switch (c) {
+    case 0x00DF : return "ss";      // sharp s
+    case 0x00E6 : return "ae";      // ae ligature
+    case 0x0153 : return "oe";      // oe ligature
+    case 0x00F8 : return "o";       // o with stroke
+    case 0x00F0 : return "d";       // eth
+    case 0x0111 : return "d";       // d with stroke
+    case 0x0127 : return "h";       // h with stroke
+    case 0x0131 : return "i";       // dotless i
+    case 0x0142 : return "l";       // l with stroke
+    case 0x00FE : return "th";      // thorn
+    }
+    return QString();
+}
+
+
+
+// Fold text for searching.  NFKD maps compatibility characters (full width
+// letters, ligatures, superscripts) to the plain ones and splits accented
+// letters into the letter and the accent.  The accents are then dropped and
+// everything is case folded.
+QString TextFolding::fold(QString text) {
+    // Plain ASCII is by far the most common case and only needs lower casing.
+    bool ascii = true;
+    for (int i=0; i<text.length() && ascii; i++)
+        ascii = text.at(i).unicode() < 0x80;
+    if (ascii)
+        return text.toLower();
+
+    QString decomposed = text.normalized(QString::NormalizationForm_KD).toCaseFolded();
+    QString folded;
+    folded.reserve(decomposed.length());
+    ushort base = 0;
+    for (int i=0; i<decomposed.length(); i++) {
+        QChar c = decomposed.at(i);
+        if (c.category() == QChar::Mark_NonSpacing) {
+            // Accents on Latin, Greek & Cyrillic letters are dropped.  In other
+            // scripts the marks are part of the spelling, so they are kept.
+            if (base < 0x0530 || (base >= 0x1E00 && base < 0x2000))
+                continue;
+            folded.append(c);
+            continue;
+        }
+        base = c.unicode();
+        QString special = foldSpecial(base);
+        if (special != "")
+            folded.append(special);
+        else
+            folded.append(c);
+    }
+
+    // Put back together whatever was left decomposed (Hangul, voiced kana ...)
+    return folded.normalized(QString::NormalizationForm_KC);
+}
+
+
+
+// Fold the text if the user wants it, otherwise just lower case it.  This is
+// what the trigram index uses for its words.
+QString TextFolding::normalize(QString text) {
+    if (global.foldSearchText)
+        return fold(text);
+    return text.toLower();
+}
+
+
+
+// Get the text that should be stored in SearchIndex.
+QString TextFolding::index(QString text) {
+    if (!enabled()) {
+        if (global.forceSearchLowerCase)
+            return text.toLower();
+        return text;
+    }
+    return transform(text);
+}
+
+
+
+// Get the FTS term for something the user searched for.  It has to be
+// folded & stemmed the same way the stored text was or nothing would match.
+QString TextFolding::query(QString term) {
+    if (!enabled())
+        return term;
+    return transform(term);
+}
+
+
+
+// Fold & stem some text.  Only the words are touched; spaces & punctuation
+// are kept where they are so phrases still line up.  Words next to a '*' in
+// a search are stemmed too, since the index only has the stems ("running*"
+// has to look for "run*").
+QString TextFolding::transform(QString text) {
+    text = normalize(text);
+    QString language = global.searchStemLanguage;
+    if (language == "")
+        return text;
+
+    QString result;
+    result.reserve(text.length());
+    int start = -1;
+    for (int i=0; i<=text.length(); i++) {
+        if (i<text.length() && text.at(i).isLetterOrNumber()) {
+            if (start < 0)
+                start = i;
+            continue;
+        }
+        if (start >= 0) {
+            result.append(stem(text.mid(start, i-start), language));
+            start = -1;
+        }
+        if (i<text.length())
+            result.append(text.at(i));
+    }
+    return result;
+}
+
+
+
+// Build a snippet from the original text of a SearchIndex row, the way FTS
+// snippet() does from the stored text: the words that match one of the
+// (already folded) search terms are wrapped in start & end marks and about
+// "tokens" words around the first match are kept.  Every term is a prefix,
+// just as the FTS query built from them is.  An empty string comes back if
+// nothing matches.
+QString TextFolding::snippet(QString text, QStringList terms, QString startMark, QString endMark, QString ellipses, int tokens) {
+    QStringList prefixes;
+    for (int i=0; i<terms.size(); i++) {
+        QString term = terms[i];
+        int start = -1;
+        for (int j=0; j<=term.length(); j++) {
+            if (j<term.length() && term.at(j).isLetterOrNumber()) {
+                if (start < 0)
+                    start = j;
+                continue;
+            }
+            if (start >= 0 && !prefixes.contains(term.mid(start, j-start)))
+                prefixes.append(term.mid(start, j-start));
+            start = -1;
+        }
+    }
+
+    // Find the words & which of them match.  Nothing more than one word past
+    // the end of the snippet is needed, so stop there.
+    QList<int> starts, ends;
+    QList<bool> matched;
+    int first = -1;
+    int start = -1;
+    for (int i=0; i<=text.length(); i++) {
+        if (i<text.length() && text.at(i).isLetterOrNumber()) {
+            if (start < 0)
+                start = i;
+            continue;
+        }
+        if (start < 0)
+            continue;
+        QString word = index(text.mid(start, i-start));
+        bool match = false;
+        for (int j=0; j<prefixes.size() && !match; j++)
+            match = word.startsWith(prefixes[j]);
+        starts.append(start);
+        ends.append(i);
+        matched.append(match);
+        if (match && first < 0)
+            first = starts.size()-1;
+        start = -1;
+        if (first >= 0 && starts.size() > first + tokens)
+            break;
+    }
+    if (first < 0)
+        return QString();
+
+    // Show a few words before the first match, as FTS does
+    int from = qMax(0, qMin(first - tokens/4, starts.size() - tokens));
+    int to = qMin(starts.size(), from + tokens);
+    QString result;
+    if (from > 0)
+        result.append(ellipses);
+    for (int i=from; i<to; i++) {
+        if (i > from)
+            result.append(text.mid(ends[i-1], starts[i]-ends[i-1]));
+        QString word = text.mid(starts[i], ends[i]-starts[i]);
+        if (matched[i])
+            result.append(startMark + word + endMark);
+        else
+            result.append(word);
+    }
+    if (to < starts.size())
+        result.append(ellipses);
+    return result;
+}
+
+
+
+// Reduce a lower case word to its root.  Only words made up of plain
+// letters are stemmed, which after folding covers the languages that
+// have a stemmer.  Anything else comes back as it was.
+QString TextFolding::stem(QString word, QString language) {
+    if (word.length() < STEM_MINIMUM_LENGTH)
+        return word;
+    for (int i=0; i<word.length(); i++) {
+        ushort c = word.at(i).unicode();
+        if (c < 'a' || c > 'z')
+            return word;
+    }
+    if (language == "en")
+        return stemEnglish(word);
+    if (language == "de")
+        return stemGerman(word);
+    if (language == "fr")
+        return stemFrench(word);
+    if (language == "es")
+        return stemSpanish(word);
+    return word;
+}
+
+
+
+static bool isVowel(QChar c) {
+    return c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u';
+}
+
+
+
+// English.  This is step 1 of the Porter stemmer: plurals, then -ed & -ing
+// as long as what is left still has a vowel.  "notes", "noted" & "noting"
+// all become "note"; "running" becomes "run".
+QString TextFolding::stemEnglish(QString word) {
+    if (word.endsWith("sses"))
+        word.chop(2);
+    else if ((word.endsWith("ies") || word.endsWith("ied")) && word.length() > 4)
+        return word.left(word.length()-3) + "y";
+    else if (word.endsWith("s") && !word.endsWith("ss") && !word.endsWith("us") && !word.endsWith("is"))
+        word.chop(1);
+
+    int suffix = 0;
+    if (word.endsWith("ing"))
+        suffix = 3;
+    else if (word.endsWith("ed") && !word.endsWith("eed"))
+        suffix = 2;
+    if (suffix == 0)
+        return word;
+
+    QString root = word.left(word.length()-suffix);
+    bool vowel = false;
+    for (int i=0; i<root.length() && !vowel; i++)
+        vowel = isVowel(root.at(i)) || (i > 0 && root.at(i) == 'y');
+    if (!vowel || root.length() < 2)
+        return word;
+
+    int len = root.length();
+    QChar last = root.at(len-1);
+    if (root.endsWith("at") || root.endsWith("bl") || root.endsWith("iz"))
+        return root + "e";                                   // rated -> rate
+    if (last == root.at(len-2) && !isVowel(last) && last != 'l' && last != 's' && last != 'z')
+        return root.left(len-1);                             // running -> run
+    if (len == 3 && !isVowel(root.at(0)) && isVowel(root.at(1)) &&
+            !isVowel(last) && last != 'w' && last != 'x' && last != 'y')
+        return root + "e";                                   // hoping -> hope
+    return root;
+}
+
+
+
+// German.  Step 1 of the Snowball stemmer: strip one inflection ending.
+// Umlauts have already been folded away by this point.
+QString TextFolding::stemGerman(QString word) {
+    static const char *endings[] = {"ern", "em", "er", "en", "es", "e"};
+    for (unsigned int i=0; i<sizeof(endings)/sizeof(endings[0]); i++) {
+        QString ending = endings[i];
+        if (word.endsWith(ending) && word.length()-ending.length() >= 3) {
+            word.chop(ending.length());
+            return word;
+        }
+    }
+    if (word.endsWith("s") && word.length() > 4 &&
+            QString("bdfghklmnrt").contains(word.at(word.length()-2)))
+        word.chop(1);
+    return word;
+}
+
+
+
+// French.  Plurals and the feminine -e.  Accents are already gone, so
+// "aimée", "aimés" & "aime" all come out as "aime".
+QString TextFolding::stemFrench(QString word) {
+    if (word.endsWith("aux") && word.length() > 4)
+        return word.left(word.length()-3) + "al";            // journaux -> journal
+    if (word.endsWith("s") || word.endsWith("x"))
+        word.chop(1);
+    if (word.endsWith("e") && word.length() > 4)
+        word.chop(1);
+    return word;
+}
+
+
+
+// Spanish.  Plurals and the gender ending.
+QString TextFolding::stemSpanish(QString word) {
+    int len = word.length();
+    if (word.endsWith("ces") && len > 4)
+        return word.left(len-3) + "z";                       // luces -> luz
+    if (word.endsWith("es") && len > 4 && !isVowel(word.at(len-3)))
+        word.chop(2);                                        // canciones -> cancion
+    else if (word.endsWith("s") && len > 4 && isVowel(word.at(len-2)))
+        word.chop(1);                                        // casas -> casa
+    if (word.length() > 4 && (word.endsWith("a") || word.endsWith("o") || word.endsWith("e")))
+        word.chop(1);
+    return word;
+}
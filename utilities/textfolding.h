@@ -0,0 +1,62 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef TEXTFOLDING_H
+#define TEXTFOLDING_H
+
+#include <QString>
+#include <QStringList>
+
+
+//*****************************************************************
+//* Normalize text before it goes into SearchIndex and do the same
+//* to the words the user searches for, so the FTS "simple"
+//* tokenizer sees the same tokens on both sides.  Folding does
+//* compatibility (NFKC) normalization, case folding and strips
+//* accents from Latin, Greek & Cyrillic letters, so "Café" and
+//* "cafe" are the same word.  Stemming reduces words to a common
+//* root ("notes", "noted" & "noting" all become "note") using a
+//* light stemmer for the language the user picked.
+//*
+//* Stemmed & folded text is what gets stored, so changing either
+//* setting means the whole index has to be rebuilt.  The text as
+//* written is kept in SearchText, and snippet() marks the words in
+//* it that match, so what the user sees isn't folded.
+//*****************************************************************
+class TextFolding
+{
+private:
+    static QString transform(QString text);                  // Fold & stem the words in some text
+    static QString stemEnglish(QString word);
+    static QString stemGerman(QString word);
+    static QString stemFrench(QString word);
+    static QString stemSpanish(QString word);
+
+public:
+    static bool enabled();                                   // Is folding or stemming turned on?
+    static QString fold(QString text);                       // NFKC, case fold & strip accents
+    static QString normalize(QString text);                  // Fold if turned on, otherwise just lower case
+    static QString stem(QString word, QString language);     // Reduce a lower case word to its root
+    static QString index(QString text);                      // The text to store in SearchIndex
+    static QString query(QString term);                      // The FTS term to search for
+    static QString snippet(QString text, QStringList terms, QString startMark,
+                           QString endMark, QString ellipses, int tokens);   // Mark matches in the original text
+};
+
+#endif // TEXTFOLDING_H
@@ -0,0 +1,166 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "zipreader.h"
+#include <QtEndian>
+#include <string.h>
+#if defined(Q_OS_WIN)
+#include <QtZlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+#define ZIP_LOCAL_HEADER_SIGNATURE      0x04034b50
+#define ZIP_CENTRAL_HEADER_SIGNATURE    0x02014b50
+#define ZIP_END_SIGNATURE               0x06054b50
+#define ZIP_LOCAL_HEADER_SIZE           30
+#define ZIP_CENTRAL_HEADER_SIZE         46
+#define ZIP_END_SIZE                    22
+
+
+static quint16 read16(const char *data) {
+    return qFromLittleEndian<quint16>(reinterpret_cast<const uchar*>(data));
+}
+
+static quint32 read32(const char *data) {
+    return qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(data));
+}
+
+
+
+ZipReader::ZipReader(QString fileName) : file(fileName) {
+    valid = file.open(QIODevice::ReadOnly) && readDirectory();
+}
+
+
+
+// Read the central directory at the end of the file
+bool ZipReader::readDirectory() {
+    // The end record is followed by a comment of up to 64K
+    qint64 size = file.size();
+    qint64 tail = qMin(size, qint64(ZIP_END_SIZE + 0xFFFF));
+    if (tail < ZIP_END_SIZE || !file.seek(size-tail))
+        return false;
+    QByteArray end = file.read(tail);
+    int pos = -1;
+    for (int i=end.size()-ZIP_END_SIZE; i>=0 && pos<0; i--) {
+        if (read32(end.constData()+i) == ZIP_END_SIGNATURE)
+            pos = i;
+    }
+    if (pos < 0)
+        return false;
+
+    quint16 count = read16(end.constData()+pos+10);
+    quint32 directorySize = read32(end.constData()+pos+12);
+    quint32 directoryOffset = read32(end.constData()+pos+16);
+    if (directoryOffset == 0xFFFFFFFF || qint64(directoryOffset)+directorySize > size)
+        return false;
+    if (!file.seek(directoryOffset))
+        return false;
+    QByteArray directory = file.read(directorySize);
+    if (directory.size() != int(directorySize))
+        return false;
+
+    const char *data = directory.constData();
+    int offset = 0;
+    for (int i=0; i<count; i++) {
+        if (offset + ZIP_CENTRAL_HEADER_SIZE > directory.size() ||
+                read32(data+offset) != ZIP_CENTRAL_HEADER_SIGNATURE)
+            return false;
+        ZipEntry entry;
+        entry.flags = read16(data+offset+8);
+        entry.method = read16(data+offset+10);
+        entry.compressedSize = read32(data+offset+20);
+        entry.size = read32(data+offset+24);
+        quint16 nameLength = read16(data+offset+28);
+        quint16 extraLength = read16(data+offset+30);
+        quint16 commentLength = read16(data+offset+32);
+        entry.offset = read32(data+offset+42);
+        if (offset + ZIP_CENTRAL_HEADER_SIZE + nameLength > directory.size())
+            return false;
+        QString name = QString::fromUtf8(data+offset+ZIP_CENTRAL_HEADER_SIZE, nameLength);
+        entries.insert(name, entry);
+        names.append(name);
+        offset = offset + ZIP_CENTRAL_HEADER_SIZE + nameLength + extraLength + commentLength;
+    }
+    return true;
+}
+
+
+
+bool ZipReader::isValid() {
+    return valid;
+}
+
+
+QStringList ZipReader::fileNames() {
+    return names;
+}
+
+
+bool ZipReader::contains(QString name) {
+    return entries.contains(name);
+}
+
+
+
+// Get the uncompressed contents of an entry
+QByteArray ZipReader::fileData(QString name) {
+    if (!valid || !entries.contains(name))
+        return QByteArray();
+    ZipEntry entry = entries.value(name);
+    if ((entry.flags & 0x01) || entry.size > ZIP_MAX_ENTRY_SIZE ||
+            entry.compressedSize > ZIP_MAX_ENTRY_SIZE)
+        return QByteArray();
+
+    if (!file.seek(entry.offset))
+        return QByteArray();
+    QByteArray header = file.read(ZIP_LOCAL_HEADER_SIZE);
+    if (header.size() != ZIP_LOCAL_HEADER_SIZE || read32(header.constData()) != ZIP_LOCAL_HEADER_SIGNATURE)
+        return QByteArray();
+    qint64 start = qint64(entry.offset) + ZIP_LOCAL_HEADER_SIZE +
+            read16(header.constData()+26) + read16(header.constData()+28);
+    if (!file.seek(start))
+        return QByteArray();
+    QByteArray compressed = file.read(entry.compressedSize);
+    if (compressed.size() != int(entry.compressedSize))
+        return QByteArray();
+
+    if (entry.method == 0)
+        return compressed;
+    if (entry.method != 8)
+        return QByteArray();
+
+    // Deflated entries are raw deflate streams, without the zlib header
+    QByteArray data;
+    data.resize(entry.size);
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+        return QByteArray();
+    stream.next_in = reinterpret_cast<Bytef*>(compressed.data());
+    stream.avail_in = compressed.size();
+    stream.next_out = reinterpret_cast<Bytef*>(data.data());
+    stream.avail_out = data.size();
+    int rc = inflate(&stream, Z_FINISH);
+    inflateEnd(&stream);
+    if (rc != Z_STREAM_END || stream.total_out != entry.size)
+        return QByteArray();
+    return data;
+}
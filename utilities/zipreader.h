@@ -0,0 +1,69 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2017 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef ZIPREADER_H
+#define ZIPREADER_H
+
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+
+// Entries bigger than this are not read.  Office documents are a lot
+// smaller, so anything bigger is most likely a zip bomb.
+#define ZIP_MAX_ENTRY_SIZE   (64*1024*1024)
+
+
+// Where an entry is in the archive
+class ZipEntry
+{
+public:
+    quint16 method;               // 0 = stored, 8 = deflated
+    quint16 flags;
+    quint32 compressedSize;
+    quint32 size;
+    quint32 offset;               // Offset of the local header
+    ZipEntry() { method = 0; flags = 0; compressedSize = 0; size = 0; offset = 0; }
+};
+
+
+//*****************************************************************
+//* Read the files in a zip archive.  Only what the Office & ODF
+//* formats need is supported: stored & deflated entries, no
+//* encryption, no zip64.
+//*****************************************************************
+class ZipReader
+{
+private:
+    QFile file;
+    QHash<QString, ZipEntry> entries;
+    QStringList names;            // Entry names in the order they are in the archive
+    bool valid;
+    bool readDirectory();
+
+public:
+    ZipReader(QString fileName);
+    bool isValid();
+    QStringList fileNames();
+    bool contains(QString name);
+    QByteArray fileData(QString name);      // Empty if it can't be read
+};
+
+#endif // ZIPREADER_H